@@ -0,0 +1,715 @@
+//***************************************************************************************
+// DynamicBvh.cpp
+//***************************************************************************************
+
+#include "DynamicBvh.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	float SurfaceArea(const XMFLOAT3& min, const XMFLOAT3& max)
+	{
+		float dx = max.x - min.x;
+		float dy = max.y - min.y;
+		float dz = max.z - min.z;
+		return 2.0f*(dx*dy + dy*dz + dz*dx);
+	}
+
+	void Union(const XMFLOAT3& minA, const XMFLOAT3& maxA, const XMFLOAT3& minB, const XMFLOAT3& maxB,
+		XMFLOAT3& min, XMFLOAT3& max)
+	{
+		min = XMFLOAT3(std::min(minA.x, minB.x), std::min(minA.y, minB.y), std::min(minA.z, minB.z));
+		max = XMFLOAT3(std::max(maxA.x, maxB.x), std::max(maxA.y, maxB.y), std::max(maxA.z, maxB.z));
+	}
+
+	float UnionArea(const XMFLOAT3& minA, const XMFLOAT3& maxA, const XMFLOAT3& minB, const XMFLOAT3& maxB)
+	{
+		XMFLOAT3 min, max;
+		Union(minA, maxA, minB, maxB, min, max);
+		return SurfaceArea(min, max);
+	}
+
+	bool Equal(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	float Component(const XMFLOAT3& v, int axis)
+	{
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+
+	// Narrows [enter, exit] to where the ray is between one axis' planes, or
+	// returns false if it never is.  A ray parallel to the planes is between
+	// them everywhere or nowhere; it is tested directly because an origin on
+	// a plane would make (min - origin)*invDirection 0*inf = NaN.
+	bool ClipSlab(float min, float max, float origin, float invDirection, float& enter, float& exit)
+	{
+		if(std::isinf(invDirection))
+			return origin >= min && origin <= max;
+
+		float t1 = (min - origin)*invDirection;
+		float t2 = (max - origin)*invDirection;
+		enter = std::max(enter, std::min(t1, t2));
+		exit = std::min(exit, std::max(t1, t2));
+		return true;
+	}
+
+	// Distance along the ray to where it enters [min, max], clipped to
+	// [0, maxDistance], or FLT_MAX when it misses.
+	float RayEnter(const XMFLOAT3& min, const XMFLOAT3& max, const XMFLOAT3& origin,
+		const XMFLOAT3& invDirection, float maxDistance)
+	{
+		float enter = 0.0f;
+		float exit = maxDistance;
+
+		if(!ClipSlab(min.x, max.x, origin.x, invDirection.x, enter, exit) ||
+			!ClipSlab(min.y, max.y, origin.y, invDirection.y, enter, exit) ||
+			!ClipSlab(min.z, max.z, origin.z, invDirection.z, enter, exit))
+			return FLT_MAX;
+
+		return enter <= exit ? enter : FLT_MAX;
+	}
+}
+
+const DynamicBvh::uint32 DynamicBvh::NullNode;
+const DynamicBvh::uint32 DynamicBvh::SahBinCount;
+
+void DynamicBvh::Clear()
+{
+	mNodes.clear();
+	mRoot = NullNode;
+	mFreeList = NullNode;
+	mLeafCount = 0;
+}
+
+DynamicBvh::uint32 DynamicBvh::AllocateNode()
+{
+	if(mFreeList == NullNode)
+	{
+		mNodes.push_back(Node());
+		return (uint32)mNodes.size() - 1;
+	}
+
+	uint32 node = mFreeList;
+	mFreeList = mNodes[node].Parent;
+	mNodes[node] = Node();
+	return node;
+}
+
+void DynamicBvh::FreeNode(uint32 node)
+{
+	mNodes[node].Parent = mFreeList;
+	mNodes[node].Height = -1;
+	mFreeList = node;
+}
+
+void DynamicBvh::Build(const BoundingBox* boxes, const uint32* items, uint32 count, std::vector<uint32>& proxies)
+{
+	Clear();
+	mNodes.reserve(2*count);
+
+	proxies.resize(count);
+	for(uint32 i = 0; i < count; ++i)
+	{
+		uint32 leaf = AllocateNode();
+		Node& node = mNodes[leaf];
+
+		XMStoreFloat3(&node.Min, XMLoadFloat3(&boxes[i].Center) - XMLoadFloat3(&boxes[i].Extents));
+		XMStoreFloat3(&node.Max, XMLoadFloat3(&boxes[i].Center) + XMLoadFloat3(&boxes[i].Extents));
+		node.Item = items[i];
+
+		proxies[i] = leaf;
+	}
+
+	mLeafCount = count;
+	if(count > 0)
+	{
+		std::vector<uint32> leaves = proxies;
+		mRoot = BuildSubtree(leaves.data(), count);
+		mNodes[mRoot].Parent = NullNode;
+	}
+}
+
+void DynamicBvh::Rebuild()
+{
+	std::vector<uint32> leaves;
+	leaves.reserve(mLeafCount);
+
+	for(uint32 i = 0; i < (uint32)mNodes.size(); ++i)
+	{
+		if(mNodes[i].Height < 0)
+			continue;
+
+		if(mNodes[i].IsLeaf())
+			leaves.push_back(i);
+		else
+			FreeNode(i);
+	}
+
+	mRoot = NullNode;
+	if(!leaves.empty())
+	{
+		mRoot = BuildSubtree(leaves.data(), (uint32)leaves.size());
+		mNodes[mRoot].Parent = NullNode;
+	}
+}
+
+DynamicBvh::uint32 DynamicBvh::BuildSubtree(uint32* leaves, uint32 count)
+{
+	if(count == 1)
+		return leaves[0];
+
+	// Split along the axis the box centers spread widest on (centers are
+	// compared doubled, min + max, to save the halving).
+	XMFLOAT3 centerMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 centerMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for(uint32 i = 0; i < count; ++i)
+	{
+		const Node& leaf = mNodes[leaves[i]];
+		XMFLOAT3 center(leaf.Min.x + leaf.Max.x, leaf.Min.y + leaf.Max.y, leaf.Min.z + leaf.Max.z);
+		Union(centerMin, centerMax, center, center, centerMin, centerMax);
+	}
+
+	XMFLOAT3 spread(centerMax.x - centerMin.x, centerMax.y - centerMin.y, centerMax.z - centerMin.z);
+	int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : (spread.y >= spread.z ? 1 : 2);
+	float axisMin = Component(centerMin, axis);
+	float axisSpread = Component(spread, axis);
+
+	auto center = [&](uint32 leaf)
+	{
+		return Component(mNodes[leaf].Min, axis) + Component(mNodes[leaf].Max, axis);
+	};
+
+	uint32 leftCount = 0;
+	if(axisSpread > 0.0f)
+	{
+		auto binOf = [&](uint32 leaf)
+		{
+			uint32 bin = (uint32)((center(leaf) - axisMin) / axisSpread * SahBinCount);
+			return std::min(bin, SahBinCount - 1);
+		};
+
+		struct Bin
+		{
+			XMFLOAT3 Min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+			XMFLOAT3 Max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			uint32 Count = 0;
+		};
+		Bin bins[SahBinCount];
+
+		for(uint32 i = 0; i < count; ++i)
+		{
+			const Node& leaf = mNodes[leaves[i]];
+			Bin& bin = bins[binOf(leaves[i])];
+			Union(bin.Min, bin.Max, leaf.Min, leaf.Max, bin.Min, bin.Max);
+			bin.Count++;
+		}
+
+		// Cost of splitting after bin b: area times count on either side.
+		float rightCost[SahBinCount];
+		Bin right;
+		for(uint32 b = SahBinCount - 1; b > 0; --b)
+		{
+			Union(right.Min, right.Max, bins[b].Min, bins[b].Max, right.Min, right.Max);
+			right.Count += bins[b].Count;
+			rightCost[b - 1] = right.Count > 0 ? SurfaceArea(right.Min, right.Max)*right.Count : 0.0f;
+		}
+
+		float bestCost = FLT_MAX;
+		uint32 bestBin = 0;
+		Bin left;
+		for(uint32 b = 0; b + 1 < SahBinCount; ++b)
+		{
+			Union(left.Min, left.Max, bins[b].Min, bins[b].Max, left.Min, left.Max);
+			left.Count += bins[b].Count;
+			if(left.Count == 0 || left.Count == count)
+				continue;
+
+			float cost = SurfaceArea(left.Min, left.Max)*left.Count + rightCost[b];
+			if(cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = b;
+			}
+		}
+
+		if(bestCost < FLT_MAX)
+		{
+			uint32* middle = std::partition(leaves, leaves + count,
+				[&](uint32 leaf) { return binOf(leaf) <= bestBin; });
+			leftCount = (uint32)(middle - leaves);
+		}
+	}
+
+	// Centers too close to bin: split at the median.
+	if(leftCount == 0)
+	{
+		leftCount = count / 2;
+		std::nth_element(leaves, leaves + leftCount, leaves + count,
+			[&](uint32 a, uint32 b) { return center(a) < center(b); });
+	}
+
+	uint32 leftChild = BuildSubtree(leaves, leftCount);
+	uint32 rightChild = BuildSubtree(leaves + leftCount, count - leftCount);
+
+	uint32 node = AllocateNode();
+	mNodes[node].Left = leftChild;
+	mNodes[node].Right = rightChild;
+	mNodes[leftChild].Parent = node;
+	mNodes[rightChild].Parent = node;
+	UpdateFromChildren(node);
+
+	return node;
+}
+
+DynamicBvh::uint32 DynamicBvh::Insert(const BoundingBox& box, uint32 item)
+{
+	uint32 leaf = AllocateNode();
+	XMStoreFloat3(&mNodes[leaf].Min, XMLoadFloat3(&box.Center) - XMLoadFloat3(&box.Extents));
+	XMStoreFloat3(&mNodes[leaf].Max, XMLoadFloat3(&box.Center) + XMLoadFloat3(&box.Extents));
+	mNodes[leaf].Item = item;
+
+	InsertLeaf(leaf);
+	mLeafCount++;
+
+	return leaf;
+}
+
+void DynamicBvh::Remove(uint32 proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	mLeafCount--;
+}
+
+void DynamicBvh::SetBounds(uint32 proxy, const BoundingBox& box)
+{
+	XMStoreFloat3(&mNodes[proxy].Min, XMLoadFloat3(&box.Center) - XMLoadFloat3(&box.Extents));
+	XMStoreFloat3(&mNodes[proxy].Max, XMLoadFloat3(&box.Center) + XMLoadFloat3(&box.Extents));
+
+	// Refit: ancestors above the first unchanged box are unchanged too.
+	for(uint32 node = mNodes[proxy].Parent; node != NullNode; node = mNodes[node].Parent)
+	{
+		XMFLOAT3 oldMin = mNodes[node].Min;
+		XMFLOAT3 oldMax = mNodes[node].Max;
+		UpdateFromChildren(node);
+
+		if(Equal(oldMin, mNodes[node].Min) && Equal(oldMax, mNodes[node].Max))
+			break;
+	}
+}
+
+BoundingBox DynamicBvh::GetBounds(uint32 proxy)const
+{
+	const Node& leaf = mNodes[proxy];
+
+	BoundingBox box;
+	XMStoreFloat3(&box.Center, 0.5f*(XMLoadFloat3(&leaf.Max) + XMLoadFloat3(&leaf.Min)));
+	XMStoreFloat3(&box.Extents, 0.5f*(XMLoadFloat3(&leaf.Max) - XMLoadFloat3(&leaf.Min)));
+	return box;
+}
+
+void DynamicBvh::InsertLeaf(uint32 leaf)
+{
+	if(mRoot == NullNode)
+	{
+		mRoot = leaf;
+		mNodes[leaf].Parent = NullNode;
+		return;
+	}
+
+	const XMFLOAT3 leafMin = mNodes[leaf].Min;
+	const XMFLOAT3 leafMax = mNodes[leaf].Max;
+
+	// Walk down to the best sibling.  Pairing with node costs the area of
+	// the new parent, and every ancestor grows by as much as node's box
+	// would; descending into a child moves that growth one level down.
+	uint32 node = mRoot;
+	while(!mNodes[node].IsLeaf())
+	{
+		const Node& current = mNodes[node];
+
+		float area = SurfaceArea(current.Min, current.Max);
+		float combinedArea = UnionArea(current.Min, current.Max, leafMin, leafMax);
+
+		float cost = 2.0f*combinedArea;
+		float inheritedCost = 2.0f*(combinedArea - area);
+
+		auto descendCost = [&](uint32 child)
+		{
+			const Node& c = mNodes[child];
+			float grown = UnionArea(c.Min, c.Max, leafMin, leafMax);
+			return (c.IsLeaf() ? grown : grown - SurfaceArea(c.Min, c.Max)) + inheritedCost;
+		};
+
+		float leftCost = descendCost(current.Left);
+		float rightCost = descendCost(current.Right);
+
+		if(cost < leftCost && cost < rightCost)
+			break;
+
+		node = leftCost < rightCost ? current.Left : current.Right;
+	}
+
+	uint32 sibling = node;
+	uint32 oldParent = mNodes[sibling].Parent;
+
+	uint32 newParent = AllocateNode();
+	mNodes[newParent].Parent = oldParent;
+	mNodes[newParent].Left = sibling;
+	mNodes[newParent].Right = leaf;
+	mNodes[sibling].Parent = newParent;
+	mNodes[leaf].Parent = newParent;
+
+	if(oldParent != NullNode)
+		ReplaceChild(oldParent, sibling, newParent);
+	else
+		mRoot = newParent;
+
+	FixUpwards(newParent);
+}
+
+void DynamicBvh::RemoveLeaf(uint32 leaf)
+{
+	if(leaf == mRoot)
+	{
+		mRoot = NullNode;
+		return;
+	}
+
+	uint32 parent = mNodes[leaf].Parent;
+	uint32 grandParent = mNodes[parent].Parent;
+	uint32 sibling = mNodes[parent].Left == leaf ? mNodes[parent].Right : mNodes[parent].Left;
+
+	// The sibling takes the parent's place.
+	mNodes[sibling].Parent = grandParent;
+	FreeNode(parent);
+
+	if(grandParent != NullNode)
+	{
+		ReplaceChild(grandParent, parent, sibling);
+		FixUpwards(grandParent);
+	}
+	else
+	{
+		mRoot = sibling;
+	}
+}
+
+void DynamicBvh::FixUpwards(uint32 node)
+{
+	while(node != NullNode)
+	{
+		node = Balance(node);
+		UpdateFromChildren(node);
+		node = mNodes[node].Parent;
+	}
+}
+
+// If one child of a is more than one level taller than the other, rotates the
+// taller child up into a's place and hands a its taller grandchild-side
+// subtree's shorter half.  Returns the node now at a's position.
+DynamicBvh::uint32 DynamicBvh::Balance(uint32 a)
+{
+	if(mNodes[a].IsLeaf() || mNodes[a].Height < 2)
+		return a;
+
+	uint32 b = mNodes[a].Left;
+	uint32 c = mNodes[a].Right;
+	int balance = mNodes[c].Height - mNodes[b].Height;
+
+	if(balance > 1)
+	{
+		// Rotate c up.
+		uint32 f = mNodes[c].Left;
+		uint32 g = mNodes[c].Right;
+
+		mNodes[c].Left = a;
+		mNodes[c].Parent = mNodes[a].Parent;
+		mNodes[a].Parent = c;
+
+		if(mNodes[c].Parent != NullNode)
+			ReplaceChild(mNodes[c].Parent, a, c);
+		else
+			mRoot = c;
+
+		// a keeps b and takes c's shorter child.
+		uint32 taller = mNodes[f].Height > mNodes[g].Height ? f : g;
+		uint32 shorter = taller == f ? g : f;
+
+		mNodes[c].Right = taller;
+		mNodes[a].Right = shorter;
+		mNodes[shorter].Parent = a;
+
+		UpdateFromChildren(a);
+		UpdateFromChildren(c);
+		return c;
+	}
+
+	if(balance < -1)
+	{
+		// Rotate b up.
+		uint32 d = mNodes[b].Left;
+		uint32 e = mNodes[b].Right;
+
+		mNodes[b].Left = a;
+		mNodes[b].Parent = mNodes[a].Parent;
+		mNodes[a].Parent = b;
+
+		if(mNodes[b].Parent != NullNode)
+			ReplaceChild(mNodes[b].Parent, a, b);
+		else
+			mRoot = b;
+
+		// a keeps c and takes b's shorter child.
+		uint32 taller = mNodes[d].Height > mNodes[e].Height ? d : e;
+		uint32 shorter = taller == d ? e : d;
+
+		mNodes[b].Right = taller;
+		mNodes[a].Left = shorter;
+		mNodes[shorter].Parent = a;
+
+		UpdateFromChildren(a);
+		UpdateFromChildren(b);
+		return b;
+	}
+
+	return a;
+}
+
+void DynamicBvh::UpdateFromChildren(uint32 node)
+{
+	Node& n = mNodes[node];
+	const Node& left = mNodes[n.Left];
+	const Node& right = mNodes[n.Right];
+
+	Union(left.Min, left.Max, right.Min, right.Max, n.Min, n.Max);
+	n.Height = 1 + std::max(left.Height, right.Height);
+}
+
+void DynamicBvh::ReplaceChild(uint32 parent, uint32 oldChild, uint32 newChild)
+{
+	if(mNodes[parent].Left == oldChild)
+		mNodes[parent].Left = newChild;
+	else
+		mNodes[parent].Right = newChild;
+}
+
+float DynamicBvh::GetSahCost()const
+{
+	if(mRoot == NullNode || mNodes[mRoot].IsLeaf())
+		return 0.0f;
+
+	float internalArea = 0.0f;
+	for(const Node& node : mNodes)
+	{
+		if(node.Height > 0)
+			internalArea += SurfaceArea(node.Min, node.Max);
+	}
+
+	return internalArea / SurfaceArea(mNodes[mRoot].Min, mNodes[mRoot].Max);
+}
+
+void DynamicBvh::QueryFrustum(const XMFLOAT4 planes[6], std::vector<uint32>& items)const
+{
+	if(mRoot == NullNode)
+		return;
+
+	XMFLOAT4 absPlanes[6];
+	for(int p = 0; p < 6; ++p)
+		XMStoreFloat4(&absPlanes[p], XMVectorAbs(XMLoadFloat4(&planes[p])));
+
+	// Nodes to visit, each with the planes its box still straddles.
+	const uint32 AllPlanes = 0x3f;
+	std::vector<std::pair<uint32, uint32>> stack;
+	stack.emplace_back(mRoot, AllPlanes);
+
+	std::vector<uint32> inside;
+
+	while(!stack.empty())
+	{
+		uint32 node = stack.back().first;
+		uint32 mask = stack.back().second;
+		stack.pop_back();
+
+		const Node& n = mNodes[node];
+		XMFLOAT3 center(0.5f*(n.Min.x + n.Max.x), 0.5f*(n.Min.y + n.Max.y), 0.5f*(n.Min.z + n.Max.z));
+		XMFLOAT3 extents(0.5f*(n.Max.x - n.Min.x), 0.5f*(n.Max.y - n.Min.y), 0.5f*(n.Max.z - n.Min.z));
+
+		bool outside = false;
+		for(int p = 0; p < 6 && !outside; ++p)
+		{
+			if((mask & (1u << p)) == 0)
+				continue;
+
+			float distance = planes[p].x*center.x + planes[p].y*center.y + planes[p].z*center.z + planes[p].w;
+			float radius = absPlanes[p].x*extents.x + absPlanes[p].y*extents.y + absPlanes[p].z*extents.z;
+
+			if(distance + radius < 0.0f)
+				outside = true;
+			else if(distance - radius >= 0.0f)
+				mask &= ~(1u << p);
+		}
+
+		if(outside)
+			continue;
+
+		if(n.IsLeaf())
+		{
+			items.push_back(n.Item);
+		}
+		else if(mask == 0)
+		{
+			// Entirely inside: every leaf below is visible.
+			inside.push_back(node);
+			while(!inside.empty())
+			{
+				const Node& m = mNodes[inside.back()];
+				inside.pop_back();
+
+				if(m.IsLeaf())
+				{
+					items.push_back(m.Item);
+				}
+				else
+				{
+					inside.push_back(m.Left);
+					inside.push_back(m.Right);
+				}
+			}
+		}
+		else
+		{
+			stack.emplace_back(n.Left, mask);
+			stack.emplace_back(n.Right, mask);
+		}
+	}
+}
+
+void DynamicBvh::QuerySphere(const BoundingSphere& sphere, std::vector<uint32>& items)const
+{
+	if(mRoot == NullNode)
+		return;
+
+	const XMFLOAT3& c = sphere.Center;
+	float radiusSq = sphere.Radius*sphere.Radius;
+
+	std::vector<uint32> stack(1, mRoot);
+	while(!stack.empty())
+	{
+		const Node& n = mNodes[stack.back()];
+		stack.pop_back();
+
+		// Squared distance from the center to the nearest point of the box.
+		float dx = std::max(std::max(n.Min.x - c.x, c.x - n.Max.x), 0.0f);
+		float dy = std::max(std::max(n.Min.y - c.y, c.y - n.Max.y), 0.0f);
+		float dz = std::max(std::max(n.Min.z - c.z, c.z - n.Max.z), 0.0f);
+		if(dx*dx + dy*dy + dz*dz > radiusSq)
+			continue;
+
+		if(n.IsLeaf())
+		{
+			items.push_back(n.Item);
+		}
+		else
+		{
+			stack.push_back(n.Left);
+			stack.push_back(n.Right);
+		}
+	}
+}
+
+void DynamicBvh::QueryBox(const BoundingBox& box, std::vector<uint32>& items)const
+{
+	if(mRoot == NullNode)
+		return;
+
+	XMFLOAT3 min, max;
+	XMStoreFloat3(&min, XMLoadFloat3(&box.Center) - XMLoadFloat3(&box.Extents));
+	XMStoreFloat3(&max, XMLoadFloat3(&box.Center) + XMLoadFloat3(&box.Extents));
+
+	std::vector<uint32> stack(1, mRoot);
+	while(!stack.empty())
+	{
+		const Node& n = mNodes[stack.back()];
+		stack.pop_back();
+
+		if(n.Min.x > max.x || n.Max.x < min.x ||
+			n.Min.y > max.y || n.Max.y < min.y ||
+			n.Min.z > max.z || n.Max.z < min.z)
+			continue;
+
+		if(n.IsLeaf())
+		{
+			items.push_back(n.Item);
+		}
+		else
+		{
+			stack.push_back(n.Left);
+			stack.push_back(n.Right);
+		}
+	}
+}
+
+bool DynamicBvh::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, RayHit& hit)const
+{
+	if(mRoot == NullNode)
+		return false;
+
+	XMFLOAT3 invDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	float best = RayEnter(mNodes[mRoot].Min, mNodes[mRoot].Max, origin, invDirection, maxDistance);
+	if(best == FLT_MAX)
+		return false;
+
+	// Nodes to visit with the distance the ray enters them.
+	std::vector<std::pair<uint32, float>> stack;
+	stack.emplace_back(mRoot, best);
+
+	bool found = false;
+	best = maxDistance;
+
+	while(!stack.empty())
+	{
+		uint32 node = stack.back().first;
+		float enter = stack.back().second;
+		stack.pop_back();
+
+		if(enter > best)
+			continue;
+
+		const Node& n = mNodes[node];
+		if(n.IsLeaf())
+		{
+			best = enter;
+			hit.Proxy = node;
+			hit.Item = n.Item;
+			hit.Distance = enter;
+			found = true;
+			continue;
+		}
+
+		float leftEnter = RayEnter(mNodes[n.Left].Min, mNodes[n.Left].Max, origin, invDirection, best);
+		float rightEnter = RayEnter(mNodes[n.Right].Min, mNodes[n.Right].Max, origin, invDirection, best);
+
+		// Push the farther child first so the nearer one is visited first.
+		uint32 nearChild = n.Left, farChild = n.Right;
+		if(rightEnter < leftEnter)
+		{
+			std::swap(nearChild, farChild);
+			std::swap(leftEnter, rightEnter);
+		}
+
+		if(rightEnter != FLT_MAX)
+			stack.emplace_back(farChild, rightEnter);
+		if(leftEnter != FLT_MAX)
+			stack.emplace_back(nearChild, leftEnter);
+	}
+
+	return found;
+}
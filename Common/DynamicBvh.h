@@ -0,0 +1,144 @@
+//***************************************************************************************
+// DynamicBvh.h
+//
+// A bounding volume hierarchy over axis-aligned boxes for scene queries
+// (frustum culling, picking, proximity) that would otherwise scan every item.
+// Each leaf holds one item's box and a caller value; internal nodes have two
+// children and the union of their boxes.
+//
+//   Build/Rebuild  top-down with the surface area heuristic, binning the box
+//                  centers along the widest axis, for a high quality tree
+//   Insert         descends to the sibling that adds the least surface area
+//                  to the tree (counting the growth of every ancestor), then
+//                  rotates ancestors to keep the tree balanced, so items can
+//                  be added at runtime in any order without degrading it
+//   Remove         unlinks the leaf and collapses its parent
+//   SetBounds      refits: replaces a leaf's box and fixes the ancestors'
+//                  boxes up to the first that did not change
+//
+// Refitting keeps the tree correct for moving items but not optimal; after
+// large motions Rebuild restores SAH quality.  Leaves are Proxies: node
+// indices that stay valid across Insert, Remove, SetBounds and Rebuild until
+// the leaf itself is removed.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <DirectXCollision.h>
+
+class DynamicBvh
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+
+	static const uint32 NullNode = UINT32_MAX;
+
+	// Centroid bins per axis tried by the SAH build.
+	static const uint32 SahBinCount = 16;
+
+	struct RayHit
+	{
+		uint32 Proxy = NullNode;
+		uint32 Item = 0;
+
+		// Distance along the ray's direction to where it enters the box.
+		float Distance = 0.0f;
+	};
+
+	void Clear();
+
+	///<summary>
+	/// Replaces the tree with one over count boxes built with the surface area
+	/// heuristic.  proxies receives the proxy of boxes[i] at index i; items[i]
+	/// is the value queries report for it.
+	///</summary>
+	void Build(const DirectX::BoundingBox* boxes, const uint32* items, uint32 count,
+		std::vector<uint32>& proxies);
+
+	///<summary>
+	/// Rebuilds the internal nodes over the current leaves with the surface
+	/// area heuristic.  Proxies are kept.
+	///</summary>
+	void Rebuild();
+
+	uint32 Insert(const DirectX::BoundingBox& box, uint32 item);
+	void Remove(uint32 proxy);
+
+	///<summary>
+	/// Moves a leaf's box and refits its ancestors.
+	///</summary>
+	void SetBounds(uint32 proxy, const DirectX::BoundingBox& box);
+
+	DirectX::BoundingBox GetBounds(uint32 proxy)const;
+	uint32 GetItem(uint32 proxy)const { return mNodes[proxy].Item; }
+
+	uint32 GetLeafCount()const { return mLeafCount; }
+	uint32 GetHeight()const { return mRoot == NullNode ? 0 : mNodes[mRoot].Height; }
+
+	///<summary>
+	/// Sum of the internal nodes' surface areas over the root's: the expected
+	/// number of internal nodes a random ray visits.  Lower is better.
+	///</summary>
+	float GetSahCost()const;
+
+	///<summary>
+	/// Append to items the items whose boxes are not outside any of planes
+	/// (as FrustumCuller::ExtractFrustumPlanes returns them), intersect
+	/// sphere, or intersect box.  Subtrees entirely inside the frustum are
+	/// gathered without further plane tests.
+	///</summary>
+	void QueryFrustum(const DirectX::XMFLOAT4 planes[6], std::vector<uint32>& items)const;
+	void QuerySphere(const DirectX::BoundingSphere& sphere, std::vector<uint32>& items)const;
+	void QueryBox(const DirectX::BoundingBox& box, std::vector<uint32>& items)const;
+
+	///<summary>
+	/// Finds the box the ray origin + t*direction, 0 <= t <= maxDistance, enters
+	/// first; a ray starting inside a box hits it at 0.  Children are visited
+	/// nearest first and subtrees farther than the best hit are skipped.
+	///</summary>
+	bool Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction,
+		float maxDistance, RayHit& hit)const;
+
+private:
+
+	struct Node
+	{
+		DirectX::XMFLOAT3 Min;
+		DirectX::XMFLOAT3 Max;
+
+		// Parent, or the next free node for nodes on the free list.
+		uint32 Parent = NullNode;
+
+		// NullNode for leaves.
+		uint32 Left = NullNode;
+		uint32 Right = NullNode;
+
+		// Leaves are height 0; -1 marks free nodes.
+		int Height = 0;
+
+		uint32 Item = 0;
+
+		bool IsLeaf()const { return Left == NullNode; }
+	};
+
+	uint32 AllocateNode();
+	void FreeNode(uint32 node);
+
+	uint32 BuildSubtree(uint32* leaves, uint32 count);
+	void InsertLeaf(uint32 leaf);
+	void RemoveLeaf(uint32 leaf);
+
+	// Recomputes the boxes and heights from node to the root, balancing on
+	// the way up.
+	void FixUpwards(uint32 node);
+	uint32 Balance(uint32 node);
+	void UpdateFromChildren(uint32 node);
+	void ReplaceChild(uint32 parent, uint32 oldChild, uint32 newChild);
+
+	std::vector<Node> mNodes;
+	uint32 mRoot = NullNode;
+	uint32 mFreeList = NullNode;
+	uint32 mLeafCount = 0;
+};
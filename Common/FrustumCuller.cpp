@@ -0,0 +1,162 @@
+//***************************************************************************************
+// FrustumCuller.cpp
+//***************************************************************************************
+
+#include "FrustumCuller.h"
+
+using namespace DirectX;
+
+namespace
+{
+	FrustumCuller::uint32 PaddedCount(FrustumCuller::uint32 count)
+	{
+		return (count + 3) & ~3u;
+	}
+}
+
+void FrustumCuller::Boxes::Reserve(uint32 count)
+{
+	uint32 padded = PaddedCount(count);
+	mCenterX.reserve(padded);
+	mCenterY.reserve(padded);
+	mCenterZ.reserve(padded);
+	mExtentX.reserve(padded);
+	mExtentY.reserve(padded);
+	mExtentZ.reserve(padded);
+}
+
+void FrustumCuller::Boxes::Resize(uint32 count)
+{
+	uint32 padded = PaddedCount(count);
+	mCenterX.resize(padded, 0.0f);
+	mCenterY.resize(padded, 0.0f);
+	mCenterZ.resize(padded, 0.0f);
+	mExtentX.resize(padded, 0.0f);
+	mExtentY.resize(padded, 0.0f);
+	mExtentZ.resize(padded, 0.0f);
+
+	// Boxes past the end are empty at the origin, whatever they were before.
+	for(uint32 i = count; i < mCount && i < padded; ++i)
+		Set(i, BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f)));
+
+	mCount = count;
+}
+
+void FrustumCuller::Boxes::PushBack(const BoundingBox& box)
+{
+	Resize(mCount + 1);
+	Set(mCount - 1, box);
+}
+
+void FrustumCuller::Boxes::PopBack()
+{
+	Resize(mCount - 1);
+}
+
+void FrustumCuller::Boxes::Set(uint32 i, const BoundingBox& box)
+{
+	mCenterX[i] = box.Center.x;
+	mCenterY[i] = box.Center.y;
+	mCenterZ[i] = box.Center.z;
+	mExtentX[i] = box.Extents.x;
+	mExtentY[i] = box.Extents.y;
+	mExtentZ[i] = box.Extents.z;
+}
+
+BoundingBox FrustumCuller::Boxes::Get(uint32 i)const
+{
+	return BoundingBox(XMFLOAT3(mCenterX[i], mCenterY[i], mCenterZ[i]),
+		XMFLOAT3(mExtentX[i], mExtentY[i], mExtentZ[i]));
+}
+
+void FrustumCuller::ExtractFrustumPlanes(FXMMATRIX viewProj, XMFLOAT4 planes[6])
+{
+	// With row vectors, clip = p*M, so the clip coordinates are dot products
+	// with the columns of M, i.e. the rows of its transpose.
+	XMMATRIX t = XMMatrixTranspose(viewProj);
+
+	XMStoreFloat4(&planes[0], XMPlaneNormalize(t.r[3] + t.r[0])); // left:   x >= -w
+	XMStoreFloat4(&planes[1], XMPlaneNormalize(t.r[3] - t.r[0])); // right:  x <= w
+	XMStoreFloat4(&planes[2], XMPlaneNormalize(t.r[3] + t.r[1])); // bottom: y >= -w
+	XMStoreFloat4(&planes[3], XMPlaneNormalize(t.r[3] - t.r[1])); // top:    y <= w
+	XMStoreFloat4(&planes[4], XMPlaneNormalize(t.r[2]));          // near:   z >= 0
+	XMStoreFloat4(&planes[5], XMPlaneNormalize(t.r[3] - t.r[2])); // far:    z <= w
+}
+
+FrustumCuller::uint32 FrustumCuller::Cull(const XMFLOAT4 planes[6], const Boxes& boxes, std::vector<uint32>& visible)
+{
+	uint32 count = boxes.GetCount();
+	uint32 padded = PaddedCount(count);
+
+	// Room for every lane of the last group, trimmed below.
+	visible.resize(padded);
+	if(count == 0)
+		return 0;
+
+	// Each plane's components, and the absolute normal, splatted across lanes.
+	XMVECTOR nx[6], ny[6], nz[6], nw[6];
+	XMVECTOR ax[6], ay[6], az[6];
+	for(int p = 0; p < 6; ++p)
+	{
+		XMVECTOR plane = XMLoadFloat4(&planes[p]);
+		XMVECTOR absPlane = XMVectorAbs(plane);
+		nx[p] = XMVectorSplatX(plane);
+		ny[p] = XMVectorSplatY(plane);
+		nz[p] = XMVectorSplatZ(plane);
+		nw[p] = XMVectorSplatW(plane);
+		ax[p] = XMVectorSplatX(absPlane);
+		ay[p] = XMVectorSplatY(absPlane);
+		az[p] = XMVectorSplatZ(absPlane);
+	}
+
+	const float* centerX = boxes.GetCenterX();
+	const float* centerY = boxes.GetCenterY();
+	const float* centerZ = boxes.GetCenterZ();
+	const float* extentX = boxes.GetExtentX();
+	const float* extentY = boxes.GetExtentY();
+	const float* extentZ = boxes.GetExtentZ();
+
+	XMVECTOR zero = XMVectorZero();
+	uint32* out = visible.data();
+	uint32 visibleCount = 0;
+
+	for(uint32 i = 0; i < padded; i += 4)
+	{
+		XMVECTOR cx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(centerX + i));
+		XMVECTOR cy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(centerY + i));
+		XMVECTOR cz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(centerZ + i));
+		XMVECTOR ex = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(extentX + i));
+		XMVECTOR ey = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(extentY + i));
+		XMVECTOR ez = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(extentZ + i));
+
+		XMVECTOR inside = XMVectorTrueInt();
+		for(int p = 0; p < 6; ++p)
+		{
+			XMVECTOR distance = XMVectorMultiplyAdd(nx[p], cx,
+				XMVectorMultiplyAdd(ny[p], cy, XMVectorMultiplyAdd(nz[p], cz, nw[p])));
+			XMVECTOR radius = XMVectorMultiplyAdd(ax[p], ex,
+				XMVectorMultiplyAdd(ay[p], ey, XMVectorMultiply(az[p], ez)));
+
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(distance + radius, zero));
+		}
+
+		uint32 lanes[4];
+		XMStoreInt4(lanes, inside);
+
+		out[visibleCount] = i;
+		visibleCount += lanes[0] & 1;
+		out[visibleCount] = i + 1;
+		visibleCount += lanes[1] & 1;
+		out[visibleCount] = i + 2;
+		visibleCount += lanes[2] & 1;
+		out[visibleCount] = i + 3;
+		visibleCount += lanes[3] & 1;
+	}
+
+	// Padding lanes hold empty boxes that may be inside; they come last.
+	while(visibleCount > 0 && out[visibleCount - 1] >= count)
+		visibleCount--;
+
+	visible.resize(visibleCount);
+	return visibleCount;
+}
@@ -0,0 +1,81 @@
+//***************************************************************************************
+// FrustumCuller.h
+//
+// Culls axis-aligned boxes against the six planes of a view frustum, four boxes
+// per XMVECTOR.  Boxes are kept as a structure of arrays (center x, y, z and
+// extents x, y, z, each in its own array padded to a multiple of four), so a
+// group of four loads with six vector loads and no shuffling.  For each plane
+//
+//   distance = dot(n, center) + w,    radius = dot(|n|, extents)
+//
+// and a box is outside when distance + radius < 0 for any plane.  Survivors
+// are written to the visible list without branches: every lane's index is
+// stored and the write position advances only past the lanes that passed.
+//
+// The test is conservative: a large box crossing two planes outside a corner
+// of the frustum is kept, as with BoundingBox::Intersects against planes.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <DirectXCollision.h>
+
+class FrustumCuller
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+
+	// Boxes as a structure of arrays.
+	class Boxes
+	{
+	public:
+
+		uint32 GetCount()const { return mCount; }
+
+		void Reserve(uint32 count);
+		void Resize(uint32 count);
+		void Clear() { Resize(0); }
+
+		void PushBack(const DirectX::BoundingBox& box);
+		void PopBack();
+
+		void Set(uint32 i, const DirectX::BoundingBox& box);
+		DirectX::BoundingBox Get(uint32 i)const;
+
+		// Arrays of GetCount() rounded up to a multiple of four; the lanes past
+		// GetCount() hold empty boxes at the origin.
+		const float* GetCenterX()const { return mCenterX.data(); }
+		const float* GetCenterY()const { return mCenterY.data(); }
+		const float* GetCenterZ()const { return mCenterZ.data(); }
+		const float* GetExtentX()const { return mExtentX.data(); }
+		const float* GetExtentY()const { return mExtentY.data(); }
+		const float* GetExtentZ()const { return mExtentZ.data(); }
+
+	private:
+
+		uint32 mCount = 0;
+
+		std::vector<float> mCenterX;
+		std::vector<float> mCenterY;
+		std::vector<float> mCenterZ;
+		std::vector<float> mExtentX;
+		std::vector<float> mExtentY;
+		std::vector<float> mExtentZ;
+	};
+
+	///<summary>
+	/// Extracts the six frustum planes (left, right, bottom, top, near, far) of
+	/// a view-projection matrix.  A point p is inside when dot(plane.xyz, p) + plane.w >= 0.
+	/// Pass world*view*proj to get the planes in a mesh's local space.
+	///</summary>
+	static void ExtractFrustumPlanes(DirectX::FXMMATRIX viewProj, DirectX::XMFLOAT4 planes[6]);
+
+	///<summary>
+	/// Fills visible with the indices, in increasing order, of the boxes not
+	/// outside any of planes, and returns how many there are.  planes are as
+	/// ExtractFrustumPlanes returns them, in the boxes' space.
+	///</summary>
+	static uint32 Cull(const DirectX::XMFLOAT4 planes[6], const Boxes& boxes, std::vector<uint32>& visible);
+};
@@ -0,0 +1,217 @@
+//***************************************************************************************
+// GeometryCache.cpp
+//***************************************************************************************
+
+#include "GeometryCache.h"
+#include "MeshOptimizer.h"
+#include <windows.h>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+const GeometryCache::uint32 GeometryCache::FileVersion;
+
+namespace
+{
+	using uint32 = GeometryCache::uint32;
+	using uint64 = GeometryCache::uint64;
+
+	const uint32 FileMagic = 0x434f4547; // "GEOC"
+
+	const uint64 FnvOffsetBasis = 14695981039346656037ull;
+	const uint64 FnvPrime = 1099511628211ull;
+
+	uint64 Fnv1a(uint64 hash, const void* data, size_t size)
+	{
+		const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+		for(size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= FnvPrime;
+		}
+		return hash;
+	}
+
+	struct FileHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		GeometryCache::ShapeType Shape;
+		GeometryCache::ShapeParams Params;
+		uint32 Options;
+		uint32 VertexCount;
+		uint32 IndexCount;
+	};
+}
+
+GeometryCache::GeometryCache(const std::wstring& directory) :
+	mDirectory(directory)
+{
+	if(!mDirectory.empty())
+		CreateDirectoryW(mDirectory.c_str(), nullptr);
+}
+
+std::shared_ptr<const GeometryCache::MeshData> GeometryCache::Get(ShapeType shape, const ShapeParams& params, uint32 options)
+{
+	Key key = { shape, params, options };
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto it = mMeshes.find(key);
+		if(it != mMeshes.end())
+		{
+			mStats.MemoryHits++;
+			return it->second;
+		}
+	}
+
+	// Load or generate without holding the lock, so other shapes are not
+	// held up.  If two threads race on one key the first mesh stored wins.
+	auto meshData = std::make_shared<MeshData>();
+
+	bool loaded = !mDirectory.empty() && Load(key, *meshData);
+	bool saved = false;
+	if(!loaded)
+	{
+		GeometryGenerator geoGen;
+		*meshData = geoGen.Create(shape, params);
+
+		if(options & WeldPositions)
+			MeshOptimizer::Weld(*meshData, 1e-5f, MeshOptimizer::WeldPositionOnly);
+		if(options & OptimizeVertexCache)
+			MeshOptimizer::OptimizeVertexCache(*meshData);
+		if(options & OptimizeVertexFetch)
+			MeshOptimizer::OptimizeVertexFetch(*meshData, sizeof(GeometryGenerator::Vertex));
+
+		saved = !mDirectory.empty() && Save(key, *meshData);
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if(loaded)
+		mStats.DiskHits++;
+	else
+		mStats.Generated++;
+	if(saved)
+		mStats.DiskWrites++;
+
+	return mMeshes.emplace(key, std::move(meshData)).first->second;
+}
+
+void GeometryCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mMeshes.clear();
+}
+
+GeometryCache::Stats GeometryCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+GeometryCache::uint64 GeometryCache::Hash(ShapeType shape, const ShapeParams& params, uint32 options)
+{
+	uint64 hash = FnvOffsetBasis;
+	hash = Fnv1a(hash, &FileVersion, sizeof(FileVersion));
+	hash = Fnv1a(hash, &shape, sizeof(shape));
+	hash = Fnv1a(hash, &params, sizeof(params));
+	hash = Fnv1a(hash, &options, sizeof(options));
+	return hash;
+}
+
+std::string GeometryCache::ToString(const Stats& stats)
+{
+	return "geometry cache: " + std::to_string(stats.MemoryHits) + " memory hits, " +
+		std::to_string(stats.DiskHits) + " disk hits, " +
+		std::to_string(stats.Generated) + " generated, " +
+		std::to_string(stats.DiskWrites) + " written";
+}
+
+bool GeometryCache::Key::operator==(const Key& rhs) const
+{
+	// ShapeParams is all 4 byte fields, so there is no padding to compare.
+	return Shape == rhs.Shape && Options == rhs.Options &&
+		std::memcmp(&Params, &rhs.Params, sizeof(ShapeParams)) == 0;
+}
+
+size_t GeometryCache::KeyHash::operator()(const Key& key) const
+{
+	return (size_t)Hash(key.Shape, key.Params, key.Options);
+}
+
+std::wstring GeometryCache::FilePath(const Key& key) const
+{
+	std::wostringstream path;
+	path << mDirectory << L'/' << std::hex << std::setw(16) << std::setfill(L'0')
+		<< Hash(key.Shape, key.Params, key.Options) << L".geo";
+	return path.str();
+}
+
+bool GeometryCache::Load(const Key& key, MeshData& meshData) const
+{
+	std::ifstream fin(FilePath(key), std::ios::binary);
+	if(!fin)
+		return false;
+
+	FileHeader header;
+	if(!fin.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return false;
+
+	// The key is stored in full, so a hash collision reads as a miss.
+	Key fileKey = { header.Shape, header.Params, header.Options };
+	if(header.Magic != FileMagic || header.Version != FileVersion || !(fileKey == key))
+		return false;
+
+	meshData.Vertices.resize(header.VertexCount);
+	meshData.Indices32.resize(header.IndexCount);
+
+	fin.read(reinterpret_cast<char*>(meshData.Vertices.data()), header.VertexCount*sizeof(GeometryGenerator::Vertex));
+	fin.read(reinterpret_cast<char*>(meshData.Indices32.data()), header.IndexCount*sizeof(uint32));
+	if(!fin)
+	{
+		meshData = MeshData();
+		return false;
+	}
+
+	return true;
+}
+
+bool GeometryCache::Save(const Key& key, const MeshData& meshData) const
+{
+	FileHeader header;
+	header.Magic = FileMagic;
+	header.Version = FileVersion;
+	header.Shape = key.Shape;
+	header.Params = key.Params;
+	header.Options = key.Options;
+	header.VertexCount = (uint32)meshData.Vertices.size();
+	header.IndexCount = (uint32)meshData.Indices32.size();
+
+	// Write to a temporary file and rename it, so an interrupted write never
+	// leaves a truncated mesh behind under the real name.
+	std::wstring path = FilePath(key);
+	std::wstring tempPath = path + L".tmp";
+	{
+		std::ofstream fout(tempPath, std::ios::binary | std::ios::trunc);
+		fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		fout.write(reinterpret_cast<const char*>(meshData.Vertices.data()), meshData.Vertices.size()*sizeof(GeometryGenerator::Vertex));
+		fout.write(reinterpret_cast<const char*>(meshData.Indices32.data()), meshData.Indices32.size()*sizeof(uint32));
+		if(!fout.flush())
+		{
+			fout.close();
+			DeleteFileW(tempPath.c_str());
+			return false;
+		}
+	}
+
+	if(!MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileW(tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
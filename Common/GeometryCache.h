@@ -0,0 +1,105 @@
+//***************************************************************************************
+// GeometryCache.h
+//
+// Memoizes GeometryGenerator output.  Meshes are keyed on the shape, its
+// ShapeParams and the post-processing options, and handed out as shared
+// immutable MeshData, so asking twice for CreateBox(1,1,1,3) generates it once.
+//
+// With a cache directory, every generated mesh is also written there as
+// <key hash>.geo and read back on later launches instead of being generated.
+// Bump FileVersion whenever GeometryGenerator or MeshOptimizer output changes,
+// so stale files are ignored.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class GeometryCache
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+	using uint64 = std::uint64_t;
+	using MeshData = GeometryGenerator::MeshData;
+	using ShapeType = GeometryGenerator::ShapeType;
+	using ShapeParams = GeometryGenerator::ShapeParams;
+
+	static const uint32 FileVersion = 2;
+
+	// Post-processing applied before a mesh is cached; part of the key.
+	enum Options : uint32
+	{
+		None = 0,
+		OptimizeVertexCache = 1 << 0,	// MeshOptimizer::OptimizeVertexCache
+		OptimizeVertexFetch = 1 << 1,	// MeshOptimizer::OptimizeVertexFetch
+		WeldPositions = 1 << 2			// MeshOptimizer::Weld on position only, first
+	};
+
+	struct Stats
+	{
+		uint32 MemoryHits = 0;
+		uint32 DiskHits = 0;
+		uint32 Generated = 0;
+		uint32 DiskWrites = 0;
+	};
+
+	///<summary>
+	/// An empty directory keeps the cache in memory only.  Otherwise the
+	/// directory is created if it does not exist.
+	///</summary>
+	explicit GeometryCache(const std::wstring& directory = L"");
+
+	GeometryCache(const GeometryCache& rhs) = delete;
+	GeometryCache& operator=(const GeometryCache& rhs) = delete;
+
+	///<summary>
+	/// Returns the mesh from memory, then from disk, generating it only if
+	/// neither has it.  Safe to call from several threads.
+	///</summary>
+	std::shared_ptr<const MeshData> Get(ShapeType shape, const ShapeParams& params, uint32 options = None);
+
+	///<summary>
+	/// Drops the in-memory meshes; meshes still referenced stay alive.
+	///</summary>
+	void Clear();
+
+	Stats GetStats() const;
+
+	///<summary>
+	/// 64-bit FNV-1a hash of the key, also used as the cache file name.
+	///</summary>
+	static uint64 Hash(ShapeType shape, const ShapeParams& params, uint32 options);
+
+	static std::string ToString(const Stats& stats);
+
+private:
+
+	struct Key
+	{
+		ShapeType Shape;
+		ShapeParams Params;
+		uint32 Options;
+
+		bool operator==(const Key& rhs) const;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+
+	std::wstring FilePath(const Key& key) const;
+	bool Load(const Key& key, MeshData& meshData) const;
+	bool Save(const Key& key, const MeshData& meshData) const;
+
+	std::wstring mDirectory;
+
+	mutable std::mutex mMutex;
+	std::unordered_map<Key, std::shared_ptr<const MeshData>, KeyHash> mMeshes;
+	Stats mStats;
+};
@@ -3,24 +3,539 @@
 //***************************************************************************************
 
 #include "GeometryGenerator.h"
+#include "Parallel.h"
+#include "TangentSpace.h"
 #include <algorithm>
+#include <unordered_map>
 
 using namespace DirectX;
 
+const GeometryGenerator::uint32 GeometryGenerator::StripRestart;
+
+namespace
+{
+	using uint32 = GeometryGenerator::uint32;
+
+	// Subdivision is capped because each level multiplies the triangle count by 4.
+	const uint32 MaxSubdivisions = 6;
+
+	// Base meshes that are subdivided with shared edge midpoints.  The box has a
+	// quad (two triangles) per face, the pyramid a quad base and four sides.
+
+	const uint32 BoxIndices[36] =
+	{
+		0, 1, 2,    0, 2, 3,    // front
+		4, 5, 6,    4, 6, 7,    // back
+		8, 9, 10,   8, 10, 11,  // top
+		12, 13, 14, 12, 14, 15, // bottom
+		16, 17, 18, 16, 18, 19, // left
+		20, 21, 22, 20, 22, 23  // right
+	};
+
+	const uint32 IcosahedronIndices[60] =
+	{
+		1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
+		1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
+		3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+		10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
+	};
+
+	const uint32 PyramidIndices[18] =
+	{
+		0, 2, 1,  0, 3, 2, // base
+		0, 1, 4,  1, 2, 4,  2, 3, 4,  3, 0, 4 // sides
+	};
+
+	// Unique edges of a base mesh, smaller vertex index first.  Base meshes are
+	// tiny, so a fixed array keeps generation free of heap allocations.
+	struct BaseEdges
+	{
+		static const uint32 MaxCount = 64;
+
+		uint32 A[MaxCount];
+		uint32 B[MaxCount];
+		uint32 Count = 0;
+
+		uint32 Find(uint32 a, uint32 b) const
+		{
+			uint32 lo = std::min(a, b);
+			uint32 hi = std::max(a, b);
+			for(uint32 e = 0; e < Count; ++e)
+			{
+				if(A[e] == lo && B[e] == hi)
+					return e;
+			}
+
+			return Count;
+		}
+	};
+
+	void FindBaseEdges(const uint32* indices, uint32 indexCount, BaseEdges& edges)
+	{
+		edges.Count = 0;
+		for(uint32 i = 0; i < indexCount; i += 3)
+		{
+			for(uint32 c = 0; c < 3; ++c)
+			{
+				uint32 a = indices[i + c];
+				uint32 b = indices[i + (c + 1)%3];
+				if(edges.Find(a, b) == edges.Count)
+				{
+					edges.A[edges.Count] = std::min(a, b);
+					edges.B[edges.Count] = std::max(a, b);
+					edges.Count++;
+				}
+			}
+		}
+	}
+
+	// Attributes at a + (b-a)*wb + (c-a)*wc.  Unit vectors are renormalized,
+	// as MidPoint does.
+	GeometryGenerator::Vertex Interpolate(const GeometryGenerator::Vertex& a, const GeometryGenerator::Vertex& b,
+		const GeometryGenerator::Vertex& c, float wb, float wc)
+	{
+		XMVECTOR vb = XMVectorReplicate(wb);
+		XMVECTOR vc = XMVectorReplicate(wc);
+
+		auto lerp = [&](XMVECTOR x, XMVECTOR y, XMVECTOR z)
+		{
+			return XMVectorMultiplyAdd(z - x, vc, XMVectorMultiplyAdd(y - x, vb, x));
+		};
+
+		GeometryGenerator::Vertex v;
+		XMStoreFloat3(&v.Position, lerp(XMLoadFloat3(&a.Position), XMLoadFloat3(&b.Position), XMLoadFloat3(&c.Position)));
+		XMStoreFloat3(&v.Normal, XMVector3Normalize(lerp(XMLoadFloat3(&a.Normal), XMLoadFloat3(&b.Normal), XMLoadFloat3(&c.Normal))));
+		XMStoreFloat3(&v.TangentU, XMVector3Normalize(lerp(XMLoadFloat3(&a.TangentU), XMLoadFloat3(&b.TangentU), XMLoadFloat3(&c.TangentU))));
+		XMStoreFloat2(&v.TexC, lerp(XMLoadFloat2(&a.TexC), XMLoadFloat2(&b.TexC), XMLoadFloat2(&c.TexC)));
+
+		return v;
+	}
+}
+
+GeometryGenerator::ShapeParams GeometryGenerator::ShapeParams::Box(float width, float height, float depth, uint32 numSubdivisions)
+{
+	ShapeParams params;
+	params.Width = width;
+	params.Height = height;
+	params.Depth = depth;
+	params.NumSubdivisions = numSubdivisions;
+	return params;
+}
+
+GeometryGenerator::ShapeParams GeometryGenerator::ShapeParams::Sphere(float radius, uint32 sliceCount, uint32 stackCount)
+{
+	ShapeParams params;
+	params.Radius = radius;
+	params.SliceCount = sliceCount;
+	params.StackCount = stackCount;
+	return params;
+}
+
+GeometryGenerator::ShapeParams GeometryGenerator::ShapeParams::Geosphere(float radius, uint32 numSubdivisions)
+{
+	ShapeParams params;
+	params.Radius = radius;
+	params.NumSubdivisions = numSubdivisions;
+	return params;
+}
+
+GeometryGenerator::ShapeParams GeometryGenerator::ShapeParams::Cylinder(float bottomRadius, float topRadius, float height,
+	uint32 sliceCount, uint32 stackCount)
+{
+	ShapeParams params;
+	params.Radius = bottomRadius;
+	params.TopRadius = topRadius;
+	params.Height = height;
+	params.SliceCount = sliceCount;
+	params.StackCount = stackCount;
+	return params;
+}
+
+GeometryGenerator::ShapeParams GeometryGenerator::ShapeParams::Grid(float width, float depth, uint32 m, uint32 n)
+{
+	ShapeParams params;
+	params.Width = width;
+	params.Depth = depth;
+	params.Rows = m;
+	params.Columns = n;
+	return params;
+}
+
+GeometryGenerator::ShapeParams GeometryGenerator::ShapeParams::Quad(float x, float y, float w, float h, float depth)
+{
+	ShapeParams params;
+	params.X = x;
+	params.Y = y;
+	params.Width = w;
+	params.Height = h;
+	params.Depth = depth;
+	return params;
+}
+
+GeometryGenerator::ShapeParams GeometryGenerator::ShapeParams::Cone(float bottomRadius, float height, uint32 sliceCount)
+{
+	ShapeParams params;
+	params.Radius = bottomRadius;
+	params.Height = height;
+	params.SliceCount = sliceCount;
+	return params;
+}
+
+GeometryGenerator::ShapeParams GeometryGenerator::ShapeParams::Wedge(float width, float height, float depth, uint32 numSubdivisions)
+{
+	ShapeParams params;
+	params.Width = width;
+	params.Height = height;
+	params.Depth = depth;
+	params.NumSubdivisions = numSubdivisions;
+	return params;
+}
+
+GeometryGenerator::ShapeParams GeometryGenerator::ShapeParams::Torus(float radius, float tubeRadius, uint32 sliceCount, uint32 tubeSliceCount)
+{
+	ShapeParams params;
+	params.Radius = radius;
+	params.TubeRadius = tubeRadius;
+	params.SliceCount = sliceCount;
+	params.StackCount = tubeSliceCount;
+	return params;
+}
+
+GeometryGenerator::ShapeParams GeometryGenerator::ShapeParams::Pyramid(float baseWidth, float height, uint32 numSubdivisions)
+{
+	ShapeParams params;
+	params.Width = baseWidth;
+	params.Height = height;
+	params.NumSubdivisions = numSubdivisions;
+	return params;
+}
+
+GeometryGenerator::MeshCounts GeometryGenerator::QueryCounts(ShapeType shape, const ShapeParams& params)
+{
+	MeshCounts counts;
+
+	uint32 numSubdivisions = std::min(params.NumSubdivisions, MaxSubdivisions);
+	uint32 slices = params.SliceCount;
+	uint32 stacks = params.StackCount;
+
+	switch(shape)
+	{
+	case ShapeType::Box:
+		return SubdividedCounts(24, BoxIndices, 36, numSubdivisions);
+
+	case ShapeType::Sphere:
+		// Two poles plus a ring per inner stack; the ring duplicates its first
+		// vertex because the texture coordinates differ at the seam.
+		counts.VertexCount = 2 + (stacks - 1)*(slices + 1);
+		counts.IndexCount = 6*slices*(stacks - 1);
+		break;
+
+	case ShapeType::Geosphere:
+		return SubdividedCounts(12, IcosahedronIndices, 60, numSubdivisions);
+
+	case ShapeType::Cylinder:
+		// Side rings, then a ring and a center vertex per cap.
+		counts.VertexCount = (stacks + 1)*(slices + 1) + 2*(slices + 2);
+		counts.IndexCount = 6*slices*stacks + 6*slices;
+		break;
+
+	case ShapeType::Grid:
+		counts.VertexCount = params.Rows*params.Columns;
+		counts.IndexCount = 6*(params.Rows - 1)*(params.Columns - 1);
+		break;
+
+	case ShapeType::Quad:
+		counts.VertexCount = 4;
+		counts.IndexCount = 6;
+		break;
+
+	case ShapeType::Cone:
+		slices = std::max(slices, 3u);
+		counts.VertexCount = 1 + slices;
+		counts.IndexCount = 3*slices + 3*(slices - 2);
+		break;
+
+	case ShapeType::Wedge:
+		counts.VertexCount = 6;
+		counts.IndexCount = 24;
+		break;
+
+	case ShapeType::Torus:
+		counts.VertexCount = (slices + 1)*(stacks + 1);
+		counts.IndexCount = 6*slices*stacks;
+		break;
+
+	case ShapeType::Pyramid:
+	case ShapeType::Diamond:
+	case ShapeType::Diamond1:
+		return SubdividedCounts(5, PyramidIndices, 18, numSubdivisions);
+	}
+
+	return counts;
+}
+
+void GeometryGenerator::Generate(ShapeType shape, const ShapeParams& params, Vertex* vertices, uint32* indices)
+{
+	switch(shape)
+	{
+	case ShapeType::Box:       GenerateBox(params, vertices, indices); break;
+	case ShapeType::Sphere:    GenerateSphere(params, vertices, indices); break;
+	case ShapeType::Geosphere: GenerateGeosphere(params, vertices, indices); break;
+	case ShapeType::Cylinder:  GenerateCylinder(params, vertices, indices); break;
+	case ShapeType::Grid:      GenerateGrid(params, vertices, indices); break;
+	case ShapeType::Quad:      GenerateQuad(params, vertices, indices); break;
+	case ShapeType::Cone:      GenerateCone(params, vertices, indices); break;
+	case ShapeType::Wedge:     GenerateWedge(params, vertices, indices); break;
+	case ShapeType::Torus:     GenerateTorus(params, vertices, indices); break;
+	case ShapeType::Pyramid:
+	case ShapeType::Diamond:
+	case ShapeType::Diamond1:  GeneratePyramid(params, vertices, indices); break;
+	}
+
+	// These shapes write no normals, or one per face that their shared
+	// vertices cannot hold, so derive them and the tangents from the triangles.
+	if(shape == ShapeType::Cone || shape == ShapeType::Wedge || shape == ShapeType::Pyramid ||
+		shape == ShapeType::Diamond || shape == ShapeType::Diamond1)
+	{
+		MeshCounts counts = QueryCounts(shape, params);
+		TangentSpace::ComputeTangentFramesInPlace(vertices, counts.VertexCount, indices, counts.IndexCount);
+	}
+}
+
+GeometryGenerator::MeshData GeometryGenerator::Create(ShapeType shape, const ShapeParams& params)
+{
+	MeshCounts counts = QueryCounts(shape, params);
+
+	MeshData meshData;
+	meshData.Vertices.resize(counts.VertexCount);
+	meshData.Indices32.resize(counts.IndexCount);
+
+	Generate(shape, params, meshData.Vertices.data(), meshData.Indices32.data());
+
+	return meshData;
+}
+
+GeometryGenerator::MeshCounts GeometryGenerator::LayoutBatch(ShapeRequest* requests, size_t requestCount)
+{
+	MeshCounts total;
+
+	for(size_t i = 0; i < requestCount; ++i)
+	{
+		ShapeRequest& request = requests[i];
+		MeshCounts counts = QueryCounts(request.Shape, request.Params);
+
+		request.IndexCount = counts.IndexCount;
+		request.StartIndexLocation = total.IndexCount;
+		request.BaseVertexLocation = total.VertexCount;
+		request.VertexCount = counts.VertexCount;
+
+		total.VertexCount += counts.VertexCount;
+		total.IndexCount += counts.IndexCount;
+	}
+
+	return total;
+}
+
+void GeometryGenerator::GenerateBatch(const ShapeRequest* requests, size_t requestCount,
+	Vertex* vertices, uint32* indices)
+{
+	// Generate only reads its arguments and writes its own region, so the
+	// shapes need no locking.  Shapes are handed out one at a time because
+	// their costs differ by orders of magnitude.
+	Parallel::ForEach(requestCount, [&](size_t i)
+	{
+		const ShapeRequest& request = requests[i];
+		Generate(request.Shape, request.Params,
+			vertices + request.BaseVertexLocation, indices + request.StartIndexLocation);
+	});
+}
+
+GeometryGenerator::MeshData GeometryGenerator::GenerateBatch(ShapeRequest* requests, size_t requestCount)
+{
+	MeshCounts total = LayoutBatch(requests, requestCount);
+
+	MeshData meshData;
+	meshData.Vertices.resize(total.VertexCount);
+	meshData.Indices32.resize(total.IndexCount);
+
+	GenerateBatch(requests, requestCount, meshData.Vertices.data(), meshData.Indices32.data());
+
+	return meshData;
+}
+
 GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
 {
-    MeshData meshData;
+	return Create(ShapeType::Box, ShapeParams::Box(width, height, depth, numSubdivisions));
+}
 
+GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount)
+{
+	return Create(ShapeType::Sphere, ShapeParams::Sphere(radius, sliceCount, stackCount));
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions)
+{
+	return Create(ShapeType::Geosphere, ShapeParams::Geosphere(radius, numSubdivisions));
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
+{
+	return Create(ShapeType::Cylinder, ShapeParams::Cylinder(bottomRadius, topRadius, height, sliceCount, stackCount));
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n)
+{
+	return Create(ShapeType::Grid, ShapeParams::Grid(width, depth, m, n));
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth)
+{
+	return Create(ShapeType::Quad, ShapeParams::Quad(x, y, w, h, depth));
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateCone(float bottomRadius, float height, uint32_t sliceCount)
+{
+	return Create(ShapeType::Cone, ShapeParams::Cone(bottomRadius, height, sliceCount));
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateWedge(float width, float height, float depth, uint32 numSubdivisions)
+{
+	return Create(ShapeType::Wedge, ShapeParams::Wedge(width, height, depth, numSubdivisions));
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateTorus(float radius, float tubeRadius, uint32 sliceCount, uint32 tubeSliceCount)
+{
+	return Create(ShapeType::Torus, ShapeParams::Torus(radius, tubeRadius, sliceCount, tubeSliceCount));
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreatePyramid(float baseWidth, float height, uint32 numSubdivisions)
+{
+	return Create(ShapeType::Pyramid, ShapeParams::Pyramid(baseWidth, height, numSubdivisions));
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateDiamond(float baseWidth, float height, uint32 numSubdivisions)
+{
+	return Create(ShapeType::Diamond, ShapeParams::Pyramid(baseWidth, height, numSubdivisions));
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateDiamond1(float baseWidth, float height, uint32 numSubdivisions)
+{
+	return Create(ShapeType::Diamond1, ShapeParams::Pyramid(baseWidth, height, numSubdivisions));
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateGridStrip(float width, float depth, uint32 m, uint32 n)
+{
+	ShapeParams params = ShapeParams::Grid(width, depth, m, n);
+
+	MeshData meshData;
+	meshData.Vertices.resize(QueryCounts(ShapeType::Grid, params).VertexCount);
+	GenerateGrid(params, meshData.Vertices.data(), nullptr);
+
+	std::vector<uint32>& strip = meshData.Indices32;
+	strip.reserve((m - 1)*(2*n + 1));
+
+	// Row i+1 leads so the strip keeps the list's clockwise winding.
+	for(uint32 i = 0; i + 1 < m; ++i)
+		AppendQuadStrip((i + 1)*n, i*n, n, strip);
+
+	return meshData;
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateSphereStrip(float radius, uint32 sliceCount, uint32 stackCount)
+{
+	ShapeParams params = ShapeParams::Sphere(radius, sliceCount, stackCount);
+
+	MeshData meshData;
+	meshData.Vertices.resize(QueryCounts(ShapeType::Sphere, params).VertexCount);
+	GenerateSphere(params, meshData.Vertices.data(), nullptr);
+
+	uint32 ringVertexCount = sliceCount + 1;
+	uint32 southPoleIndex = 1 + (stackCount - 1)*ringVertexCount;
+
+	std::vector<uint32>& strip = meshData.Indices32;
+	strip.reserve(2*(2*sliceCount + 2) + (stackCount - 2)*(2*ringVertexCount + 1));
+
+	AppendFanStrip(0, 1, ringVertexCount, true, strip);
+
+	// Inner stacks, ring i+1 leading as for the grid.
+	for(uint32 i = 0; i + 2 < stackCount; ++i)
+		AppendQuadStrip(1 + (i + 1)*ringVertexCount, 1 + i*ringVertexCount, ringVertexCount, strip);
+
+	AppendFanStrip(southPoleIndex, southPoleIndex - ringVertexCount, ringVertexCount, false, strip);
+
+	return meshData;
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateCylinderStrip(float bottomRadius, float topRadius, float height,
+	uint32 sliceCount, uint32 stackCount)
+{
+	ShapeParams params = ShapeParams::Cylinder(bottomRadius, topRadius, height, sliceCount, stackCount);
+
+	MeshData meshData;
+	meshData.Vertices.resize(QueryCounts(ShapeType::Cylinder, params).VertexCount);
+	GenerateCylinder(params, meshData.Vertices.data(), nullptr);
+
+	uint32 ringVertexCount = sliceCount + 1;
+	uint32 sideVertexCount = (stackCount + 1)*ringVertexCount;
+	uint32 capVertexCount = ringVertexCount + 1;
+
+	std::vector<uint32>& strip = meshData.Indices32;
+	strip.reserve(stackCount*(2*ringVertexCount + 1) + 2*(2*sliceCount + 2));
+
+	// Rings go bottom to top, and the lower ring leads.
+	for(uint32 i = 0; i < stackCount; ++i)
+		AppendQuadStrip(i*ringVertexCount, (i + 1)*ringVertexCount, ringVertexCount, strip);
+
+	// Cap rings are followed by their center vertex; the bottom cap winds the
+	// other way.
+	uint32 topCap = sideVertexCount;
+	uint32 bottomCap = sideVertexCount + capVertexCount;
+	AppendFanStrip(topCap + ringVertexCount, topCap, ringVertexCount, true, strip);
+	AppendFanStrip(bottomCap + ringVertexCount, bottomCap, ringVertexCount, false, strip);
+
+	return meshData;
+}
+
+void GeometryGenerator::AppendQuadStrip(uint32 leadRow, uint32 otherRow, uint32 count, std::vector<uint32>& strip)
+{
+	if(!strip.empty())
+		strip.push_back(StripRestart);
+
+	for(uint32 j = 0; j < count; ++j)
+	{
+		strip.push_back(leadRow + j);
+		strip.push_back(otherRow + j);
+	}
+}
+
+void GeometryGenerator::AppendFanStrip(uint32 center, uint32 ringStart, uint32 count, bool ascending,
+	std::vector<uint32>& strip)
+{
+	if(!strip.empty())
+		strip.push_back(StripRestart);
+
+	// q0, c, q1, c, q2, ... gives the triangles (c, q1, q0), (c, q2, q1), ...
+	// with a degenerate (q1, c, c) and so on between them.
+	for(uint32 k = 0; k < count; ++k)
+	{
+		if(k > 0)
+			strip.push_back(center);
+		strip.push_back(ascending ? ringStart + k : ringStart + count - 1 - k);
+	}
+}
+
+void GeometryGenerator::GenerateBox(const ShapeParams& params, Vertex* vertices, uint32* indices)
+{
     //
 	// Create the vertices.
 	//
 
 	Vertex v[24];
 
-	float w2 = 0.5f*width;
-	float h2 = 0.5f*height;
-	float d2 = 0.5f*depth;
-    
+	float w2 = 0.5f*params.Width;
+	float h2 = 0.5f*params.Height;
+	float d2 = 0.5f*params.Depth;
+
 	// Fill in the front face vertex data.
 	v[0] = Vertex(-w2, -h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 	v[1] = Vertex(-w2, +h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
@@ -57,52 +572,19 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
 	v[22] = Vertex(+w2, +h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f);
 	v[23] = Vertex(+w2, -h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
 
-	meshData.Vertices.assign(&v[0], &v[24]);
- 
-	//
-	// Create the indices.
-	//
-
-	uint32 i[36];
-
-	// Fill in the front face index data
-	i[0] = 0; i[1] = 1; i[2] = 2;
-	i[3] = 0; i[4] = 2; i[5] = 3;
-
-	// Fill in the back face index data
-	i[6] = 4; i[7]  = 5; i[8]  = 6;
-	i[9] = 4; i[10] = 6; i[11] = 7;
-
-	// Fill in the top face index data
-	i[12] = 8; i[13] =  9; i[14] = 10;
-	i[15] = 8; i[16] = 10; i[17] = 11;
-
-	// Fill in the bottom face index data
-	i[18] = 12; i[19] = 13; i[20] = 14;
-	i[21] = 12; i[22] = 14; i[23] = 15;
-
-	// Fill in the left face index data
-	i[24] = 16; i[25] = 17; i[26] = 18;
-	i[27] = 16; i[28] = 18; i[29] = 19;
-
-	// Fill in the right face index data
-	i[30] = 20; i[31] = 21; i[32] = 22;
-	i[33] = 20; i[34] = 22; i[35] = 23;
-
-	meshData.Indices32.assign(&i[0], &i[36]);
-
     // Put a cap on the number of subdivisions.
-    numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+    uint32 numSubdivisions = std::min(params.NumSubdivisions, MaxSubdivisions);
 
-    for(uint32 i = 0; i < numSubdivisions; ++i)
-        Subdivide(meshData);
-
-    return meshData;
+	GenerateSubdivided(v, 24, BoxIndices, 36, numSubdivisions, vertices, indices);
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount)
+void GeometryGenerator::GenerateSphere(const ShapeParams& params, Vertex* vertices, uint32* indices)
 {
-    MeshData meshData;
+	float radius = params.Radius;
+	uint32 sliceCount = params.SliceCount;
+	uint32 stackCount = params.StackCount;
+
+	uint32 ringVertexCount = sliceCount + 1;
 
 	//
 	// Compute the vertices stating at the top pole and moving down the stacks.
@@ -114,47 +596,31 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 	Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 
-	meshData.Vertices.push_back( topVertex );
+	*vertices++ = topVertex;
+
+	RingTable ring;
+	BuildRingTable(sliceCount, ring);
 
 	float phiStep   = XM_PI/stackCount;
-	float thetaStep = 2.0f*XM_PI/sliceCount;
 
 	// Compute vertices for each stack ring (do not count the poles as rings).
+	// A ring at angle phi has radius r*sin(phi) at height r*cos(phi), and its
+	// unit normals are the positions divided by the sphere radius.
 	for(uint32 i = 1; i <= stackCount-1; ++i)
 	{
 		float phi = i*phiStep;
 
-		// Vertices of ring.
-        for(uint32 j = 0; j <= sliceCount; ++j)
-		{
-			float theta = j*thetaStep;
+		float sinPhi, cosPhi;
+		XMScalarSinCos(&sinPhi, &cosPhi, phi);
 
-			Vertex v;
-
-			// spherical to cartesian
-			v.Position.x = radius*sinf(phi)*cosf(theta);
-			v.Position.y = radius*cosf(phi);
-			v.Position.z = radius*sinf(phi)*sinf(theta);
-
-			// Partial derivative of P with respect to theta
-			v.TangentU.x = -radius*sinf(phi)*sinf(theta);
-			v.TangentU.y = 0.0f;
-			v.TangentU.z = +radius*sinf(phi)*cosf(theta);
-
-			XMVECTOR T = XMLoadFloat3(&v.TangentU);
-			XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
-
-			XMVECTOR p = XMLoadFloat3(&v.Position);
-			XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
-
-			v.TexC.x = theta / XM_2PI;
-			v.TexC.y = phi / XM_PI;
-
-			meshData.Vertices.push_back( v );
-		}
+		BuildRing(ring, radius*sinPhi, radius*cosPhi, sinPhi, cosPhi, phi / XM_PI, vertices);
+		vertices += ringVertexCount;
 	}
 
-	meshData.Vertices.push_back( bottomVertex );
+	*vertices++ = bottomVertex;
+
+	if(indices == nullptr)
+		return;
 
 	//
 	// Compute indices for top stack.  The top stack was written first to the vertex buffer
@@ -163,11 +629,11 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 
     for(uint32 i = 1; i <= sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(0);
-		meshData.Indices32.push_back(i+1);
-		meshData.Indices32.push_back(i);
+		*indices++ = 0;
+		*indices++ = i+1;
+		*indices++ = i;
 	}
-	
+
 	//
 	// Compute indices for inner stacks (not connected to poles).
 	//
@@ -175,18 +641,17 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	// Offset the indices to the index of the first vertex in the first ring.
 	// This is just skipping the top pole vertex.
     uint32 baseIndex = 1;
-    uint32 ringVertexCount = sliceCount + 1;
 	for(uint32 i = 0; i < stackCount-2; ++i)
 	{
 		for(uint32 j = 0; j < sliceCount; ++j)
 		{
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
+			*indices++ = baseIndex + i*ringVertexCount + j;
+			*indices++ = baseIndex + i*ringVertexCount + j+1;
+			*indices++ = baseIndex + (i+1)*ringVertexCount + j;
 
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j+1);
+			*indices++ = baseIndex + (i+1)*ringVertexCount + j;
+			*indices++ = baseIndex + i*ringVertexCount + j+1;
+			*indices++ = baseIndex + (i+1)*ringVertexCount + j+1;
 		}
 	}
 
@@ -196,203 +661,136 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	//
 
 	// South pole vertex was added last.
-	uint32 southPoleIndex = (uint32)meshData.Vertices.size()-1;
+	uint32 southPoleIndex = 1 + (stackCount-1)*ringVertexCount;
 
 	// Offset the indices to the index of the first vertex in the last ring.
 	baseIndex = southPoleIndex - ringVertexCount;
-	
-	for(uint32 i = 0; i < sliceCount; ++i)
-	{
-		meshData.Indices32.push_back(southPoleIndex);
-		meshData.Indices32.push_back(baseIndex+i);
-		meshData.Indices32.push_back(baseIndex+i+1);
-	}
-
-    return meshData;
-}
- 
-void GeometryGenerator::Subdivide(MeshData& meshData)
-{
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
-
-
-	meshData.Vertices.resize(0);
-	meshData.Indices32.resize(0);
 
-	//       v1
-	//       *
-	//      / \
-	//     /   \
-	//  m0*-----*m1
-	//   / \   / \
-	//  /   \ /   \
-	// *-----*-----*
-	// v0    m2     v2
-
-	uint32 numTris = (uint32)inputCopy.Indices32.size()/3;
-	for(uint32 i = 0; i < numTris; ++i)
+	for(uint32 i = 0; i < sliceCount; ++i)
 	{
-		Vertex v0 = inputCopy.Vertices[ inputCopy.Indices32[i*3+0] ];
-		Vertex v1 = inputCopy.Vertices[ inputCopy.Indices32[i*3+1] ];
-		Vertex v2 = inputCopy.Vertices[ inputCopy.Indices32[i*3+2] ];
-
-		//
-		// Generate the midpoints.
-		//
-
-        Vertex m0 = MidPoint(v0, v1);
-        Vertex m1 = MidPoint(v1, v2);
-        Vertex m2 = MidPoint(v0, v2);
-
-		//
-		// Add new geometry.
-		//
-
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
- 
-		meshData.Indices32.push_back(i*6+0);
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+5);
-
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+5);
-
-		meshData.Indices32.push_back(i*6+5);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+2);
-
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+1);
-		meshData.Indices32.push_back(i*6+4);
+		*indices++ = southPoleIndex;
+		*indices++ = baseIndex+i;
+		*indices++ = baseIndex+i+1;
 	}
 }
 
-GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Vertex& v1)
+void GeometryGenerator::GenerateGeosphere(const ShapeParams& params, Vertex* vertices, uint32* indices)
 {
-    XMVECTOR p0 = XMLoadFloat3(&v0.Position);
-    XMVECTOR p1 = XMLoadFloat3(&v1.Position);
-
-    XMVECTOR n0 = XMLoadFloat3(&v0.Normal);
-    XMVECTOR n1 = XMLoadFloat3(&v1.Normal);
-
-    XMVECTOR tan0 = XMLoadFloat3(&v0.TangentU);
-    XMVECTOR tan1 = XMLoadFloat3(&v1.TangentU);
-
-    XMVECTOR tex0 = XMLoadFloat2(&v0.TexC);
-    XMVECTOR tex1 = XMLoadFloat2(&v1.TexC);
-
-    // Compute the midpoints of all the attributes.  Vectors need to be normalized
-    // since linear interpolating can make them not unit length.  
-    XMVECTOR pos = 0.5f*(p0 + p1);
-    XMVECTOR normal = XMVector3Normalize(0.5f*(n0 + n1));
-    XMVECTOR tangent = XMVector3Normalize(0.5f*(tan0+tan1));
-    XMVECTOR tex = 0.5f*(tex0 + tex1);
-
-    Vertex v;
-    XMStoreFloat3(&v.Position, pos);
-    XMStoreFloat3(&v.Normal, normal);
-    XMStoreFloat3(&v.TangentU, tangent);
-    XMStoreFloat2(&v.TexC, tex);
-
-    return v;
-}
-
-GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions)
-{
-    MeshData meshData;
+	float radius = params.Radius;
 
 	// Put a cap on the number of subdivisions.
-    numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+    uint32 numSubdivisions = std::min(params.NumSubdivisions, MaxSubdivisions);
 
 	// Approximate a sphere by tessellating an icosahedron.
 
-	const float X = 0.525731f; 
+	const float X = 0.525731f;
 	const float Z = 0.850651f;
 
-	XMFLOAT3 pos[12] = 
+	XMFLOAT3 pos[12] =
 	{
-		XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),  
-		XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),    
-		XMFLOAT3(0.0f, Z, X),   XMFLOAT3(0.0f, Z, -X), 
-		XMFLOAT3(0.0f, -Z, X),  XMFLOAT3(0.0f, -Z, -X),    
-		XMFLOAT3(Z, X, 0.0f),   XMFLOAT3(-Z, X, 0.0f), 
+		XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),
+		XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),
+		XMFLOAT3(0.0f, Z, X),   XMFLOAT3(0.0f, Z, -X),
+		XMFLOAT3(0.0f, -Z, X),  XMFLOAT3(0.0f, -Z, -X),
+		XMFLOAT3(Z, X, 0.0f),   XMFLOAT3(-Z, X, 0.0f),
 		XMFLOAT3(Z, -X, 0.0f),  XMFLOAT3(-Z, -X, 0.0f)
 	};
 
-    uint32 k[60] =
-	{
-		1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,    
-		1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,    
-		3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0, 
-		10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7 
-	};
-
-    meshData.Vertices.resize(12);
-    meshData.Indices32.assign(&k[0], &k[60]);
-
+	// Only the positions matter; everything else is derived after projection.
+	Vertex base[12];
 	for(uint32 i = 0; i < 12; ++i)
-		meshData.Vertices[i].Position = pos[i];
+		base[i] = Vertex(pos[i], XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT2(0.0f, 0.0f));
 
-	for(uint32 i = 0; i < numSubdivisions; ++i)
-		Subdivide(meshData);
+	GenerateSubdivided(base, 12, IcosahedronIndices, 60, numSubdivisions, vertices, indices);
 
 	// Project vertices onto sphere and scale.
-	for(uint32 i = 0; i < meshData.Vertices.size(); ++i)
+	uint32 vertexCount = SubdividedCounts(12, IcosahedronIndices, 60, numSubdivisions).VertexCount;
+	for(uint32 i = 0; i < vertexCount; ++i)
 	{
 		// Project onto unit sphere.
-		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&meshData.Vertices[i].Position));
+		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&vertices[i].Position));
 
 		// Project onto sphere.
 		XMVECTOR p = radius*n;
 
-		XMStoreFloat3(&meshData.Vertices[i].Position, p);
-		XMStoreFloat3(&meshData.Vertices[i].Normal, n);
+		XMStoreFloat3(&vertices[i].Position, p);
+		XMStoreFloat3(&vertices[i].Normal, n);
 
 		// Derive texture coordinates from spherical coordinates.
-        float theta = atan2f(meshData.Vertices[i].Position.z, meshData.Vertices[i].Position.x);
+        float theta = atan2f(vertices[i].Position.z, vertices[i].Position.x);
 
         // Put in [0, 2pi].
         if(theta < 0.0f)
             theta += XM_2PI;
 
-		float phi = acosf(meshData.Vertices[i].Position.y / radius);
+		float phi = acosf(vertices[i].Position.y / radius);
 
-		meshData.Vertices[i].TexC.x = theta/XM_2PI;
-		meshData.Vertices[i].TexC.y = phi/XM_PI;
+		vertices[i].TexC.x = theta/XM_2PI;
+		vertices[i].TexC.y = phi/XM_PI;
 
 		// Partial derivative of P with respect to theta
-		meshData.Vertices[i].TangentU.x = -radius*sinf(phi)*sinf(theta);
-		meshData.Vertices[i].TangentU.y = 0.0f;
-		meshData.Vertices[i].TangentU.z = +radius*sinf(phi)*cosf(theta);
+		vertices[i].TangentU.x = -radius*sinf(phi)*sinf(theta);
+		vertices[i].TangentU.y = 0.0f;
+		vertices[i].TangentU.z = +radius*sinf(phi)*cosf(theta);
 
-		XMVECTOR T = XMLoadFloat3(&meshData.Vertices[i].TangentU);
-		XMStoreFloat3(&meshData.Vertices[i].TangentU, XMVector3Normalize(T));
+		XMVECTOR T = XMLoadFloat3(&vertices[i].TangentU);
+		XMStoreFloat3(&vertices[i].TangentU, XMVector3Normalize(T));
 	}
+}
+
+void GeometryGenerator::GenerateCylinder(const ShapeParams& params, Vertex* vertices, uint32* indices)
+{
+	float bottomRadius = params.Radius;
+	float topRadius = params.TopRadius;
+	float height = params.Height;
+	uint32 sliceCount = params.SliceCount;
+	uint32 stackCount = params.StackCount;
+
+	// Add one because we duplicate the first and last vertex per ring
+	// since the texture coordinates are different.
+	uint32 ringVertexCount = sliceCount+1;
+	uint32 ringCount = stackCount+1;
 
-    return meshData;
-}
+	// Side rings, then a ring and a center vertex per cap.
+	uint32 sideVertexCount = ringCount*ringVertexCount;
+	uint32 capVertexCount = ringVertexCount + 1;
 
-GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
-{
-    MeshData meshData;
+	RingTable ring;
+	BuildRingTable(sliceCount, ring);
 
 	//
 	// Build Stacks.
-	// 
+	//
 
 	float stackHeight = height / stackCount;
 
 	// Amount to increment radius as we move up each stack level from bottom to top.
 	float radiusStep = (topRadius - bottomRadius) / stackCount;
 
-	uint32 ringCount = stackCount+1;
+	// Cylinder can be parameterized as follows, where we introduce v
+	// parameter that goes in the same direction as the v tex-coord
+	// so that the bitangent goes in the same direction as the v tex-coord.
+	//   Let r0 be the bottom radius and let r1 be the top radius.
+	//   y(v) = h - hv for v in [0,1].
+	//   r(v) = r1 + (r0-r1)v
+	//
+	//   x(t, v) = r(v)*cos(t)
+	//   y(t, v) = h - hv
+	//   z(t, v) = r(v)*sin(t)
+	//
+	//  dx/dt = -r(v)*sin(t)
+	//  dy/dt = 0
+	//  dz/dt = +r(v)*cos(t)
+	//
+	//  dx/dv = (r0-r1)*cos(t)
+	//  dy/dv = -h
+	//  dz/dv = (r0-r1)*sin(t)
+	//
+	// The unit tangent is T = (-sin(t), 0, cos(t)) and the normal is
+	// normalize(T x B) = (h*cos(t), r0-r1, h*sin(t)) / sqrt(h^2 + (r0-r1)^2),
+	// which is the same for every ring.
+	float dr = bottomRadius-topRadius;
+	float invLength = 1.0f / sqrtf(height*height + dr*dr);
 
 	// Compute vertices for each stack ring starting at the bottom and moving up.
 	for(uint32 i = 0; i < ringCount; ++i)
@@ -400,160 +798,84 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius
 		float y = -0.5f*height + i*stackHeight;
 		float r = bottomRadius + i*radiusStep;
 
-		// vertices of ring
-		float dTheta = 2.0f*XM_PI/sliceCount;
-		for(uint32 j = 0; j <= sliceCount; ++j)
-		{
-			Vertex vertex;
-
-			float c = cosf(j*dTheta);
-			float s = sinf(j*dTheta);
-
-			vertex.Position = XMFLOAT3(r*c, y, r*s);
-
-			vertex.TexC.x = (float)j/sliceCount;
-			vertex.TexC.y = 1.0f - (float)i/stackCount;
-
-			// Cylinder can be parameterized as follows, where we introduce v
-			// parameter that goes in the same direction as the v tex-coord
-			// so that the bitangent goes in the same direction as the v tex-coord.
-			//   Let r0 be the bottom radius and let r1 be the top radius.
-			//   y(v) = h - hv for v in [0,1].
-			//   r(v) = r1 + (r0-r1)v
-			//
-			//   x(t, v) = r(v)*cos(t)
-			//   y(t, v) = h - hv
-			//   z(t, v) = r(v)*sin(t)
-			// 
-			//  dx/dt = -r(v)*sin(t)
-			//  dy/dt = 0
-			//  dz/dt = +r(v)*cos(t)
-			//
-			//  dx/dv = (r0-r1)*cos(t)
-			//  dy/dv = -h
-			//  dz/dv = (r0-r1)*sin(t)
-
-			// This is unit length.
-			vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
-
-			float dr = bottomRadius-topRadius;
-			XMFLOAT3 bitangent(dr*c, -height, dr*s);
-
-			XMVECTOR T = XMLoadFloat3(&vertex.TangentU);
-			XMVECTOR B = XMLoadFloat3(&bitangent);
-			XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
-			XMStoreFloat3(&vertex.Normal, N);
-
-			meshData.Vertices.push_back(vertex);
-		}
+		BuildRing(ring, r, y, height*invLength, dr*invLength, 1.0f - (float)i/stackCount,
+			&vertices[i*ringVertexCount]);
 	}
 
-	// Add one because we duplicate the first and last vertex per ring
-	// since the texture coordinates are different.
-	uint32 ringVertexCount = sliceCount+1;
+	if(indices == nullptr)
+	{
+		BuildCylinderCap(ring, topRadius, 0.5f*height, +1.0f, height,
+			&vertices[sideVertexCount], sideVertexCount, nullptr);
+		BuildCylinderCap(ring, bottomRadius, -0.5f*height, -1.0f, height,
+			&vertices[sideVertexCount + capVertexCount], sideVertexCount + capVertexCount, nullptr);
+		return;
+	}
 
 	// Compute indices for each stack.
 	for(uint32 i = 0; i < stackCount; ++i)
 	{
 		for(uint32 j = 0; j < sliceCount; ++j)
 		{
-			meshData.Indices32.push_back(i*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j+1);
+			*indices++ = i*ringVertexCount + j;
+			*indices++ = (i+1)*ringVertexCount + j;
+			*indices++ = (i+1)*ringVertexCount + j+1;
 
-			meshData.Indices32.push_back(i*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j+1);
-			meshData.Indices32.push_back(i*ringVertexCount + j+1);
+			*indices++ = i*ringVertexCount + j;
+			*indices++ = (i+1)*ringVertexCount + j+1;
+			*indices++ = i*ringVertexCount + j+1;
 		}
 	}
 
-	BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
-	BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
-
-    return meshData;
+	BuildCylinderCap(ring, topRadius, 0.5f*height, +1.0f, height,
+		&vertices[sideVertexCount], sideVertexCount, indices);
+	BuildCylinderCap(ring, bottomRadius, -0.5f*height, -1.0f, height,
+		&vertices[sideVertexCount + capVertexCount], sideVertexCount + capVertexCount, indices + 3*sliceCount);
 }
 
-void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius, float height,
-											uint32 sliceCount, uint32 stackCount, MeshData& meshData)
+void GeometryGenerator::BuildCylinderCap(const RingTable& ring, float radius, float y, float normalY, float height,
+										 Vertex* vertices, uint32 baseIndex, uint32* indices)
 {
-	uint32 baseIndex = (uint32)meshData.Vertices.size();
-
-	float y = 0.5f*height;
-	float dTheta = 2.0f*XM_PI/sliceCount;
+	uint32 sliceCount = ring.SliceCount;
 
 	// Duplicate cap ring vertices because the texture coordinates and normals differ.
 	for(uint32 i = 0; i <= sliceCount; ++i)
 	{
-		float x = topRadius*cosf(i*dTheta);
-		float z = topRadius*sinf(i*dTheta);
+		float x = radius*ring.Cos[i];
+		float z = radius*ring.Sin[i];
 
 		// Scale down by the height to try and make top cap texture coord area
 		// proportional to base.
 		float u = x/height + 0.5f;
 		float v = z/height + 0.5f;
 
-		meshData.Vertices.push_back( Vertex(x, y, z, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v) );
+		vertices[i] = Vertex(x, y, z, 0.0f, normalY, 0.0f, 1.0f, 0.0f, 0.0f, u, v);
 	}
 
 	// Cap center vertex.
-	meshData.Vertices.push_back( Vertex(0.0f, y, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f) );
-
-	// Index of center vertex.
-	uint32 centerIndex = (uint32)meshData.Vertices.size()-1;
-
-	for(uint32 i = 0; i < sliceCount; ++i)
-	{
-		meshData.Indices32.push_back(centerIndex);
-		meshData.Indices32.push_back(baseIndex + i+1);
-		meshData.Indices32.push_back(baseIndex + i);
-	}
-}
-
-void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadius, float height,
-											   uint32 sliceCount, uint32 stackCount, MeshData& meshData)
-{
-	// 
-	// Build bottom cap.
-	//
+	vertices[sliceCount+1] = Vertex(0.0f, y, 0.0f, 0.0f, normalY, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f);
 
-	uint32 baseIndex = (uint32)meshData.Vertices.size();
-	float y = -0.5f*height;
+	if(indices == nullptr)
+		return;
 
-	// vertices of ring
-	float dTheta = 2.0f*XM_PI/sliceCount;
-	for(uint32 i = 0; i <= sliceCount; ++i)
-	{
-		float x = bottomRadius*cosf(i*dTheta);
-		float z = bottomRadius*sinf(i*dTheta);
-
-		// Scale down by the height to try and make top cap texture coord area
-		// proportional to base.
-		float u = x/height + 0.5f;
-		float v = z/height + 0.5f;
-
-		meshData.Vertices.push_back( Vertex(x, y, z, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v) );
-	}
-
-	// Cap center vertex.
-	meshData.Vertices.push_back( Vertex(0.0f, y, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f) );
-
-	// Cache the index of center vertex.
-	uint32 centerIndex = (uint32)meshData.Vertices.size()-1;
+	// Index of center vertex.
+	uint32 centerIndex = baseIndex + sliceCount+1;
 
+	// The bottom cap faces down, so its triangles wind the other way.
+	uint32 first = normalY > 0.0f ? 1 : 0;
 	for(uint32 i = 0; i < sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(centerIndex);
-		meshData.Indices32.push_back(baseIndex + i);
-		meshData.Indices32.push_back(baseIndex + i+1);
+		*indices++ = centerIndex;
+		*indices++ = baseIndex + i + first;
+		*indices++ = baseIndex + i + 1 - first;
 	}
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n)
+void GeometryGenerator::GenerateGrid(const ShapeParams& params, Vertex* vertices, uint32* indices)
 {
-    MeshData meshData;
-
-	uint32 vertexCount = m*n;
-	uint32 faceCount   = (m-1)*(n-1)*2;
+	float width = params.Width;
+	float depth = params.Depth;
+	uint32 m = params.Rows;
+	uint32 n = params.Columns;
 
 	//
 	// Create the vertices.
@@ -568,7 +890,6 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	float du = 1.0f / (n-1);
 	float dv = 1.0f / (m-1);
 
-	meshData.Vertices.resize(vertexCount);
 	for(uint32 i = 0; i < m; ++i)
 	{
 		float z = halfDepth - i*dz;
@@ -576,218 +897,196 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 		{
 			float x = -halfWidth + j*dx;
 
-			meshData.Vertices[i*n+j].Position = XMFLOAT3(x, 0.0f, z);
-			meshData.Vertices[i*n+j].Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			meshData.Vertices[i*n+j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+			vertices[i*n+j].Position = XMFLOAT3(x, 0.0f, z);
+			vertices[i*n+j].Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
+			vertices[i*n+j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
 
 			// Stretch texture over grid.
-			meshData.Vertices[i*n+j].TexC.x = j*du;
-			meshData.Vertices[i*n+j].TexC.y = i*dv;
+			vertices[i*n+j].TexC.x = j*du;
+			vertices[i*n+j].TexC.y = i*dv;
 		}
 	}
- 
+
+	if(indices == nullptr)
+		return;
+
     //
 	// Create the indices.
 	//
 
-	meshData.Indices32.resize(faceCount*3); // 3 indices per face
-
 	// Iterate over each quad and compute indices.
 	uint32 k = 0;
 	for(uint32 i = 0; i < m-1; ++i)
 	{
 		for(uint32 j = 0; j < n-1; ++j)
 		{
-			meshData.Indices32[k]   = i*n+j;
-			meshData.Indices32[k+1] = i*n+j+1;
-			meshData.Indices32[k+2] = (i+1)*n+j;
+			indices[k]   = i*n+j;
+			indices[k+1] = i*n+j+1;
+			indices[k+2] = (i+1)*n+j;
 
-			meshData.Indices32[k+3] = (i+1)*n+j;
-			meshData.Indices32[k+4] = i*n+j+1;
-			meshData.Indices32[k+5] = (i+1)*n+j+1;
+			indices[k+3] = (i+1)*n+j;
+			indices[k+4] = i*n+j+1;
+			indices[k+5] = (i+1)*n+j+1;
 
 			k += 6; // next quad
 		}
 	}
-
-    return meshData;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth)
+void GeometryGenerator::GenerateQuad(const ShapeParams& params, Vertex* vertices, uint32* indices)
 {
-    MeshData meshData;
-
-	meshData.Vertices.resize(4);
-	meshData.Indices32.resize(6);
+	float x = params.X;
+	float y = params.Y;
+	float w = params.Width;
+	float h = params.Height;
+	float depth = params.Depth;
 
 	// Position coordinates specified in NDC space.
-	meshData.Vertices[0] = Vertex(
+	vertices[0] = Vertex(
         x, y - h, depth,
 		0.0f, 0.0f, -1.0f,
 		1.0f, 0.0f, 0.0f,
 		0.0f, 1.0f);
 
-	meshData.Vertices[1] = Vertex(
+	vertices[1] = Vertex(
 		x, y, depth,
 		0.0f, 0.0f, -1.0f,
 		1.0f, 0.0f, 0.0f,
 		0.0f, 0.0f);
 
-	meshData.Vertices[2] = Vertex(
+	vertices[2] = Vertex(
 		x+w, y, depth,
 		0.0f, 0.0f, -1.0f,
 		1.0f, 0.0f, 0.0f,
 		1.0f, 0.0f);
 
-	meshData.Vertices[3] = Vertex(
+	vertices[3] = Vertex(
 		x+w, y-h, depth,
 		0.0f, 0.0f, -1.0f,
 		1.0f, 0.0f, 0.0f,
 		1.0f, 1.0f);
 
-	meshData.Indices32[0] = 0;
-	meshData.Indices32[1] = 1;
-	meshData.Indices32[2] = 2;
+	indices[0] = 0;
+	indices[1] = 1;
+	indices[2] = 2;
 
-	meshData.Indices32[3] = 0;
-	meshData.Indices32[4] = 2;
-	meshData.Indices32[5] = 3;
-
-    return meshData;
+	indices[3] = 0;
+	indices[4] = 2;
+	indices[5] = 3;
 }
-GeometryGenerator::MeshData GeometryGenerator::CreateCone(float bottomRadius, float height, uint32_t sliceCount)
+
+void GeometryGenerator::GenerateCone(const ShapeParams& params, Vertex* vertices, uint32* indices)
 {
-	MeshData meshData;
+	float bottomRadius = params.Radius;
+	float height = params.Height;
+	uint32 sliceCount = params.SliceCount;
+
+
+	if (sliceCount < 3) sliceCount = 3;
 
-	
-	if (sliceCount < 3) sliceCount = 3; 
 
+	vertices[0] = Vertex();
+	vertices[0].Position = XMFLOAT3(0.0f, height, 0.0f);
 
-	Vertex apexVertex;
-	apexVertex.Position = XMFLOAT3(0.0f, height, 0.0f); 
-	meshData.Vertices.push_back(apexVertex);
+	RingTable ring;
+	BuildRingTable(sliceCount, ring);
 
-	
-	float angleStep = 2.0f * XM_PI / sliceCount; 
 	for (uint32_t i = 0; i < sliceCount; ++i)
 	{
-		float angle = i * angleStep;
-		Vertex vertex;
-		vertex.Position = XMFLOAT3(bottomRadius * cos(angle), 0.0f, bottomRadius * sin(angle)); 
-		meshData.Vertices.push_back(vertex);
+		vertices[i + 1] = Vertex();
+		vertices[i + 1].Position = XMFLOAT3(bottomRadius * ring.Cos[i], 0.0f, bottomRadius * ring.Sin[i]);
 	}
 
-	
+
 	for (uint32_t i = 1; i <= sliceCount; ++i)
 	{
-		
+
 		uint32_t next = (i % sliceCount) + 1;
 
-		
-		meshData.Indices32.push_back(0); 
-		meshData.Indices32.push_back(i); 
-		meshData.Indices32.push_back(next); 
+
+		*indices++ = 0;
+		*indices++ = next;
+		*indices++ = i;
 	}
 
-	
+
 	for (uint32_t i = 1; i < sliceCount - 1; ++i)
 	{
-		meshData.Indices32.push_back(i);
-		meshData.Indices32.push_back(i + 1);
-		meshData.Indices32.push_back(sliceCount); 
+		*indices++ = i;
+		*indices++ = i + 1;
+		*indices++ = sliceCount;
 	}
-
-	
-	return meshData;
 }
-GeometryGenerator::MeshData GeometryGenerator::CreateWedge(float width, float height, float depth, uint32 numSubdivisions)
+
+void GeometryGenerator::GenerateWedge(const ShapeParams& params, Vertex* vertices, uint32* indices)
 {
-	MeshData meshData;
+	float width = params.Width;
+	float height = params.Height;
+	float depth = params.Depth;
 
-	
-	std::vector<Vertex> vertices;
 
+	vertices[0] = Vertex(-width / 2, -height / 2, -depth / 2, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 
-	vertices.push_back(Vertex(-width / 2, -height / 2, -depth / 2, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f));
-	
-	vertices.push_back(Vertex(width / 2, -height / 2, -depth / 2, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f));
-	
-	vertices.push_back(Vertex(0.0f, -height / 2, depth / 2, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 1.0f));
+	vertices[1] = Vertex(width / 2, -height / 2, -depth / 2, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
 
+	vertices[2] = Vertex(0.0f, -height / 2, depth / 2, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 1.0f);
 
-	vertices.push_back(Vertex(-width / 2, height / 2, -depth / 2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f));
 
-	vertices.push_back(Vertex(width / 2, height / 2, -depth / 2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f));
-	
-	vertices.push_back(Vertex(0.0f, height / 2, depth / 2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 1.0f));
+	vertices[3] = Vertex(-width / 2, height / 2, -depth / 2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 
-	meshData.Vertices = vertices;
+	vertices[4] = Vertex(width / 2, height / 2, -depth / 2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
 
-	
-	std::vector<uint32> indices = {
-		// Bottom face (Counter-clockwise winding)
-		0, 2, 1,
+	vertices[5] = Vertex(0.0f, height / 2, depth / 2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 1.0f);
 
-		// Top face (Counter-clockwise winding)
-		3, 4, 5,
 
-		// Front face (Counter-clockwise winding)
-		2, 3, 5,
-		2, 5, 4,
+	const uint32 wedgeIndices[24] = {
+		// Bottom face
+		0, 1, 2,
 
-		// Left face (Counter-clockwise winding)
-		0, 4, 3,
-		0, 1, 4,
+		// Top face
+		3, 5, 4,
 
-		// Right face (Counter-clockwise winding)
-		1, 2, 5,
-		1, 5, 4
-	};
+		// Front face
+		0, 3, 4,
+		0, 4, 1,
 
-	meshData.Indices32 = indices;
+		// Left face
+		2, 5, 3,
+		2, 3, 0,
 
-	return meshData;
-}
-GeometryGenerator::MeshData GeometryGenerator::CreateTorus(float radius, float tubeRadius, uint32 sliceCount, uint32 tubeSliceCount)
-{
-	MeshData meshData;
+		// Right face
+		1, 4, 5,
+		1, 5, 2
+	};
 
-	// Calculate the number of vertices and indices
-	uint32 vertexCount = (sliceCount + 1) * (tubeSliceCount + 1);
-	uint32 indexCount = sliceCount * tubeSliceCount * 6;
+	std::copy(&wedgeIndices[0], &wedgeIndices[24], indices);
+}
 
-	meshData.Vertices.resize(vertexCount);
-	meshData.Indices32.resize(indexCount);
+void GeometryGenerator::GenerateTorus(const ShapeParams& params, Vertex* vertices, uint32* indices)
+{
+	float radius = params.Radius;
+	float tubeRadius = params.TubeRadius;
+	uint32 sliceCount = params.SliceCount;
+	uint32 tubeSliceCount = params.StackCount;
+
+	// Generate vertices.  Vertex (i, j) sits at slice angle s = 2*pi*i/sliceCount
+	// around the y axis and tube angle t = 2*pi*j/tubeSliceCount around the tube:
+	//   P = (R + r*cos(t))*(cos(s), 0, sin(s)) + (0, r*sin(t), 0)
+	//   N = cos(t)*(cos(s), 0, sin(s)) + (0, sin(t), 0)
+	// For a fixed t this is a ring around the y axis, so every tube angle is
+	// emitted as one ring over the slices, strided through the vertex array.
+	RingTable ring;
+	BuildRingTable(sliceCount, ring);
 
-	// Generate vertices
-	float sliceAngleStep = 2.0f * XM_PI / sliceCount;
 	float tubeSliceAngleStep = 2.0f * XM_PI / tubeSliceCount;
 
-	for (uint32 i = 0; i <= sliceCount; ++i)
+	for (uint32 j = 0; j <= tubeSliceCount; ++j)
 	{
-		float sliceAngle = i * sliceAngleStep;
-		XMVECTOR sliceNormal = XMVectorSet(cosf(sliceAngle), 0.0f, sinf(sliceAngle), 0.0f);
-		XMVECTOR sliceCenter = radius * sliceNormal;
+		float sinT, cosT;
+		XMScalarSinCos(&sinT, &cosT, j == tubeSliceCount ? 0.0f : j * tubeSliceAngleStep);
 
-		for (uint32 j = 0; j <= tubeSliceCount; ++j)
-		{
-			float tubeSliceAngle = j * tubeSliceAngleStep;
-			XMVECTOR tubeNormal = XMVectorSet(cosf(tubeSliceAngle), sinf(tubeSliceAngle), 0.0f, 0.0f);
-			XMVECTOR position = sliceCenter + tubeRadius * tubeNormal;
-
-			// Compute the vertex
-			Vertex vertex;
-			XMStoreFloat3(&vertex.Position, position);
-			XMStoreFloat3(&vertex.Normal, XMVector3Normalize(position - sliceCenter));
-			XMStoreFloat3(&vertex.TangentU, XMVector3Normalize(XMVectorSet(-sinf(sliceAngle), 0.0f, cosf(sliceAngle), 0.0f)));
-
-			// Set texture coordinates (u, v)
-			vertex.TexC.x = (float)i / sliceCount;
-			vertex.TexC.y = (float)j / tubeSliceCount;
-
-			// Store the vertex in the appropriate index in the array
-			meshData.Vertices[i * (tubeSliceCount + 1) + j] = vertex;
-		}
+		BuildRing(ring, radius + tubeRadius * cosT, tubeRadius * sinT, cosT, sinT,
+			(float)j / tubeSliceCount, &vertices[j], tubeSliceCount + 1);
 	}
 
 	// Generate indices
@@ -798,40 +1097,33 @@ GeometryGenerator::MeshData GeometryGenerator::CreateTorus(float radius, float t
 		{
 			// Compute indices for each quad (two triangles per quad)
 			uint32 current = i * (tubeSliceCount + 1) + j;
-			uint32 nextI = (i + 1) % (sliceCount + 1); // Wraps around at the end
-			uint32 nextJ = (j + 1) % (tubeSliceCount + 1); // Wraps around at the end
-
-			uint32 next = nextI * (tubeSliceCount + 1) + j;
-			uint32 nextNextJ = nextI * (tubeSliceCount + 1) + nextJ;
-			uint32 currentNextJ = i * (tubeSliceCount + 1) + nextJ;
+			uint32 next = (i + 1) * (tubeSliceCount + 1) + j;
+			uint32 nextNextJ = next + 1;
+			uint32 currentNextJ = current + 1;
 
 			// First triangle
-			meshData.Indices32[index++] = current;
-			meshData.Indices32[index++] = next;
-			meshData.Indices32[index++] = currentNextJ;
+			indices[index++] = current;
+			indices[index++] = currentNextJ;
+			indices[index++] = next;
 
 			// Second triangle
-			meshData.Indices32[index++] = next;
-			meshData.Indices32[index++] = nextNextJ;
-			meshData.Indices32[index++] = currentNextJ;
+			indices[index++] = next;
+			indices[index++] = currentNextJ;
+			indices[index++] = nextNextJ;
 		}
 	}
-
-	return meshData;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreatePyramid(float baseWidth, float height, uint32 numSubdivisions)
+void GeometryGenerator::GeneratePyramid(const ShapeParams& params, Vertex* vertices, uint32* indices)
 {
-	MeshData meshData;
-
 	//
 	// Create the vertices.
 	//
 
 	Vertex v[5];
 
-	float halfBase = 0.5f * baseWidth;
-	float h = height;
+	float halfBase = 0.5f * params.Width;
+	float h = params.Height;
 
 	// Define the 4 vertices for the base (square).
 	v[0] = Vertex(-halfBase, 0.0f, -halfBase, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f); // Base front-left
@@ -842,142 +1134,352 @@ GeometryGenerator::MeshData GeometryGenerator::CreatePyramid(float baseWidth, fl
 	// Define the apex of the pyramid.
 	v[4] = Vertex(0.0f, h, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f); // Apex (top)
 
-	meshData.Vertices.assign(&v[0], &v[5]);
-
-	//
-	// Create the indices.
-	//
+	// Put a cap on the number of subdivisions.
+	uint32 numSubdivisions = std::min(params.NumSubdivisions, MaxSubdivisions);
 
-	uint32 i[18];
+	GenerateSubdivided(v, 5, PyramidIndices, 18, numSubdivisions, vertices, indices);
+}
 
-	// Base face (quad)
-	i[0] = 0; i[1] = 1; i[2] = 2;
-	i[3] = 0; i[4] = 2; i[5] = 3;
+GeometryGenerator::MeshCounts GeometryGenerator::SubdividedCounts(uint32 baseVertexCount,
+	const uint32* baseIndices, uint32 baseIndexCount, uint32 numSubdivisions)
+{
+	BaseEdges edges;
+	FindBaseEdges(baseIndices, baseIndexCount, edges);
 
-	// Side faces (4 triangles)
-	i[6] = 0; i[7] = 1; i[8] = 4;
-	i[9] = 1; i[10] = 2; i[11] = 4;
-	i[12] = 2; i[13] = 3; i[14] = 4;
-	i[15] = 3; i[16] = 0; i[17] = 4;
+	// Each level splits every edge in two, so after n levels an edge holds
+	// k-1 new vertices and a triangle (k-1)(k-2)/2 interior ones, k = 2^n.
+	uint32 k = 1u << numSubdivisions;
+	uint32 triCount = baseIndexCount/3;
 
-	meshData.Indices32.assign(&i[0], &i[18]);
+	MeshCounts counts;
+	counts.VertexCount = baseVertexCount + edges.Count*(k-1) + triCount*(k-1)*(k-2)/2;
+	counts.IndexCount = 3*triCount*k*k;
 
-	// Put a cap on the number of subdivisions.
-	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+	return counts;
+}
 
-	// Apply subdivisions if needed
-	for (uint32 j = 0; j < numSubdivisions; ++j)
+void GeometryGenerator::GenerateSubdivided(const Vertex* baseVertices, uint32 baseVertexCount,
+	const uint32* baseIndices, uint32 baseIndexCount, uint32 numSubdivisions, Vertex* vertices, uint32* indices)
+{
+	// n levels of shared midpoint subdivision place the vertices of a base
+	// triangle (a, b, c) on the regular grid a + (b-a)*i/k + (c-a)*j/k with
+	// i+j <= k and k = 2^n, so the final mesh is written in one pass.  Output
+	// order: base vertices, then k-1 vertices per edge, then the interior of
+	// each triangle row by row.
+	BaseEdges edges;
+	FindBaseEdges(baseIndices, baseIndexCount, edges);
+
+	uint32 k = 1u << numSubdivisions;
+	float invK = 1.0f / k;
+	uint32 triCount = baseIndexCount/3;
+	uint32 edgeStart = baseVertexCount;
+	uint32 faceStart = edgeStart + edges.Count*(k-1);
+	uint32 faceInteriorCount = (k-1)*(k-2)/2;
+
+	std::copy(baseVertices, baseVertices + baseVertexCount, vertices);
+
+	for(uint32 e = 0; e < edges.Count; ++e)
 	{
-		Subdivide(meshData);
+		const Vertex& a = baseVertices[edges.A[e]];
+		const Vertex& b = baseVertices[edges.B[e]];
+		for(uint32 t = 1; t < k; ++t)
+			vertices[edgeStart + e*(k-1) + t-1] = Interpolate(a, b, a, t*invK, 0.0f);
 	}
 
-	return meshData;
+	// Index of the vertex t/k of the way from u to v along a base edge.
+	auto edgePoint = [&](uint32 u, uint32 v, uint32 e, uint32 t)
+	{
+		if(t == 0)
+			return u;
+		if(t == k)
+			return v;
+
+		return edgeStart + e*(k-1) + (u < v ? t-1 : k-t-1);
+	};
+
+	for(uint32 f = 0; f < triCount; ++f)
+	{
+		uint32 a = baseIndices[f*3+0];
+		uint32 b = baseIndices[f*3+1];
+		uint32 c = baseIndices[f*3+2];
+
+		uint32 ab = edges.Find(a, b);
+		uint32 ac = edges.Find(a, c);
+		uint32 bc = edges.Find(b, c);
+
+		uint32 interiorStart = faceStart + f*faceInteriorCount;
+
+		// Row j of the interior holds i = 1..k-1-j.
+		auto interiorIndex = [&](uint32 i, uint32 j)
+		{
+			return interiorStart + (j-1)*(k-1) - (j-1)*j/2 + (i-1);
+		};
+
+		auto gridIndex = [&](uint32 i, uint32 j)
+		{
+			if(j == 0)
+				return edgePoint(a, b, ab, i);
+			if(i == 0)
+				return edgePoint(a, c, ac, j);
+			if(i + j == k)
+				return edgePoint(b, c, bc, j);
+
+			return interiorIndex(i, j);
+		};
+
+		for(uint32 j = 1; j + 1 < k; ++j)
+		{
+			for(uint32 i = 1; i + j < k; ++i)
+			{
+				vertices[interiorIndex(i, j)] = Interpolate(baseVertices[a], baseVertices[b], baseVertices[c],
+					i*invK, j*invK);
+			}
+		}
+
+		// Every grid cell has an upright triangle and, away from the bc edge,
+		// an inverted one; both keep the winding of (a, b, c).
+		for(uint32 j = 0; j < k; ++j)
+		{
+			for(uint32 i = 0; i + j < k; ++i)
+			{
+				*indices++ = gridIndex(i, j);
+				*indices++ = gridIndex(i+1, j);
+				*indices++ = gridIndex(i, j+1);
+
+				if(i + j + 1 < k)
+				{
+					*indices++ = gridIndex(i+1, j);
+					*indices++ = gridIndex(i+1, j+1);
+					*indices++ = gridIndex(i, j+1);
+				}
+			}
+		}
+	}
 }
-GeometryGenerator::MeshData GeometryGenerator::CreateDiamond(float baseWidth, float height, uint32 numSubdivisions)
+
+void GeometryGenerator::Subdivide(MeshData& meshData, SubdivideMode mode)
 {
-	MeshData meshData;
+	if(mode == SubdivideMode::Shared)
+	{
+		SubdivideShared(meshData);
+		return;
+	}
 
-	//
-	// Create the vertices.
-	//
+	// Save a copy of the input geometry.
+	MeshData inputCopy = meshData;
 
-	Vertex v[5];
 
-	float halfBase = 0.5f * baseWidth;
-	float h = height;
+	meshData.Vertices.resize(0);
+	meshData.Indices32.resize(0);
+
+	//       v1
+	//       *
+	//      / \
+	//     /   \
+	//  m0*-----*m1
+	//   / \   / \
+	//  /   \ /   \
+	// *-----*-----*
+	// v0    m2     v2
 
-	// Define the 4 vertices for the base (square).
-	v[0] = Vertex(-halfBase, 0.0f, -halfBase, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f); // Base front-left
-	v[1] = Vertex(-halfBase, 0.0f, +halfBase, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f); // Base back-left
-	v[2] = Vertex(+halfBase, 0.0f, +halfBase, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f); // Base back-right
-	v[3] = Vertex(+halfBase, 0.0f, -halfBase, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f); // Base front-right
+	uint32 numTris = (uint32)inputCopy.Indices32.size()/3;
+	for(uint32 i = 0; i < numTris; ++i)
+	{
+		Vertex v0 = inputCopy.Vertices[ inputCopy.Indices32[i*3+0] ];
+		Vertex v1 = inputCopy.Vertices[ inputCopy.Indices32[i*3+1] ];
+		Vertex v2 = inputCopy.Vertices[ inputCopy.Indices32[i*3+2] ];
 
-	// Define the apex of the pyramid.
-	v[4] = Vertex(0.0f, h, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f); // Apex (top)
+		//
+		// Generate the midpoints.
+		//
 
-	meshData.Vertices.assign(&v[0], &v[5]);
+        Vertex m0 = MidPoint(v0, v1);
+        Vertex m1 = MidPoint(v1, v2);
+        Vertex m2 = MidPoint(v0, v2);
 
-	//
-	// Create the indices.
-	//
+		//
+		// Add new geometry.
+		//
+
+		meshData.Vertices.push_back(v0); // 0
+		meshData.Vertices.push_back(v1); // 1
+		meshData.Vertices.push_back(v2); // 2
+		meshData.Vertices.push_back(m0); // 3
+		meshData.Vertices.push_back(m1); // 4
+		meshData.Vertices.push_back(m2); // 5
+ 
+		meshData.Indices32.push_back(i*6+0);
+		meshData.Indices32.push_back(i*6+3);
+		meshData.Indices32.push_back(i*6+5);
+
+		meshData.Indices32.push_back(i*6+3);
+		meshData.Indices32.push_back(i*6+4);
+		meshData.Indices32.push_back(i*6+5);
 
-	uint32 i[18];
+		meshData.Indices32.push_back(i*6+5);
+		meshData.Indices32.push_back(i*6+4);
+		meshData.Indices32.push_back(i*6+2);
 
-	// Base face (quad)
-	i[0] = 0; i[1] = 1; i[2] = 2;
-	i[3] = 0; i[4] = 2; i[5] = 3;
+		meshData.Indices32.push_back(i*6+3);
+		meshData.Indices32.push_back(i*6+1);
+		meshData.Indices32.push_back(i*6+4);
+	}
+}
 
-	// Side faces (4 triangles)
-	i[6] = 0; i[7] = 1; i[8] = 4;
-	i[9] = 1; i[10] = 2; i[11] = 4;
-	i[12] = 2; i[13] = 3; i[14] = 4;
-	i[15] = 3; i[16] = 0; i[17] = 4;
+void GeometryGenerator::SubdivideShared(MeshData& meshData)
+{
+	// Same split as above, but the midpoint of an edge is created once and
+	// reused by the triangle on the other side of the edge.  Only the
+	// connectivity is rebuilt; the input vertices stay where they are.
+	std::vector<uint32> inputIndices;
+	inputIndices.swap(meshData.Indices32);
 
-	meshData.Indices32.assign(&i[0], &i[18]);
+	uint32 numTris = (uint32)inputIndices.size()/3;
 
-	// Put a cap on the number of subdivisions.
-	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+	// A closed mesh has about 3/2 edges per triangle.
+	std::unordered_map<std::uint64_t, uint32> edgeMidpoints;
+	edgeMidpoints.reserve(numTris*3/2 + 1);
+	meshData.Vertices.reserve(meshData.Vertices.size() + numTris*3/2 + 1);
+	meshData.Indices32.resize(numTris*12);
 
-	// Apply subdivisions if needed
-	for (uint32 j = 0; j < numSubdivisions; ++j)
+	auto midPointIndex = [&](uint32 a, uint32 b)
 	{
-		Subdivide(meshData);
-	}
+		std::uint64_t key = a < b ?
+			((std::uint64_t)a << 32) | b :
+			((std::uint64_t)b << 32) | a;
 
-	return meshData;
+		auto result = edgeMidpoints.emplace(key, (uint32)meshData.Vertices.size());
+		if(result.second)
+		{
+			Vertex m = MidPoint(meshData.Vertices[a], meshData.Vertices[b]);
+			meshData.Vertices.push_back(m);
+		}
+
+		return result.first->second;
+	};
+
+	for(uint32 i = 0; i < numTris; ++i)
+	{
+		uint32 v0 = inputIndices[i*3+0];
+		uint32 v1 = inputIndices[i*3+1];
+		uint32 v2 = inputIndices[i*3+2];
+
+		uint32 m0 = midPointIndex(v0, v1);
+		uint32 m1 = midPointIndex(v1, v2);
+		uint32 m2 = midPointIndex(v0, v2);
+
+		uint32* k = &meshData.Indices32[i*12];
+
+		k[0] = v0; k[1]  = m0; k[2]  = m2;
+		k[3] = m0; k[4]  = m1; k[5]  = m2;
+		k[6] = m2; k[7]  = m1; k[8]  = v2;
+		k[9] = m0; k[10] = v1; k[11] = m1;
+	}
 }
-GeometryGenerator::MeshData GeometryGenerator::CreateDiamond1(float baseWidth, float height, uint32 numSubdivisions)
-{
-	MeshData meshData;
 
-	//
-	// Create the vertices.
-	//
+GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Vertex& v1)
+{
+    XMVECTOR p0 = XMLoadFloat3(&v0.Position);
+    XMVECTOR p1 = XMLoadFloat3(&v1.Position);
 
-	Vertex v[5];
+    XMVECTOR n0 = XMLoadFloat3(&v0.Normal);
+    XMVECTOR n1 = XMLoadFloat3(&v1.Normal);
 
-	float halfBase = 0.5f * baseWidth;
-	float h = height;
+    XMVECTOR tan0 = XMLoadFloat3(&v0.TangentU);
+    XMVECTOR tan1 = XMLoadFloat3(&v1.TangentU);
 
-	// Define the 4 vertices for the base (square).
-	v[0] = Vertex(-halfBase, 0.0f, -halfBase, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f); // Base front-left
-	v[1] = Vertex(-halfBase, 0.0f, +halfBase, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f); // Base back-left
-	v[2] = Vertex(+halfBase, 0.0f, +halfBase, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f); // Base back-right
-	v[3] = Vertex(+halfBase, 0.0f, -halfBase, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f); // Base front-right
+    XMVECTOR tex0 = XMLoadFloat2(&v0.TexC);
+    XMVECTOR tex1 = XMLoadFloat2(&v1.TexC);
 
-	// Define the apex of the pyramid.
-	v[4] = Vertex(0.0f, h, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f); // Apex (top)
+    // Compute the midpoints of all the attributes.  Vectors need to be normalized
+    // since linear interpolating can make them not unit length.  
+    XMVECTOR pos = 0.5f*(p0 + p1);
+    XMVECTOR normal = XMVector3Normalize(0.5f*(n0 + n1));
+    XMVECTOR tangent = XMVector3Normalize(0.5f*(tan0+tan1));
+    XMVECTOR tex = 0.5f*(tex0 + tex1);
 
-	meshData.Vertices.assign(&v[0], &v[5]);
+    Vertex v;
+    XMStoreFloat3(&v.Position, pos);
+    XMStoreFloat3(&v.Normal, normal);
+    XMStoreFloat3(&v.TangentU, tangent);
+    XMStoreFloat2(&v.TexC, tex);
 
-	//
-	// Create the indices.
-	//
+    return v;
+}
 
-	uint32 i[18];
 
-	// Base face (quad)
-	i[0] = 0; i[1] = 1; i[2] = 2;
-	i[3] = 0; i[4] = 2; i[5] = 3;
+void GeometryGenerator::BuildRingTable(uint32 sliceCount, RingTable& ring)
+{
+	// One entry per ring vertex (sliceCount+1), padded to whole packs of four.
+	uint32 packCount = (sliceCount + 4) / 4;
 
-	// Side faces (4 triangles)
-	i[6] = 0; i[7] = 1; i[8] = 4;
-	i[9] = 1; i[10] = 2; i[11] = 4;
-	i[12] = 2; i[13] = 3; i[14] = 4;
-	i[15] = 3; i[16] = 0; i[17] = 4;
+	float* storage = ring.Inline;
+	if(sliceCount > RingTable::InlineSliceCount)
+	{
+		ring.Heap.resize(3*4*packCount);
+		storage = ring.Heap.data();
+	}
 
-	meshData.Indices32.assign(&i[0], &i[18]);
+	ring.SliceCount = sliceCount;
+	ring.Cos = storage;
+	ring.Sin = storage + 4*packCount;
+	ring.U = storage + 8*packCount;
 
-	// Put a cap on the number of subdivisions.
-	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+	XMVECTOR dTheta = XMVectorReplicate(2.0f*XM_PI/sliceCount);
+	XMVECTOR du = XMVectorReplicate(1.0f/sliceCount);
+	XMVECTOR j = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
 
-	// Apply subdivisions if needed
-	for (uint32 j = 0; j < numSubdivisions; ++j)
+	for(uint32 k = 0; k < packCount; ++k)
 	{
-		Subdivide(meshData);
+		XMVECTOR s, c;
+		XMVectorSinCos(&s, &c, j*dTheta);
+
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&ring.Cos[4*k]), c);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&ring.Sin[4*k]), s);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&ring.U[4*k]), j*du);
+
+		j += XMVectorReplicate(4.0f);
 	}
 
-	return meshData;
+	// Close the ring exactly so the seam vertices share their position.
+	ring.Cos[sliceCount] = 1.0f;
+	ring.Sin[sliceCount] = 0.0f;
+	ring.U[sliceCount] = 1.0f;
 }
 
+void GeometryGenerator::BuildRing(const RingTable& ring, float radius, float y,
+								  float normalRadius, float normalY, float v, Vertex* out, uint32 stride)
+{
+	uint32 vertexCount = ring.SliceCount + 1;
+
+	XMVECTOR vRadius = XMVectorReplicate(radius);
+	XMVECTOR vY = XMVectorReplicate(y);
+	XMVECTOR vNormalRadius = XMVectorReplicate(normalRadius);
+	XMVECTOR vNormalY = XMVectorReplicate(normalY);
+	XMVECTOR vV = XMVectorReplicate(v);
+	XMVECTOR zero = XMVectorZero();
 
+	for(uint32 j = 0; j < vertexCount; j += 4)
+	{
+		XMVECTOR c = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&ring.Cos[j]));
+		XMVECTOR s = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&ring.Sin[j]));
+		XMVECTOR u = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&ring.U[j]));
+
+		// Each row holds one component of four vertices; transposing gives
+		// one vertex per row.
+		XMMATRIX position = XMMatrixTranspose(XMMATRIX(vRadius*c, vY, vRadius*s, zero));
+		XMMATRIX normal = XMMatrixTranspose(XMMATRIX(vNormalRadius*c, vNormalY, vNormalRadius*s, zero));
+		XMMATRIX tangent = XMMatrixTranspose(XMMATRIX(-s, zero, c, zero));
+		XMMATRIX texC = XMMatrixTranspose(XMMATRIX(u, vV, zero, zero));
+
+		uint32 count = std::min(4u, vertexCount - j);
+		for(uint32 k = 0; k < count; ++k)
+		{
+			Vertex& vertex = out[(j + k)*stride];
+			XMStoreFloat3(&vertex.Position, position.r[k]);
+			XMStoreFloat3(&vertex.Normal, normal.r[k]);
+			XMStoreFloat3(&vertex.TangentU, tangent.r[k]);
+			XMStoreFloat2(&vertex.TexC, texC.r[k]);
+		}
+	}
+}
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <cassert>
 #include <cstdint>
 #include <DirectXMath.h>
 #include <vector>
@@ -64,7 +65,17 @@ public:
 			{
 				mIndices16.resize(Indices32.size());
 				for(size_t i = 0; i < Indices32.size(); ++i)
+				{
+					if(Indices32[i] == StripRestart)
+					{
+						mIndices16[i] = 0xffff;
+						continue;
+					}
+
+					// Use IndexPacking for meshes that do not fit in 16 bits.
+					assert(Indices32[i] < 0xffff);
 					mIndices16[i] = static_cast<uint16>(Indices32[i]);
+				}
 			}
 
 			return mIndices16;
@@ -74,6 +85,120 @@ public:
 		std::vector<uint16> mIndices16;
 	};
 
+	enum class ShapeType
+	{
+		Box,
+		Sphere,
+		Geosphere,
+		Cylinder,
+		Grid,
+		Quad,
+		Cone,
+		Wedge,
+		Torus,
+		Pyramid,
+		Diamond,
+		Diamond1
+	};
+
+	///<summary>
+	/// Inputs of every shape.  Each shape reads the fields its Create* function
+	/// takes; the static helpers fill them from the same argument lists.
+	/// Cylinder and cone use Radius as the bottom radius, the torus uses
+	/// StackCount as its tube slice count and the grid has Rows x Columns vertices.
+	///</summary>
+	struct ShapeParams
+	{
+		float Width = 1.0f;
+		float Height = 1.0f;
+		float Depth = 1.0f;
+		float Radius = 1.0f;
+		float TopRadius = 1.0f;
+		float TubeRadius = 0.25f;
+		float X = 0.0f;
+		float Y = 0.0f;
+		uint32 SliceCount = 16;
+		uint32 StackCount = 16;
+		uint32 Rows = 2;
+		uint32 Columns = 2;
+		uint32 NumSubdivisions = 0;
+
+		static ShapeParams Box(float width, float height, float depth, uint32 numSubdivisions);
+		static ShapeParams Sphere(float radius, uint32 sliceCount, uint32 stackCount);
+		static ShapeParams Geosphere(float radius, uint32 numSubdivisions);
+		static ShapeParams Cylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount);
+		static ShapeParams Grid(float width, float depth, uint32 m, uint32 n);
+		static ShapeParams Quad(float x, float y, float w, float h, float depth);
+		static ShapeParams Cone(float bottomRadius, float height, uint32 sliceCount);
+		static ShapeParams Wedge(float width, float height, float depth, uint32 numSubdivisions);
+		static ShapeParams Torus(float radius, float tubeRadius, uint32 sliceCount, uint32 tubeSliceCount);
+
+		// Also used by Diamond and Diamond1.
+		static ShapeParams Pyramid(float baseWidth, float height, uint32 numSubdivisions);
+	};
+
+	struct MeshCounts
+	{
+		uint32 VertexCount = 0;
+		uint32 IndexCount = 0;
+	};
+
+	///<summary>
+	/// Returns the exact number of vertices and indices Generate writes for a shape.
+	///</summary>
+	MeshCounts QueryCounts(ShapeType shape, const ShapeParams& params);
+
+	///<summary>
+	/// Writes the shape into caller memory with room for QueryCounts() vertices
+	/// and indices, e.g. straight into a concatenated vertex/index buffer.
+	/// Indices are relative to the first vertex written, so draw with
+	/// BaseVertexLocation set to the vertex offset.  Nothing is allocated on
+	/// the heap, except a sin/cos table for more than 1024 slices.
+	///</summary>
+	void Generate(ShapeType shape, const ShapeParams& params, Vertex* vertices, uint32* indices);
+
+	///<summary>
+	/// QueryCounts and Generate into a new MeshData.  The Create* functions
+	/// below are shorthands for this.
+	///</summary>
+	MeshData Create(ShapeType shape, const ShapeParams& params);
+
+	///<summary>
+	/// One shape of a GenerateBatch call.  Shape and Params are inputs; the
+	/// rest is filled in with the shape's region of the packed buffers, ready
+	/// to copy into a SubmeshGeometry.
+	///</summary>
+	struct ShapeRequest
+	{
+		ShapeType Shape = ShapeType::Box;
+		ShapeParams Params;
+
+		uint32 IndexCount = 0;
+		uint32 StartIndexLocation = 0;
+		uint32 BaseVertexLocation = 0;
+		uint32 VertexCount = 0;
+	};
+
+	///<summary>
+	/// Lays out requestCount shapes back to back in one vertex/index buffer and
+	/// returns the totals.  Fills the offsets and counts of every request.
+	///</summary>
+	MeshCounts LayoutBatch(ShapeRequest* requests, size_t requestCount);
+
+	///<summary>
+	/// Generates every request into its region of caller buffers sized by
+	/// LayoutBatch, on the shared Parallel pool.  Shapes are handed out one at
+	/// a time, so a batch runs about as long as its largest shape.  Indices
+	/// stay relative to each shape's first vertex.
+	///</summary>
+	void GenerateBatch(const ShapeRequest* requests, size_t requestCount,
+		Vertex* vertices, uint32* indices);
+
+	///<summary>
+	/// LayoutBatch and GenerateBatch into a new MeshData holding every shape.
+	///</summary>
+	MeshData GenerateBatch(ShapeRequest* requests, size_t requestCount);
+
 	///<summary>
 	/// Creates a box centered at the origin with the given dimensions, where each
     /// face has m rows and n columns of vertices.
@@ -124,6 +249,24 @@ public:
 
 	GeometryGenerator::MeshData CreateDiamond1(float baseWidth, float height, uint32 numSubdivisions);
 
+	// Ends one strip and starts the next in a strip index list (primitive
+	// restart).  Set the PSO's IBStripCutValue to 0xFFFFFFFF, or to 0xFFFF
+	// when IndexPacking narrows the indices to 16 bits.
+	static const uint32 StripRestart = 0xffffffff;
+
+	///<summary>
+	/// The vertices of CreateGrid, CreateSphere and CreateCylinder, with
+	/// Indices32 holding a triangle strip instead of a list: one strip per row
+	/// or stack of quads, about 1 index per triangle instead of 3, with the
+	/// quads split along their other diagonal.  Sphere poles and cylinder caps
+	/// are fans, which take 2 indices per triangle because the center repeats
+	/// between them, leaving a degenerate triangle the GPU discards.  Strips
+	/// are separated by StripRestart.  Draw with D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP.
+	///</summary>
+	MeshData CreateGridStrip(float width, float depth, uint32 m, uint32 n);
+	MeshData CreateSphereStrip(float radius, uint32 sliceCount, uint32 stackCount);
+	MeshData CreateCylinderStrip(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount);
+
 	
 
 	
@@ -139,11 +282,81 @@ public:
 
 	
 
-	void Subdivide(MeshData& meshData);
+	///<summary>
+	/// Split mode emits six fresh vertices per input triangle.  Shared mode keeps
+	/// an edge->midpoint map so triangles that share an edge also share its
+	/// midpoint, which keeps the output watertight and grows the vertex count by
+	/// about 4x per level instead of 6x.
+	///</summary>
+	enum class SubdivideMode
+	{
+		Split,
+		Shared
+	};
+
+	void Subdivide(MeshData& meshData, SubdivideMode mode = SubdivideMode::Split);
 private:
 	
     Vertex MidPoint(const Vertex& v0, const Vertex& v1);
-    void BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
-    void BuildCylinderBottomCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
+    void SubdivideShared(MeshData& meshData);
+
+	// Cosine, sine and u texture coordinate of the slice angles 2*pi*j/sliceCount
+	// for j = 0..sliceCount, padded to whole packs of four for the SIMD ring
+	// loops.  Lives on the stack up to InlineSliceCount slices.
+	struct RingTable
+	{
+		static const uint32 InlineSliceCount = 1024;
+
+		RingTable() {}
+		RingTable(const RingTable&) = delete;
+		RingTable& operator=(const RingTable&) = delete;
+
+		float* Cos = nullptr;
+		float* Sin = nullptr;
+		float* U = nullptr;
+		uint32 SliceCount = 0;
+
+		float Inline[3*(InlineSliceCount + 4)];
+		std::vector<float> Heap;
+	};
+
+    void BuildRingTable(uint32 sliceCount, RingTable& ring);
+
+	// Writes the sliceCount+1 vertices of a ring around the y axis, four at a
+	// time: position (radius*cos, y, radius*sin), normal
+	// (normalRadius*cos, normalY, normalRadius*sin), tangent (-sin, 0, cos)
+	// and texture coordinates (u, v).  Consecutive ring vertices are stride
+	// vertices apart in out.
+    void BuildRing(const RingTable& ring, float radius, float y, float normalRadius, float normalY, float v,
+		Vertex* out, uint32 stride = 1);
+
+    void BuildCylinderCap(const RingTable& ring, float radius, float y, float normalY, float height,
+		Vertex* vertices, uint32 baseIndex, uint32* indices);
+
+	// Strip of the quads between two rows of count vertices, leadRow first, and
+	// strip of the fan (center, q[k+1], q[k]) around count ring vertices.  Both
+	// start with StripRestart unless strip is empty.
+	void AppendQuadStrip(uint32 leadRow, uint32 otherRow, uint32 count, std::vector<uint32>& strip);
+	void AppendFanStrip(uint32 center, uint32 ringStart, uint32 count, bool ascending, std::vector<uint32>& strip);
+
+	// Sphere, cylinder and grid write only the vertices when indices is null,
+	// for the strip builders.
+	void GenerateBox(const ShapeParams& params, Vertex* vertices, uint32* indices);
+	void GenerateSphere(const ShapeParams& params, Vertex* vertices, uint32* indices);
+	void GenerateGeosphere(const ShapeParams& params, Vertex* vertices, uint32* indices);
+	void GenerateCylinder(const ShapeParams& params, Vertex* vertices, uint32* indices);
+	void GenerateGrid(const ShapeParams& params, Vertex* vertices, uint32* indices);
+	void GenerateQuad(const ShapeParams& params, Vertex* vertices, uint32* indices);
+	void GenerateCone(const ShapeParams& params, Vertex* vertices, uint32* indices);
+	void GenerateWedge(const ShapeParams& params, Vertex* vertices, uint32* indices);
+	void GenerateTorus(const ShapeParams& params, Vertex* vertices, uint32* indices);
+	void GeneratePyramid(const ShapeParams& params, Vertex* vertices, uint32* indices);
+
+	// Shared midpoint subdivision of a small base mesh, written in one pass
+	// without an edge map; see GenerateSubdivided.
+	MeshCounts SubdividedCounts(uint32 baseVertexCount, const uint32* baseIndices, uint32 baseIndexCount,
+		uint32 numSubdivisions);
+	void GenerateSubdivided(const Vertex* baseVertices, uint32 baseVertexCount, const uint32* baseIndices,
+		uint32 baseIndexCount, uint32 numSubdivisions, Vertex* vertices, uint32* indices);
 };
 
@@ -0,0 +1,297 @@
+//***************************************************************************************
+// IndexPacking.cpp
+//***************************************************************************************
+
+#include "IndexPacking.h"
+#include <algorithm>
+#include <cstdio>
+
+const IndexPacking::uint32 IndexPacking::MaxIndex16;
+const IndexPacking::uint32 IndexPacking::DefaultMaxChunks;
+
+namespace
+{
+	using uint32 = IndexPacking::uint32;
+	using IndexRange = IndexPacking::IndexRange;
+
+	// Cuts a range into runs of whole triangles whose indices span at most
+	// MaxIndex16, appending one chunk per run.  Fails if one triangle spans
+	// more than that or the range needs more than maxChunks runs.
+	bool SplitRange(const std::vector<uint32>& indices, const IndexRange& range, uint32 maxChunks,
+		std::vector<IndexRange>& chunks)
+	{
+		const uint32 end = range.StartIndexLocation + range.IndexCount;
+		const size_t firstChunk = chunks.size();
+
+		uint32 chunkStart = range.StartIndexLocation;
+		uint32 lo = 0xffffffff;
+		uint32 hi = 0;
+
+		auto emit = [&](uint32 chunkEnd)
+		{
+			IndexRange chunk;
+			chunk.IndexCount = chunkEnd - chunkStart;
+			chunk.StartIndexLocation = chunkStart;
+			chunk.BaseVertexLocation = range.BaseVertexLocation + (chunk.IndexCount > 0 ? (std::int32_t)lo : 0);
+			chunks.push_back(chunk);
+		};
+
+		for(uint32 i = range.StartIndexLocation; i < end; i += 3)
+		{
+			uint32 triEnd = std::min(i + 3, end);
+
+			uint32 triLo = indices[i];
+			uint32 triHi = indices[i];
+			for(uint32 k = i + 1; k < triEnd; ++k)
+			{
+				triLo = std::min(triLo, indices[k]);
+				triHi = std::max(triHi, indices[k]);
+			}
+
+			if(triHi - triLo > IndexPacking::MaxIndex16)
+				return false;
+
+			if(std::max(hi, triHi) - std::min(lo, triLo) > IndexPacking::MaxIndex16)
+			{
+				emit(i);
+				chunkStart = i;
+				lo = triLo;
+				hi = triHi;
+			}
+			else
+			{
+				lo = std::min(lo, triLo);
+				hi = std::max(hi, triHi);
+			}
+		}
+
+		emit(end);
+
+		return chunks.size() - firstChunk <= maxChunks;
+	}
+
+	// The 32-bit strip cut value becomes the 16-bit one.
+	void Narrow(const std::vector<uint32>& indices, std::vector<IndexPacking::uint16>& indices16)
+	{
+		indices16.resize(indices.size());
+		for(size_t i = 0; i < indices.size(); ++i)
+			indices16[i] = indices[i] == GeometryGenerator::StripRestart ? 0xffff : static_cast<IndexPacking::uint16>(indices[i]);
+	}
+}
+
+const void* IndexPacking::PackedIndices::GetData()const
+{
+	return Format == DXGI_FORMAT_R16_UINT ? (const void*)Indices16.data() : (const void*)Indices32.data();
+}
+
+IndexPacking::uint32 IndexPacking::PackedIndices::GetByteSize()const
+{
+	return Format == DXGI_FORMAT_R16_UINT ?
+		(uint32)(Indices16.size()*sizeof(uint16)) : (uint32)(Indices32.size()*sizeof(uint32));
+}
+
+IndexPacking::uint32 IndexPacking::PackedIndices::GetSavedBytes()const
+{
+	return (uint32)(Indices16.size()*(sizeof(uint32) - sizeof(uint16)));
+}
+
+IndexPacking::PackedIndices IndexPacking::Pack(const std::vector<uint32>& indices)
+{
+	PackedIndices packed;
+
+	IndexRange all;
+	all.IndexCount = (uint32)indices.size();
+	packed.Chunks.push_back(all);
+	packed.FirstChunk = { 0, 1 };
+
+	uint32 maxIndex = 0;
+	for(uint32 index : indices)
+	{
+		if(index != GeometryGenerator::StripRestart)
+			maxIndex = std::max(maxIndex, index);
+	}
+
+	if(maxIndex <= MaxIndex16)
+	{
+		Narrow(indices, packed.Indices16);
+	}
+	else
+	{
+		packed.Result = Layout::Index32;
+		packed.Format = DXGI_FORMAT_R32_UINT;
+		packed.Indices32 = indices;
+	}
+
+	return packed;
+}
+
+IndexPacking::PackedIndices IndexPacking::Pack(const std::vector<uint32>& indices, const std::vector<IndexRange>& ranges,
+	uint32 maxChunksPerRange)
+{
+	PackedIndices packed;
+
+	//
+	// Chunk every range; any range that cannot be chunked forces 32 bits.
+	//
+
+	bool fits = true;
+	bool split = false;
+	for(const IndexRange& range : ranges)
+	{
+		uint32 first = (uint32)packed.Chunks.size();
+		packed.FirstChunk.push_back(first);
+
+		if(!SplitRange(indices, range, maxChunksPerRange, packed.Chunks))
+		{
+			fits = false;
+			break;
+		}
+
+		split |= packed.Chunks.size() - first > 1;
+	}
+	packed.FirstChunk.push_back((uint32)packed.Chunks.size());
+
+	//
+	// Rebase each chunk on its smallest index; then every index, including
+	// those outside the ranges, must fit in 16 bits.
+	//
+
+	if(fits)
+	{
+		std::vector<uint32> rebased = indices;
+		for(size_t r = 0; r < ranges.size(); ++r)
+		{
+			for(uint32 c = packed.FirstChunk[r]; c < packed.FirstChunk[r + 1]; ++c)
+			{
+				const IndexRange& chunk = packed.Chunks[c];
+				uint32 lo = (uint32)(chunk.BaseVertexLocation - ranges[r].BaseVertexLocation);
+				for(uint32 i = chunk.StartIndexLocation; i < chunk.StartIndexLocation + chunk.IndexCount; ++i)
+					rebased[i] -= lo;
+			}
+		}
+
+		uint32 maxIndex = rebased.empty() ? 0 : *std::max_element(rebased.begin(), rebased.end());
+		if(maxIndex <= MaxIndex16)
+		{
+			packed.Result = split ? Layout::Split16 : Layout::Index16;
+			Narrow(rebased, packed.Indices16);
+			return packed;
+		}
+	}
+
+	//
+	// 32-bit fallback: the ranges are drawn as given.
+	//
+
+	packed.Result = Layout::Index32;
+	packed.Format = DXGI_FORMAT_R32_UINT;
+	packed.Indices32 = indices;
+	packed.Chunks = ranges;
+	packed.FirstChunk.resize(ranges.size() + 1);
+	for(uint32 r = 0; r <= (uint32)ranges.size(); ++r)
+		packed.FirstChunk[r] = r;
+
+	return packed;
+}
+
+IndexPacking::PackedIndices IndexPacking::Pack(GeometryGenerator::MeshData& meshData, uint32 maxChunks)
+{
+	std::vector<IndexRange> all(1);
+	all[0].IndexCount = (uint32)meshData.Indices32.size();
+
+	PackedIndices packed = Pack(meshData.Indices32, all, maxChunks);
+	if(packed.Result != Layout::Index32)
+		return packed;
+
+	//
+	// Give every chunk its own run of vertices, copying a vertex again when a
+	// later chunk uses it too.  A chunk closes before it would need more than
+	// MaxIndex16 + 1 vertices.
+	//
+
+	const uint32 invalid = 0xffffffff;
+	const std::vector<uint32>& indices = meshData.Indices32;
+
+	std::vector<GeometryGenerator::Vertex> vertices;
+	vertices.reserve(meshData.Vertices.size());
+
+	std::vector<uint32> local(meshData.Vertices.size(), invalid);
+	std::vector<uint32> used;
+	std::vector<uint32> indices32(indices.size());
+	std::vector<IndexRange> chunks;
+
+	IndexRange chunk;
+	for(uint32 i = 0; i < (uint32)indices.size(); i += 3)
+	{
+		uint32 triEnd = std::min(i + 3, (uint32)indices.size());
+
+		// A vertex repeated in a degenerate triangle counts twice, which at
+		// worst closes the chunk one triangle early.
+		uint32 newVertices = 0;
+		for(uint32 k = i; k < triEnd; ++k)
+			newVertices += local[indices[k]] == invalid ? 1 : 0;
+
+		uint32 chunkVertices = (uint32)vertices.size() - (uint32)chunk.BaseVertexLocation;
+		if(chunkVertices + newVertices > MaxIndex16 + 1)
+		{
+			chunk.IndexCount = i - chunk.StartIndexLocation;
+			chunks.push_back(chunk);
+			if(chunks.size() >= maxChunks)
+				return packed;
+
+			for(uint32 v : used)
+				local[v] = invalid;
+			used.clear();
+
+			chunk.StartIndexLocation = i;
+			chunk.BaseVertexLocation = (std::int32_t)vertices.size();
+		}
+
+		for(uint32 k = i; k < triEnd; ++k)
+		{
+			uint32 v = indices[k];
+			if(local[v] == invalid)
+			{
+				local[v] = (uint32)vertices.size() - (uint32)chunk.BaseVertexLocation;
+				vertices.push_back(meshData.Vertices[v]);
+				used.push_back(v);
+			}
+
+			indices32[k] = local[v];
+		}
+	}
+
+	chunk.IndexCount = (uint32)indices.size() - chunk.StartIndexLocation;
+	chunks.push_back(chunk);
+
+	packed.Result = Layout::Split16;
+	packed.Format = DXGI_FORMAT_R16_UINT;
+	Narrow(indices32, packed.Indices16);
+	packed.Indices32.clear();
+	packed.Chunks = chunks;
+	packed.FirstChunk = { 0, (uint32)chunks.size() };
+
+	// Keep meshData self-contained: its indices address the new vertices.
+	for(const IndexRange& c : chunks)
+	{
+		for(uint32 k = c.StartIndexLocation; k < c.StartIndexLocation + c.IndexCount; ++k)
+			indices32[k] += (uint32)c.BaseVertexLocation;
+	}
+
+	meshData.Vertices.swap(vertices);
+	meshData.Indices32.swap(indices32);
+
+	return packed;
+}
+
+std::string IndexPacking::ToString(const PackedIndices& packed)
+{
+	const char* layout = packed.Result == Layout::Index16 ? "16-bit" :
+		packed.Result == Layout::Split16 ? "16-bit split" : "32-bit";
+
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer), "%s indices, %u draws, %u bytes (%u saved)",
+		layout, (uint32)packed.Chunks.size(), packed.GetByteSize(), packed.GetSavedBytes());
+
+	return buffer;
+}
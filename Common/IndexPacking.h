@@ -0,0 +1,96 @@
+//***************************************************************************************
+// IndexPacking.h
+//
+// Chooses the index buffer format instead of assuming DXGI_FORMAT_R16_UINT.
+// A triangle list packs to one of three layouts:
+//
+//   Index16  every draw fits in 16 bits after subtracting its smallest index,
+//            which moves into the draw's BaseVertexLocation
+//   Split16  some draw spans more vertices than 16 bits address, so it is cut
+//            into chunks of whole triangles, each with its own base vertex
+//   Index32  a single triangle spans too many vertices, or splitting would
+//            need too many draws
+//
+// Indices keep their positions, so StartIndexLocation values stay valid.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <dxgiformat.h>
+#include <string>
+
+class IndexPacking
+{
+public:
+
+	using uint16 = GeometryGenerator::uint16;
+	using uint32 = GeometryGenerator::uint32;
+
+	// 0xffff is never written, so it stays free as the strip cut value.
+	static const uint32 MaxIndex16 = 0xfffe;
+
+	// Each chunk is a draw call, so past this many a range goes 32-bit.
+	static const uint32 DefaultMaxChunks = 16;
+
+	enum class Layout { Index16, Split16, Index32 };
+
+	// Arguments of one DrawIndexedInstanced call, as in SubmeshGeometry.
+	struct IndexRange
+	{
+		uint32 IndexCount = 0;
+		uint32 StartIndexLocation = 0;
+		std::int32_t BaseVertexLocation = 0;
+	};
+
+	struct PackedIndices
+	{
+		Layout Result = Layout::Index16;
+		DXGI_FORMAT Format = DXGI_FORMAT_R16_UINT;
+
+		// Only the vector matching Format is filled.
+		std::vector<uint16> Indices16;
+		std::vector<uint32> Indices32;
+
+		// Draws for input range r are Chunks[FirstChunk[r]] up to, not
+		// including, Chunks[FirstChunk[r + 1]].
+		std::vector<IndexRange> Chunks;
+		std::vector<uint32> FirstChunk;
+
+		const void* GetData()const;
+		uint32 GetByteSize()const;
+
+		// Bytes saved against storing every index in 32 bits.
+		uint32 GetSavedBytes()const;
+	};
+
+	///<summary>
+	/// Packs indices that are already relative to their draw's base vertex,
+	/// e.g. several GeometryGenerator meshes concatenated.  Nothing is rebased
+	/// or split: the result is 16-bit if every index fits, else 32-bit, so
+	/// existing SubmeshGeometry values stay valid either way.  Strip indices
+	/// may be mixed in; GeometryGenerator::StripRestart becomes 0xffff in 16 bits.
+	///</summary>
+	static PackedIndices Pack(const std::vector<uint32>& indices);
+
+	///<summary>
+	/// Packs the triangle list ranges of indices, rebasing and if necessary
+	/// splitting each range as described above.  Ranges must not overlap;
+	/// indices outside every range are copied unchanged.  Only the indices
+	/// change, so a split needs each run of triangles to use vertices
+	/// numbered close together, as the generator's row ordered grids do.
+	///</summary>
+	static PackedIndices Pack(const std::vector<uint32>& indices, const std::vector<IndexRange>& ranges,
+		uint32 maxChunksPerRange = DefaultMaxChunks);
+
+	///<summary>
+	/// Packs a whole mesh as one range.  When the indices alone cannot be
+	/// split, e.g. after vertex cache reordering sends late triangles back to
+	/// early vertices, the vertices are regrouped per chunk instead, with the
+	/// ones shared by two chunks duplicated.  meshData then holds the new
+	/// vertices and matching 32-bit indices; call this before copying them.
+	///</summary>
+	static PackedIndices Pack(GeometryGenerator::MeshData& meshData, uint32 maxChunks = DefaultMaxChunks);
+
+	static std::string ToString(const PackedIndices& packed);
+};
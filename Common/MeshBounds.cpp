@@ -0,0 +1,446 @@
+//***************************************************************************************
+// MeshBounds.cpp
+//***************************************************************************************
+
+#include "MeshBounds.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Fewest points worth handing to another thread.
+	const size_t MinPointsPerChunk = 16384;
+
+	// Shrink-and-regrow rounds after the first Ritter sphere.
+	const int SphereRefinements = 8;
+	const float SphereShrink = 0.95f;
+
+	struct Points
+	{
+		const std::uint8_t* Base;
+		size_t Count;
+		size_t Stride;
+
+		XMVECTOR XM_CALLCONV Load(size_t i)const
+		{
+			return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(Base + i*Stride));
+		}
+	};
+
+	struct MinMax
+	{
+		XMFLOAT3 Min = { +FLT_MAX, +FLT_MAX, +FLT_MAX };
+		XMFLOAT3 Max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	};
+
+	MinMax CombineMinMax(const MinMax& a, const MinMax& b)
+	{
+		MinMax r;
+		XMStoreFloat3(&r.Min, XMVectorMin(XMLoadFloat3(&a.Min), XMLoadFloat3(&b.Min)));
+		XMStoreFloat3(&r.Max, XMVectorMax(XMLoadFloat3(&a.Max), XMLoadFloat3(&b.Max)));
+		return r;
+	}
+
+	// Min/max of the points, optionally projected onto three axes first.
+	MinMax ComputeMinMax(const Points& points, const XMFLOAT3* axes = nullptr)
+	{
+		return Parallel::Reduce<MinMax>(points.Count, MinPointsPerChunk, [&](size_t begin, size_t end)
+		{
+			XMMATRIX project = XMMatrixIdentity();
+			if(axes != nullptr)
+			{
+				project = XMMatrixTranspose(XMMATRIX(XMLoadFloat3(&axes[0]), XMLoadFloat3(&axes[1]),
+					XMLoadFloat3(&axes[2]), g_XMIdentityR3));
+			}
+
+			// Two accumulators so consecutive points do not wait on each other.
+			XMVECTOR min0 = XMVectorReplicate(+FLT_MAX), min1 = min0;
+			XMVECTOR max0 = XMVectorReplicate(-FLT_MAX), max1 = max0;
+
+			size_t i = begin;
+			for(; i + 1 < end; i += 2)
+			{
+				XMVECTOR p0 = points.Load(i);
+				XMVECTOR p1 = points.Load(i + 1);
+				if(axes != nullptr)
+				{
+					p0 = XMVector3TransformNormal(p0, project);
+					p1 = XMVector3TransformNormal(p1, project);
+				}
+
+				min0 = XMVectorMin(min0, p0);
+				max0 = XMVectorMax(max0, p0);
+				min1 = XMVectorMin(min1, p1);
+				max1 = XMVectorMax(max1, p1);
+			}
+			if(i < end)
+			{
+				XMVECTOR p = points.Load(i);
+				if(axes != nullptr)
+					p = XMVector3TransformNormal(p, project);
+				min0 = XMVectorMin(min0, p);
+				max0 = XMVectorMax(max0, p);
+			}
+
+			MinMax r;
+			XMStoreFloat3(&r.Min, XMVectorMin(min0, min1));
+			XMStoreFloat3(&r.Max, XMVectorMax(max0, max1));
+			return r;
+		}, CombineMinMax);
+	}
+
+	// Directions searched for extreme points: the axes and the four cube
+	// diagonals, so long diagonal meshes such as grids start from a good pair.
+	const int ExtremeDirections = 7;
+	const float ExtremeDirection[ExtremeDirections][3] =
+	{
+		{ 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f },
+		{ 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, -1.0f }, { 1.0f, -1.0f, 1.0f }, { 1.0f, -1.0f, -1.0f }
+	};
+
+	// Indices of the points with the smallest and largest projection onto
+	// each direction.
+	struct Extremes
+	{
+		float Min[ExtremeDirections];
+		float Max[ExtremeDirections];
+		size_t MinIndex[ExtremeDirections];
+		size_t MaxIndex[ExtremeDirections];
+
+		Extremes()
+		{
+			for(int d = 0; d < ExtremeDirections; ++d)
+			{
+				Min[d] = +FLT_MAX;
+				Max[d] = -FLT_MAX;
+				MinIndex[d] = MaxIndex[d] = 0;
+			}
+		}
+	};
+
+	Extremes FindExtremes(const Points& points)
+	{
+		return Parallel::Reduce<Extremes>(points.Count, MinPointsPerChunk, [&](size_t begin, size_t end)
+		{
+			Extremes e;
+			for(size_t i = begin; i < end; ++i)
+			{
+				XMFLOAT3 p;
+				XMStoreFloat3(&p, points.Load(i));
+				for(int d = 0; d < ExtremeDirections; ++d)
+				{
+					const float* dir = ExtremeDirection[d];
+					float t = p.x*dir[0] + p.y*dir[1] + p.z*dir[2];
+					if(t < e.Min[d]) { e.Min[d] = t; e.MinIndex[d] = i; }
+					if(t > e.Max[d]) { e.Max[d] = t; e.MaxIndex[d] = i; }
+				}
+			}
+			return e;
+		}, [](const Extremes& a, const Extremes& b)
+		{
+			Extremes r = a;
+			for(int d = 0; d < ExtremeDirections; ++d)
+			{
+				if(b.Min[d] < r.Min[d]) { r.Min[d] = b.Min[d]; r.MinIndex[d] = b.MinIndex[d]; }
+				if(b.Max[d] > r.Max[d]) { r.Max[d] = b.Max[d]; r.MaxIndex[d] = b.MaxIndex[d]; }
+			}
+			return r;
+		});
+	}
+
+	// Grows the sphere (center, radius) just enough to take in every point,
+	// visiting them forwards or backwards.
+	void GrowSphere(const Points& points, XMVECTOR& center, float& radius, bool backwards)
+	{
+		float radiusSq = radius*radius;
+		for(size_t k = 0; k < points.Count; ++k)
+		{
+			XMVECTOR p = points.Load(backwards ? points.Count - 1 - k : k);
+			XMVECTOR d = p - center;
+			float distSq = XMVectorGetX(XMVector3LengthSq(d));
+			if(distSq <= radiusSq)
+				continue;
+
+			float dist = sqrtf(distSq);
+			float newRadius = 0.5f*(radius + dist);
+			center += d*((newRadius - radius) / dist);
+			radius = newRadius;
+			radiusSq = radius*radius;
+		}
+	}
+
+	struct Moments
+	{
+		double Sum[3] = { 0.0, 0.0, 0.0 };
+		double Products[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 }; // xx yy zz xy xz yz
+	};
+
+	// Eigenvectors of the symmetric 3x3 matrix m by cyclic Jacobi rotations;
+	// columns of v on return.
+	void Jacobi(double m[3][3], double v[3][3])
+	{
+		for(int i = 0; i < 3; ++i)
+			for(int j = 0; j < 3; ++j)
+				v[i][j] = i == j ? 1.0 : 0.0;
+
+		for(int sweep = 0; sweep < 32; ++sweep)
+		{
+			double off = m[0][1]*m[0][1] + m[0][2]*m[0][2] + m[1][2]*m[1][2];
+			if(off < 1e-24)
+				break;
+
+			for(int p = 0; p < 2; ++p)
+			{
+				for(int q = p + 1; q < 3; ++q)
+				{
+					if(fabs(m[p][q]) < 1e-30)
+						continue;
+
+					double theta = (m[q][q] - m[p][p]) / (2.0*m[p][q]);
+					double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta*theta + 1.0));
+					double c = 1.0 / sqrt(t*t + 1.0);
+					double s = t*c;
+
+					for(int k = 0; k < 3; ++k)
+					{
+						double mkp = m[k][p], mkq = m[k][q];
+						m[k][p] = c*mkp - s*mkq;
+						m[k][q] = s*mkp + c*mkq;
+					}
+					for(int k = 0; k < 3; ++k)
+					{
+						double mpk = m[p][k], mqk = m[q][k];
+						m[p][k] = c*mpk - s*mqk;
+						m[q][k] = s*mpk + c*mqk;
+					}
+					for(int k = 0; k < 3; ++k)
+					{
+						double vkp = v[k][p], vkq = v[k][q];
+						v[k][p] = c*vkp - s*vkq;
+						v[k][q] = s*vkp + c*vkq;
+					}
+				}
+			}
+		}
+	}
+}
+
+MeshBounds::Result MeshBounds::Compute(const MeshData& meshData, bool orientedBox)
+{
+	if(meshData.Vertices.empty())
+		return Compute(nullptr, 0, sizeof(GeometryGenerator::Vertex), orientedBox);
+
+	return Compute(&meshData.Vertices[0].Position, meshData.Vertices.size(), sizeof(GeometryGenerator::Vertex), orientedBox);
+}
+
+MeshBounds::Result MeshBounds::Compute(const MeshData& meshData, uint32 indexCount, uint32 startIndexLocation,
+	int baseVertexLocation, bool orientedBox)
+{
+	// Gather each referenced vertex once, so shared vertices do not weigh
+	// more in the oriented box fit.
+	std::vector<bool> seen(meshData.Vertices.size(), false);
+	std::vector<XMFLOAT3> positions;
+	positions.reserve(std::min<size_t>(indexCount, meshData.Vertices.size()));
+
+	for(uint32 i = startIndexLocation; i < startIndexLocation + indexCount; ++i)
+	{
+		size_t v = (size_t)((std::int64_t)meshData.Indices32[i] + baseVertexLocation);
+		if(!seen[v])
+		{
+			seen[v] = true;
+			positions.push_back(meshData.Vertices[v].Position);
+		}
+	}
+
+	return Compute(positions.data(), positions.size(), sizeof(XMFLOAT3), orientedBox);
+}
+
+MeshBounds::Result MeshBounds::Compute(const XMFLOAT3* positions, size_t count, size_t stride, bool orientedBox)
+{
+	Result result;
+	ComputeBox(positions, count, stride, result.Box);
+	ComputeSphere(positions, count, stride, result.Sphere);
+
+	if(orientedBox)
+	{
+		ComputeOrientedBox(positions, count, stride, result.OrientedBox);
+	}
+	else
+	{
+		result.OrientedBox.Center = result.Box.Center;
+		result.OrientedBox.Extents = result.Box.Extents;
+		result.OrientedBox.Orientation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	return result;
+}
+
+void MeshBounds::ComputeBox(const XMFLOAT3* positions, size_t count, size_t stride, BoundingBox& box)
+{
+	if(count == 0)
+	{
+		box = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f));
+		return;
+	}
+
+	Points points = { reinterpret_cast<const std::uint8_t*>(positions), count, stride };
+	MinMax mm = ComputeMinMax(points);
+
+	BoundingBox::CreateFromPoints(box, XMLoadFloat3(&mm.Min), XMLoadFloat3(&mm.Max));
+}
+
+void MeshBounds::ComputeSphere(const XMFLOAT3* positions, size_t count, size_t stride, BoundingSphere& sphere)
+{
+	if(count == 0)
+	{
+		sphere = BoundingSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f);
+		return;
+	}
+
+	Points points = { reinterpret_cast<const std::uint8_t*>(positions), count, stride };
+
+	//
+	// Ritter: start from the most distant pair of extremes, then grow.
+	//
+
+	Extremes e = FindExtremes(points);
+
+	int pair = 0;
+	float bestSq = -1.0f;
+	for(int d = 0; d < ExtremeDirections; ++d)
+	{
+		float distSq = XMVectorGetX(XMVector3LengthSq(points.Load(e.MaxIndex[d]) - points.Load(e.MinIndex[d])));
+		if(distSq > bestSq)
+		{
+			bestSq = distSq;
+			pair = d;
+		}
+	}
+
+	XMVECTOR pMin = points.Load(e.MinIndex[pair]);
+	XMVECTOR pMax = points.Load(e.MaxIndex[pair]);
+
+	XMVECTOR center = 0.5f*(pMin + pMax);
+	float radius = 0.5f*sqrtf(bestSq);
+	GrowSphere(points, center, radius, false);
+
+	//
+	// Refinement: shrink the sphere a little and regrow it in the other
+	// direction; keep whichever sphere comes out smaller.
+	//
+
+	XMVECTOR bestCenter = center;
+	float bestRadius = radius;
+	for(int k = 0; k < SphereRefinements; ++k)
+	{
+		center = bestCenter;
+		radius = bestRadius*SphereShrink;
+		GrowSphere(points, center, radius, (k & 1) == 0);
+
+		if(radius < bestRadius)
+		{
+			bestCenter = center;
+			bestRadius = radius;
+		}
+	}
+
+	// Rounding in the growth steps can leave a point a hair outside; make
+	// the radius exact for the final center.
+	float maxDistSq = Parallel::Reduce<float>(count, MinPointsPerChunk, [&](size_t begin, size_t end)
+	{
+		XMVECTOR m = XMVectorZero();
+		for(size_t i = begin; i < end; ++i)
+			m = XMVectorMax(m, XMVector3LengthSq(points.Load(i) - bestCenter));
+		return XMVectorGetX(m);
+	}, [](float a, float b) { return std::max(a, b); });
+
+	XMStoreFloat3(&sphere.Center, bestCenter);
+	sphere.Radius = sqrtf(maxDistSq);
+}
+
+void MeshBounds::ComputeOrientedBox(const XMFLOAT3* positions, size_t count, size_t stride, BoundingOrientedBox& box)
+{
+	BoundingBox aabb;
+	ComputeBox(positions, count, stride, aabb);
+
+	box.Center = aabb.Center;
+	box.Extents = aabb.Extents;
+	box.Orientation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	if(count < 3)
+		return;
+
+	Points points = { reinterpret_cast<const std::uint8_t*>(positions), count, stride };
+
+	//
+	// Covariance of the points.  Sums are in double so million point meshes
+	// do not lose the small terms.
+	//
+
+	Moments moments = Parallel::Reduce<Moments>(count, MinPointsPerChunk, [&](size_t begin, size_t end)
+	{
+		Moments m;
+		for(size_t i = begin; i < end; ++i)
+		{
+			XMFLOAT3 p;
+			XMStoreFloat3(&p, points.Load(i));
+			m.Sum[0] += p.x; m.Sum[1] += p.y; m.Sum[2] += p.z;
+			m.Products[0] += (double)p.x*p.x; m.Products[1] += (double)p.y*p.y; m.Products[2] += (double)p.z*p.z;
+			m.Products[3] += (double)p.x*p.y; m.Products[4] += (double)p.x*p.z; m.Products[5] += (double)p.y*p.z;
+		}
+		return m;
+	}, [](const Moments& a, const Moments& b)
+	{
+		Moments r = a;
+		for(int k = 0; k < 3; ++k) r.Sum[k] += b.Sum[k];
+		for(int k = 0; k < 6; ++k) r.Products[k] += b.Products[k];
+		return r;
+	});
+
+	double n = (double)count;
+	double mean[3] = { moments.Sum[0] / n, moments.Sum[1] / n, moments.Sum[2] / n };
+
+	double cov[3][3];
+	cov[0][0] = moments.Products[0] / n - mean[0]*mean[0];
+	cov[1][1] = moments.Products[1] / n - mean[1]*mean[1];
+	cov[2][2] = moments.Products[2] / n - mean[2]*mean[2];
+	cov[0][1] = cov[1][0] = moments.Products[3] / n - mean[0]*mean[1];
+	cov[0][2] = cov[2][0] = moments.Products[4] / n - mean[0]*mean[2];
+	cov[1][2] = cov[2][1] = moments.Products[5] / n - mean[1]*mean[2];
+
+	double eigen[3][3];
+	Jacobi(cov, eigen);
+
+	// Orthonormal, right-handed axes: the third is rebuilt from the first two.
+	XMVECTOR a0 = XMVector3Normalize(XMVectorSet((float)eigen[0][0], (float)eigen[1][0], (float)eigen[2][0], 0.0f));
+	XMVECTOR a1 = XMVectorSet((float)eigen[0][1], (float)eigen[1][1], (float)eigen[2][1], 0.0f);
+	a1 = XMVector3Normalize(a1 - a0*XMVector3Dot(a0, a1));
+	XMVECTOR a2 = XMVector3Cross(a0, a1);
+
+	XMFLOAT3 axes[3];
+	XMStoreFloat3(&axes[0], a0);
+	XMStoreFloat3(&axes[1], a1);
+	XMStoreFloat3(&axes[2], a2);
+
+	MinMax extent = ComputeMinMax(points, axes);
+
+	XMFLOAT3 extents(0.5f*(extent.Max.x - extent.Min.x), 0.5f*(extent.Max.y - extent.Min.y), 0.5f*(extent.Max.z - extent.Min.z));
+
+	// The fit can lose to the axis-aligned box, e.g. for a cube whose
+	// covariance has no preferred direction.
+	float obbVolume = extents.x*extents.y*extents.z;
+	float aabbVolume = aabb.Extents.x*aabb.Extents.y*aabb.Extents.z;
+	if(obbVolume >= aabbVolume)
+		return;
+
+	XMVECTOR localCenter = 0.5f*(XMLoadFloat3(&extent.Min) + XMLoadFloat3(&extent.Max));
+	XMMATRIX rotation(a0, a1, a2, g_XMIdentityR3);
+
+	XMStoreFloat3(&box.Center, XMVector3TransformNormal(localCenter, rotation));
+	box.Extents = extents;
+	XMStoreFloat4(&box.Orientation, XMQuaternionRotationMatrix(rotation));
+}
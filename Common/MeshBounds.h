@@ -0,0 +1,59 @@
+//***************************************************************************************
+// MeshBounds.h
+//
+// Bounding volumes for GeometryGenerator::MeshData, whole or per submesh range:
+//   axis-aligned box     exact
+//   sphere               Ritter's extreme-point sphere, then shrunk and regrown
+//                        a few times, which typically lands within a few
+//                        percent of the minimum sphere
+//   oriented box         optional; axes from the covariance of the points (PCA),
+//                        replaced by the axis-aligned box when that is smaller
+//
+// The passes over the points are reductions that split across the Parallel
+// worker pool for large meshes.  The results are meant for
+// SubmeshGeometry::Bounds and SubmeshGeometry::Sphere.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <DirectXCollision.h>
+
+class MeshBounds
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+	using MeshData = GeometryGenerator::MeshData;
+
+	struct Result
+	{
+		DirectX::BoundingBox Box;
+		DirectX::BoundingSphere Sphere;
+
+		// Only filled when requested; otherwise equal to Box.
+		DirectX::BoundingOrientedBox OrientedBox;
+	};
+
+	///<summary>
+	/// Bounds of every vertex of meshData.
+	///</summary>
+	static Result Compute(const MeshData& meshData, bool orientedBox = false);
+
+	///<summary>
+	/// Bounds of the vertices a submesh range references, in the same space as
+	/// meshData (BaseVertexLocation is applied to find the vertices).
+	///</summary>
+	static Result Compute(const MeshData& meshData, uint32 indexCount, uint32 startIndexLocation,
+		int baseVertexLocation, bool orientedBox = false);
+
+	///<summary>
+	/// Bounds of count positions spaced stride bytes apart, so any vertex
+	/// struct that holds an XMFLOAT3 position can be passed directly.
+	///</summary>
+	static Result Compute(const DirectX::XMFLOAT3* positions, size_t count, size_t stride, bool orientedBox = false);
+
+	static void ComputeBox(const DirectX::XMFLOAT3* positions, size_t count, size_t stride, DirectX::BoundingBox& box);
+	static void ComputeSphere(const DirectX::XMFLOAT3* positions, size_t count, size_t stride, DirectX::BoundingSphere& sphere);
+	static void ComputeOrientedBox(const DirectX::XMFLOAT3* positions, size_t count, size_t stride, DirectX::BoundingOrientedBox& box);
+};
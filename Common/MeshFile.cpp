@@ -0,0 +1,338 @@
+//***************************************************************************************
+// MeshFile.cpp
+//***************************************************************************************
+
+#include "MeshFile.h"
+#include <windows.h>
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+
+const MeshFile::uint32 MeshFile::Magic;
+const MeshFile::uint32 MeshFile::Version;
+const MeshFile::uint32 MeshFile::SectionAlignment;
+
+namespace
+{
+	using uint32 = MeshFile::uint32;
+	using uint64 = MeshFile::uint64;
+
+	uint64 AlignUp(uint64 offset)
+	{
+		return (offset + MeshFile::SectionAlignment - 1) & ~uint64(MeshFile::SectionAlignment - 1);
+	}
+
+	uint32 ReadIndex(const MeshFile::MeshDesc& desc, uint32 i)
+	{
+		return desc.IndexSize == 2 ?
+			static_cast<const std::uint16_t*>(desc.Indices)[i] :
+			static_cast<const uint32*>(desc.Indices)[i];
+	}
+
+	const XMFLOAT3* Position(const MeshFile::MeshDesc& desc, uint32 vertex)
+	{
+		return reinterpret_cast<const XMFLOAT3*>(static_cast<const std::uint8_t*>(desc.Vertices) + (size_t)vertex*desc.VertexStride);
+	}
+
+	// Bounds of the vertices an index range references, or false if the
+	// range or a vertex it references is outside the buffers.
+	bool RangeBounds(const MeshFile::MeshDesc& desc, uint32 indexCount, uint32 startIndex,
+		std::int32_t baseVertex, BoundingBox& bounds)
+	{
+		if((uint64)startIndex + indexCount > desc.IndexCount)
+			return false;
+
+		XMVECTOR vMin = XMVectorReplicate(+FLT_MAX);
+		XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+		for(uint32 i = startIndex; i < startIndex + indexCount; ++i)
+		{
+			std::int64_t v = (std::int64_t)ReadIndex(desc, i) + baseVertex;
+			if(v < 0 || v >= desc.VertexCount)
+				return false;
+
+			XMVECTOR p = XMLoadFloat3(Position(desc, (uint32)v));
+			vMin = XMVectorMin(vMin, p);
+			vMax = XMVectorMax(vMax, p);
+		}
+
+		if(indexCount == 0)
+			vMin = vMax = XMVectorZero();
+
+		BoundingBox::CreateFromPoints(bounds, vMin, vMax);
+		return true;
+	}
+
+	// Pads with zeros up to offset.  Fails, rather than computing a huge pad,
+	// if an earlier write failed (tellp() returns -1) or wrote past offset.
+	bool WritePadding(std::ofstream& fout, uint64 offset)
+	{
+		static const char zeros[MeshFile::SectionAlignment] = {};
+		if(!fout)
+			return false;
+
+		std::streamoff position = fout.tellp();
+		if(position < 0 || (uint64)position > offset || offset - (uint64)position > sizeof(zeros))
+			return false;
+
+		fout.write(zeros, (std::streamsize)(offset - (uint64)position));
+		return (bool)fout;
+	}
+}
+
+bool MeshFile::Write(const std::wstring& filename, const MeshDesc& desc)
+{
+	if(desc.VertexStride < sizeof(XMFLOAT3) || (desc.IndexSize != 2 && desc.IndexSize != 4))
+		return false;
+
+	FileHeader header = {};
+	header.Magic = Magic;
+	header.Version = Version;
+	header.HeaderSize = sizeof(FileHeader);
+	header.VertexCount = desc.VertexCount;
+	header.VertexStride = desc.VertexStride;
+	header.IndexCount = desc.IndexCount;
+	header.IndexSize = desc.IndexSize;
+	header.SubmeshCount = (uint32)desc.Submeshes.size();
+
+	//
+	// Submesh and LOD tables, with bounds taken from the full detail range.
+	//
+
+	std::vector<SubmeshRecord> submeshes(desc.Submeshes.size());
+	std::vector<LodRecord> lods;
+	std::string names;
+
+	for(size_t i = 0; i < desc.Submeshes.size(); ++i)
+	{
+		const SubmeshDesc& src = desc.Submeshes[i];
+		SubmeshRecord& dst = submeshes[i];
+
+		dst.NameOffset = (uint32)names.size();
+		dst.NameLength = (uint32)src.Name.size();
+		names.append(src.Name.c_str(), src.Name.size() + 1);
+
+		dst.IndexCount = src.IndexCount;
+		dst.StartIndexLocation = src.StartIndexLocation;
+		dst.BaseVertexLocation = src.BaseVertexLocation;
+		dst.FirstLod = (uint32)lods.size();
+		dst.LodCount = (uint32)src.Lods.size();
+
+		if(!RangeBounds(desc, src.IndexCount, src.StartIndexLocation, src.BaseVertexLocation, dst.Bounds))
+			return false;
+
+		BoundingBox unused;
+		for(const LodRecord& lod : src.Lods)
+		{
+			if(!RangeBounds(desc, lod.IndexCount, lod.StartIndexLocation, lod.BaseVertexLocation, unused))
+				return false;
+			lods.push_back(lod);
+		}
+	}
+
+	header.LodCount = (uint32)lods.size();
+	header.NameBytes = (uint32)names.size();
+
+	XMVECTOR vMin = XMVectorReplicate(+FLT_MAX);
+	XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+	for(uint32 v = 0; v < desc.VertexCount; ++v)
+	{
+		XMVECTOR p = XMLoadFloat3(Position(desc, v));
+		vMin = XMVectorMin(vMin, p);
+		vMax = XMVectorMax(vMax, p);
+	}
+	if(desc.VertexCount == 0)
+		vMin = vMax = XMVectorZero();
+	BoundingBox::CreateFromPoints(header.Bounds, vMin, vMax);
+
+	//
+	// Section layout.
+	//
+
+	uint64 vertexBytes = (uint64)desc.VertexCount*desc.VertexStride;
+	uint64 indexBytes = (uint64)desc.IndexCount*desc.IndexSize;
+
+	header.VertexOffset = AlignUp(sizeof(FileHeader));
+	header.IndexOffset = AlignUp(header.VertexOffset + vertexBytes);
+	header.SubmeshOffset = AlignUp(header.IndexOffset + indexBytes);
+	header.LodOffset = AlignUp(header.SubmeshOffset + submeshes.size()*sizeof(SubmeshRecord));
+	header.NameOffset = AlignUp(header.LodOffset + lods.size()*sizeof(LodRecord));
+
+	std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+	if(!fout)
+		return false;
+
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if(!WritePadding(fout, header.VertexOffset))
+		return false;
+	fout.write(static_cast<const char*>(desc.Vertices), (std::streamsize)vertexBytes);
+	if(!WritePadding(fout, header.IndexOffset))
+		return false;
+	fout.write(static_cast<const char*>(desc.Indices), (std::streamsize)indexBytes);
+	if(!WritePadding(fout, header.SubmeshOffset))
+		return false;
+	fout.write(reinterpret_cast<const char*>(submeshes.data()), submeshes.size()*sizeof(SubmeshRecord));
+	if(!WritePadding(fout, header.LodOffset))
+		return false;
+	fout.write(reinterpret_cast<const char*>(lods.data()), lods.size()*sizeof(LodRecord));
+	if(!WritePadding(fout, header.NameOffset))
+		return false;
+	fout.write(names.data(), names.size());
+
+	return (bool)fout.flush();
+}
+
+MeshFile::~MeshFile()
+{
+	Close();
+}
+
+bool MeshFile::Open(const std::wstring& filename)
+{
+	Close();
+
+	HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+	mFile = file;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size) || (uint64)size.QuadPart < sizeof(FileHeader))
+	{
+		Close();
+		return false;
+	}
+	mSize = (uint64)size.QuadPart;
+
+	mMapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mMapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	// The view is page aligned, so the 64 byte aligned sections are too.
+	mView = static_cast<const std::uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+	if(mView == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	mHeader = reinterpret_cast<const FileHeader*>(mView);
+	if(!Validate())
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshFile::Close()
+{
+	if(mView != nullptr)
+		UnmapViewOfFile(mView);
+	if(mMapping != nullptr)
+		CloseHandle(mMapping);
+	if(mFile != nullptr)
+		CloseHandle(mFile);
+
+	mFile = nullptr;
+	mMapping = nullptr;
+	mView = nullptr;
+	mSize = 0;
+	mHeader = nullptr;
+}
+
+const MeshFile::uint16* MeshFile::GetIndices16()const
+{
+	return mHeader->IndexSize == 2 ? static_cast<const uint16*>(GetIndexData()) : nullptr;
+}
+
+const MeshFile::uint32* MeshFile::GetIndices32()const
+{
+	return mHeader->IndexSize == 4 ? static_cast<const uint32*>(GetIndexData()) : nullptr;
+}
+
+const MeshFile::SubmeshRecord* MeshFile::GetSubmeshes()const
+{
+	return reinterpret_cast<const SubmeshRecord*>(mView + mHeader->SubmeshOffset);
+}
+
+const char* MeshFile::GetSubmeshName(const SubmeshRecord& submesh)const
+{
+	return reinterpret_cast<const char*>(mView + mHeader->NameOffset) + submesh.NameOffset;
+}
+
+const MeshFile::SubmeshRecord* MeshFile::FindSubmesh(const std::string& name)const
+{
+	const SubmeshRecord* submeshes = GetSubmeshes();
+	for(uint32 i = 0; i < mHeader->SubmeshCount; ++i)
+	{
+		if(submeshes[i].NameLength == name.size() &&
+			std::memcmp(GetSubmeshName(submeshes[i]), name.data(), name.size()) == 0)
+			return &submeshes[i];
+	}
+
+	return nullptr;
+}
+
+const MeshFile::LodRecord* MeshFile::GetLods(const SubmeshRecord& submesh)const
+{
+	return reinterpret_cast<const LodRecord*>(mView + mHeader->LodOffset) + submesh.FirstLod;
+}
+
+bool MeshFile::Validate()const
+{
+	const FileHeader& h = *mHeader;
+
+	if(h.Magic != Magic || h.Version != Version || h.HeaderSize != sizeof(FileHeader))
+		return false;
+	if(h.VertexStride == 0 || (h.IndexSize != 2 && h.IndexSize != 4))
+		return false;
+
+	// Counts are 32 bit and record sizes small, so none of these overflow.
+	struct Section { uint64 Offset; uint64 Bytes; };
+	const Section sections[] =
+	{
+		{ h.VertexOffset, (uint64)h.VertexCount*h.VertexStride },
+		{ h.IndexOffset, (uint64)h.IndexCount*h.IndexSize },
+		{ h.SubmeshOffset, (uint64)h.SubmeshCount*sizeof(SubmeshRecord) },
+		{ h.LodOffset, (uint64)h.LodCount*sizeof(LodRecord) },
+		{ h.NameOffset, (uint64)h.NameBytes }
+	};
+
+	for(const Section& section : sections)
+	{
+		if(section.Offset % SectionAlignment != 0 || section.Offset > mSize || section.Bytes > mSize - section.Offset)
+			return false;
+	}
+
+	// One pass over the small tables so the accessors never read outside
+	// the file.  Index values themselves are left to the GPU.
+	const SubmeshRecord* submeshes = GetSubmeshes();
+	const char* names = reinterpret_cast<const char*>(mView + h.NameOffset);
+	for(uint32 i = 0; i < h.SubmeshCount; ++i)
+	{
+		const SubmeshRecord& submesh = submeshes[i];
+		if((uint64)submesh.NameOffset + submesh.NameLength >= h.NameBytes ||
+			names[submesh.NameOffset + submesh.NameLength] != '\0')
+			return false;
+		if((uint64)submesh.StartIndexLocation + submesh.IndexCount > h.IndexCount)
+			return false;
+		if((uint64)submesh.FirstLod + submesh.LodCount > h.LodCount)
+			return false;
+	}
+
+	const LodRecord* lods = reinterpret_cast<const LodRecord*>(mView + h.LodOffset);
+	for(uint32 i = 0; i < h.LodCount; ++i)
+	{
+		if((uint64)lods[i].StartIndexLocation + lods[i].IndexCount > h.IndexCount)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,162 @@
+//***************************************************************************************
+// MeshFile.h
+//
+// Binary mesh container that is read by memory mapping the file.  Every
+// section starts on a 64 byte boundary and is stored exactly as it is used,
+// so opening a file validates the header and section table and nothing else;
+// vertex and index data are only touched (and paged in) when read, e.g. by
+// d3dUtil::CreateDefaultBuffer straight from GetVertexData/GetIndexData.
+//
+//   FileHeader
+//   vertices     VertexCount x VertexStride bytes, any layout
+//   indices      IndexCount x IndexSize (2 or 4) bytes
+//   submeshes    SubmeshCount x SubmeshRecord (the DrawArgs of a MeshGeometry)
+//   lods         LodCount x LodRecord, coarser index ranges per submesh
+//   names        NUL terminated submesh names
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <DirectXCollision.h>
+#include <string>
+#include <vector>
+
+class MeshFile
+{
+public:
+
+	using uint16 = std::uint16_t;
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	static const uint32 Magic = 0x4853454d; // "MESH"
+	static const uint32 Version = 1;
+	static const uint32 SectionAlignment = 64;
+
+	// A coarser version of a submesh, drawn like a SubmeshGeometry.  Error is
+	// the simplification error MeshSimplifier reported for it.
+	struct LodRecord
+	{
+		uint32 IndexCount = 0;
+		uint32 StartIndexLocation = 0;
+		std::int32_t BaseVertexLocation = 0;
+		float Error = 0.0f;
+	};
+
+	struct SubmeshRecord
+	{
+		uint32 NameOffset;
+		uint32 NameLength;
+		uint32 IndexCount;
+		uint32 StartIndexLocation;
+		std::int32_t BaseVertexLocation;
+		uint32 FirstLod;
+		uint32 LodCount;
+		DirectX::BoundingBox Bounds;
+	};
+
+	struct FileHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 HeaderSize;
+		uint32 VertexCount;
+		uint32 VertexStride;
+		uint32 IndexCount;
+		uint32 IndexSize;
+		uint32 SubmeshCount;
+		uint32 LodCount;
+		uint32 NameBytes;
+		uint64 VertexOffset;
+		uint64 IndexOffset;
+		uint64 SubmeshOffset;
+		uint64 LodOffset;
+		uint64 NameOffset;
+		DirectX::BoundingBox Bounds;
+	};
+
+	struct SubmeshDesc
+	{
+		std::string Name;
+		uint32 IndexCount = 0;
+		uint32 StartIndexLocation = 0;
+		std::int32_t BaseVertexLocation = 0;
+		std::vector<LodRecord> Lods;
+	};
+
+	// Input of Write.  The data is only referenced and must outlive the call.
+	struct MeshDesc
+	{
+		const void* Vertices = nullptr;
+		uint32 VertexCount = 0;
+		uint32 VertexStride = 0;
+
+		const void* Indices = nullptr;
+		uint32 IndexCount = 0;
+		uint32 IndexSize = sizeof(uint32);
+
+		std::vector<SubmeshDesc> Submeshes;
+	};
+
+	///<summary>
+	/// Writes a mesh file.  Bounds are computed from the first float3 of each
+	/// vertex, where both GeometryGenerator::Vertex and the app vertices keep
+	/// the position.  Returns false if a submesh or LOD indexes outside the
+	/// buffers or the file cannot be written.
+	///</summary>
+	static bool Write(const std::wstring& filename, const MeshDesc& desc);
+
+	MeshFile() = default;
+	MeshFile(const MeshFile& rhs) = delete;
+	MeshFile& operator=(const MeshFile& rhs) = delete;
+	~MeshFile();
+
+	///<summary>
+	/// Maps the file read-only and checks that every section lies inside it.
+	/// Returns false, leaving the object closed, for a missing or malformed file.
+	///</summary>
+	bool Open(const std::wstring& filename);
+	void Close();
+	bool IsOpen()const { return mHeader != nullptr; }
+
+	uint64 GetFileSize()const { return mSize; }
+	const DirectX::BoundingBox& GetBounds()const { return mHeader->Bounds; }
+
+	uint32 GetVertexCount()const { return mHeader->VertexCount; }
+	uint32 GetVertexStride()const { return mHeader->VertexStride; }
+	const void* GetVertexData()const { return mView + mHeader->VertexOffset; }
+
+	// Typed view of the vertices; null if T does not match the stored stride.
+	template<typename T>
+	const T* GetVertices()const
+	{
+		return sizeof(T) == mHeader->VertexStride ? static_cast<const T*>(GetVertexData()) : nullptr;
+	}
+
+	uint32 GetIndexCount()const { return mHeader->IndexCount; }
+	uint32 GetIndexSize()const { return mHeader->IndexSize; }
+	const void* GetIndexData()const { return mView + mHeader->IndexOffset; }
+
+	// Null unless the file stores indices of that size.
+	const uint16* GetIndices16()const;
+	const uint32* GetIndices32()const;
+
+	uint32 GetSubmeshCount()const { return mHeader->SubmeshCount; }
+	const SubmeshRecord* GetSubmeshes()const;
+	const char* GetSubmeshName(const SubmeshRecord& submesh)const;
+	const SubmeshRecord* FindSubmesh(const std::string& name)const;
+
+	// The LODs of a submesh, GetSubmeshes()[i].LodCount of them.
+	const LodRecord* GetLods(const SubmeshRecord& submesh)const;
+
+private:
+
+	bool Validate()const;
+
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+	const std::uint8_t* mView = nullptr;
+	uint64 mSize = 0;
+	const FileHeader* mHeader = nullptr;
+};
@@ -0,0 +1,443 @@
+//***************************************************************************************
+// MeshOptimizer.cpp
+//***************************************************************************************
+
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+const MeshOptimizer::uint32 MeshOptimizer::DefaultCacheSize;
+const MeshOptimizer::uint32 MeshOptimizer::InvalidIndex;
+const MeshOptimizer::uint32 MeshOptimizer::FetchCacheLineSize;
+const MeshOptimizer::uint32 MeshOptimizer::FetchCacheLineCount;
+
+namespace
+{
+	using uint32 = MeshOptimizer::uint32;
+
+	// Vertex -> triangle adjacency stored as one flat array.  The triangles that
+	// use vertex v are Triangles[Offsets[v]] .. Triangles[Offsets[v+1]-1].
+	struct TriangleAdjacency
+	{
+		std::vector<uint32> Offsets;
+		std::vector<uint32> Triangles;
+	};
+
+	void BuildTriangleAdjacency(const std::vector<uint32>& indices, size_t vertexCount, TriangleAdjacency& adj)
+	{
+		adj.Offsets.assign(vertexCount + 1, 0);
+		adj.Triangles.resize(indices.size());
+
+		for(uint32 index : indices)
+			adj.Offsets[index + 1]++;
+
+		for(size_t v = 0; v < vertexCount; ++v)
+			adj.Offsets[v + 1] += adj.Offsets[v];
+
+		std::vector<uint32> cursor(adj.Offsets.begin(), adj.Offsets.end() - 1);
+		for(size_t i = 0; i < indices.size(); ++i)
+			adj.Triangles[cursor[indices[i]]++] = (uint32)(i / 3);
+	}
+
+	bool Near(const float* a, const float* b, int count, float epsilon)
+	{
+		for(int i = 0; i < count; ++i)
+		{
+			if(fabsf(a[i] - b[i]) > epsilon)
+				return false;
+		}
+		return true;
+	}
+
+	bool WeldMatch(const GeometryGenerator::Vertex& a, const GeometryGenerator::Vertex& b, float epsilon, uint32 mask)
+	{
+		return Near(&a.Position.x, &b.Position.x, 3, epsilon) &&
+			(!(mask & MeshOptimizer::WeldNormal) || Near(&a.Normal.x, &b.Normal.x, 3, epsilon)) &&
+			(!(mask & MeshOptimizer::WeldTangent) || Near(&a.TangentU.x, &b.TangentU.x, 3, epsilon)) &&
+			(!(mask & MeshOptimizer::WeldTexC) || Near(&a.TexC.x, &b.TexC.x, 2, epsilon));
+	}
+
+	// Weld grid coordinate of one position component.  With a zero epsilon the
+	// float bits are the cell, so only exact matches share one.
+	std::int64_t WeldCell(float v, float invCellSize)
+	{
+		if(invCellSize == 0.0f)
+		{
+			float folded = v + 0.0f; // -0 -> +0
+			std::int32_t bits;
+			std::memcpy(&bits, &folded, sizeof(bits));
+			return bits;
+		}
+
+		return (std::int64_t)floorf(v*invCellSize);
+	}
+
+	std::uint64_t WeldCellKey(std::int64_t x, std::int64_t y, std::int64_t z)
+	{
+		return (std::uint64_t)x*73856093ull ^ (std::uint64_t)y*19349663ull ^ (std::uint64_t)z*83492791ull;
+	}
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32>& indices,
+	size_t vertexCount, uint32 cacheSize)
+{
+	VertexCacheStats stats;
+
+	size_t triCount = indices.size() / 3;
+	if(triCount == 0 || vertexCount == 0)
+		return stats;
+
+	// A vertex is in a FIFO cache if fewer than cacheSize misses happened
+	// since it was last inserted.  This avoids simulating the queue itself.
+	std::vector<uint32> insertedAt(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+
+	uint32 misses = 0;
+	uint32 uniqueCount = 0;
+	for(uint32 index : indices)
+	{
+		if(!referenced[index])
+		{
+			referenced[index] = true;
+			uniqueCount++;
+		}
+		else if(misses - insertedAt[index] < cacheSize)
+		{
+			continue;
+		}
+
+		insertedAt[index] = misses;
+		misses++;
+	}
+
+	stats.ACMR = (float)misses / triCount;
+	stats.ATVR = (float)misses / uniqueCount;
+
+	return stats;
+}
+
+MeshOptimizer::VertexCacheReport MeshOptimizer::OptimizeVertexCache(MeshData& meshData, uint32 cacheSize)
+{
+	return OptimizeVertexCache(meshData.Indices32, meshData.Vertices.size(), cacheSize);
+}
+
+MeshOptimizer::VertexCacheReport MeshOptimizer::OptimizeVertexCache(std::vector<uint32>& indices,
+	size_t vertexCount, uint32 cacheSize)
+{
+	VertexCacheReport report;
+	report.Before = AnalyzeVertexCache(indices, vertexCount, cacheSize);
+
+	size_t triCount = indices.size() / 3;
+	if(triCount == 0)
+	{
+		report.After = report.Before;
+		return report;
+	}
+
+	TriangleAdjacency adj;
+	BuildTriangleAdjacency(indices, vertexCount, adj);
+
+	// Number of not yet emitted triangles that use each vertex.
+	std::vector<uint32> liveCount(vertexCount);
+	for(size_t v = 0; v < vertexCount; ++v)
+		liveCount[v] = adj.Offsets[v + 1] - adj.Offsets[v];
+
+	// Time at which each vertex last entered the simulated cache.
+	std::vector<uint32> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triCount, false);
+
+	// Recently referenced vertices; used to escape when the fanning vertex
+	// runs out of triangles.
+	std::vector<uint32> deadEnd;
+	deadEnd.reserve(indices.size());
+
+	std::vector<uint32> candidates;
+	candidates.reserve(64);
+
+	std::vector<uint32> output;
+	output.reserve(indices.size());
+
+	uint32 timeStamp = cacheSize + 1;
+	uint32 cursor = 0;
+
+	uint32 fanning = indices[0];
+	for(;;)
+	{
+		candidates.clear();
+
+		// Emit every remaining triangle around the fanning vertex.
+		for(uint32 k = adj.Offsets[fanning]; k < adj.Offsets[fanning + 1]; ++k)
+		{
+			uint32 tri = adj.Triangles[k];
+			if(emitted[tri])
+				continue;
+
+			for(uint32 c = 0; c < 3; ++c)
+			{
+				uint32 v = indices[tri*3 + c];
+
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				liveCount[v]--;
+
+				if(timeStamp - cacheTime[v] > cacheSize)
+					cacheTime[v] = timeStamp++;
+			}
+
+			emitted[tri] = true;
+		}
+
+		// Pick the candidate that will still be in the cache after its
+		// remaining triangles are emitted, preferring the oldest one.
+		int next = -1;
+		int best = -1;
+		for(uint32 v : candidates)
+		{
+			if(liveCount[v] == 0)
+				continue;
+
+			int priority = 0;
+			if(timeStamp - cacheTime[v] + 2*liveCount[v] <= cacheSize)
+				priority = (int)(timeStamp - cacheTime[v]);
+
+			if(priority > best)
+			{
+				best = priority;
+				next = (int)v;
+			}
+		}
+
+		// Dead end: back up through recently used vertices, then fall back
+		// to scanning the vertex list in order.
+		while(next == -1 && !deadEnd.empty())
+		{
+			uint32 v = deadEnd.back();
+			deadEnd.pop_back();
+
+			if(liveCount[v] > 0)
+				next = (int)v;
+		}
+
+		while(next == -1 && cursor < vertexCount)
+		{
+			if(liveCount[cursor] > 0)
+				next = (int)cursor;
+
+			cursor++;
+		}
+
+		if(next == -1)
+			break;
+
+		fanning = (uint32)next;
+	}
+
+	indices.swap(output);
+
+	report.After = AnalyzeVertexCache(indices, vertexCount, cacheSize);
+
+	return report;
+}
+
+MeshOptimizer::VertexFetchStats MeshOptimizer::AnalyzeVertexFetch(const std::vector<uint32>& indices,
+	size_t vertexCount, size_t vertexByteSize)
+{
+	VertexFetchStats stats;
+
+	if(indices.empty() || vertexCount == 0 || vertexByteSize == 0)
+		return stats;
+
+	size_t lineCount = (vertexCount*vertexByteSize + FetchCacheLineSize - 1) / FetchCacheLineSize;
+
+	// Same FIFO trick as AnalyzeVertexCache, but over cache lines.
+	std::vector<uint32> insertedAt(lineCount, 0);
+	std::vector<bool> lineSeen(lineCount, false);
+	std::vector<bool> vertexSeen(vertexCount, false);
+
+	size_t misses = 0;
+	size_t uniqueCount = 0;
+	for(uint32 index : indices)
+	{
+		if(!vertexSeen[index])
+		{
+			vertexSeen[index] = true;
+			uniqueCount++;
+		}
+
+		size_t firstLine = (index*vertexByteSize) / FetchCacheLineSize;
+		size_t lastLine = ((index + 1)*vertexByteSize - 1) / FetchCacheLineSize;
+
+		for(size_t line = firstLine; line <= lastLine; ++line)
+		{
+			if(lineSeen[line] && misses - insertedAt[line] < FetchCacheLineCount)
+				continue;
+
+			lineSeen[line] = true;
+			insertedAt[line] = (uint32)misses;
+			misses++;
+		}
+	}
+
+	stats.Overfetch = (float)(misses*FetchCacheLineSize) / (float)(uniqueCount*vertexByteSize);
+
+	return stats;
+}
+
+MeshOptimizer::VertexFetchReport MeshOptimizer::OptimizeVertexFetch(MeshData& meshData, size_t vertexByteSize)
+{
+	VertexFetchReport report = OptimizeVertexFetchRemap(meshData.Indices32, meshData.Vertices.size(), vertexByteSize);
+
+	RemapVertices(meshData.Vertices, report.Remap, report.VertexCount);
+
+	return report;
+}
+
+MeshOptimizer::VertexFetchReport MeshOptimizer::OptimizeVertexFetchRemap(std::vector<uint32>& indices,
+	size_t vertexCount, size_t vertexByteSize)
+{
+	VertexFetchReport report;
+	report.Before = AnalyzeVertexFetch(indices, vertexCount, vertexByteSize);
+
+	report.Remap.assign(vertexCount, InvalidIndex);
+
+	uint32 next = 0;
+	for(uint32& index : indices)
+	{
+		if(report.Remap[index] == InvalidIndex)
+			report.Remap[index] = next++;
+
+		index = report.Remap[index];
+	}
+
+	report.VertexCount = next;
+	report.After = AnalyzeVertexFetch(indices, next, vertexByteSize);
+
+	return report;
+}
+
+MeshOptimizer::WeldReport MeshOptimizer::Weld(MeshData& meshData, float epsilon, uint32 attributeMask)
+{
+	WeldReport report;
+	report.VerticesBefore = (uint32)meshData.Vertices.size();
+
+	epsilon = std::max(epsilon, 0.0f);
+	const float invCellSize = epsilon > 0.0f ? 0.5f / epsilon : 0.0f;
+
+	const auto& vertices = meshData.Vertices;
+	std::vector<GeometryGenerator::Vertex> welded;
+	welded.reserve(vertices.size());
+
+	// Kept vertices chained per cell: cellHeads[key] is the newest, next[] the rest.
+	std::unordered_map<std::uint64_t, uint32> cellHeads;
+	cellHeads.reserve(vertices.size());
+	std::vector<uint32> next;
+	next.reserve(vertices.size());
+
+	std::vector<uint32> remap(vertices.size());
+	for(size_t v = 0; v < vertices.size(); ++v)
+	{
+		const GeometryGenerator::Vertex& vertex = vertices[v];
+		const DirectX::XMFLOAT3& p = vertex.Position;
+
+		// A cell is at least 2*epsilon wide, so anything within epsilon lies in
+		// one of at most two cells per axis.
+		std::int64_t lo[3] = { WeldCell(p.x - epsilon, invCellSize), WeldCell(p.y - epsilon, invCellSize), WeldCell(p.z - epsilon, invCellSize) };
+		std::int64_t hi[3] = { WeldCell(p.x + epsilon, invCellSize), WeldCell(p.y + epsilon, invCellSize), WeldCell(p.z + epsilon, invCellSize) };
+
+		uint32 match = InvalidIndex;
+		for(std::int64_t x = lo[0]; x <= hi[0] && match == InvalidIndex; ++x)
+		{
+			for(std::int64_t y = lo[1]; y <= hi[1] && match == InvalidIndex; ++y)
+			{
+				for(std::int64_t z = lo[2]; z <= hi[2] && match == InvalidIndex; ++z)
+				{
+					auto it = cellHeads.find(WeldCellKey(x, y, z));
+					if(it == cellHeads.end())
+						continue;
+
+					for(uint32 w = it->second; w != InvalidIndex; w = next[w])
+					{
+						if(WeldMatch(vertex, welded[w], epsilon, attributeMask))
+						{
+							match = w;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		if(match == InvalidIndex)
+		{
+			match = (uint32)welded.size();
+			welded.push_back(vertex);
+
+			std::uint64_t key = WeldCellKey(WeldCell(p.x, invCellSize), WeldCell(p.y, invCellSize), WeldCell(p.z, invCellSize));
+			auto inserted = cellHeads.emplace(key, match);
+			next.push_back(inserted.second ? InvalidIndex : inserted.first->second);
+			inserted.first->second = match;
+		}
+
+		remap[v] = match;
+	}
+
+	//
+	// Rewrite the triangles, dropping the ones that lost a corner.
+	//
+
+	std::vector<uint32>& indices = meshData.Indices32;
+	size_t out = 0;
+	for(size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		uint32 a = remap[indices[i]];
+		uint32 b = remap[indices[i + 1]];
+		uint32 c = remap[indices[i + 2]];
+		if(a == b || b == c || c == a)
+		{
+			report.DegenerateTriangles++;
+			continue;
+		}
+
+		indices[out++] = a;
+		indices[out++] = b;
+		indices[out++] = c;
+	}
+	indices.resize(out);
+
+	meshData.Vertices.swap(welded);
+	report.VerticesAfter = (uint32)meshData.Vertices.size();
+
+	return report;
+}
+
+std::string MeshOptimizer::ToString(const VertexCacheReport& report)
+{
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer), "ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+		report.Before.ACMR, report.After.ACMR, report.Before.ATVR, report.After.ATVR);
+
+	return buffer;
+}
+
+std::string MeshOptimizer::ToString(const VertexFetchReport& report)
+{
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer), "overfetch %.3f -> %.3f, %u vertices",
+		report.Before.Overfetch, report.After.Overfetch, report.VertexCount);
+
+	return buffer;
+}
+
+std::string MeshOptimizer::ToString(const WeldReport& report)
+{
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer), "welded %u -> %u vertices (%u removed), %u degenerate triangles",
+		report.VerticesBefore, report.VerticesAfter, report.VerticesBefore - report.VerticesAfter,
+		report.DegenerateTriangles);
+
+	return buffer;
+}
@@ -0,0 +1,153 @@
+//***************************************************************************************
+// MeshOptimizer.h
+//
+// Post-processing passes that reorder GeometryGenerator::MeshData for the GPU.
+// None of the passes change what is drawn; they only change the order in which
+// triangles and vertices are stored so the hardware does less work.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <string>
+
+class MeshOptimizer
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+	using MeshData = GeometryGenerator::MeshData;
+
+	// Size of the simulated post-transform cache.  Real hardware sits somewhere
+	// between 16 and 32 entries, so 16 is a safe target for every GPU.
+	static const uint32 DefaultCacheSize = 16;
+
+	struct VertexCacheStats
+	{
+		// Average cache miss ratio: vertex shader invocations per triangle.
+		// 3.0 is the worst case, ~0.5 is the best a regular grid can do.
+		float ACMR = 0.0f;
+
+		// Average transform to vertex ratio: vertex shader invocations per
+		// referenced vertex.  1.0 means every vertex is transformed exactly once.
+		float ATVR = 0.0f;
+	};
+
+	struct VertexCacheReport
+	{
+		VertexCacheStats Before;
+		VertexCacheStats After;
+	};
+
+	// Marks vertices in a remap table that no index references.
+	static const uint32 InvalidIndex = 0xffffffff;
+
+	// Cache line size and line count of the simulated vertex fetch cache.
+	static const uint32 FetchCacheLineSize = 64;
+	static const uint32 FetchCacheLineCount = 64;
+
+	struct VertexFetchStats
+	{
+		// Bytes pulled through the simulated fetch cache divided by the bytes of
+		// vertex data the indices reference.  1.0 means every cache line is
+		// read once; scattered indices push this well above 1.
+		float Overfetch = 0.0f;
+	};
+
+	struct VertexFetchReport
+	{
+		VertexFetchStats Before;
+		VertexFetchStats After;
+
+		// Remap[oldIndex] = newIndex, or InvalidIndex for vertices no triangle uses.
+		// Apply it to any array that runs parallel to the vertex buffer.
+		std::vector<uint32> Remap;
+
+		// Number of vertices left after unreferenced ones were dropped.
+		uint32 VertexCount = 0;
+	};
+
+	// Attributes that must match, besides the position, for Weld to merge
+	// two vertices.  Apps that only upload positions can weld on position alone.
+	enum WeldAttributes : uint32
+	{
+		WeldPositionOnly = 0,
+		WeldNormal = 1 << 0,
+		WeldTangent = 1 << 1,
+		WeldTexC = 1 << 2,
+		WeldAll = WeldNormal | WeldTangent | WeldTexC
+	};
+
+	struct WeldReport
+	{
+		uint32 VerticesBefore = 0;
+		uint32 VerticesAfter = 0;
+
+		// Triangles removed because welding collapsed two of their corners.
+		uint32 DegenerateTriangles = 0;
+	};
+
+	///<summary>
+	/// Simulates a FIFO post-transform cache with cacheSize entries over a
+	/// triangle list and reports how often vertices had to be transformed.
+	///</summary>
+	static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32>& indices,
+		size_t vertexCount, uint32 cacheSize = DefaultCacheSize);
+
+	///<summary>
+	/// Reorders the triangles of a triangle list so that consecutive triangles
+	/// reuse vertices still in the post-transform cache (Tipsify, Sander et al. 2007).
+	/// Triangle winding is preserved.  Returns the cache statistics before and after.
+	///</summary>
+	static VertexCacheReport OptimizeVertexCache(MeshData& meshData, uint32 cacheSize = DefaultCacheSize);
+	static VertexCacheReport OptimizeVertexCache(std::vector<uint32>& indices,
+		size_t vertexCount, uint32 cacheSize = DefaultCacheSize);
+
+	///<summary>
+	/// Simulates a small cache of FetchCacheLineCount lines over the vertex
+	/// buffer, touching every line a vertex of vertexByteSize bytes covers.
+	///</summary>
+	static VertexFetchStats AnalyzeVertexFetch(const std::vector<uint32>& indices,
+		size_t vertexCount, size_t vertexByteSize);
+
+	///<summary>
+	/// Renumbers vertices in the order the indices first use them, so the
+	/// vertex buffer is read front to back.  Run after OptimizeVertexCache,
+	/// which fixes the index order this pass follows.  Unreferenced vertices are
+	/// dropped.  vertexByteSize is the stride of the buffer the app uploads,
+	/// which need not be sizeof(GeometryGenerator::Vertex).
+	///</summary>
+	static VertexFetchReport OptimizeVertexFetch(MeshData& meshData,
+		size_t vertexByteSize = sizeof(GeometryGenerator::Vertex));
+	static VertexFetchReport OptimizeVertexFetchRemap(std::vector<uint32>& indices,
+		size_t vertexCount, size_t vertexByteSize);
+
+	///<summary>
+	/// Merges vertices whose positions, and the attributes in attributeMask,
+	/// agree to within epsilon per component, then rewrites the indices and
+	/// drops triangles that collapsed.  Positions are hashed into cells of
+	/// 2*epsilon, so each vertex is compared only against the vertices already
+	/// kept in the 8 cells around it: expected O(n).  Run before OptimizeVertexCache.
+	///</summary>
+	static WeldReport Weld(MeshData& meshData, float epsilon = 1e-5f, uint32 attributeMask = WeldAll);
+
+	///<summary>
+	/// Moves the elements of a vertex-parallel array to where a remap table says.
+	///</summary>
+	template<typename T>
+	static void RemapVertices(std::vector<T>& vertices, const std::vector<uint32>& remap, uint32 newVertexCount)
+	{
+		std::vector<T> result(newVertexCount);
+		for(size_t i = 0; i < remap.size(); ++i)
+		{
+			if(remap[i] != InvalidIndex)
+				result[remap[i]] = vertices[i];
+		}
+
+		vertices.swap(result);
+	}
+
+	static std::string ToString(const VertexCacheReport& report);
+	static std::string ToString(const VertexFetchReport& report);
+	static std::string ToString(const WeldReport& report);
+};
@@ -0,0 +1,576 @@
+//***************************************************************************************
+// MeshSimplifier.cpp
+//***************************************************************************************
+
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = MeshSimplifier::uint32;
+	using Vertex = GeometryGenerator::Vertex;
+
+	const uint32 InvalidIndex = 0xffffffff;
+
+	// Border edges get an extra plane perpendicular to the surface so that
+	// moving a border vertex off the border line is expensive.
+	const float BorderWeight = 10.0f;
+
+	// A collapse may not turn a triangle by more than ~75 degrees, and may not
+	// merge vertices whose shading normals differ by more than 60 degrees.
+	const float MinFaceNormalDot = 0.25f;
+	const float MinVertexNormalDot = 0.5f;
+
+	// A border vertex may only slide along a straight border: the sine of
+	// the turn between its two border edges must stay below this, otherwise
+	// it is a corner of the outline and locked.
+	const float MaxBorderTurnSine = 1e-3f;
+
+	// Symmetric 4x4 error quadric stored as its ten unique coefficients, plus
+	// the total weight of the planes accumulated into it so the error can be
+	// reported as an average squared distance.
+	struct Quadric
+	{
+		float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f;
+		float a01 = 0.0f, a02 = 0.0f, a12 = 0.0f;
+		float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+		float c = 0.0f;
+		float w = 0.0f;
+
+		void AddPlane(const XMFLOAT3& n, float d, float weight)
+		{
+			a00 += weight*n.x*n.x; a11 += weight*n.y*n.y; a22 += weight*n.z*n.z;
+			a01 += weight*n.x*n.y; a02 += weight*n.x*n.z; a12 += weight*n.y*n.z;
+			b0 += weight*n.x*d; b1 += weight*n.y*d; b2 += weight*n.z*d;
+			c += weight*d*d;
+			w += weight;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a00 += q.a00; a11 += q.a11; a22 += q.a22;
+			a01 += q.a01; a02 += q.a02; a12 += q.a12;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			w += q.w;
+		}
+
+		float Error(const XMFLOAT3& p)const
+		{
+			float r =
+				a00*p.x*p.x + a11*p.y*p.y + a22*p.z*p.z +
+				2.0f*(a01*p.x*p.y + a02*p.x*p.z + a12*p.y*p.z) +
+				2.0f*(b0*p.x + b1*p.y + b2*p.z) + c;
+
+			return w > 0.0f ? std::max(r, 0.0f) / w : 0.0f;
+		}
+	};
+
+	enum class VertexKind
+	{
+		Manifold, // interior vertex, may collapse onto any neighbor
+		Border,   // on an open border, may only slide along it
+		Locked    // seam, corner or non-manifold vertex, never moves
+	};
+
+	struct Collapse
+	{
+		float Cost;
+		uint32 From;       // canonical vertex that disappears
+		uint32 To;         // canonical vertex it merges into
+		uint32 FromVertex; // actual vertex indices used by the triangles
+		uint32 ToVertex;
+	};
+
+	std::uint64_t EdgeKey(uint32 a, uint32 b)
+	{
+		return ((std::uint64_t)a << 32) | b;
+	}
+
+	// Maps every vertex to the lowest-numbered vertex with the same position.
+	// Vertices that share a position but differ in normal or uv form a seam.
+	std::vector<uint32> BuildPositionRemap(const std::vector<Vertex>& vertices)
+	{
+		std::vector<uint32> order(vertices.size());
+		for(uint32 i = 0; i < (uint32)order.size(); ++i)
+			order[i] = i;
+
+		auto less = [&](uint32 a, uint32 b)
+		{
+			const XMFLOAT3& pa = vertices[a].Position;
+			const XMFLOAT3& pb = vertices[b].Position;
+			if(pa.x != pb.x) return pa.x < pb.x;
+			if(pa.y != pb.y) return pa.y < pb.y;
+			if(pa.z != pb.z) return pa.z < pb.z;
+			return a < b;
+		};
+		std::sort(order.begin(), order.end(), less);
+
+		std::vector<uint32> remap(vertices.size());
+		for(size_t i = 0; i < order.size(); )
+		{
+			const XMFLOAT3& p = vertices[order[i]].Position;
+
+			size_t j = i;
+			while(j < order.size() &&
+				vertices[order[j]].Position.x == p.x &&
+				vertices[order[j]].Position.y == p.y &&
+				vertices[order[j]].Position.z == p.z)
+			{
+				remap[order[j]] = order[i];
+				++j;
+			}
+
+			i = j;
+		}
+
+		return remap;
+	}
+
+	XMVECTOR FaceNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&p0);
+		XMVECTOR e1 = XMLoadFloat3(&p1) - v0;
+		XMVECTOR e2 = XMLoadFloat3(&p2) - v0;
+
+		return XMVector3Cross(e1, e2);
+	}
+
+	// Classifies the canonical vertices of the current triangle list and
+	// records the directed border half-edges.
+	void ClassifyVertices(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices,
+		const std::vector<uint32>& canon, std::vector<VertexKind>& kinds,
+		std::unordered_map<std::uint64_t, uint32>& halfEdges)
+	{
+		size_t vertexCount = canon.size();
+
+		kinds.assign(vertexCount, VertexKind::Manifold);
+		halfEdges.clear();
+		halfEdges.reserve(indices.size());
+
+		// More than one vertex at a position makes it a seam.  Judge by the
+		// source vertices, not the ones still in use: collapses onto one
+		// side of a seam can leave the other side's copy unused, and the
+		// seam must not start moving then.
+		for(size_t v = 0; v < vertexCount; ++v)
+		{
+			if(canon[v] != v)
+				kinds[canon[v]] = VertexKind::Locked;
+		}
+
+		for(size_t i = 0; i < indices.size(); i += 3)
+		{
+			for(size_t e = 0; e < 3; ++e)
+			{
+				uint32 a = canon[indices[i + e]];
+				uint32 b = canon[indices[i + (e + 1) % 3]];
+				halfEdges[EdgeKey(a, b)]++;
+			}
+		}
+
+		std::vector<uint32> borderCount(vertexCount, 0);
+		std::vector<uint32> borderPrev(vertexCount, InvalidIndex);
+		std::vector<uint32> borderNext(vertexCount, InvalidIndex);
+		for(const auto& edge : halfEdges)
+		{
+			uint32 a = (uint32)(edge.first >> 32);
+			uint32 b = (uint32)(edge.first & 0xffffffff);
+
+			if(edge.second > 1)
+			{
+				// Non-manifold edge.
+				kinds[a] = VertexKind::Locked;
+				kinds[b] = VertexKind::Locked;
+			}
+			else if(halfEdges.find(EdgeKey(b, a)) == halfEdges.end())
+			{
+				borderCount[a]++;
+				borderCount[b]++;
+				borderNext[a] = b;
+				borderPrev[b] = a;
+			}
+		}
+
+		for(size_t v = 0; v < vertexCount; ++v)
+		{
+			if(kinds[v] == VertexKind::Locked || borderCount[v] == 0)
+				continue;
+
+			// A simple border vertex has one incoming and one outgoing border
+			// edge, and only slides if they continue in a straight line.
+			kinds[v] = VertexKind::Locked;
+			if(borderCount[v] != 2 || borderPrev[v] == InvalidIndex || borderNext[v] == InvalidIndex)
+				continue;
+
+			XMVECTOR p = XMLoadFloat3(&vertices[v].Position);
+			XMVECTOR incoming = p - XMLoadFloat3(&vertices[borderPrev[v]].Position);
+			XMVECTOR outgoing = XMLoadFloat3(&vertices[borderNext[v]].Position) - p;
+
+			float lengths = XMVectorGetX(XMVector3Length(incoming))*XMVectorGetX(XMVector3Length(outgoing));
+			float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(incoming, outgoing)));
+			if(XMVectorGetX(XMVector3Dot(incoming, outgoing)) > 0.0f && sine <= MaxBorderTurnSine*lengths)
+				kinds[v] = VertexKind::Border;
+		}
+	}
+
+	bool IsBorderEdge(const std::unordered_map<std::uint64_t, uint32>& halfEdges, uint32 a, uint32 b)
+	{
+		return halfEdges.find(EdgeKey(a, b)) == halfEdges.end() ||
+			halfEdges.find(EdgeKey(b, a)) == halfEdges.end();
+	}
+}
+
+GeometryGenerator::MeshData MeshSimplifier::Simplify(const MeshData& meshData, uint32 targetTriangleCount,
+	float maxError, float* resultError)
+{
+	MeshData result;
+	result.Vertices = meshData.Vertices;
+	result.Indices32 = meshData.Indices32;
+
+	if(resultError != nullptr)
+		*resultError = 0.0f;
+
+	std::vector<Vertex>& vertices = result.Vertices;
+	std::vector<uint32>& indices = result.Indices32;
+
+	size_t vertexCount = vertices.size();
+	if(vertexCount == 0 || indices.size()/3 <= targetTriangleCount)
+		return result;
+
+	std::vector<uint32> canon = BuildPositionRemap(vertices);
+
+	//
+	// Scale the error limit by the size of the mesh.
+	//
+
+	XMVECTOR vMin = XMLoadFloat3(&vertices[0].Position);
+	XMVECTOR vMax = vMin;
+	for(const Vertex& v : vertices)
+	{
+		XMVECTOR p = XMLoadFloat3(&v.Position);
+		vMin = XMVectorMin(vMin, p);
+		vMax = XMVectorMax(vMax, p);
+	}
+
+	float diagonal = XMVectorGetX(XMVector3Length(vMax - vMin));
+	if(diagonal <= 0.0f)
+		return result;
+
+	float maxCost = (maxError*diagonal)*(maxError*diagonal);
+
+	//
+	// Accumulate the plane of every triangle, weighted by area, into the
+	// quadrics of its corners, plus a perpendicular plane along open borders.
+	//
+
+	std::vector<VertexKind> kinds;
+	std::unordered_map<std::uint64_t, uint32> halfEdges;
+	ClassifyVertices(vertices, indices, canon, kinds, halfEdges);
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for(size_t i = 0; i < indices.size(); i += 3)
+	{
+		const XMFLOAT3& p0 = vertices[indices[i+0]].Position;
+		const XMFLOAT3& p1 = vertices[indices[i+1]].Position;
+		const XMFLOAT3& p2 = vertices[indices[i+2]].Position;
+
+		XMVECTOR n = FaceNormal(p0, p1, p2);
+		float length = XMVectorGetX(XMVector3Length(n));
+		if(length <= 0.0f)
+			continue;
+
+		n = n / length;
+
+		XMFLOAT3 normal;
+		XMStoreFloat3(&normal, n);
+		float d = -XMVectorGetX(XMVector3Dot(n, XMLoadFloat3(&p0)));
+
+		for(size_t c = 0; c < 3; ++c)
+			quadrics[canon[indices[i + c]]].AddPlane(normal, d, 0.5f*length);
+
+		for(size_t e = 0; e < 3; ++e)
+		{
+			uint32 a = canon[indices[i + e]];
+			uint32 b = canon[indices[i + (e + 1) % 3]];
+			if(halfEdges.find(EdgeKey(b, a)) != halfEdges.end())
+				continue;
+
+			XMVECTOR pa = XMLoadFloat3(&vertices[a].Position);
+			XMVECTOR edge = XMLoadFloat3(&vertices[b].Position) - pa;
+			XMVECTOR borderNormal = XMVector3Normalize(XMVector3Cross(edge, n));
+
+			XMFLOAT3 bn;
+			XMStoreFloat3(&bn, borderNormal);
+			float bd = -XMVectorGetX(XMVector3Dot(borderNormal, pa));
+			float weight = BorderWeight*XMVectorGetX(XMVector3LengthSq(edge));
+
+			quadrics[a].AddPlane(bn, bd, weight);
+			quadrics[b].AddPlane(bn, bd, weight);
+		}
+	}
+
+	//
+	// Collapse in passes.  Each pass sorts all candidate collapses by cost and
+	// performs the cheapest ones whose neighborhoods do not overlap, so the
+	// adjacency built at the start of the pass stays valid throughout it.
+	//
+
+	float largestCost = 0.0f;
+	size_t triCount = indices.size()/3;
+
+	std::vector<uint32> adjOffsets;
+	std::vector<uint32> adjTriangles;
+	std::vector<Collapse> candidates;
+	std::vector<bool> locked;
+	std::vector<uint32> vertexRemap(vertexCount);
+	std::vector<uint32> ringA, ringB;
+
+	for(bool firstPass = true; triCount > targetTriangleCount; firstPass = false)
+	{
+		// Borders and seams survive collapses, but edges can become
+		// non-manifold, so reclassify after every pass.
+		if(!firstPass)
+			ClassifyVertices(vertices, indices, canon, kinds, halfEdges);
+
+		// Canonical vertex -> triangle adjacency.
+		adjOffsets.assign(vertexCount + 1, 0);
+		adjTriangles.resize(indices.size());
+		for(uint32 index : indices)
+			adjOffsets[canon[index] + 1]++;
+		for(size_t v = 0; v < vertexCount; ++v)
+			adjOffsets[v + 1] += adjOffsets[v];
+		{
+			std::vector<uint32> cursor(adjOffsets.begin(), adjOffsets.end() - 1);
+			for(size_t i = 0; i < indices.size(); ++i)
+				adjTriangles[cursor[canon[indices[i]]]++] = (uint32)(i / 3);
+		}
+
+		candidates.clear();
+		for(size_t i = 0; i < indices.size(); i += 3)
+		{
+			for(size_t e = 0; e < 3; ++e)
+			{
+				uint32 va = indices[i + e];
+				uint32 vb = indices[i + (e + 1) % 3];
+				uint32 a = canon[va];
+				uint32 b = canon[vb];
+
+				for(int dir = 0; dir < 2; ++dir)
+				{
+					uint32 from = dir == 0 ? a : b;
+					uint32 to = dir == 0 ? b : a;
+
+					if(kinds[from] == VertexKind::Locked)
+						continue;
+					if(kinds[from] == VertexKind::Border && !IsBorderEdge(halfEdges, a, b))
+						continue;
+
+					Quadric q = quadrics[from];
+					q.Add(quadrics[to]);
+
+					Collapse collapse;
+					collapse.Cost = q.Error(vertices[to].Position);
+					collapse.From = from;
+					collapse.To = to;
+					collapse.FromVertex = dir == 0 ? va : vb;
+					collapse.ToVertex = dir == 0 ? vb : va;
+					candidates.push_back(collapse);
+				}
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(),
+			[](const Collapse& x, const Collapse& y) { return x.Cost < y.Cost; });
+
+		locked.assign(vertexCount, false);
+		for(uint32 v = 0; v < (uint32)vertexCount; ++v)
+			vertexRemap[v] = v;
+
+		size_t collapses = 0;
+		size_t estimate = triCount;
+
+		for(const Collapse& collapse : candidates)
+		{
+			if(collapse.Cost > maxCost || estimate <= targetTriangleCount)
+				break;
+
+			if(locked[collapse.From] || locked[collapse.To])
+				continue;
+
+			// Keep hard shading edges that were not split into seams.
+			XMVECTOR nFrom = XMLoadFloat3(&vertices[collapse.FromVertex].Normal);
+			XMVECTOR nTo = XMLoadFloat3(&vertices[collapse.ToVertex].Normal);
+			if(XMVectorGetX(XMVector3LengthSq(nFrom)) > 0.0f &&
+				XMVectorGetX(XMVector3LengthSq(nTo)) > 0.0f &&
+				XMVectorGetX(XMVector3Dot(XMVector3Normalize(nFrom), XMVector3Normalize(nTo))) < MinVertexNormalDot)
+				continue;
+
+			// Link condition: the two one-rings may only share the vertices
+			// opposite the collapsed edge, otherwise the result is non-manifold.
+			ringA.clear();
+			ringB.clear();
+			for(uint32 k = adjOffsets[collapse.From]; k < adjOffsets[collapse.From + 1]; ++k)
+			{
+				const uint32* t = &indices[adjTriangles[k]*3];
+				for(int c = 0; c < 3; ++c)
+					ringA.push_back(canon[t[c]]);
+			}
+			for(uint32 k = adjOffsets[collapse.To]; k < adjOffsets[collapse.To + 1]; ++k)
+			{
+				const uint32* t = &indices[adjTriangles[k]*3];
+				for(int c = 0; c < 3; ++c)
+					ringB.push_back(canon[t[c]]);
+			}
+			std::sort(ringA.begin(), ringA.end());
+			ringA.erase(std::unique(ringA.begin(), ringA.end()), ringA.end());
+			std::sort(ringB.begin(), ringB.end());
+			ringB.erase(std::unique(ringB.begin(), ringB.end()), ringB.end());
+
+			size_t shared = 0;
+			size_t edgeTriangles = 0;
+			for(size_t x = 0, y = 0; x < ringA.size() && y < ringB.size(); )
+			{
+				if(ringA[x] < ringB[y]) ++x;
+				else if(ringB[y] < ringA[x]) ++y;
+				else
+				{
+					if(ringA[x] != collapse.From && ringA[x] != collapse.To)
+						shared++;
+					++x; ++y;
+				}
+			}
+
+			// Reject collapses that flip or badly skew a surviving triangle, or
+			// that would pull triangles from both sides of a seam at To (e.g.
+			// a sphere's pole) onto one of its copies.
+			bool flips = false;
+			bool splitsSeam = false;
+			for(uint32 k = adjOffsets[collapse.From]; k < adjOffsets[collapse.From + 1] && !flips; ++k)
+			{
+				const uint32* t = &indices[adjTriangles[k]*3];
+
+				XMFLOAT3 p[3];
+				bool hasTo = false;
+				for(int c = 0; c < 3; ++c)
+				{
+					p[c] = vertices[t[c]].Position;
+					if(canon[t[c]] == collapse.To)
+					{
+						hasTo = true;
+						splitsSeam = splitsSeam || t[c] != collapse.ToVertex;
+					}
+				}
+
+				if(hasTo)
+				{
+					edgeTriangles++;
+					continue;
+				}
+
+				XMVECTOR before = FaceNormal(p[0], p[1], p[2]);
+				XMVECTOR shadingBefore = XMVectorZero();
+				XMVECTOR shadingAfter = XMVectorZero();
+				for(int c = 0; c < 3; ++c)
+				{
+					uint32 v = canon[t[c]] == collapse.From ? collapse.ToVertex : t[c];
+					p[c] = vertices[v].Position;
+					shadingBefore += XMLoadFloat3(&vertices[t[c]].Normal);
+					shadingAfter += XMLoadFloat3(&vertices[v].Normal);
+				}
+				XMVECTOR after = FaceNormal(p[0], p[1], p[2]);
+
+				float lengths = XMVectorGetX(XMVector3Length(before))*XMVectorGetX(XMVector3Length(after));
+				float dot = XMVectorGetX(XMVector3Dot(before, after));
+				flips = lengths <= 0.0f || dot < MinFaceNormalDot*lengths;
+
+				// Small turns add up over many passes; never let a triangle
+				// that faces along its shading normals turn away from them.
+				flips = flips || (XMVectorGetX(XMVector3Dot(before, shadingBefore)) > 0.0f &&
+					XMVectorGetX(XMVector3Dot(after, shadingAfter)) <= 0.0f);
+			}
+
+			if(flips || splitsSeam || shared != edgeTriangles)
+				continue;
+
+			vertexRemap[collapse.FromVertex] = collapse.ToVertex;
+			quadrics[collapse.To].Add(quadrics[collapse.From]);
+
+			// Freeze the whole neighborhood for the rest of this pass.
+			for(uint32 v : ringA)
+				locked[v] = true;
+
+			largestCost = std::max(largestCost, collapse.Cost);
+			estimate -= std::min(estimate, edgeTriangles);
+			collapses++;
+		}
+
+		if(collapses == 0)
+			break;
+
+		// Apply the collapses and drop triangles that became degenerate.
+		size_t write = 0;
+		for(size_t i = 0; i < indices.size(); i += 3)
+		{
+			uint32 i0 = vertexRemap[indices[i+0]];
+			uint32 i1 = vertexRemap[indices[i+1]];
+			uint32 i2 = vertexRemap[indices[i+2]];
+
+			if(canon[i0] == canon[i1] || canon[i1] == canon[i2] || canon[i0] == canon[i2])
+				continue;
+
+			indices[write++] = i0;
+			indices[write++] = i1;
+			indices[write++] = i2;
+		}
+
+		indices.resize(write);
+		triCount = write/3;
+	}
+
+	//
+	// Drop the vertices no triangle references anymore.
+	//
+
+	std::vector<uint32> compact(vertexCount, InvalidIndex);
+	std::vector<Vertex> kept;
+	kept.reserve(vertexCount);
+	for(uint32& index : indices)
+	{
+		if(compact[index] == InvalidIndex)
+		{
+			compact[index] = (uint32)kept.size();
+			kept.push_back(vertices[index]);
+		}
+
+		index = compact[index];
+	}
+	vertices.swap(kept);
+
+	if(resultError != nullptr)
+		*resultError = sqrtf(largestCost) / diagonal;
+
+	return result;
+}
+
+std::vector<GeometryGenerator::MeshData> MeshSimplifier::BuildLodChain(const MeshData& meshData,
+	const std::vector<float>& triangleRatios, float maxError)
+{
+	std::vector<MeshData> lods;
+	lods.reserve(triangleRatios.size());
+
+	uint32 sourceTriCount = (uint32)meshData.Indices32.size()/3;
+
+	const MeshData* previous = &meshData;
+	for(float ratio : triangleRatios)
+	{
+		uint32 target = (uint32)(sourceTriCount*std::min(std::max(ratio, 0.0f), 1.0f));
+		lods.push_back(Simplify(*previous, target, maxError));
+		previous = &lods.back();
+	}
+
+	return lods;
+}
@@ -0,0 +1,45 @@
+//***************************************************************************************
+// MeshSimplifier.h
+//
+// Quadric error metric mesh simplification (Garland & Heckbert 1997) for
+// GeometryGenerator::MeshData.  Used to build coarser levels of detail from any
+// mesh, including ones that cannot simply be regenerated with fewer slices.
+//
+// The simplifier only performs half-edge collapses, so every output vertex is
+// one of the input vertices with its original normal, tangent and texture
+// coordinates.  Vertices on UV/normal seams (several vertices sharing one
+// position) never move, and vertices on open borders only slide along
+// straight stretches of the border, so seams and silhouettes of open meshes
+// stay intact.  No collapse turns a triangle away from its vertex normals.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+
+class MeshSimplifier
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+	using MeshData = GeometryGenerator::MeshData;
+
+	///<summary>
+	/// Collapses edges in order of increasing quadric error until the mesh has
+	/// at most targetTriangleCount triangles or the next collapse would exceed
+	/// maxError.  maxError is relative to the diagonal of the mesh bounding box
+	/// (0.01 = 1% of the mesh size).  If resultError is not null it receives the
+	/// largest error of the collapses that were performed, in the same units.
+	///</summary>
+	static MeshData Simplify(const MeshData& meshData, uint32 targetTriangleCount,
+		float maxError, float* resultError = nullptr);
+
+	///<summary>
+	/// Builds a level of detail chain.  triangleRatios lists the fraction of the
+	/// source triangle count to keep per level, e.g. {1.0f, 0.5f, 0.25f, 0.1f}.
+	/// Each level is simplified from the previous one, so the chain is cheap to
+	/// build.  A level that hits maxError before its target keeps the triangles it has.
+	///</summary>
+	static std::vector<MeshData> BuildLodChain(const MeshData& meshData,
+		const std::vector<float>& triangleRatios, float maxError);
+};
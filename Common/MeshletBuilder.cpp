@@ -0,0 +1,280 @@
+//***************************************************************************************
+// MeshletBuilder.cpp
+//***************************************************************************************
+
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+const MeshletBuilder::uint32 MeshletBuilder::DefaultMaxVertices;
+const MeshletBuilder::uint32 MeshletBuilder::DefaultMaxPrimitives;
+
+namespace
+{
+	using uint32 = MeshletBuilder::uint32;
+
+	const uint32 InvalidIndex = 0xffffffff;
+
+	// Below this spread (~84 degrees from the axis) a normal cone is too wide to
+	// cull anything, so the meshlet is marked as never back-facing.
+	const float MinConeDot = 0.1f;
+
+	void ComputeMeshletBounds(const GeometryGenerator::MeshData& meshData, const std::vector<uint32>& indices,
+		const std::vector<uint32>& meshletVertices, Meshlet& meshlet)
+	{
+		const auto& vertices = meshData.Vertices;
+
+		//
+		// Bounding sphere around the center of the meshlet's box.
+		//
+
+		XMVECTOR vMin = XMLoadFloat3(&vertices[meshletVertices[0]].Position);
+		XMVECTOR vMax = vMin;
+		for(uint32 v : meshletVertices)
+		{
+			XMVECTOR p = XMLoadFloat3(&vertices[v].Position);
+			vMin = XMVectorMin(vMin, p);
+			vMax = XMVectorMax(vMax, p);
+		}
+
+		XMVECTOR center = 0.5f*(vMin + vMax);
+		XMVECTOR radiusSq = XMVectorZero();
+		for(uint32 v : meshletVertices)
+		{
+			XMVECTOR d = XMLoadFloat3(&vertices[v].Position) - center;
+			radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(d));
+		}
+
+		XMStoreFloat3(&meshlet.Center, center);
+		meshlet.Radius = sqrtf(XMVectorGetX(radiusSq));
+
+		//
+		// Normal cone: average the unit face normals, then find how far the
+		// widest one strays from the average.
+		//
+
+		uint32 triCount = meshlet.IndexCount/3;
+		std::vector<XMFLOAT3> normals(triCount);
+
+		XMVECTOR axis = XMVectorZero();
+		for(uint32 t = 0; t < triCount; ++t)
+		{
+			const uint32* k = &indices[meshlet.IndexStart + t*3];
+			XMVECTOR p0 = XMLoadFloat3(&vertices[k[0]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[k[1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[k[2]].Position);
+
+			XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+			float length = XMVectorGetX(XMVector3Length(n));
+			n = length > 0.0f ? n / length : XMVectorZero();
+
+			XMStoreFloat3(&normals[t], n);
+			axis += n;
+		}
+
+		meshlet.ConeApex = meshlet.Center;
+		meshlet.ConeCutoff = 1.0f;
+
+		float axisLength = XMVectorGetX(XMVector3Length(axis));
+		if(axisLength <= 0.0f)
+			return;
+
+		axis = axis / axisLength;
+		XMStoreFloat3(&meshlet.ConeAxis, axis);
+
+		float minDot = 1.0f;
+		for(uint32 t = 0; t < triCount; ++t)
+		{
+			XMVECTOR n = XMLoadFloat3(&normals[t]);
+			if(XMVectorGetX(XMVector3LengthSq(n)) > 0.0f)
+				minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(n, axis)));
+		}
+
+		if(minDot <= MinConeDot)
+			return;
+
+		// Slide the apex back along the axis until it is behind every
+		// triangle plane, so the cone test is exact for nearby viewers.
+		float maxT = 0.0f;
+		for(uint32 t = 0; t < triCount; ++t)
+		{
+			XMVECTOR n = XMLoadFloat3(&normals[t]);
+			float dn = XMVectorGetX(XMVector3Dot(n, axis));
+			if(dn <= 0.0f)
+				continue;
+
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[meshlet.IndexStart + t*3]].Position);
+			float dc = XMVectorGetX(XMVector3Dot(center - p0, n));
+			maxT = std::max(maxT, dc / dn);
+		}
+
+		XMStoreFloat3(&meshlet.ConeApex, center - axis*maxT);
+		meshlet.ConeCutoff = sqrtf(1.0f - minDot*minDot);
+	}
+}
+
+std::vector<Meshlet> MeshletBuilder::BuildMeshlets(MeshData& meshData, uint32 maxVertices, uint32 maxPrimitives)
+{
+	std::vector<Meshlet> meshlets;
+
+	const std::vector<uint32>& indices = meshData.Indices32;
+	const auto& vertices = meshData.Vertices;
+
+	size_t triCount = indices.size()/3;
+	size_t vertexCount = vertices.size();
+	if(triCount == 0 || maxVertices < 3 || maxPrimitives == 0)
+		return meshlets;
+
+	//
+	// Vertex -> triangle adjacency and triangle centroids.
+	//
+
+	std::vector<uint32> adjOffsets(vertexCount + 1, 0);
+	std::vector<uint32> adjTriangles(indices.size());
+	for(uint32 index : indices)
+		adjOffsets[index + 1]++;
+	for(size_t v = 0; v < vertexCount; ++v)
+		adjOffsets[v + 1] += adjOffsets[v];
+	{
+		std::vector<uint32> cursor(adjOffsets.begin(), adjOffsets.end() - 1);
+		for(size_t i = 0; i < indices.size(); ++i)
+			adjTriangles[cursor[indices[i]]++] = (uint32)(i / 3);
+	}
+
+	std::vector<XMFLOAT3> centroids(triCount);
+	for(size_t t = 0; t < triCount; ++t)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t*3+0]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t*3+1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t*3+2]].Position);
+		XMStoreFloat3(&centroids[t], (p0 + p1 + p2) / 3.0f);
+	}
+
+	//
+	// Grow meshlets greedily from the first unused triangle.
+	//
+
+	std::vector<bool> emitted(triCount, false);
+
+	// Id of the meshlet that last referenced each vertex.
+	std::vector<uint32> vertexOwner(vertexCount, InvalidIndex);
+
+	std::vector<uint32> meshletVertices;
+	meshletVertices.reserve(maxVertices);
+
+	std::vector<uint32> output;
+	output.reserve(indices.size());
+
+	size_t seed = 0;
+	for(;;)
+	{
+		while(seed < triCount && emitted[seed])
+			seed++;
+
+		if(seed == triCount)
+			break;
+
+		uint32 id = (uint32)meshlets.size();
+
+		Meshlet meshlet;
+		meshlet.IndexStart = (uint32)output.size();
+		meshletVertices.clear();
+
+		XMVECTOR centroidSum = XMVectorZero();
+		uint32 primCount = 0;
+
+		uint32 tri = (uint32)seed;
+		while(tri != InvalidIndex)
+		{
+			emitted[tri] = true;
+			for(uint32 c = 0; c < 3; ++c)
+			{
+				uint32 v = indices[tri*3 + c];
+				output.push_back(v);
+
+				if(vertexOwner[v] != id)
+				{
+					vertexOwner[v] = id;
+					meshletVertices.push_back(v);
+				}
+			}
+
+			centroidSum += XMLoadFloat3(&centroids[tri]);
+			if(++primCount == maxPrimitives)
+				break;
+
+			XMVECTOR center = centroidSum / (float)primCount;
+
+			// Next triangle: fewest new vertices first, then closest to the
+			// center so the meshlet stays round and its bounds tight.
+			tri = InvalidIndex;
+			uint32 bestNew = 4;
+			float bestDistance = 0.0f;
+			for(uint32 v : meshletVertices)
+			{
+				for(uint32 k = adjOffsets[v]; k < adjOffsets[v + 1]; ++k)
+				{
+					uint32 t = adjTriangles[k];
+					if(emitted[t])
+						continue;
+
+					uint32 newVertices = 0;
+					for(uint32 c = 0; c < 3; ++c)
+						newVertices += vertexOwner[indices[t*3 + c]] != id ? 1 : 0;
+
+					if(meshletVertices.size() + newVertices > maxVertices)
+						continue;
+
+					float distance = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&centroids[t]) - center));
+					if(newVertices < bestNew || (newVertices == bestNew && distance < bestDistance))
+					{
+						tri = t;
+						bestNew = newVertices;
+						bestDistance = distance;
+					}
+				}
+			}
+		}
+
+		meshlet.IndexCount = (uint32)output.size() - meshlet.IndexStart;
+		meshlet.VertexCount = (uint32)meshletVertices.size();
+		meshlets.push_back(meshlet);
+	}
+
+	meshData.Indices32.swap(output);
+
+	for(Meshlet& meshlet : meshlets)
+	{
+		meshletVertices.assign(meshData.Indices32.begin() + meshlet.IndexStart,
+			meshData.Indices32.begin() + meshlet.IndexStart + meshlet.IndexCount);
+		std::sort(meshletVertices.begin(), meshletVertices.end());
+		meshletVertices.erase(std::unique(meshletVertices.begin(), meshletVertices.end()), meshletVertices.end());
+
+		ComputeMeshletBounds(meshData, meshData.Indices32, meshletVertices, meshlet);
+	}
+
+	return meshlets;
+}
+
+bool MeshletBuilder::IsVisible(const Meshlet& meshlet, const XMFLOAT4 planes[6], const XMFLOAT3& eyePos)
+{
+	XMVECTOR center = XMVectorSetW(XMLoadFloat3(&meshlet.Center), 1.0f);
+
+	for(int i = 0; i < 6; ++i)
+	{
+		float distance = XMVectorGetX(XMVector4Dot(XMLoadFloat4(&planes[i]), center));
+		if(distance < -meshlet.Radius)
+			return false;
+	}
+
+	if(meshlet.ConeCutoff < 1.0f)
+	{
+		XMVECTOR toApex = XMVector3Normalize(XMLoadFloat3(&meshlet.ConeApex) - XMLoadFloat3(&eyePos));
+		if(XMVectorGetX(XMVector3Dot(toApex, XMLoadFloat3(&meshlet.ConeAxis))) >= meshlet.ConeCutoff)
+			return false;
+	}
+
+	return true;
+}
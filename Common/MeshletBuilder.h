@@ -0,0 +1,68 @@
+//***************************************************************************************
+// MeshletBuilder.h
+//
+// Splits GeometryGenerator::MeshData into small spatially coherent clusters of
+// triangles ("meshlets") with a bounding sphere and a normal cone each, so the
+// CPU can skip whole clusters that are outside the frustum or facing away.
+//
+// Meshlets are stored as contiguous ranges of the mesh's own index buffer, so a
+// visible meshlet is drawn with an ordinary DrawIndexedInstanced call:
+//   StartIndexLocation = submesh.StartIndexLocation + meshlet.IndexStart
+//   BaseVertexLocation = submesh.BaseVertexLocation
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+
+struct Meshlet
+{
+	// Range of Indices32 that holds this meshlet's triangles.
+	GeometryGenerator::uint32 IndexStart = 0;
+	GeometryGenerator::uint32 IndexCount = 0;
+
+	// Number of distinct vertices the triangles reference.
+	GeometryGenerator::uint32 VertexCount = 0;
+
+	// Bounding sphere in mesh space.
+	DirectX::XMFLOAT3 Center = { 0.0f, 0.0f, 0.0f };
+	float Radius = 0.0f;
+
+	// Normal cone.  Every triangle faces away from a viewer at position p when
+	// dot(normalize(ConeApex - p), ConeAxis) >= ConeCutoff.  A cutoff of 1 means
+	// the triangles are spread too widely for the cone to cull anything.
+	DirectX::XMFLOAT3 ConeApex = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 ConeAxis = { 0.0f, 0.0f, 0.0f };
+	float ConeCutoff = 1.0f;
+};
+
+class MeshletBuilder
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+	using MeshData = GeometryGenerator::MeshData;
+
+	// Limits recommended for mesh shaders on current hardware; small enough
+	// that the bounds are tight, large enough that the draw count stays low.
+	static const uint32 DefaultMaxVertices = 64;
+	static const uint32 DefaultMaxPrimitives = 124;
+
+	///<summary>
+	/// Groups the triangles into meshlets of at most maxVertices distinct
+	/// vertices and maxPrimitives triangles and reorders meshData.Indices32 so
+	/// every meshlet is one contiguous range.  Growth prefers triangles that
+	/// add no new vertices, then triangles close to the meshlet center.
+	///</summary>
+	static std::vector<Meshlet> BuildMeshlets(MeshData& meshData,
+		uint32 maxVertices = DefaultMaxVertices, uint32 maxPrimitives = DefaultMaxPrimitives);
+
+	///<summary>
+	/// Returns false when the meshlet is fully outside a frustum plane or all of
+	/// its triangles face away from eyePos.  planes are as
+	/// FrustumCuller::ExtractFrustumPlanes returns them; planes and eyePos must
+	/// be in the same space as the mesh.
+	///</summary>
+	static bool IsVisible(const Meshlet& meshlet, const DirectX::XMFLOAT4 planes[6],
+		const DirectX::XMFLOAT3& eyePos);
+};
@@ -0,0 +1,148 @@
+//***************************************************************************************
+// Parallel.cpp
+//***************************************************************************************
+
+#include "Parallel.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	class WorkerPool
+	{
+	public:
+
+		explicit WorkerPool(size_t workerCount)
+		{
+			for(size_t i = 0; i < workerCount; ++i)
+				mWorkers.emplace_back(&WorkerPool::WorkerLoop, this);
+		}
+
+		~WorkerPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStop = true;
+			}
+			mWake.notify_all();
+
+			for(std::thread& worker : mWorkers)
+				worker.join();
+		}
+
+		// Runs the loop on the pool and returns true, or returns false at once
+		// if another loop has the pool.
+		bool TryRun(size_t chunkCount, void (*run)(void*, size_t), void* context)
+		{
+			bool busy = false;
+			if(!mBusy.compare_exchange_strong(busy, true))
+				return false;
+
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mRun = run;
+				mContext = context;
+				mChunkCount = chunkCount;
+				mNextChunk = 0;
+				mLoop++;
+			}
+			mWake.notify_all();
+
+			RunChunks(run, context, chunkCount);
+
+			// Every chunk is claimed; wait for the workers still running one.
+			// A worker that wakes after this sees no loop and goes back to sleep.
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mDone.wait(lock, [this] { return mActiveWorkers == 0; });
+				mRun = nullptr;
+			}
+
+			mBusy = false;
+			return true;
+		}
+
+	private:
+
+		void RunChunks(void (*run)(void*, size_t), void* context, size_t chunkCount)
+		{
+			for(size_t chunk = mNextChunk++; chunk < chunkCount; chunk = mNextChunk++)
+				run(context, chunk);
+		}
+
+		void WorkerLoop()
+		{
+			std::uint64_t lastLoop = 0;
+
+			std::unique_lock<std::mutex> lock(mMutex);
+			for(;;)
+			{
+				mWake.wait(lock, [&] { return mStop || (mRun != nullptr && mLoop != lastLoop); });
+				if(mStop)
+					return;
+
+				lastLoop = mLoop;
+				void (*run)(void*, size_t) = mRun;
+				void* context = mContext;
+				size_t chunkCount = mChunkCount;
+				mActiveWorkers++;
+
+				lock.unlock();
+				RunChunks(run, context, chunkCount);
+				lock.lock();
+
+				if(--mActiveWorkers == 0)
+					mDone.notify_one();
+			}
+		}
+
+		std::vector<std::thread> mWorkers;
+
+		// Set while a loop owns the pool.
+		std::atomic<bool> mBusy{ false };
+
+		std::mutex mMutex;
+		std::condition_variable mWake;
+		std::condition_variable mDone;
+		bool mStop = false;
+
+		// The current loop, null between loops.  mLoop counts loops so a
+		// worker joins each one once.
+		void (*mRun)(void*, size_t) = nullptr;
+		void* mContext = nullptr;
+		size_t mChunkCount = 0;
+		std::uint64_t mLoop = 0;
+		size_t mActiveWorkers = 0;
+
+		std::atomic<size_t> mNextChunk{ 0 };
+	};
+
+	WorkerPool& GetPool()
+	{
+		static WorkerPool pool(Parallel::GetThreadCount() - 1);
+		return pool;
+	}
+}
+
+size_t Parallel::GetThreadCount()
+{
+	static const size_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	return threadCount;
+}
+
+size_t Parallel::GetChunkCount(size_t count, size_t minChunk)
+{
+	return std::min(GetThreadCount(), count / std::max<size_t>(minChunk, 1));
+}
+
+void Parallel::Run(size_t chunkCount, ChunkRunner run, void* context)
+{
+	if(GetPool().TryRun(chunkCount, run, context))
+		return;
+
+	for(size_t chunk = 0; chunk < chunkCount; ++chunk)
+		run(context, chunk);
+}
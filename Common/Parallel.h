@@ -0,0 +1,153 @@
+//***************************************************************************************
+// Parallel.h
+//
+// Loops split across a pool of worker threads shared by the Common modules.
+// The pool starts on the first parallel loop, with one worker per core besides
+// the calling thread, and lives until exit.  A loop therefore costs a wake-up
+// of threads that already exist rather than creating and joining new ones,
+// which costs about as much as a few thousand matrix products per thread.
+//
+// For and Reduce cut [0, count) into contiguous chunks, at most one per
+// thread and none shorter than minChunk, and call the chunk function on the
+// pool and on the calling thread.  A loop shorter than 2*minChunk runs inline.
+// Each module passes the minChunk that makes one chunk worth a wake-up for its
+// own per-element cost.  ForEach instead makes every index its own chunk, for
+// a few items that each cost far more than a wake-up.
+//
+// One loop runs on the pool at a time.  A loop started while another is
+// running, from another thread or from inside a chunk, runs inline on its
+// caller instead of waiting, so loops may nest and may be started from other
+// worker threads (e.g. TerrainStreamer's) without deadlocking.
+//***************************************************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+class Parallel
+{
+public:
+
+	///<summary>
+	/// Threads a loop can run on: the pool's workers and the caller.
+	///</summary>
+	static size_t GetThreadCount();
+
+	///<summary>
+	/// Calls fn(begin, end) on disjoint chunks covering [0, count) and returns
+	/// when all have finished.
+	///</summary>
+	template<typename Fn>
+	static void For(size_t count, size_t minChunk, Fn&& fn);
+
+	///<summary>
+	/// Calls fn(i) for every i in [0, count), handing the indices out one at a
+	/// time, so a thread that finishes a cheap item takes the next one.  For a
+	/// few items of uneven and large cost, e.g. whole meshes.
+	///</summary>
+	template<typename Fn>
+	static void ForEach(size_t count, Fn&& fn);
+
+	///<summary>
+	/// Calls chunkFn(begin, end) on disjoint chunks covering [0, count), each
+	/// returning a T, and folds the results in chunk order with combine.
+	///</summary>
+	template<typename T, typename ChunkFn, typename CombineFn>
+	static T Reduce(size_t count, size_t minChunk, ChunkFn&& chunkFn, CombineFn&& combine);
+
+private:
+
+	typedef void (*ChunkRunner)(void* context, size_t chunk);
+
+	static size_t GetChunkCount(size_t count, size_t minChunk);
+
+	// Calls run(context, chunk) for every chunk in [0, chunkCount), on the pool
+	// if it is free and otherwise inline.
+	static void Run(size_t chunkCount, ChunkRunner run, void* context);
+
+	template<typename Fn>
+	struct ForContext
+	{
+		Fn* Function;
+		size_t Count;
+		size_t ChunkCount;
+	};
+
+	template<typename T, typename ChunkFn>
+	struct ReduceContext
+	{
+		ChunkFn* Function;
+		size_t Count;
+		size_t ChunkCount;
+		T* Results;
+	};
+};
+
+template<typename Fn>
+void Parallel::For(size_t count, size_t minChunk, Fn&& fn)
+{
+	size_t chunkCount = GetChunkCount(count, minChunk);
+	if(chunkCount <= 1)
+	{
+		if(count > 0)
+			fn((size_t)0, count);
+		return;
+	}
+
+	typedef typename std::remove_reference<Fn>::type Function;
+	ForContext<Function> context = { &fn, count, chunkCount };
+
+	Run(chunkCount, [](void* p, size_t chunk)
+	{
+		const ForContext<Function>& c = *static_cast<ForContext<Function>*>(p);
+		(*c.Function)(chunk*c.Count / c.ChunkCount, (chunk + 1)*c.Count / c.ChunkCount);
+	}, &context);
+}
+
+template<typename Fn>
+void Parallel::ForEach(size_t count, Fn&& fn)
+{
+	if(count <= 1 || GetThreadCount() == 1)
+	{
+		for(size_t i = 0; i < count; ++i)
+			fn(i);
+		return;
+	}
+
+	typedef typename std::remove_reference<Fn>::type Function;
+	Function* function = &fn;
+
+	// One chunk per index; the pool hands chunks to whichever thread is free.
+	Run(count, [](void* p, size_t i)
+	{
+		(**static_cast<Function**>(p))(i);
+	}, &function);
+}
+
+template<typename T, typename ChunkFn, typename CombineFn>
+T Parallel::Reduce(size_t count, size_t minChunk, ChunkFn&& chunkFn, CombineFn&& combine)
+{
+	size_t chunkCount = GetChunkCount(count, minChunk);
+	if(chunkCount <= 1)
+		return chunkFn((size_t)0, count);
+
+	std::vector<T> results(chunkCount);
+
+	typedef typename std::remove_reference<ChunkFn>::type Function;
+	ReduceContext<T, Function> context = { &chunkFn, count, chunkCount, results.data() };
+
+	Run(chunkCount, [](void* p, size_t chunk)
+	{
+		const ReduceContext<T, Function>& c = *static_cast<ReduceContext<T, Function>*>(p);
+		c.Results[chunk] = (*c.Function)(chunk*c.Count / c.ChunkCount, (chunk + 1)*c.Count / c.ChunkCount);
+	}, &context);
+
+	T result = results[0];
+	for(size_t i = 1; i < chunkCount; ++i)
+		result = combine(result, results[i]);
+
+	return result;
+}
@@ -0,0 +1,199 @@
+//***************************************************************************************
+// RenderItemStore.cpp
+//***************************************************************************************
+
+#include "RenderItemStore.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+using namespace DirectX;
+
+RenderItemStore::RenderItemStore(uint32 frameResourceCount) :
+	mDirtyBits(frameResourceCount),
+	mDirtyLists(frameResourceCount),
+	mFrameResourceCount(frameResourceCount)
+{
+	assert(frameResourceCount > 0);
+}
+
+void RenderItemStore::Reserve(uint32 count)
+{
+	mSlotIndices.reserve(count);
+	mSlotGenerations.reserve(count);
+	mWorlds.reserve(count);
+	mDrawArgs.reserve(count);
+	mLocalBounds.reserve(count);
+	mWorldBounds.Reserve(count);
+	mSlots.reserve(count);
+
+	for(uint32 f = 0; f < mFrameResourceCount; ++f)
+	{
+		mDirtyBits[f].reserve((count + 63) / 64);
+		mDirtyLists[f].reserve(count);
+	}
+}
+
+RenderItemStore::Handle RenderItemStore::Add(const XMFLOAT4X4& world, const DrawArgs& drawArgs,
+	const BoundingBox& localBounds)
+{
+	uint32 index = GetCount();
+
+	uint32 slot;
+	if(!mFreeSlots.empty())
+	{
+		slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+		mSlotIndices[slot] = index;
+	}
+	else
+	{
+		slot = (uint32)mSlotIndices.size();
+		mSlotIndices.push_back(index);
+		mSlotGenerations.push_back(0);
+	}
+
+	BoundingBox worldBounds;
+	localBounds.Transform(worldBounds, XMLoadFloat4x4(&world));
+
+	mWorlds.push_back(world);
+	mDrawArgs.push_back(drawArgs);
+	mLocalBounds.push_back(localBounds);
+	mWorldBounds.PushBack(worldBounds);
+	mSlots.push_back(slot);
+
+	if(mDirtyBits[0].size() * 64 <= index)
+	{
+		for(uint32 f = 0; f < mFrameResourceCount; ++f)
+			mDirtyBits[f].push_back(0);
+	}
+	MarkDirty(index);
+
+	Handle handle;
+	handle.Slot = slot;
+	handle.Generation = mSlotGenerations[slot];
+	return handle;
+}
+
+void RenderItemStore::Remove(Handle handle)
+{
+	assert(IsValid(handle));
+
+	uint32 index = mSlotIndices[handle.Slot];
+	uint32 last = GetCount() - 1;
+
+	if(index != last)
+	{
+		mWorlds[index] = mWorlds[last];
+		mDrawArgs[index] = mDrawArgs[last];
+		mLocalBounds[index] = mLocalBounds[last];
+		mWorldBounds.Set(index, mWorldBounds.Get(last));
+		mSlots[index] = mSlots[last];
+		mSlotIndices[mSlots[index]] = index;
+
+		// The moved item's constants are not at its new index yet.
+		MarkDirty(index);
+	}
+
+	// Any entries for the last index are stale now.
+	for(uint32 f = 0; f < mFrameResourceCount; ++f)
+		ClearDirty(f, last);
+
+	mWorlds.pop_back();
+	mDrawArgs.pop_back();
+	mLocalBounds.pop_back();
+	mWorldBounds.PopBack();
+	mSlots.pop_back();
+
+	mSlotIndices[handle.Slot] = UINT32_MAX;
+	mSlotGenerations[handle.Slot]++;
+	mFreeSlots.push_back(handle.Slot);
+}
+
+void RenderItemStore::Clear()
+{
+	for(uint32 slot : mSlots)
+	{
+		mSlotIndices[slot] = UINT32_MAX;
+		mSlotGenerations[slot]++;
+		mFreeSlots.push_back(slot);
+	}
+
+	mWorlds.clear();
+	mDrawArgs.clear();
+	mLocalBounds.clear();
+	mWorldBounds.Clear();
+	mSlots.clear();
+
+	for(uint32 f = 0; f < mFrameResourceCount; ++f)
+	{
+		std::fill(mDirtyBits[f].begin(), mDirtyBits[f].end(), 0);
+		mDirtyLists[f].clear();
+	}
+}
+
+bool RenderItemStore::IsValid(Handle handle)const
+{
+	return handle.Slot < mSlotIndices.size() &&
+		mSlotGenerations[handle.Slot] == handle.Generation &&
+		mSlotIndices[handle.Slot] != UINT32_MAX;
+}
+
+RenderItemStore::uint32 RenderItemStore::GetIndex(Handle handle)const
+{
+	assert(IsValid(handle));
+	return mSlotIndices[handle.Slot];
+}
+
+RenderItemStore::Handle RenderItemStore::GetHandle(uint32 index)const
+{
+	Handle handle;
+	handle.Slot = mSlots[index];
+	handle.Generation = mSlotGenerations[handle.Slot];
+	return handle;
+}
+
+void RenderItemStore::SetWorld(Handle handle, const XMFLOAT4X4& world)
+{
+	uint32 index = GetIndex(handle);
+	mWorlds[index] = world;
+	MarkDirty(index);
+
+	BoundingBox worldBounds;
+	mLocalBounds[index].Transform(worldBounds, XMLoadFloat4x4(&world));
+	mWorldBounds.Set(index, worldBounds);
+}
+
+void RenderItemStore::SetDrawArgs(Handle handle, const DrawArgs& drawArgs)
+{
+	mDrawArgs[GetIndex(handle)] = drawArgs;
+}
+
+void RenderItemStore::MarkDirty(uint32 index)
+{
+	std::uint64_t bit = 1ull << (index & 63);
+
+	for(uint32 f = 0; f < mFrameResourceCount; ++f)
+	{
+		std::uint64_t& word = mDirtyBits[f][index >> 6];
+		if((word & bit) == 0)
+		{
+			word |= bit;
+			mDirtyLists[f].push_back(index);
+		}
+	}
+}
+
+std::string RenderItemStore::ToString(const UpdateStats& stats)
+{
+	std::uint64_t items = stats.Uploads + stats.SkippedUploads;
+	float skipped = items > 0 ? 100.0f*stats.SkippedUploads / items : 0.0f;
+
+	char buffer[160];
+	snprintf(buffer, sizeof(buffer),
+		"%llu updates: %llu uploads, %llu skipped (%.1f%%)",
+		(unsigned long long)stats.Updates, (unsigned long long)stats.Uploads,
+		(unsigned long long)stats.SkippedUploads, skipped);
+
+	return buffer;
+}
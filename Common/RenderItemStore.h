@@ -0,0 +1,194 @@
+//***************************************************************************************
+// RenderItemStore.h
+//
+// Render items kept as a structure of arrays instead of one heap allocation
+// each.  Item i's world matrix, draw arguments and bounds live at index i of
+// their own packed arrays, so drawing walks 20-byte draw records instead of
+// chasing a pointer to a 100-byte item and its geometry.  World-space boxes
+// are kept up to date as FrustumCuller::Boxes, ready to cull.
+//
+// Changes are tracked per frame resource: each keeps a list of the items
+// changed since its constant buffer was last written, and a bitset so an item
+// changed twice is listed once.  UpdateDirty visits only the listed items, so
+// the per-frame constant buffer update costs O(changed) instead of a scan of
+// every item, and a static scene costs nothing once every frame resource has
+// caught up.
+//
+// Items are referred to by Handles that stay valid until the item is removed.
+// A handle names a slot that maps to the item's current index; Remove moves
+// the last item into the hole and repoints its slot, so adding and removing
+// are O(1) and the arrays never have gaps.  A slot's generation changes when
+// it is freed, so a stale handle is detected instead of reaching whatever item
+// reuses the slot.
+//
+// An item's index doubles as its object constant buffer index.  An item that
+// Remove moves is marked dirty in every frame resource so its constants are
+// written to its new index; the entries its old index left in the dirty lists
+// are dropped as stale when they are visited.
+//***************************************************************************************
+
+#pragma once
+
+#include "FrustumCuller.h"
+#include <string>
+
+class RenderItemStore
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+
+	struct Handle
+	{
+		uint32 Slot = UINT32_MAX;
+		uint32 Generation = 0;
+	};
+
+	// Constant buffer writes done and avoided by UpdateDirty: an item that
+	// was not dirty in the frame resource updated counts as skipped.
+	struct UpdateStats
+	{
+		std::uint64_t Updates = 0;
+		std::uint64_t Uploads = 0;
+		std::uint64_t SkippedUploads = 0;
+	};
+
+	// DrawIndexedInstanced parameters.  Geometry and PrimitiveType are the
+	// caller's: an index into its own geometry table and a
+	// D3D12_PRIMITIVE_TOPOLOGY, so the store does not depend on Direct3D.
+	struct DrawArgs
+	{
+		uint32 Geometry = 0;
+		uint32 PrimitiveType = 4;	// D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+		uint32 IndexCount = 0;
+		uint32 StartIndexLocation = 0;
+		int BaseVertexLocation = 0;
+	};
+
+	///<summary>
+	/// frameResourceCount is how many frame resources, each with its own
+	/// object constant buffer, a change must be uploaded to.
+	///</summary>
+	explicit RenderItemStore(uint32 frameResourceCount);
+
+	void Reserve(uint32 count);
+
+	///<summary>
+	/// Appends an item, dirty in every frame resource, at index GetCount() - 1.
+	/// localBounds encloses its geometry before world is applied, e.g. the
+	/// submesh's Bounds.
+	///</summary>
+	Handle Add(const DirectX::XMFLOAT4X4& world, const DrawArgs& drawArgs,
+		const DirectX::BoundingBox& localBounds);
+
+	///<summary>
+	/// Removes the item; the last item takes its index.  handle must be valid.
+	///</summary>
+	void Remove(Handle handle);
+
+	void Clear();
+
+	bool IsValid(Handle handle)const;
+
+	uint32 GetCount()const { return (uint32)mWorlds.size(); }
+	uint32 GetFrameResourceCount()const { return mFrameResourceCount; }
+
+	// Current index of a valid handle's item, and the handle of the item at an
+	// index.  Indices change when items are removed; handles do not.
+	uint32 GetIndex(Handle handle)const;
+	Handle GetHandle(uint32 index)const;
+
+	const DirectX::XMFLOAT4X4& GetWorld(Handle handle)const { return mWorlds[GetIndex(handle)]; }
+	const DrawArgs& GetDrawArgs(Handle handle)const { return mDrawArgs[GetIndex(handle)]; }
+	DirectX::BoundingBox GetWorldBounds(Handle handle)const { return mWorldBounds.Get(GetIndex(handle)); }
+
+	///<summary>
+	/// Replace the item's world matrix or draw arguments.  SetWorld marks the
+	/// item dirty in every frame resource and moves its world bounds.
+	///</summary>
+	void SetWorld(Handle handle, const DirectX::XMFLOAT4X4& world);
+	void SetDrawArgs(Handle handle, const DrawArgs& drawArgs);
+
+	///<summary>
+	/// Marks the item at index dirty in every frame resource, e.g. after
+	/// constants other than the world matrix changed.
+	///</summary>
+	void MarkDirty(uint32 index);
+
+	///<summary>
+	/// Calls write(index, world) once for every item changed since the last
+	/// UpdateDirty of frameResource, then clears that frame resource's dirty
+	/// set.  Items are visited in the order they were first changed.
+	///</summary>
+	template<typename WriteFn>
+	void UpdateDirty(uint32 frameResource, WriteFn&& write);
+
+	const UpdateStats& GetUpdateStats()const { return mUpdateStats; }
+	static std::string ToString(const UpdateStats& stats);
+
+	// The packed arrays, GetCount() long, for the per-frame passes.
+	const DirectX::XMFLOAT4X4* GetWorlds()const { return mWorlds.data(); }
+	const DrawArgs* GetDrawArgs()const { return mDrawArgs.data(); }
+
+	// World-space boxes of the items, by index: the local bounds transformed
+	// by the world matrix.
+	const FrustumCuller::Boxes& GetWorldBounds()const { return mWorldBounds; }
+
+private:
+
+	bool IsDirty(uint32 frameResource, uint32 index)const;
+	void ClearDirty(uint32 frameResource, uint32 index);
+
+	// Per slot: the index of its item, and a count bumped on every free.
+	std::vector<uint32> mSlotIndices;
+	std::vector<uint32> mSlotGenerations;
+	std::vector<uint32> mFreeSlots;
+
+	// Per item.
+	std::vector<DirectX::XMFLOAT4X4> mWorlds;
+	std::vector<DrawArgs> mDrawArgs;
+	std::vector<DirectX::BoundingBox> mLocalBounds;
+	FrustumCuller::Boxes mWorldBounds;
+	std::vector<uint32> mSlots;
+
+	// Per frame resource: one bit per item index, and the indices whose bit
+	// was set since the last update, possibly with stale ones.
+	std::vector<std::vector<std::uint64_t>> mDirtyBits;
+	std::vector<std::vector<uint32>> mDirtyLists;
+
+	uint32 mFrameResourceCount;
+	UpdateStats mUpdateStats;
+};
+
+inline bool RenderItemStore::IsDirty(uint32 frameResource, uint32 index)const
+{
+	return (mDirtyBits[frameResource][index >> 6] >> (index & 63)) & 1;
+}
+
+inline void RenderItemStore::ClearDirty(uint32 frameResource, uint32 index)
+{
+	mDirtyBits[frameResource][index >> 6] &= ~(1ull << (index & 63));
+}
+
+template<typename WriteFn>
+void RenderItemStore::UpdateDirty(uint32 frameResource, WriteFn&& write)
+{
+	std::vector<uint32>& dirty = mDirtyLists[frameResource];
+
+	std::uint64_t uploads = 0;
+	for(uint32 index : dirty)
+	{
+		// Entries left by removed items have had their bit cleared.
+		if(!IsDirty(frameResource, index))
+			continue;
+
+		ClearDirty(frameResource, index);
+		write(index, mWorlds[index]);
+		uploads++;
+	}
+	dirty.clear();
+
+	mUpdateStats.Updates++;
+	mUpdateStats.Uploads += uploads;
+	mUpdateStats.SkippedUploads += GetCount() - uploads;
+}
@@ -0,0 +1,252 @@
+//***************************************************************************************
+// Stripifier.cpp
+//***************************************************************************************
+
+#include "Stripifier.h"
+#include <cstdio>
+
+namespace
+{
+	using uint32 = Stripifier::uint32;
+
+	const uint32 Restart = GeometryGenerator::StripRestart;
+
+	// Marks a triangle already written to a strip; smaller values are the id
+	// of the trial walk that last visited it.
+	const uint32 Used = 0xffffffff;
+
+	bool IsDegenerate(uint32 a, uint32 b, uint32 c)
+	{
+		return a == b || b == c || c == a;
+	}
+
+	class StripBuilder
+	{
+	public:
+
+		StripBuilder(const std::vector<uint32>& indices, size_t vertexCount) :
+			mIndices(indices),
+			mMark(indices.size()/3, 0)
+		{
+			// Triangles around each vertex, as compressed rows.
+			mOffsets.assign(vertexCount + 1, 0);
+			for(uint32 index : indices)
+				mOffsets[index + 1]++;
+			for(size_t v = 0; v < vertexCount; ++v)
+				mOffsets[v + 1] += mOffsets[v];
+
+			mTriangles.resize(indices.size());
+			std::vector<uint32> next(mOffsets.begin(), mOffsets.end() - 1);
+			for(size_t i = 0; i < indices.size(); ++i)
+				mTriangles[next[indices[i]]++] = (uint32)(i/3);
+
+			// Degenerate triangles draw nothing, so they are never emitted.
+			for(size_t t = 0; t < mMark.size(); ++t)
+			{
+				if(IsDegenerate(indices[3*t], indices[3*t + 1], indices[3*t + 2]))
+					mMark[t] = Used;
+			}
+		}
+
+		size_t TriangleCount()const { return mMark.size(); }
+		bool IsUsed(size_t t)const { return mMark[t] == Used; }
+
+		///<summary>
+		/// Walks a strip from triangle start entered at corner rotation, marking
+		/// the triangles with mark.  Appends the strip to out when out is not null.
+		/// Returns the number of triangles.
+		///</summary>
+		uint32 Walk(uint32 start, uint32 rotation, uint32 mark, std::vector<uint32>* out)
+		{
+			uint32 a = mIndices[3*start + rotation];
+			uint32 b = mIndices[3*start + (rotation + 1) % 3];
+			uint32 c = mIndices[3*start + (rotation + 2) % 3];
+			mMark[start] = mark;
+
+			if(out != nullptr)
+			{
+				out->push_back(a);
+				out->push_back(b);
+				out->push_back(c);
+			}
+
+			// The last two strip vertices, and whether the next triangle is odd.
+			uint32 prev = b;
+			uint32 last = c;
+			bool odd = true;
+			uint32 count = 1;
+
+			for(;;)
+			{
+				// Triangle j of a strip is (s[j], s[j+1], s[j+2]) when j is even
+				// and (s[j+1], s[j], s[j+2]) when odd, so the next triangle must
+				// hold this directed edge.
+				uint32 from = odd ? last : prev;
+				uint32 to = odd ? prev : last;
+
+				uint32 third;
+				uint32 t = FindTriangle(from, to, mark, third);
+				if(t == Used)
+					break;
+
+				mMark[t] = mark;
+				if(out != nullptr)
+					out->push_back(third);
+
+				prev = last;
+				last = third;
+				odd = !odd;
+				count++;
+			}
+
+			return count;
+		}
+
+	private:
+
+		// An unmarked triangle holding the directed edge from->to; returns Used
+		// if there is none.
+		uint32 FindTriangle(uint32 from, uint32 to, uint32 mark, uint32& third)const
+		{
+			for(uint32 k = mOffsets[from]; k < mOffsets[from + 1]; ++k)
+			{
+				uint32 t = mTriangles[k];
+				if(mMark[t] == Used || mMark[t] == mark)
+					continue;
+
+				const uint32* tri = &mIndices[3*t];
+				for(int corner = 0; corner < 3; ++corner)
+				{
+					if(tri[corner] == from && tri[(corner + 1) % 3] == to)
+					{
+						third = tri[(corner + 2) % 3];
+						return t;
+					}
+				}
+			}
+
+			return Used;
+		}
+
+		const std::vector<uint32>& mIndices;
+		std::vector<uint32> mOffsets;
+		std::vector<uint32> mTriangles;
+		std::vector<uint32> mMark;
+	};
+}
+
+Stripifier::StripReport Stripifier::Stripify(const std::vector<uint32>& listIndices, size_t vertexCount,
+	std::vector<uint32>& stripIndices)
+{
+	StripBuilder builder(listIndices, vertexCount);
+
+	stripIndices.clear();
+	stripIndices.reserve(listIndices.size()/2);
+
+	uint32 trial = 0;
+	for(uint32 t = 0; t < builder.TriangleCount(); ++t)
+	{
+		if(builder.IsUsed(t))
+			continue;
+
+		// Try leaving the start triangle across each of its edges.
+		uint32 bestRotation = 0;
+		uint32 bestCount = 0;
+		for(uint32 rotation = 0; rotation < 3; ++rotation)
+		{
+			uint32 count = builder.Walk(t, rotation, ++trial, nullptr);
+			if(count > bestCount)
+			{
+				bestCount = count;
+				bestRotation = rotation;
+			}
+		}
+
+		if(!stripIndices.empty())
+			stripIndices.push_back(Restart);
+
+		builder.Walk(t, bestRotation, Used, &stripIndices);
+	}
+
+	return Analyze(stripIndices);
+}
+
+Stripifier::StripReport Stripifier::Stripify(MeshData& meshData)
+{
+	std::vector<uint32> strip;
+	StripReport report = Stripify(meshData.Indices32, meshData.Vertices.size(), strip);
+
+	meshData.Indices32.swap(strip);
+	return report;
+}
+
+Stripifier::StripReport Stripifier::Analyze(const std::vector<uint32>& stripIndices)
+{
+	StripReport report;
+	report.StripIndexCount = (uint32)stripIndices.size();
+
+	size_t start = 0;
+	while(start < stripIndices.size())
+	{
+		size_t end = start;
+		while(end < stripIndices.size() && stripIndices[end] != Restart)
+			++end;
+
+		if(end > start)
+			report.StripCount++;
+
+		for(size_t i = start; i + 2 < end; ++i)
+		{
+			if(!IsDegenerate(stripIndices[i], stripIndices[i + 1], stripIndices[i + 2]))
+				report.TriangleCount++;
+		}
+
+		start = end + 1;
+	}
+
+	report.ListIndexCount = 3*report.TriangleCount;
+	return report;
+}
+
+void Stripifier::ToTriangleList(const std::vector<uint32>& stripIndices, std::vector<uint32>& listIndices)
+{
+	listIndices.clear();
+
+	size_t start = 0;
+	while(start < stripIndices.size())
+	{
+		size_t end = start;
+		while(end < stripIndices.size() && stripIndices[end] != Restart)
+			++end;
+
+		for(size_t i = start; i + 2 < end; ++i)
+		{
+			// Odd triangles swap their first two vertices to keep the winding.
+			bool odd = ((i - start) & 1) != 0;
+			uint32 a = stripIndices[odd ? i + 1 : i];
+			uint32 b = stripIndices[odd ? i : i + 1];
+			uint32 c = stripIndices[i + 2];
+
+			if(!IsDegenerate(a, b, c))
+			{
+				listIndices.push_back(a);
+				listIndices.push_back(b);
+				listIndices.push_back(c);
+			}
+		}
+
+		start = end + 1;
+	}
+}
+
+std::string Stripifier::ToString(const StripReport& report)
+{
+	float saved = report.ListIndexCount > 0 ?
+		100.0f*(1.0f - (float)report.StripIndexCount / report.ListIndexCount) : 0.0f;
+
+	char buffer[160];
+	snprintf(buffer, sizeof(buffer), "%u triangles in %u strips: %u indices, %u as a list (%.1f%% saved)",
+		report.TriangleCount, report.StripCount, report.StripIndexCount, report.ListIndexCount, saved);
+
+	return buffer;
+}
@@ -0,0 +1,63 @@
+//***************************************************************************************
+// Stripifier.h
+//
+// Converts triangle lists to triangle strips joined by primitive restart.
+// A strip reuses the last two indices of every triangle, so a long strip costs
+// about 1 index per triangle instead of 3; each restart adds one.
+//
+// The greedy walk starts a strip at the first unused triangle, tries each of
+// its three edges as the way forward, and keeps the direction that runs
+// longest.  A strip continues into the neighbour across its last edge as long
+// as that neighbour is unused and its winding matches the strip's parity, so
+// the triangles and their facing are exactly those of the list.
+//
+// GeometryGenerator's CreateGridStrip/CreateSphereStrip/CreateCylinderStrip
+// build strips directly; use this for everything else.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <string>
+
+class Stripifier
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+	using MeshData = GeometryGenerator::MeshData;
+
+	struct StripReport
+	{
+		// Indices the same triangles take as a list, and as strips.
+		uint32 ListIndexCount = 0;
+		uint32 StripIndexCount = 0;
+
+		uint32 StripCount = 0;
+		uint32 TriangleCount = 0;
+	};
+
+	///<summary>
+	/// Writes the triangle list indices as strips separated by
+	/// GeometryGenerator::StripRestart.
+	///</summary>
+	static StripReport Stripify(const std::vector<uint32>& listIndices, size_t vertexCount, std::vector<uint32>& stripIndices);
+
+	///<summary>
+	/// Replaces meshData.Indices32 with strips.
+	///</summary>
+	static StripReport Stripify(MeshData& meshData);
+
+	///<summary>
+	/// Counts the strips and non-degenerate triangles of a strip index list,
+	/// e.g. one of the generator's, to compare it with the list form.
+	///</summary>
+	static StripReport Analyze(const std::vector<uint32>& stripIndices);
+
+	///<summary>
+	/// Expands strips back into a triangle list, dropping degenerate triangles.
+	///</summary>
+	static void ToTriangleList(const std::vector<uint32>& stripIndices, std::vector<uint32>& listIndices);
+
+	static std::string ToString(const StripReport& report);
+};
@@ -0,0 +1,293 @@
+//***************************************************************************************
+// TangentSpace.cpp
+//***************************************************************************************
+
+#include "TangentSpace.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = TangentSpace::uint32;
+	using Vertex = TangentSpace::Vertex;
+
+	// Fewest vertices or triangles worth handing to another thread.
+	const size_t MinElementsPerChunk = 16384;
+
+	// Below this squared length a summed normal or tangent counts as zero.
+	const float DegenerateLengthSq = 1e-20f;
+
+	// Angles of the triangle (p0, p1, p2) at each of its corners, in x, y, z.
+	XMVECTOR XM_CALLCONV CornerAngles(FXMVECTOR p0, FXMVECTOR p1, FXMVECTOR p2)
+	{
+		XMVECTOR e01 = XMVector3Normalize(p1 - p0);
+		XMVECTOR e12 = XMVector3Normalize(p2 - p1);
+		XMVECTOR e20 = XMVector3Normalize(p0 - p2);
+
+		// The angle at a corner is between the two edges leaving it.
+		XMVECTOR a0 = XMVector3AngleBetweenNormals(e01, -e20);
+		XMVECTOR a1 = XMVector3AngleBetweenNormals(e12, -e01);
+		XMVECTOR a2 = XMVector3AngleBetweenNormals(e20, -e12);
+
+		return XMVectorSet(XMVectorGetX(a0), XMVectorGetX(a1), XMVectorGetX(a2), 0.0f);
+	}
+
+	// Any unit vector perpendicular to n, preferring the generators' +x tangent.
+	XMVECTOR XM_CALLCONV Perpendicular(FXMVECTOR n)
+	{
+		XMVECTOR axis = fabsf(XMVectorGetX(n)) < 0.9f ? g_XMIdentityR0 : g_XMIdentityR2;
+		return XMVector3Normalize(axis - n*XMVector3Dot(n, axis));
+	}
+
+	// Each corner's share of its triangle's normal, before normalizing.
+	void XM_CALLCONV NormalCorners(FXMVECTOR p0, FXMVECTOR p1, FXMVECTOR p2,
+		TangentSpace::NormalWeighting weighting, XMVECTOR corners[3])
+	{
+		// Twice the area times the unit normal, for left-handed clockwise
+		// front faces.
+		XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+
+		corners[0] = corners[1] = corners[2] = n;
+		if(weighting == TangentSpace::NormalWeighting::Angle)
+		{
+			n = XMVector3Normalize(n);
+			XMVECTOR angles = CornerAngles(p0, p1, p2);
+			corners[0] = n*XMVectorSplatX(angles);
+			corners[1] = n*XMVectorSplatY(angles);
+			corners[2] = n*XMVectorSplatZ(angles);
+		}
+	}
+
+	// Each corner's share of its triangle's u direction, in the plane of the
+	// corner's vertex normal.
+	void TangentCorners(const Vertex* vertices, const uint32* tri, XMVECTOR corners[3])
+	{
+		const Vertex& v0 = vertices[tri[0]];
+		const Vertex& v1 = vertices[tri[1]];
+		const Vertex& v2 = vertices[tri[2]];
+
+		XMVECTOR p0 = XMLoadFloat3(&v0.Position);
+		XMVECTOR e1 = XMLoadFloat3(&v1.Position) - p0;
+		XMVECTOR e2 = XMLoadFloat3(&v2.Position) - p0;
+
+		float du1 = v1.TexC.x - v0.TexC.x, dv1 = v1.TexC.y - v0.TexC.y;
+		float du2 = v2.TexC.x - v0.TexC.x, dv2 = v2.TexC.y - v0.TexC.y;
+
+		// Solve e1 = du1*T + dv1*B, e2 = du2*T + dv2*B for T.  Only the
+		// direction matters, so dividing by the determinant is replaced by
+		// multiplying with its sign.
+		float det = du1*dv2 - du2*dv1;
+		XMVECTOR faceTangent = XMVectorZero();
+		if(det != 0.0f)
+			faceTangent = (e1*dv2 - e2*dv1)*(det > 0.0f ? 1.0f : -1.0f);
+
+		XMVECTOR angles = CornerAngles(p0, XMLoadFloat3(&v1.Position), XMLoadFloat3(&v2.Position));
+		float angle[3] = { XMVectorGetX(angles), XMVectorGetY(angles), XMVectorGetZ(angles) };
+
+		for(int k = 0; k < 3; ++k)
+		{
+			XMVECTOR n = XMLoadFloat3(&vertices[tri[k]].Normal);
+			XMVECTOR tangent = XMVector3Normalize(faceTangent - n*XMVector3Dot(n, faceTangent));
+			corners[k] = tangent*angle[k];
+		}
+	}
+
+	// Normalizes a vertex's summed corners into its normal, unless they
+	// cancel out and the old normal is kept.
+	void XM_CALLCONV FinishNormal(FXMVECTOR sum, XMFLOAT3& normal)
+	{
+		if(XMVectorGetX(XMVector3LengthSq(sum)) > DegenerateLengthSq)
+			XMStoreFloat3(&normal, XMVector3Normalize(sum));
+	}
+
+	void XM_CALLCONV FinishTangent(FXMVECTOR sum, const XMFLOAT3& normal, XMFLOAT3& tangentU)
+	{
+		XMVECTOR n = XMLoadFloat3(&normal);
+		XMVECTOR tangent = sum - n*XMVector3Dot(n, sum);
+
+		if(XMVectorGetX(XMVector3LengthSq(tangent)) > DegenerateLengthSq)
+			tangent = XMVector3Normalize(tangent);
+		else
+			tangent = Perpendicular(n);
+
+		XMStoreFloat3(&tangentU, tangent);
+	}
+
+	// Sums the corner contributions of every vertex in [begin, end).
+	template<typename Finish>
+	void GatherCorners(const TangentSpace::VertexAdjacency& adjacency, const std::vector<XMFLOAT3>& corners,
+		size_t begin, size_t end, Finish finish)
+	{
+		for(size_t v = begin; v < end; ++v)
+		{
+			uint32 first = adjacency.Offsets[v];
+			uint32 last = adjacency.Offsets[v + 1];
+			if(first == last)
+				continue;
+
+			XMVECTOR sum = XMVectorZero();
+			for(uint32 c = first; c < last; ++c)
+				sum += XMLoadFloat3(&corners[adjacency.Corners[c]]);
+
+			finish(v, sum);
+		}
+	}
+}
+
+void TangentSpace::BuildAdjacency(const uint32* indices, size_t indexCount, size_t vertexCount, VertexAdjacency& adjacency)
+{
+	adjacency.Offsets.assign(vertexCount + 1, 0);
+	adjacency.Corners.resize(indexCount);
+
+	// Count the corners of each vertex, turn the counts into row starts, then
+	// drop every corner into the next free slot of its row.
+	for(size_t i = 0; i < indexCount; ++i)
+		adjacency.Offsets[indices[i] + 1]++;
+
+	for(size_t v = 0; v < vertexCount; ++v)
+		adjacency.Offsets[v + 1] += adjacency.Offsets[v];
+
+	std::vector<uint32> next(adjacency.Offsets.begin(), adjacency.Offsets.end() - 1);
+	for(size_t i = 0; i < indexCount; ++i)
+		adjacency.Corners[next[indices[i]]++] = (uint32)i;
+}
+
+void TangentSpace::ComputeNormals(Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount,
+	const VertexAdjacency& adjacency, NormalWeighting weighting)
+{
+	size_t triCount = indexCount / 3;
+	std::vector<XMFLOAT3> corners(triCount*3);
+
+	Parallel::For(triCount, MinElementsPerChunk, [&](size_t begin, size_t end)
+	{
+		for(size_t t = begin; t < end; ++t)
+		{
+			const uint32* tri = &indices[3*t];
+			XMVECTOR w[3];
+			NormalCorners(XMLoadFloat3(&vertices[tri[0]].Position), XMLoadFloat3(&vertices[tri[1]].Position),
+				XMLoadFloat3(&vertices[tri[2]].Position), weighting, w);
+
+			for(int k = 0; k < 3; ++k)
+				XMStoreFloat3(&corners[3*t + k], w[k]);
+		}
+	});
+
+	Parallel::For(vertexCount, MinElementsPerChunk, [&](size_t begin, size_t end)
+	{
+		GatherCorners(adjacency, corners, begin, end, [&](size_t v, FXMVECTOR sum)
+		{
+			FinishNormal(sum, vertices[v].Normal);
+		});
+	});
+}
+
+void TangentSpace::ComputeTangents(Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount,
+	const VertexAdjacency& adjacency)
+{
+	size_t triCount = indexCount / 3;
+	std::vector<XMFLOAT3> corners(triCount*3);
+
+	Parallel::For(triCount, MinElementsPerChunk, [&](size_t begin, size_t end)
+	{
+		for(size_t t = begin; t < end; ++t)
+		{
+			XMVECTOR w[3];
+			TangentCorners(vertices, &indices[3*t], w);
+
+			for(int k = 0; k < 3; ++k)
+				XMStoreFloat3(&corners[3*t + k], w[k]);
+		}
+	});
+
+	Parallel::For(vertexCount, MinElementsPerChunk, [&](size_t begin, size_t end)
+	{
+		GatherCorners(adjacency, corners, begin, end, [&](size_t v, FXMVECTOR sum)
+		{
+			FinishTangent(sum, vertices[v].Normal, vertices[v].TangentU);
+		});
+	});
+}
+
+void TangentSpace::ComputeTangentFrames(Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount,
+	NormalWeighting weighting)
+{
+	VertexAdjacency adjacency;
+	BuildAdjacency(indices, indexCount, vertexCount, adjacency);
+
+	ComputeNormals(vertices, vertexCount, indices, indexCount, adjacency, weighting);
+	ComputeTangents(vertices, vertexCount, indices, indexCount, adjacency);
+}
+
+void TangentSpace::ComputeTangentFramesInPlace(Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount,
+	NormalWeighting weighting)
+{
+	// The same corners as the gathers above, added to each vertex in the
+	// same order, so the sums match them bit for bit.  TangentU holds the
+	// normal sums until the tangent pass needs it.
+	for(size_t v = 0; v < vertexCount; ++v)
+		vertices[v].TangentU = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	size_t triCount = indexCount / 3;
+	for(size_t t = 0; t < triCount; ++t)
+	{
+		const uint32* tri = &indices[3*t];
+		XMVECTOR w[3];
+		NormalCorners(XMLoadFloat3(&vertices[tri[0]].Position), XMLoadFloat3(&vertices[tri[1]].Position),
+			XMLoadFloat3(&vertices[tri[2]].Position), weighting, w);
+
+		for(int k = 0; k < 3; ++k)
+		{
+			XMFLOAT3& sum = vertices[tri[k]].TangentU;
+			XMStoreFloat3(&sum, XMLoadFloat3(&sum) + w[k]);
+		}
+	}
+
+	for(size_t v = 0; v < vertexCount; ++v)
+	{
+		FinishNormal(XMLoadFloat3(&vertices[v].TangentU), vertices[v].Normal);
+		vertices[v].TangentU = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	}
+
+	for(size_t t = 0; t < triCount; ++t)
+	{
+		const uint32* tri = &indices[3*t];
+		XMVECTOR w[3];
+		TangentCorners(vertices, tri, w);
+
+		for(int k = 0; k < 3; ++k)
+		{
+			XMFLOAT3& sum = vertices[tri[k]].TangentU;
+			XMStoreFloat3(&sum, XMLoadFloat3(&sum) + w[k]);
+		}
+	}
+
+	for(size_t v = 0; v < vertexCount; ++v)
+		FinishTangent(XMLoadFloat3(&vertices[v].TangentU), vertices[v].Normal, vertices[v].TangentU);
+}
+
+void TangentSpace::ComputeNormals(MeshData& meshData, NormalWeighting weighting)
+{
+	VertexAdjacency adjacency;
+	BuildAdjacency(meshData.Indices32.data(), meshData.Indices32.size(), meshData.Vertices.size(), adjacency);
+
+	ComputeNormals(meshData.Vertices.data(), meshData.Vertices.size(),
+		meshData.Indices32.data(), meshData.Indices32.size(), adjacency, weighting);
+}
+
+void TangentSpace::ComputeTangents(MeshData& meshData)
+{
+	VertexAdjacency adjacency;
+	BuildAdjacency(meshData.Indices32.data(), meshData.Indices32.size(), meshData.Vertices.size(), adjacency);
+
+	ComputeTangents(meshData.Vertices.data(), meshData.Vertices.size(),
+		meshData.Indices32.data(), meshData.Indices32.size(), adjacency);
+}
+
+void TangentSpace::ComputeTangentFrames(MeshData& meshData, NormalWeighting weighting)
+{
+	ComputeTangentFrames(meshData.Vertices.data(), meshData.Vertices.size(),
+		meshData.Indices32.data(), meshData.Indices32.size(), weighting);
+}
@@ -0,0 +1,90 @@
+//***************************************************************************************
+// TangentSpace.h
+//
+// Rebuilds Vertex::Normal and Vertex::TangentU from positions, texture
+// coordinates and the triangle list, for meshes whose generator or editing
+// (e.g. displacing grid heights) left them missing or wrong.
+//
+// Both passes are written as gathers, never scatters:
+//   1. every triangle writes the contribution of each of its three corners to
+//      its own slot in a per-corner array,
+//   2. every vertex sums the corner slots that reference it, found through a
+//      VertexAdjacency (compressed rows of corner indices per vertex).
+// Neither pass writes memory another thread writes, so both split into
+// independent chunks on the Parallel worker pool for large meshes.
+//
+// Face normals follow the winding of the triangles (clockwise front faces).
+// Split vertices, such as the copies along a texture seam or a hard edge, are
+// separate vertices here and only see the triangles that use them.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+
+class TangentSpace
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+	using Vertex = GeometryGenerator::Vertex;
+	using MeshData = GeometryGenerator::MeshData;
+
+	// How face normals are weighted when summed into a vertex normal.
+	enum class NormalWeighting
+	{
+		Area,	// by triangle area; cheapest, but long thin triangles dominate
+		Angle	// by the angle the triangle makes at the vertex; independent of tessellation
+	};
+
+	// The triangle corners that use each vertex: corners of vertex v are
+	// Corners[Offsets[v]] up to, not including, Corners[Offsets[v + 1]].  A
+	// corner is a position in the index array, so its triangle is corner / 3.
+	struct VertexAdjacency
+	{
+		std::vector<uint32> Offsets;
+		std::vector<uint32> Corners;
+	};
+
+	static void BuildAdjacency(const uint32* indices, size_t indexCount, size_t vertexCount, VertexAdjacency& adjacency);
+
+	///<summary>
+	/// Replaces every referenced vertex's normal with the weighted average of
+	/// the faces around it.  Vertices no triangle uses, or whose faces cancel
+	/// out, keep their old normal.
+	///</summary>
+	static void ComputeNormals(Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount,
+		const VertexAdjacency& adjacency, NormalWeighting weighting = NormalWeighting::Angle);
+
+	///<summary>
+	/// Replaces every referenced vertex's tangent with the direction of
+	/// increasing u, following MikkTSpace: per corner the triangle's u
+	/// direction is projected into the plane of the vertex normal, the
+	/// corners are summed weighted by their angle, and the sum is
+	/// orthonormalized against the normal.  Needs final normals.  Where the
+	/// texture coordinates are degenerate any unit vector perpendicular to the
+	/// normal is used.
+	///</summary>
+	static void ComputeTangents(Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount,
+		const VertexAdjacency& adjacency);
+
+	///<summary>
+	/// ComputeNormals then ComputeTangents, sharing one adjacency.
+	///</summary>
+	static void ComputeTangentFrames(Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount,
+		NormalWeighting weighting = NormalWeighting::Angle);
+
+	///<summary>
+	/// ComputeTangentFrames on one thread without allocating: corner sums are
+	/// added straight into the vertices instead of gathered through an
+	/// adjacency.  The results are the same, except that vertices no triangle
+	/// uses get a tangent perpendicular to their normal.  For small meshes,
+	/// e.g. inside GeometryGenerator::Generate.
+	///</summary>
+	static void ComputeTangentFramesInPlace(Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount,
+		NormalWeighting weighting = NormalWeighting::Angle);
+
+	static void ComputeNormals(MeshData& meshData, NormalWeighting weighting = NormalWeighting::Angle);
+	static void ComputeTangents(MeshData& meshData);
+	static void ComputeTangentFrames(MeshData& meshData, NormalWeighting weighting = NormalWeighting::Angle);
+};
@@ -0,0 +1,219 @@
+//***************************************************************************************
+// Terrain.cpp
+//***************************************************************************************
+
+#include "Terrain.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+
+using namespace DirectX;
+
+const Terrain::uint32 Terrain::ColorTableSize;
+
+namespace
+{
+	const Terrain::ColorBand LandBands[] =
+	{
+		{ -10.0f, XMFLOAT4(1.0f, 0.96f, 0.62f, 1.0f) },	// sandy beach
+		{ 5.0f, XMFLOAT4(0.48f, 0.77f, 0.46f, 1.0f) },		// light yellow-green
+		{ 12.0f, XMFLOAT4(0.1f, 0.48f, 0.19f, 1.0f) },		// dark yellow-green
+		{ 20.0f, XMFLOAT4(0.45f, 0.39f, 0.34f, 1.0f) },		// dark brown
+		{ FLT_MAX, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f) }		// white snow
+	};
+
+	// The hills at four points: heights, and the partial derivatives
+	// dh/dx = a*(f*z*cos(f*x) + cos(f*z)) and dh/dz = a*(sin(f*x) - f*x*sin(f*z)).
+	struct HillsKernel
+	{
+		XMVECTOR Amplitude;
+		XMVECTOR Frequency;
+
+		XMVECTOR XM_CALLCONV Height(FXMVECTOR x, FXMVECTOR z)const
+		{
+			XMVECTOR sinX = XMVectorSin(Frequency*x);
+			XMVECTOR cosZ = XMVectorCos(Frequency*z);
+			return Amplitude*XMVectorMultiplyAdd(z, sinX, x*cosZ);
+		}
+
+		XMVECTOR XM_CALLCONV Height(FXMVECTOR x, FXMVECTOR z, XMVECTOR& slopeX, XMVECTOR& slopeZ)const
+		{
+			XMVECTOR sinX, cosX, sinZ, cosZ;
+			XMVectorSinCos(&sinX, &cosX, Frequency*x);
+			XMVectorSinCos(&sinZ, &cosZ, Frequency*z);
+
+			slopeX = Amplitude*XMVectorMultiplyAdd(Frequency*z, cosX, cosZ);
+			slopeZ = Amplitude*XMVectorNegativeMultiplySubtract(Frequency*x, sinZ, sinX);
+			return Amplitude*XMVectorMultiplyAdd(z, sinX, x*cosZ);
+		}
+	};
+
+	HillsKernel MakeKernel(const Terrain::HillsDesc& hills)
+	{
+		return { XMVectorReplicate(hills.Amplitude), XMVectorReplicate(hills.Frequency) };
+	}
+}
+
+Terrain::Terrain() :
+	Terrain(HillsDesc())
+{
+}
+
+Terrain::Terrain(const HillsDesc& hills) :
+	mHills(hills)
+{
+	SetColorBands(LandBands, _countof(LandBands));
+}
+
+float Terrain::GetHeight(float x, float z)const
+{
+	return mHills.Amplitude*(z*sinf(mHills.Frequency*x) + x*cosf(mHills.Frequency*z));
+}
+
+XMFLOAT3 Terrain::GetNormal(float x, float z)const
+{
+	float a = mHills.Amplitude;
+	float f = mHills.Frequency;
+
+	float slopeX = a*(f*z*cosf(f*x) + cosf(f*z));
+	float slopeZ = a*(sinf(f*x) - f*x*sinf(f*z));
+
+	XMFLOAT3 n;
+	XMStoreFloat3(&n, XMVector3Normalize(XMVectorSet(-slopeX, 1.0f, -slopeZ, 0.0f)));
+	return n;
+}
+
+void Terrain::GetHeights(const float* x, const float* z, float* heights, size_t count)const
+{
+	HillsKernel hills = MakeKernel(mHills);
+
+	// Two independent vectors per iteration keep both halves of the sine and
+	// cosine polynomials in flight.
+	size_t i = 0;
+	for(; i + 8 <= count; i += 8)
+	{
+		XMVECTOR h0 = hills.Height(XMLoadFloat4((const XMFLOAT4*)&x[i]), XMLoadFloat4((const XMFLOAT4*)&z[i]));
+		XMVECTOR h1 = hills.Height(XMLoadFloat4((const XMFLOAT4*)&x[i + 4]), XMLoadFloat4((const XMFLOAT4*)&z[i + 4]));
+		XMStoreFloat4((XMFLOAT4*)&heights[i], h0);
+		XMStoreFloat4((XMFLOAT4*)&heights[i + 4], h1);
+	}
+
+	for(; i + 4 <= count; i += 4)
+		XMStoreFloat4((XMFLOAT4*)&heights[i], hills.Height(XMLoadFloat4((const XMFLOAT4*)&x[i]), XMLoadFloat4((const XMFLOAT4*)&z[i])));
+
+	if(i < count)
+	{
+		// Pad the last few points out to a vector.
+		XMFLOAT4 tailX(0.0f, 0.0f, 0.0f, 0.0f);
+		XMFLOAT4 tailZ(0.0f, 0.0f, 0.0f, 0.0f);
+		size_t tail = count - i;
+		std::copy(x + i, x + count, &tailX.x);
+		std::copy(z + i, z + count, &tailZ.x);
+
+		XMFLOAT4 tailHeights;
+		XMStoreFloat4(&tailHeights, hills.Height(XMLoadFloat4(&tailX), XMLoadFloat4(&tailZ)));
+		std::copy(&tailHeights.x, &tailHeights.x + tail, heights + i);
+	}
+}
+
+void Terrain::Displace(Vertex* vertices, size_t count)const
+{
+	HillsKernel hills = MakeKernel(mHills);
+	XMVECTOR one = XMVectorSplatOne();
+
+	for(size_t i = 0; i < count; i += 4)
+	{
+		// Gather four vertices; a short last group repeats its final vertex.
+		size_t lanes = std::min<size_t>(4, count - i);
+		const XMFLOAT3& p0 = vertices[i].Position;
+		const XMFLOAT3& p1 = vertices[i + std::min<size_t>(1, lanes - 1)].Position;
+		const XMFLOAT3& p2 = vertices[i + std::min<size_t>(2, lanes - 1)].Position;
+		const XMFLOAT3& p3 = vertices[i + lanes - 1].Position;
+
+		XMVECTOR x = XMVectorSet(p0.x, p1.x, p2.x, p3.x);
+		XMVECTOR z = XMVectorSet(p0.z, p1.z, p2.z, p3.z);
+
+		XMVECTOR slopeX, slopeZ;
+		XMVECTOR h = hills.Height(x, z, slopeX, slopeZ);
+
+		// Normal (-sx, 1, -sz) and tangent (1, sx, 0), each normalized.
+		XMVECTOR normalScale = XMVectorReciprocalSqrt(XMVectorMultiplyAdd(slopeX, slopeX, XMVectorMultiplyAdd(slopeZ, slopeZ, one)));
+		XMVECTOR tangentScale = XMVectorReciprocalSqrt(XMVectorMultiplyAdd(slopeX, slopeX, one));
+
+		XMFLOAT4 heights, normalX, normalY, normalZ, tangentX, tangentY;
+		XMStoreFloat4(&heights, h);
+		XMStoreFloat4(&normalX, -slopeX*normalScale);
+		XMStoreFloat4(&normalY, normalScale);
+		XMStoreFloat4(&normalZ, -slopeZ*normalScale);
+		XMStoreFloat4(&tangentX, tangentScale);
+		XMStoreFloat4(&tangentY, slopeX*tangentScale);
+
+		for(size_t lane = 0; lane < lanes; ++lane)
+		{
+			Vertex& v = vertices[i + lane];
+			v.Position.y = (&heights.x)[lane];
+			v.Normal = XMFLOAT3((&normalX.x)[lane], (&normalY.x)[lane], (&normalZ.x)[lane]);
+			v.TangentU = XMFLOAT3((&tangentX.x)[lane], (&tangentY.x)[lane], 0.0f);
+		}
+	}
+}
+
+void Terrain::Displace(MeshData& meshData)const
+{
+	if(!meshData.Vertices.empty())
+		Displace(&meshData.Vertices[0], meshData.Vertices.size());
+}
+
+void Terrain::SetColorBands(const ColorBand* bands, size_t count)
+{
+	assert(count > 0 && count <= 256);
+
+	mThresholds.resize(count);
+	mColors.resize(count);
+	for(size_t b = 0; b < count; ++b)
+	{
+		assert(b == 0 || bands[b - 1].MaxHeight <= bands[b].MaxHeight);
+		mThresholds[b] = bands[b].MaxHeight;
+		mColors[b] = bands[b].Color;
+	}
+
+	mCellBands.assign(ColorTableSize, 0);
+	if(count == 1)
+	{
+		mTableMin = 0.0f;
+		mTableScale = 0.0f;
+		return;
+	}
+
+	// Cover the thresholds, with cell 0 wholly below the first so that heights
+	// clamped into it start from band 0.
+	float first = mThresholds[0];
+	float last = mThresholds[count - 2];
+	float cell = std::max(last - first, 1.0f) / (ColorTableSize - 1);
+	mTableMin = first - cell;
+	mTableScale = 1.0f / cell;
+
+	// Each cell starts from the band half a cell below its lower edge, so a
+	// height rounded into the cell never starts above its band; the lookup
+	// steps up from there.
+	size_t band = 0;
+	for(uint32 i = 0; i < ColorTableSize; ++i)
+	{
+		float start = mTableMin + (i - 0.5f)*cell;
+		while(band + 1 < count && start >= mThresholds[band])
+			++band;
+		mCellBands[i] = (uint8_t)band;
+	}
+}
+
+XMFLOAT4 Terrain::GetColor(float height)const
+{
+	float t = (height - mTableMin)*mTableScale;
+	uint32 cell = (uint32)std::min(std::max(t, 0.0f), (float)(ColorTableSize - 1));
+
+	size_t band = mCellBands[cell];
+	while(band + 1 < mThresholds.size() && height >= mThresholds[band])
+		++band;
+
+	return mColors[band];
+}
@@ -0,0 +1,96 @@
+//***************************************************************************************
+// Terrain.h
+//
+// The rolling hills of the land demo as a reusable heightfield:
+//
+//   h(x, z) = Amplitude*(z*sin(Frequency*x) + x*cos(Frequency*z))
+//
+// Heights are evaluated in batches, four points per XMVECTOR and two vectors
+// per iteration, so the sines and cosines of a whole grid run through
+// DirectXMath's vector polynomials instead of one sinf/cosf call per point.
+// Normals and tangents come from the analytic partial derivatives rather than
+// from finite differences of neighbouring heights.
+//
+// Heights map to colors through bands (sand, grass, rock, snow, ...).  The
+// bands are baked into a ColorTableSize table over the range of their
+// thresholds; a lookup indexes the table and then checks the one threshold its
+// cell may straddle, so the result matches comparing against every band.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+
+class Terrain
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+	using Vertex = GeometryGenerator::Vertex;
+	using MeshData = GeometryGenerator::MeshData;
+
+	struct HillsDesc
+	{
+		float Amplitude = 0.3f;
+		float Frequency = 0.1f;
+	};
+
+	// Heights below MaxHeight that no earlier band took get Color.  The last
+	// band takes everything left, whatever its MaxHeight.
+	struct ColorBand
+	{
+		float MaxHeight;
+		DirectX::XMFLOAT4 Color;
+	};
+
+	static const uint32 ColorTableSize = 256;
+
+	///<summary>
+	/// The land demo's hills and its beach, grass, rock and snow bands.
+	///</summary>
+	Terrain();
+	explicit Terrain(const HillsDesc& hills);
+
+	const HillsDesc& GetHills()const { return mHills; }
+
+	float GetHeight(float x, float z)const;
+
+	///<summary>
+	/// Unit normal at (x, z): (-dh/dx, 1, -dh/dz), normalized.
+	///</summary>
+	DirectX::XMFLOAT3 GetNormal(float x, float z)const;
+
+	///<summary>
+	/// heights[i] = GetHeight(x[i], z[i]) for count points, vectorized.
+	///</summary>
+	void GetHeights(const float* x, const float* z, float* heights, size_t count)const;
+
+	///<summary>
+	/// Sets Position.y of every vertex to the height under its x and z, and
+	/// replaces Normal and TangentU (the direction of increasing x, as
+	/// CreateGrid's) with the analytic ones of the surface.
+	///</summary>
+	void Displace(Vertex* vertices, size_t count)const;
+	void Displace(MeshData& meshData)const;
+
+	///<summary>
+	/// Replaces the bands, given in increasing MaxHeight, and rebuilds the table.
+	///</summary>
+	void SetColorBands(const ColorBand* bands, size_t count);
+
+	DirectX::XMFLOAT4 GetColor(float height)const;
+
+private:
+
+	HillsDesc mHills;
+
+	// Band b covers [mThresholds[b - 1], mThresholds[b]); the last band has no
+	// upper end.
+	std::vector<float> mThresholds;
+	std::vector<DirectX::XMFLOAT4> mColors;
+
+	// First band each table cell may hold, and the table's range.
+	std::vector<uint8_t> mCellBands;
+	float mTableMin = 0.0f;
+	float mTableScale = 0.0f;
+};
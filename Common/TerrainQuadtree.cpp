@@ -0,0 +1,377 @@
+//***************************************************************************************
+// TerrainQuadtree.cpp
+//***************************************************************************************
+
+#include "TerrainQuadtree.h"
+#include "MeshOptimizer.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+const TerrainQuadtree::uint32 TerrainQuadtree::DefaultChunkQuads;
+const TerrainQuadtree::uint32 TerrainQuadtree::MaxChunkQuads;
+
+namespace
+{
+	using uint32 = TerrainQuadtree::uint32;
+
+	// Fewest nodes worth handing to another thread; each one samples the
+	// terrain (2*ChunkQuads + 1)^2 times.
+	const size_t MinNodesPerChunk = 16;
+
+	// Distance from p to the nearest point of box, 0 inside it.
+	float Distance(const BoundingBox& box, const XMFLOAT3& p)
+	{
+		XMVECTOR d = XMVectorAbs(XMLoadFloat3(&p) - XMLoadFloat3(&box.Center)) - XMLoadFloat3(&box.Extents);
+		return XMVectorGetX(XMVector3Length(XMVectorMax(d, XMVectorZero())));
+	}
+
+	bool IsInside(const BoundingBox& box, const XMFLOAT4 planes[6])
+	{
+		XMVECTOR center = XMLoadFloat3(&box.Center);
+		XMVECTOR extents = XMLoadFloat3(&box.Extents);
+
+		for(int i = 0; i < 6; ++i)
+		{
+			// Outside when even the corner farthest along the normal is behind.
+			XMVECTOR plane = XMLoadFloat4(&planes[i]);
+			float distance = XMVectorGetX(XMPlaneDotCoord(plane, center));
+			float radius = XMVectorGetX(XMVector3Dot(XMVectorAbs(plane), extents));
+			if(distance + radius < 0.0f)
+				return false;
+		}
+
+		return true;
+	}
+}
+
+TerrainQuadtree::TerrainQuadtree(const Terrain& terrain, float size, uint32 levelCount, uint32 chunkQuads) :
+	mTerrain(terrain),
+	mSize(size),
+	mLevelCount(std::min(std::max(levelCount, 1u), 12u)),
+	mChunkQuads(std::min(std::max(chunkQuads, 1u), MaxChunkQuads))
+{
+	BuildTemplate();
+	MeasureNodes();
+}
+
+float TerrainQuadtree::GetCellSize(uint32 level)const
+{
+	return mSize / (float)(mChunkQuads << level);
+}
+
+void TerrainQuadtree::BuildTemplate()
+{
+	uint32 n = mChunkQuads;
+
+	// A unit grid of the chunk's resolution; the rows and columns are all
+	// BuildChunk needs from it.
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData chunk = geoGen.CreateGrid(1.0f, 1.0f, n + 1, n + 1);
+
+	// Walk the border clockwise seen from above, so the skirt quads face out:
+	// along the top row, down the right column, back along the bottom row and
+	// up the left column.
+	std::vector<uint32> edges[4];
+	for(uint32 k = 0; k <= n; ++k)
+	{
+		edges[0].push_back(k);
+		edges[1].push_back(k*(n + 1) + n);
+		edges[2].push_back(n*(n + 1) + n - k);
+		edges[3].push_back((n - k)*(n + 1));
+	}
+
+	for(const std::vector<uint32>& edge : edges)
+	{
+		// Skirt vertices are copies of the edge marked with y = -1.
+		uint32 base = (uint32)chunk.Vertices.size();
+		for(uint32 index : edge)
+		{
+			GeometryGenerator::Vertex v = chunk.Vertices[index];
+			v.Position.y = -1.0f;
+			chunk.Vertices.push_back(v);
+		}
+
+		for(uint32 k = 0; k < n; ++k)
+		{
+			uint32 top0 = edge[k];
+			uint32 top1 = edge[k + 1];
+			uint32 bottom0 = base + k;
+			uint32 bottom1 = base + k + 1;
+
+			chunk.Indices32.push_back(top0);
+			chunk.Indices32.push_back(bottom0);
+			chunk.Indices32.push_back(top1);
+
+			chunk.Indices32.push_back(top1);
+			chunk.Indices32.push_back(bottom0);
+			chunk.Indices32.push_back(bottom1);
+		}
+	}
+
+	// Every chunk is drawn with these indices, so optimize them once.
+	MeshOptimizer::OptimizeVertexCache(chunk);
+	MeshOptimizer::OptimizeVertexFetch(chunk);
+
+	mTemplate.resize(chunk.Vertices.size());
+	for(size_t i = 0; i < chunk.Vertices.size(); ++i)
+	{
+		const XMFLOAT3& p = chunk.Vertices[i].Position;
+		mTemplate[i].Column = (uint32)lroundf((p.x + 0.5f)*n);
+		mTemplate[i].Row = (uint32)lroundf((0.5f - p.z)*n);
+		mTemplate[i].Skirt = p.y < 0.0f;
+	}
+
+	mIndices.swap(chunk.Indices32);
+}
+
+void TerrainQuadtree::MeasureNodes()
+{
+	// Breadth first, so levels are contiguous and so are siblings.
+	mNodes.resize(1);
+	for(uint32 i = 0; i < mNodes.size(); ++i)
+	{
+		Node node = mNodes[i];
+		if(node.Level + 1 == mLevelCount)
+			continue;
+
+		mNodes[i].FirstChild = (uint32)mNodes.size();
+		for(uint32 child = 0; child < 4; ++child)
+		{
+			Node c;
+			c.Level = node.Level + 1;
+			c.X = 2*node.X + (child & 1);
+			c.Z = 2*node.Z + (child >> 1);
+			mNodes.push_back(c);
+		}
+	}
+
+	// Sample every node at twice its resolution: the even points are its
+	// vertices, the odd ones the midpoints the next level adds.
+	uint32 n = mChunkQuads;
+	uint32 side = 2*n + 1;
+	float half = 0.5f*mSize;
+
+	std::vector<XMFLOAT3> lo(mNodes.size());
+	std::vector<XMFLOAT3> hi(mNodes.size());
+
+	Parallel::For(mNodes.size(), MinNodesPerChunk, [&](size_t begin, size_t end)
+	{
+		std::vector<float> x(side*side), z(side*side), h(side*side);
+
+		for(size_t i = begin; i < end; ++i)
+		{
+			Node& node = mNodes[i];
+			float step = 0.5f*GetCellSize(node.Level);
+			uint32 firstColumn = 2*node.X*n;
+			uint32 firstRow = 2*node.Z*n;
+
+			for(uint32 r = 0; r < side; ++r)
+			{
+				for(uint32 c = 0; c < side; ++c)
+				{
+					x[r*side + c] = -half + (firstColumn + c)*step;
+					z[r*side + c] = half - (firstRow + r)*step;
+				}
+			}
+
+			mTerrain.GetHeights(x.data(), z.data(), h.data(), h.size());
+
+			float error = 0.0f;
+			float minY = +FLT_MAX;
+			float maxY = -FLT_MAX;
+			for(uint32 r = 0; r < side; ++r)
+			{
+				for(uint32 c = 0; c < side; ++c)
+				{
+					float y = h[r*side + c];
+					minY = std::min(minY, y);
+					maxY = std::max(maxY, y);
+
+					// What the node's triangles show at this point: edge midpoints
+					// lie between two vertices, cell centers on the diagonal from
+					// the top right to the bottom left corner.
+					float shown;
+					if(r % 2 == 0 && c % 2 == 0)
+						continue;
+					else if(r % 2 == 0)
+						shown = 0.5f*(h[r*side + c - 1] + h[r*side + c + 1]);
+					else if(c % 2 == 0)
+						shown = 0.5f*(h[(r - 1)*side + c] + h[(r + 1)*side + c]);
+					else
+						shown = 0.5f*(h[(r - 1)*side + c + 1] + h[(r + 1)*side + c - 1]);
+
+					error = std::max(error, fabsf(y - shown));
+				}
+			}
+
+			node.Error = error;
+			lo[i] = XMFLOAT3(x.front(), minY, z.back());
+			hi[i] = XMFLOAT3(x.back(), maxY, z.front());
+		}
+	});
+
+	// Children follow their parents, so walking backwards finishes every
+	// subtree before its root.
+	std::vector<float> levelErrors(mLevelCount, 0.0f);
+	for(size_t i = mNodes.size(); i-- > 0;)
+	{
+		Node& node = mNodes[i];
+		levelErrors[node.Level] = std::max(levelErrors[node.Level], node.Error);
+
+		if(node.FirstChild != 0)
+		{
+			for(uint32 c = node.FirstChild; c < node.FirstChild + 4; ++c)
+			{
+				node.Error = std::max(node.Error, mNodes[c].Error);
+				lo[i].y = std::min(lo[i].y, lo[c].y);
+				hi[i].y = std::max(hi[i].y, hi[c].y);
+			}
+		}
+
+		BoundingBox::CreateFromPoints(node.Bounds, XMLoadFloat3(&lo[i]), XMLoadFloat3(&hi[i]));
+	}
+
+	// Along a shared edge a chunk of level L and one of level L+k differ by at
+	// most the errors of the levels between them added up, so skirts as deep
+	// as all the drawn levels' worst errors together close every crack.
+	mSkirtDepth = GetCellSize(mLevelCount - 1);
+	for(uint32 level = 0; level + 1 < mLevelCount; ++level)
+		mSkirtDepth += levelErrors[level];
+}
+
+void TerrainQuadtree::BuildChunk(uint32 node, std::vector<Vertex>& vertices)const
+{
+	const Node& n = mNodes[node];
+	float cell = GetCellSize(n.Level);
+	float half = 0.5f*mSize;
+
+	// Grid positions and texture coordinates over the whole terrain, as
+	// CreateGrid(size, size, ...) at this level's resolution would give them.
+	uint32 gridQuads = mChunkQuads << n.Level;
+	float duv = 1.0f / gridQuads;
+
+	vertices.resize(mTemplate.size());
+	for(size_t i = 0; i < mTemplate.size(); ++i)
+	{
+		uint32 column = n.X*mChunkQuads + mTemplate[i].Column;
+		uint32 row = n.Z*mChunkQuads + mTemplate[i].Row;
+
+		vertices[i].Position = XMFLOAT3(-half + column*cell, 0.0f, half - row*cell);
+		vertices[i].TexC = XMFLOAT2(column*duv, row*duv);
+	}
+
+	mTerrain.Displace(vertices.data(), vertices.size());
+
+	for(size_t i = 0; i < mTemplate.size(); ++i)
+	{
+		if(mTemplate[i].Skirt)
+			vertices[i].Position.y -= mSkirtDepth;
+	}
+}
+
+void TerrainQuadtree::Select(const XMFLOAT3& eyePos, const XMFLOAT4 planes[6],
+	const LodSettings& settings, Selection& selection,
+	const std::function<bool(uint32 node)>& isReady)const
+{
+	selection.Chunks.clear();
+	selection.TriangleCount = 0;
+	selection.CulledCount = 0;
+	selection.PixelError = 0.0f;
+	selection.BudgetLimited = false;
+
+	std::vector<std::pair<float, uint32>>& heap = selection.Candidates;
+	heap.clear();
+
+	auto pixelError = [&](uint32 node)
+	{
+		const Node& n = mNodes[node];
+		float distance = std::max(Distance(n.Bounds, eyePos), 1e-4f);
+		return n.Error*settings.ScreenScale / distance;
+	};
+
+	if(!IsInside(mNodes[0].Bounds, planes))
+	{
+		selection.CulledCount = 1;
+		return;
+	}
+
+	if(isReady && !isReady(0))
+		return;
+
+	uint32 chunkTriangles = GetChunkTriangleCount();
+	uint32 triangles = chunkTriangles;
+	heap.emplace_back(pixelError(0), 0);
+
+	// Split the worst node of the cut until all are within tolerance.
+	while(!heap.empty() && heap.front().first > settings.MaxPixelError)
+	{
+		std::pop_heap(heap.begin(), heap.end());
+		uint32 node = heap.back().second;
+		float error = heap.back().first;
+		const Node& n = mNodes[node];
+
+		if(n.FirstChild == 0)
+		{
+			heap.pop_back();
+			selection.Chunks.push_back(node);
+			selection.PixelError = std::max(selection.PixelError, error);
+			continue;
+		}
+
+		uint32 visible = 0;
+		bool inside[4];
+		bool ready = true;
+		for(uint32 c = 0; c < 4; ++c)
+		{
+			inside[c] = IsInside(mNodes[n.FirstChild + c].Bounds, planes);
+			visible += inside[c] ? 1 : 0;
+
+			// Ask about every child, not just up to the first that is missing,
+			// so a streamer hears of them all at once.
+			if(inside[c] && isReady && !isReady(n.FirstChild + c))
+				ready = false;
+		}
+
+		if(!ready)
+		{
+			heap.pop_back();
+			selection.Chunks.push_back(node);
+			selection.PixelError = std::max(selection.PixelError, error);
+			continue;
+		}
+
+		uint32 refined = triangles - chunkTriangles + visible*chunkTriangles;
+		if(settings.TriangleBudget != 0 && refined > settings.TriangleBudget)
+		{
+			// Put it back; the cut stays as it is.
+			std::push_heap(heap.begin(), heap.end());
+			selection.BudgetLimited = true;
+			break;
+		}
+
+		heap.pop_back();
+		triangles = refined;
+		selection.CulledCount += 4 - visible;
+
+		for(uint32 c = 0; c < 4; ++c)
+		{
+			if(inside[c])
+			{
+				heap.emplace_back(pixelError(n.FirstChild + c), n.FirstChild + c);
+				std::push_heap(heap.begin(), heap.end());
+			}
+		}
+	}
+
+	for(const std::pair<float, uint32>& candidate : heap)
+	{
+		selection.Chunks.push_back(candidate.second);
+		selection.PixelError = std::max(selection.PixelError, candidate.first);
+	}
+
+	selection.TriangleCount = triangles;
+}
@@ -0,0 +1,172 @@
+//***************************************************************************************
+// TerrainQuadtree.h
+//
+// Chunked level of detail for a Terrain.  A square of the xz-plane is split
+// into a quadtree of LevelCount levels; every node is one chunk of
+// ChunkQuads x ChunkQuads quads covering its square, so each level has four
+// times the resolution of the one above it.
+//
+// All chunks share one index list: a CreateGrid grid of the chunk's
+// resolution plus a skirt, a strip of quads hanging SkirtDepth below each of
+// its four edges.  Where neighbouring chunks of different levels disagree
+// about the height along their shared edge the skirts fill the gap, so no
+// cracks open whatever levels meet.  A chunk's vertices are the template's,
+// scaled to the node and displaced, so a chunk is drawn as
+//   DrawIndexedInstanced(chunk index count, 1, shared indices start,
+//                        base vertex + node * chunk vertex count, 0)
+// when every node's vertices are stored one after another.
+//
+// Every node knows its geometric error: how far, in world units, its
+// surface is from the heights the next level adds (its edge and diagonal
+// midpoints), maximized over the subtree.  Select projects that error to
+// pixels at the node's distance from the eye and refines the nodes that miss
+// the tolerance, worst first, until every drawn chunk meets it or the
+// triangle budget would be exceeded.
+//***************************************************************************************
+
+#pragma once
+
+#include "Terrain.h"
+#include <DirectXCollision.h>
+#include <functional>
+#include <utility>
+
+class TerrainQuadtree
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+	using Vertex = GeometryGenerator::Vertex;
+
+	static const uint32 DefaultChunkQuads = 32;
+
+	// The most quads per side that keep a chunk with its skirt under 0xffff
+	// vertices, so the shared indices fit in 16 bits.
+	static const uint32 MaxChunkQuads = 252;
+
+	// Nodes are stored level by level; a node's four children are stored
+	// together, ordered (2X, 2Z), (2X+1, 2Z), (2X, 2Z+1), (2X+1, 2Z+1).
+	struct Node
+	{
+		uint32 Level = 0;
+
+		// Column and row of the node among the 2^Level x 2^Level nodes of its
+		// level.  Rows run from +z to -z, like CreateGrid's.
+		uint32 X = 0;
+		uint32 Z = 0;
+
+		// Index of the first child, 0 for leaves (the root is nobody's child).
+		uint32 FirstChild = 0;
+
+		// World units between the node's surface and its subtree's.
+		float Error = 0.0f;
+
+		// Encloses the node's surface and its whole subtree's, skirts excluded.
+		DirectX::BoundingBox Bounds;
+	};
+
+	struct LodSettings
+	{
+		// Pixels one world unit covers at distance 1 from the eye:
+		// 0.5 * viewport height * proj(1, 1) for a perspective projection.
+		float ScreenScale = 1.0f;
+
+		// Largest error, in pixels, a drawn chunk may have.
+		float MaxPixelError = 2.0f;
+
+		// Most triangles (skirts included) to draw; 0 for no limit.
+		uint32 TriangleBudget = 0;
+	};
+
+	struct Selection
+	{
+		// Nodes to draw this frame, covering every visible part of the terrain
+		// exactly once.
+		std::vector<uint32> Chunks;
+
+		uint32 TriangleCount = 0;
+
+		// Nodes of the cut skipped because they are outside the frustum.
+		uint32 CulledCount = 0;
+
+		// Largest pixel error among the drawn chunks.  Above MaxPixelError
+		// only when the budget, the finest level or a child that was not
+		// ready stopped refinement.
+		float PixelError = 0.0f;
+		bool BudgetLimited = false;
+
+		// Working heap of (pixel error, node), kept to avoid reallocating.
+		std::vector<std::pair<float, uint32>> Candidates;
+	};
+
+	///<summary>
+	/// Covers the size x size square centered on the origin with levelCount
+	/// levels of chunks of chunkQuads x chunkQuads quads, and measures every
+	/// node's error.  Chunk vertices are not built here; see BuildChunk.
+	///</summary>
+	TerrainQuadtree(const Terrain& terrain, float size, uint32 levelCount, uint32 chunkQuads = DefaultChunkQuads);
+
+	const Terrain& GetTerrain()const { return mTerrain; }
+	float GetSize()const { return mSize; }
+	uint32 GetLevelCount()const { return mLevelCount; }
+	uint32 GetChunkQuads()const { return mChunkQuads; }
+	float GetSkirtDepth()const { return mSkirtDepth; }
+
+	uint32 GetNodeCount()const { return (uint32)mNodes.size(); }
+	const Node& GetNode(uint32 node)const { return mNodes[node]; }
+
+	// Size of every chunk, and the index list they all share.
+	uint32 GetChunkVertexCount()const { return (uint32)mTemplate.size(); }
+	uint32 GetChunkTriangleCount()const { return (uint32)mIndices.size() / 3; }
+	const std::vector<uint32>& GetChunkIndices()const { return mIndices; }
+
+	// Whether chunk vertex i hangs SkirtDepth below the surface.
+	bool IsSkirtVertex(uint32 i)const { return mTemplate[i].Skirt; }
+
+	///<summary>
+	/// Fills vertices with the chunk of node, GetChunkVertexCount() of them, in
+	/// world space with the terrain's heights, normals and tangents.  Vertices
+	/// on an edge are computed from the same global grid position as the
+	/// neighbour's, so chunks of one level meet bit for bit.  Const: threads
+	/// may build different chunks at once.
+	///</summary>
+	void BuildChunk(uint32 node, std::vector<Vertex>& vertices)const;
+
+	///<summary>
+	/// Chooses the chunks to draw for an eye at eyePos.  planes are the
+	/// frustum planes in world space, as FrustumCuller::ExtractFrustumPlanes
+	/// returns them.  Nodes outside the frustum are neither drawn nor refined.
+	/// With isReady, e.g. for streamed chunks, only nodes it accepts are drawn:
+	/// a node is refined only when all its children in the frustum are ready,
+	/// and nothing is drawn until the root is.
+	///</summary>
+	void Select(const DirectX::XMFLOAT3& eyePos, const DirectX::XMFLOAT4 planes[6],
+		const LodSettings& settings, Selection& selection,
+		const std::function<bool(uint32 node)>& isReady = nullptr)const;
+
+private:
+
+	// Grid position of a template vertex in quads from the chunk's top left
+	// corner, and whether it hangs from the edge as part of the skirt.
+	struct TemplateVertex
+	{
+		uint32 Column;
+		uint32 Row;
+		bool Skirt;
+	};
+
+	void BuildTemplate();
+	void MeasureNodes();
+
+	float GetCellSize(uint32 level)const;
+
+	Terrain mTerrain;
+	float mSize;
+	uint32 mLevelCount;
+	uint32 mChunkQuads;
+	float mSkirtDepth = 0.0f;
+
+	std::vector<Node> mNodes;
+	std::vector<TemplateVertex> mTemplate;
+	std::vector<uint32> mIndices;
+};
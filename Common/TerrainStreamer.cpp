@@ -0,0 +1,161 @@
+//***************************************************************************************
+// TerrainStreamer.cpp
+//***************************************************************************************
+
+#include "TerrainStreamer.h"
+#include <algorithm>
+#include <cstdio>
+
+const TerrainStreamer::uint32 TerrainStreamer::MaxThreadCount;
+
+TerrainStreamer::TerrainStreamer(const TerrainQuadtree& tree, Encoder encoder, uint64 byteBudget, uint32 threadCount) :
+	mTree(tree),
+	mEncoder(std::move(encoder))
+{
+	mStats.ByteBudget = byteBudget;
+
+	if(threadCount == 0)
+		threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	threadCount = std::min(threadCount, MaxThreadCount);
+
+	for(uint32 i = 0; i < threadCount; ++i)
+		mWorkers.emplace_back(&TerrainStreamer::WorkerLoop, this);
+}
+
+TerrainStreamer::~TerrainStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mWake.notify_all();
+
+	for(std::thread& worker : mWorkers)
+		worker.join();
+}
+
+void TerrainStreamer::BeginFrame()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mFrame++;
+
+	// Requests last made before the frame that just ended are stale.
+	auto stale = [&](uint32 node)
+	{
+		auto it = mEntries.find(node);
+		if(it->second.RequestFrame + 1 >= mFrame)
+			return false;
+
+		mEntries.erase(it);
+		mStats.Cancelled++;
+		return true;
+	};
+	mQueue.erase(std::remove_if(mQueue.begin(), mQueue.end(), stale), mQueue.end());
+}
+
+TerrainStreamer::ChunkPtr TerrainStreamer::Acquire(uint32 node)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto it = mEntries.find(node);
+	if(it != mEntries.end() && it->second.Status == State::Resident)
+	{
+		mUse.splice(mUse.begin(), mUse, it->second.Use);
+		mStats.Hits++;
+		return it->second.Data;
+	}
+
+	mStats.Misses++;
+
+	if(it == mEntries.end())
+	{
+		Entry& entry = mEntries[node];
+		entry.RequestFrame = mFrame;
+		mQueue.push_front(node);
+		mWake.notify_one();
+	}
+	else
+	{
+		it->second.RequestFrame = mFrame;
+	}
+
+	return nullptr;
+}
+
+void TerrainStreamer::WorkerLoop()
+{
+	std::vector<Vertex> vertices;
+
+	for(;;)
+	{
+		uint32 node;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [this] { return mStop || !mQueue.empty(); });
+			if(mStop)
+				return;
+
+			node = mQueue.front();
+			mQueue.pop_front();
+			mEntries[node].Status = State::Building;
+		}
+
+		auto chunk = std::make_shared<Chunk>();
+		chunk->Node = node;
+		mTree.BuildChunk(node, vertices);
+		mEncoder(node, vertices, chunk->Bytes);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		Entry& entry = mEntries[node];
+		entry.Status = State::Resident;
+		entry.Data = chunk;
+		mUse.push_front(node);
+		entry.Use = mUse.begin();
+
+		mStats.Built++;
+		mStats.ResidentBytes += chunk->Bytes.size();
+		Evict();
+	}
+}
+
+void TerrainStreamer::Evict()
+{
+	// The newest chunk always stays, even if it alone is over budget.
+	while(mStats.ResidentBytes > mStats.ByteBudget && mUse.size() > 1)
+	{
+		auto it = mEntries.find(mUse.back());
+		mStats.ResidentBytes -= it->second.Data->Bytes.size();
+		mStats.Evictions++;
+
+		mEntries.erase(it);
+		mUse.pop_back();
+	}
+}
+
+TerrainStreamer::Stats TerrainStreamer::GetStats()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	Stats stats = mStats;
+	stats.ResidentChunks = (uint32)mUse.size();
+	stats.QueuedChunks = (uint32)mQueue.size();
+	return stats;
+}
+
+std::string TerrainStreamer::ToString(const Stats& stats)
+{
+	uint64 requests = stats.Hits + stats.Misses;
+	float hitRate = requests > 0 ? 100.0f*stats.Hits / requests : 0.0f;
+
+	char buffer[256];
+	snprintf(buffer, sizeof(buffer),
+		"%llu hits, %llu misses (%.1f%% hit rate), %llu built, %llu evicted, %llu cancelled; "
+		"%u chunks in %.1f of %.1f MB, %u queued",
+		(unsigned long long)stats.Hits, (unsigned long long)stats.Misses, hitRate,
+		(unsigned long long)stats.Built, (unsigned long long)stats.Evictions, (unsigned long long)stats.Cancelled,
+		stats.ResidentChunks, stats.ResidentBytes / (1024.0f*1024.0f), stats.ByteBudget / (1024.0f*1024.0f),
+		stats.QueuedChunks);
+
+	return buffer;
+}
@@ -0,0 +1,148 @@
+//***************************************************************************************
+// TerrainStreamer.h
+//
+// Builds TerrainQuadtree chunks on background threads and keeps the finished
+// ones in a least recently used cache bounded in bytes.
+//
+// The frame loop never waits for a chunk: Acquire returns a chunk that is
+// ready and otherwise queues it and returns null, so the caller draws what is
+// resident (e.g. by refining the quadtree only into ready children) and picks
+// the chunk up on a later frame.  Workers build the newest requests first,
+// and drop requests nobody has repeated for a frame, so a moving camera does
+// not leave a backlog of chunks it no longer needs.
+//
+// Each chunk is turned into the bytes the application uploads by an Encoder
+// run on the worker thread, so vertex conversion or compression stays off the
+// frame loop too.  Chunks are shared: evicting one frees it only once the
+// caller lets go of it.
+//
+// The streamer keeps at most MaxThreadCount threads of its own rather than
+// building on the Parallel pool.  That pool already has a worker per core for
+// the frame's loops and runs one loop at a time, so a chunk build queued on it
+// would hold those workers, and with them the frame, until it finished.  A
+// couple of background threads keep up with a moving camera while leaving the
+// cores to the pool.
+//***************************************************************************************
+
+#pragma once
+
+#include "TerrainQuadtree.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+class TerrainStreamer
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+	using uint64 = std::uint64_t;
+	using Vertex = GeometryGenerator::Vertex;
+
+	///<summary>
+	/// Writes the chunk of node, as built by TerrainQuadtree::BuildChunk, to
+	/// bytes.  Runs on worker threads, several at once.
+	///</summary>
+	using Encoder = std::function<void(uint32 node, const std::vector<Vertex>& vertices, std::vector<std::uint8_t>& bytes)>;
+
+	struct Chunk
+	{
+		uint32 Node = 0;
+		std::vector<std::uint8_t> Bytes;
+	};
+
+	using ChunkPtr = std::shared_ptr<const Chunk>;
+
+	struct Stats
+	{
+		// Acquire calls that found the chunk ready, and that did not.
+		uint64 Hits = 0;
+		uint64 Misses = 0;
+
+		// Chunks built, evicted to stay within the budget, and requests
+		// dropped because they were not repeated.
+		uint64 Built = 0;
+		uint64 Evictions = 0;
+		uint64 Cancelled = 0;
+
+		uint32 ResidentChunks = 0;
+		uint64 ResidentBytes = 0;
+		uint64 ByteBudget = 0;
+		uint32 QueuedChunks = 0;
+	};
+
+	static const uint32 MaxThreadCount = 2;
+
+	///<summary>
+	/// Starts threadCount workers, at most MaxThreadCount.  When threadCount
+	/// is 0 it starts MaxThreadCount, or one fewer than the hardware threads
+	/// if that is less, but at least one.  tree must outlive the streamer.
+	///</summary>
+	TerrainStreamer(const TerrainQuadtree& tree, Encoder encoder, uint64 byteBudget, uint32 threadCount = 0);
+	~TerrainStreamer();
+
+	TerrainStreamer(const TerrainStreamer& rhs) = delete;
+	TerrainStreamer& operator=(const TerrainStreamer& rhs) = delete;
+
+	///<summary>
+	/// Call once per frame before the frame's Acquire calls.  Queued requests
+	/// not repeated since the previous BeginFrame are dropped.
+	///</summary>
+	void BeginFrame();
+
+	///<summary>
+	/// Returns the chunk of node and marks it most recently used if it is
+	/// ready.  Otherwise queues it, if it is not queued or being built
+	/// already, and returns null.  Never blocks on building.
+	///</summary>
+	ChunkPtr Acquire(uint32 node);
+
+	Stats GetStats()const;
+	static std::string ToString(const Stats& stats);
+
+private:
+
+	enum class State
+	{
+		Queued,
+		Building,
+		Resident
+	};
+
+	struct Entry
+	{
+		State Status = State::Queued;
+		uint64 RequestFrame = 0;
+		ChunkPtr Data;
+		std::list<uint32>::iterator Use;
+	};
+
+	void WorkerLoop();
+
+	// Drops least recently used chunks until the cache is within budget.
+	// Expects mMutex held.
+	void Evict();
+
+	const TerrainQuadtree& mTree;
+	Encoder mEncoder;
+
+	mutable std::mutex mMutex;
+	std::condition_variable mWake;
+	bool mStop = false;
+
+	uint64 mFrame = 0;
+	std::unordered_map<uint32, Entry> mEntries;
+
+	// Queued nodes, newest first, and resident nodes, most recently used first.
+	std::deque<uint32> mQueue;
+	std::list<uint32> mUse;
+
+	Stats mStats;
+	std::vector<std::thread> mWorkers;
+};
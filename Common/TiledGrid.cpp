@@ -0,0 +1,137 @@
+//***************************************************************************************
+// TiledGrid.cpp
+//***************************************************************************************
+
+#include "TiledGrid.h"
+#include <algorithm>
+#include <cfloat>
+
+using namespace DirectX;
+
+const TiledGrid::uint32 TiledGrid::DefaultTileQuads;
+const TiledGrid::uint32 TiledGrid::MaxTileQuads;
+
+TiledGrid::TiledGrid(float width, float depth, uint32 m, uint32 n, uint32 tileQuads, HeightFunction height) :
+	mWidth(width),
+	mDepth(depth),
+	mRows(std::max(m, 2u)),
+	mColumns(std::max(n, 2u)),
+	mTileQuads(std::min(std::max(tileQuads, 1u), MaxTileQuads)),
+	mHeight(std::move(height))
+{
+	mTileCountX = (mColumns - 1 + mTileQuads - 1) / mTileQuads;
+	mTileCountZ = (mRows - 1 + mTileQuads - 1) / mTileQuads;
+}
+
+void TiledGrid::BuildTile(uint32 tileX, uint32 tileZ, Tile& tile)const
+{
+	tile.TileX = tileX;
+	tile.TileZ = tileZ;
+	tile.FirstRow = tileZ*mTileQuads;
+	tile.FirstColumn = tileX*mTileQuads;
+
+	// One more vertex than quads, so the last row and column are shared with
+	// the next tile.
+	uint32 rows = std::min(mTileQuads, mRows - 1 - tile.FirstRow) + 1;
+	uint32 columns = std::min(mTileQuads, mColumns - 1 - tile.FirstColumn) + 1;
+
+	// Tiles of the same size have the same indices, so keep them.
+	if(rows != tile.Rows || columns != tile.Columns || tile.Mesh.Indices32.empty())
+	{
+		tile.Mesh.Indices32.resize(6*(rows - 1)*(columns - 1));
+
+		uint32 k = 0;
+		for(uint32 i = 0; i < rows - 1; ++i)
+		{
+			for(uint32 j = 0; j < columns - 1; ++j)
+			{
+				tile.Mesh.Indices32[k]     = i*columns + j;
+				tile.Mesh.Indices32[k + 1] = i*columns + j + 1;
+				tile.Mesh.Indices32[k + 2] = (i + 1)*columns + j;
+
+				tile.Mesh.Indices32[k + 3] = (i + 1)*columns + j;
+				tile.Mesh.Indices32[k + 4] = i*columns + j + 1;
+				tile.Mesh.Indices32[k + 5] = (i + 1)*columns + j + 1;
+
+				k += 6;
+			}
+		}
+	}
+
+	tile.Rows = rows;
+	tile.Columns = columns;
+	tile.Mesh.Vertices.resize(rows*columns);
+
+	// Same expressions as GenerateGrid, evaluated at global rows and columns.
+	float halfWidth = 0.5f*mWidth;
+	float halfDepth = 0.5f*mDepth;
+
+	float dx = mWidth / (mColumns - 1);
+	float dz = mDepth / (mRows - 1);
+
+	float du = 1.0f / (mColumns - 1);
+	float dv = 1.0f / (mRows - 1);
+
+	// Central differences half a cell to either side.
+	float ex = 0.5f*dx;
+	float ez = 0.5f*dz;
+
+	XMFLOAT3 lo(+FLT_MAX, +FLT_MAX, +FLT_MAX);
+	XMFLOAT3 hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for(uint32 i = 0; i < rows; ++i)
+	{
+		uint32 row = tile.FirstRow + i;
+		float z = halfDepth - row*dz;
+
+		for(uint32 j = 0; j < columns; ++j)
+		{
+			uint32 column = tile.FirstColumn + j;
+			float x = -halfWidth + column*dx;
+
+			GeometryGenerator::Vertex& v = tile.Mesh.Vertices[i*columns + j];
+			v.TexC = XMFLOAT2(column*du, row*dv);
+
+			if(mHeight)
+			{
+				float slopeX = (mHeight(x + ex, z) - mHeight(x - ex, z)) / (2.0f*ex);
+				float slopeZ = (mHeight(x, z + ez) - mHeight(x, z - ez)) / (2.0f*ez);
+
+				v.Position = XMFLOAT3(x, mHeight(x, z), z);
+				XMStoreFloat3(&v.Normal, XMVector3Normalize(XMVectorSet(-slopeX, 1.0f, -slopeZ, 0.0f)));
+				XMStoreFloat3(&v.TangentU, XMVector3Normalize(XMVectorSet(1.0f, slopeX, 0.0f, 0.0f)));
+			}
+			else
+			{
+				v.Position = XMFLOAT3(x, 0.0f, z);
+				v.Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				v.TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+			}
+
+			lo.y = std::min(lo.y, v.Position.y);
+			hi.y = std::max(hi.y, v.Position.y);
+		}
+	}
+
+	// x and z bounds come from the corners; rows run from +z to -z.
+	const XMFLOAT3& first = tile.Mesh.Vertices.front().Position;
+	const XMFLOAT3& last = tile.Mesh.Vertices.back().Position;
+	lo.x = first.x; hi.x = last.x;
+	lo.z = last.z;  hi.z = first.z;
+
+	BoundingBox::CreateFromPoints(tile.Bounds, XMLoadFloat3(&lo), XMLoadFloat3(&hi));
+}
+
+void TiledGrid::ForEachTile(const std::function<bool(const Tile& tile)>& consume)const
+{
+	Tile tile;
+	for(uint32 tileZ = 0; tileZ < mTileCountZ; ++tileZ)
+	{
+		for(uint32 tileX = 0; tileX < mTileCountX; ++tileX)
+		{
+			BuildTile(tileX, tileZ, tile);
+			if(!consume(tile))
+				return;
+		}
+	}
+}
@@ -0,0 +1,87 @@
+//***************************************************************************************
+// TiledGrid.h
+//
+// Produces the grid of GeometryGenerator::CreateGrid one square tile at a time,
+// so terrains far larger than memory (e.g. 16384x16384 vertices) can be built
+// and consumed incrementally.  Only the tile being built is held in memory.
+//
+// Neighbouring tiles share their edge row or column: both contain those
+// vertices, computed from the same global row and column, so positions, normals
+// and texture coordinates match bit for bit and the tiles join without cracks.
+// A tile has at most (TileQuads+1)^2 vertices, so its indices fit in 16 bits.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <DirectXCollision.h>
+#include <functional>
+
+class TiledGrid
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+	using MeshData = GeometryGenerator::MeshData;
+
+	// Height of the terrain at (x, z).  It is sampled at vertices and half a
+	// cell to either side for the normals, so it must be defined everywhere.
+	using HeightFunction = std::function<float(float x, float z)>;
+
+	static const uint32 DefaultTileQuads = 128;
+
+	// (MaxTileQuads+1)^2 is the most vertices that leave 0xffff free.
+	static const uint32 MaxTileQuads = 254;
+
+	struct Tile
+	{
+		uint32 TileX = 0;
+		uint32 TileZ = 0;
+
+		// Global row and column of the tile's first vertex, and its size in
+		// vertices.  Tiles on the far edges may be smaller.
+		uint32 FirstRow = 0;
+		uint32 FirstColumn = 0;
+		uint32 Rows = 0;
+		uint32 Columns = 0;
+
+		// Vertices in the same space as CreateGrid's, indices local to the tile.
+		MeshData Mesh;
+		DirectX::BoundingBox Bounds;
+	};
+
+	///<summary>
+	/// The grid CreateGrid(width, depth, m, n) would build, cut into tiles of
+	/// tileQuads x tileQuads quads.  Without a height function the grid is flat.
+	///</summary>
+	TiledGrid(float width, float depth, uint32 m, uint32 n, uint32 tileQuads = DefaultTileQuads,
+		HeightFunction height = nullptr);
+
+	uint32 GetTileCountX()const { return mTileCountX; }
+	uint32 GetTileCountZ()const { return mTileCountZ; }
+
+	///<summary>
+	/// Fills tile with tile (tileX, tileZ), reusing its vectors, so building
+	/// tile after tile into one Tile allocates once.  Const and free of shared
+	/// state: threads may build different tiles into their own Tile objects.
+	///</summary>
+	void BuildTile(uint32 tileX, uint32 tileZ, Tile& tile)const;
+
+	///<summary>
+	/// Builds every tile in row order and passes it to consume, which returns
+	/// false to stop early.  The tile is only valid during the call.
+	///</summary>
+	void ForEachTile(const std::function<bool(const Tile& tile)>& consume)const;
+
+private:
+
+	float mWidth;
+	float mDepth;
+	uint32 mRows;
+	uint32 mColumns;
+	uint32 mTileQuads;
+	HeightFunction mHeight;
+
+	uint32 mTileCountX;
+	uint32 mTileCountZ;
+};
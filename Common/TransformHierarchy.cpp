@@ -0,0 +1,138 @@
+//***************************************************************************************
+// TransformHierarchy.cpp
+//***************************************************************************************
+
+#include "TransformHierarchy.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace DirectX;
+
+namespace
+{
+	// Fewest nodes of a level worth handing to another thread.  A node takes
+	// about 35 ns (TransformHierarchy_Update), so a chunk is some 35 us of
+	// work against the 2-4 us a pool worker takes to wake; creating and
+	// joining a thread per chunk cost nearly as much as the chunk itself
+	// (Parallel_WakeVsSpawn).
+	const size_t MinNodesPerChunk = 1024;
+
+	// Ends a list of children.
+	const TransformHierarchy::uint32 NoNode = UINT32_MAX;
+
+	XMMATRIX XM_CALLCONV LocalMatrix(const TransformHierarchy::Transform& local)
+	{
+		return XMMatrixScalingFromVector(XMLoadFloat3(&local.Scale)) *
+			XMMatrixRotationQuaternion(XMLoadFloat4(&local.Rotation)) *
+			XMMatrixTranslationFromVector(XMLoadFloat3(&local.Translation));
+	}
+}
+
+const TransformHierarchy::uint32 TransformHierarchy::NoParent;
+
+void TransformHierarchy::Reserve(uint32 count)
+{
+	mParents.reserve(count);
+	mLevels.reserve(count);
+	mFirstChildren.reserve(count);
+	mNextSiblings.reserve(count);
+	mLocals.reserve(count);
+	mWorlds.reserve(count);
+	mQueued.reserve(count);
+}
+
+TransformHierarchy::uint32 TransformHierarchy::AddNode(uint32 parent, const Transform& local)
+{
+	assert(parent == NoParent || parent < GetNodeCount());
+
+	uint32 node = GetNodeCount();
+	uint32 level = parent == NoParent ? 0 : mLevels[parent] + 1;
+
+	mParents.push_back(parent);
+	mLevels.push_back(level);
+	mFirstChildren.push_back(NoNode);
+	mNextSiblings.push_back(NoNode);
+	mLocals.push_back(local);
+	mWorlds.push_back(XMFLOAT4X4());
+	mQueued.push_back(0);
+
+	// Prepending reverses the children, which only matters for visit order.
+	if(parent != NoParent)
+	{
+		mNextSiblings[node] = mFirstChildren[parent];
+		mFirstChildren[parent] = node;
+	}
+
+	if(mLevelQueues.size() <= level)
+		mLevelQueues.resize(level + 1);
+
+	MarkDirty(node);
+	return node;
+}
+
+void TransformHierarchy::SetLocal(uint32 node, const Transform& local)
+{
+	mLocals[node] = local;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetTranslation(uint32 node, const XMFLOAT3& translation)
+{
+	mLocals[node].Translation = translation;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetRotation(uint32 node, const XMFLOAT4& rotation)
+{
+	mLocals[node].Rotation = rotation;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::MarkDirty(uint32 node)
+{
+	if(mQueued[node])
+		return;
+
+	mQueued[node] = 1;
+	mLevelQueues[mLevels[node]].push_back(node);
+}
+
+void TransformHierarchy::Update()
+{
+	mUpdated.clear();
+
+	for(size_t level = 0; level < mLevelQueues.size(); ++level)
+	{
+		std::vector<uint32>& queue = mLevelQueues[level];
+		if(queue.empty())
+			continue;
+
+		// Nodes of one level only read the level above, which is final.
+		Parallel::For(queue.size(), MinNodesPerChunk, [&](size_t begin, size_t end)
+		{
+			for(size_t i = begin; i < end; ++i)
+			{
+				uint32 node = queue[i];
+				XMMATRIX world = LocalMatrix(mLocals[node]);
+
+				uint32 parent = mParents[node];
+				if(parent != NoParent)
+					world = XMMatrixMultiply(world, XMLoadFloat4x4(&mWorlds[parent]));
+
+				XMStoreFloat4x4(&mWorlds[node], world);
+			}
+		});
+
+		// A recomputed node's children are dirty too.
+		for(uint32 node : queue)
+		{
+			mQueued[node] = 0;
+			for(uint32 child = mFirstChildren[node]; child != NoNode; child = mNextSiblings[child])
+				MarkDirty(child);
+		}
+
+		mUpdated.insert(mUpdated.end(), queue.begin(), queue.end());
+		queue.clear();
+	}
+}
@@ -0,0 +1,99 @@
+//***************************************************************************************
+// TransformHierarchy.h
+//
+// A tree of transforms.  Every node has a local scale, rotation (a unit
+// quaternion) and translation relative to its parent, and a world matrix
+//
+//   World = Scaling * Rotation * Translation * parent's World
+//
+// so a group node places everything under it: moving a whole building, or one
+// row of its columns, is a single SetLocal on the group.
+//
+// Update recomputes only dirty subtrees.  Nodes changed since the last Update
+// are queued by depth; Update then works down one level at a time, computing
+// the queued nodes of a level (on the Parallel worker pool for large levels,
+// since nodes of one level depend only on the level above) and then
+// queueing their children.  Nodes outside the changed subtrees are never
+// visited.  GetUpdatedNodes lists the nodes whose world matrix Update
+// recomputed, for copying them to render items or constant buffers.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+
+class TransformHierarchy
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+
+	static const uint32 NoParent = UINT32_MAX;
+
+	struct Transform
+	{
+		DirectX::XMFLOAT3 Scale = { 1.0f, 1.0f, 1.0f };
+		DirectX::XMFLOAT4 Rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+		DirectX::XMFLOAT3 Translation = { 0.0f, 0.0f, 0.0f };
+	};
+
+	void Reserve(uint32 count);
+
+	///<summary>
+	/// Adds a node under parent, which must already exist, or a root for
+	/// NoParent, and returns its index.  The node is dirty until the next
+	/// Update.
+	///</summary>
+	uint32 AddNode(uint32 parent, const Transform& local);
+
+	uint32 GetNodeCount()const { return (uint32)mParents.size(); }
+	uint32 GetParent(uint32 node)const { return mParents[node]; }
+
+	// Depth of the node: 0 for roots.
+	uint32 GetLevel(uint32 node)const { return mLevels[node]; }
+
+	const Transform& GetLocal(uint32 node)const { return mLocals[node]; }
+
+	///<summary>
+	/// Replaces the node's local transform, marking its subtree dirty.
+	///</summary>
+	void SetLocal(uint32 node, const Transform& local);
+	void SetTranslation(uint32 node, const DirectX::XMFLOAT3& translation);
+	void SetRotation(uint32 node, const DirectX::XMFLOAT4& rotation);
+
+	///<summary>
+	/// World matrix as of the last Update.
+	///</summary>
+	const DirectX::XMFLOAT4X4& GetWorld(uint32 node)const { return mWorlds[node]; }
+
+	///<summary>
+	/// Recomputes the world matrices of every dirty node and its descendants.
+	///</summary>
+	void Update();
+
+	///<summary>
+	/// Nodes the last Update recomputed, parents before children.
+	///</summary>
+	const std::vector<uint32>& GetUpdatedNodes()const { return mUpdated; }
+
+private:
+
+	void MarkDirty(uint32 node);
+
+	// Per node: the tree, as parent, depth and a list of children.
+	std::vector<uint32> mParents;
+	std::vector<uint32> mLevels;
+	std::vector<uint32> mFirstChildren;
+	std::vector<uint32> mNextSiblings;
+
+	std::vector<Transform> mLocals;
+	std::vector<DirectX::XMFLOAT4X4> mWorlds;
+
+	// Per node, whether it is waiting in its level's queue.
+	std::vector<std::uint8_t> mQueued;
+
+	// Per level, the nodes to recompute.
+	std::vector<std::vector<uint32>> mLevelQueues;
+
+	std::vector<uint32> mUpdated;
+};
@@ -57,6 +57,14 @@ public:
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // Copies count consecutive elements, e.g. vertices of a dynamic vertex
+    // buffer.  Constant buffer elements are padded, so they are copied singly.
+    void CopyData(int firstElementIndex, const T* data, UINT count)
+    {
+        assert(!mIsConstantBuffer);
+        memcpy(&mMappedData[firstElementIndex*mElementByteSize], data, sizeof(T)*count);
+    }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE* mMappedData = nullptr;
@@ -0,0 +1,435 @@
+//***************************************************************************************
+// VertexCompression.cpp
+//***************************************************************************************
+
+#include "VertexCompression.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+const VertexCompression::ErrorBounds VertexCompression::DefaultTolerance =
+	{ 0.0001f, XMConvertToRadians(0.5f), XMConvertToRadians(1.0f), 1.0f / 2048.0f };
+
+namespace
+{
+	using uint32 = VertexCompression::uint32;
+	using PositionFormat = VertexCompression::PositionFormat;
+	using FrameFormat = VertexCompression::FrameFormat;
+	using TexCFormat = VertexCompression::TexCFormat;
+
+	uint32 PositionSize(PositionFormat format)
+	{
+		return format == PositionFormat::Float3 ? 12 : 8;
+	}
+
+	uint32 FrameSize(FrameFormat format)
+	{
+		switch(format)
+		{
+		case FrameFormat::Float3: return 24;
+		case FrameFormat::Oct16:  return 8;
+		default:                  return 4;
+		}
+	}
+
+	uint32 TexCSize(TexCFormat format)
+	{
+		return format == TexCFormat::Float2 ? 8 : 4;
+	}
+
+	const char* FormatName(PositionFormat format)
+	{
+		switch(format)
+		{
+		case PositionFormat::Float3: return "Float3";
+		case PositionFormat::Half4:  return "Half4";
+		default:                     return "UNorm16";
+		}
+	}
+
+	const char* FormatName(FrameFormat format)
+	{
+		switch(format)
+		{
+		case FrameFormat::Float3: return "Float3";
+		case FrameFormat::Oct16:  return "Oct16";
+		default:                  return "Oct8";
+		}
+	}
+
+	const char* FormatName(TexCFormat format)
+	{
+		return format == TexCFormat::Float2 ? "Float2" : "Half2";
+	}
+
+	// Rounding each octahedral coordinate on its own can be almost a full
+	// step off on the sphere; trying the four surrounding grid points and
+	// keeping the closest one roughly halves the angular error.  Returns the
+	// chosen point in [-1,1], exactly on the grid of steps 1/maxValue.
+	XMVECTOR XM_CALLCONV QuantizeOct(FXMVECTOR n, float maxValue)
+	{
+		if(XMVectorGetX(XMVector3LengthSq(n)) <= 0.0f)
+			return XMVectorZero();
+
+		XMVECTOR lo = XMVectorFloor(VertexCompression::OctEncode(n) * maxValue);
+		XMVECTOR limit = XMVectorReplicate(maxValue);
+
+		XMVECTOR best = lo;
+		float bestDot = -2.0f;
+		for(int k = 0; k < 4; ++k)
+		{
+			XMVECTOR e = lo + XMVectorSet((float)(k & 1), (float)(k >> 1), 0.0f, 0.0f);
+			e = XMVectorClamp(e, -limit, limit);
+
+			float d = XMVectorGetX(XMVector3Dot(VertexCompression::OctDecode(e / maxValue), n));
+			if(d > bestDot)
+			{
+				bestDot = d;
+				best = e;
+			}
+		}
+
+		return best / maxValue;
+	}
+
+	float AngleBetween(FXMVECTOR a, FXMVECTOR b)
+	{
+		if(XMVectorGetX(XMVector3LengthSq(a)) <= 0.0f || XMVectorGetX(XMVector3LengthSq(b)) <= 0.0f)
+			return 0.0f;
+
+		// atan2 stays accurate for tiny angles where acos(dot) rounds to ~0.03 degrees.
+		float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(a, b)));
+		float cosine = XMVectorGetX(XMVector3Dot(a, b));
+
+		return atan2f(sine, cosine);
+	}
+
+	VertexCompression::ErrorBounds MeasureError(const GeometryGenerator::MeshData& meshData,
+		const VertexCompression::EncodedMesh& mesh, float diagonal)
+	{
+		std::vector<GeometryGenerator::Vertex> decoded;
+		VertexCompression::Decode(mesh, decoded);
+
+		float invDiagonal = diagonal > 0.0f ? 1.0f / diagonal : 1.0f;
+
+		VertexCompression::ErrorBounds error;
+		for(size_t i = 0; i < decoded.size(); ++i)
+		{
+			const GeometryGenerator::Vertex& a = meshData.Vertices[i];
+			const GeometryGenerator::Vertex& b = decoded[i];
+
+			float dp = XMVectorGetX(XMVector3Length(XMLoadFloat3(&a.Position) - XMLoadFloat3(&b.Position)));
+			error.Position = std::max(error.Position, dp*invDiagonal);
+
+			error.Normal = std::max(error.Normal, AngleBetween(XMLoadFloat3(&a.Normal), XMLoadFloat3(&b.Normal)));
+			error.Tangent = std::max(error.Tangent, AngleBetween(XMLoadFloat3(&a.TangentU), XMLoadFloat3(&b.TangentU)));
+
+			error.TexC = std::max(error.TexC, std::max(fabsf(a.TexC.x - b.TexC.x), fabsf(a.TexC.y - b.TexC.y)));
+		}
+
+		return error;
+	}
+}
+
+VertexCompression::VertexLayout VertexCompression::GetLayout(const VertexFormat& format)
+{
+	// All attribute sizes are multiples of 4, so packing them back to back
+	// keeps every offset aligned.
+	VertexLayout layout;
+	layout.PositionOffset = 0;
+	layout.FrameOffset = layout.PositionOffset + PositionSize(format.Position);
+	layout.TexCOffset = layout.FrameOffset + FrameSize(format.Frame);
+	layout.Stride = layout.TexCOffset + TexCSize(format.TexC);
+
+	return layout;
+}
+
+VertexCompression::EncodedMesh VertexCompression::Encode(const MeshData& meshData, const VertexFormat& format)
+{
+	EncodedMesh mesh;
+	mesh.Format = format;
+	mesh.Layout = GetLayout(format);
+	mesh.VertexCount = (uint32)meshData.Vertices.size();
+	mesh.Data.resize((size_t)mesh.VertexCount * mesh.Layout.Stride);
+
+	if(mesh.VertexCount == 0)
+		return mesh;
+
+	const auto& vertices = meshData.Vertices;
+	const uint32 stride = mesh.Layout.Stride;
+
+	XMVECTOR vMin = XMLoadFloat3(&vertices[0].Position);
+	XMVECTOR vMax = vMin;
+	for(const auto& v : vertices)
+	{
+		XMVECTOR p = XMLoadFloat3(&v.Position);
+		vMin = XMVectorMin(vMin, p);
+		vMax = XMVectorMax(vMax, p);
+	}
+
+	//
+	// Positions.
+	//
+
+	std::uint8_t* dst = mesh.Data.data() + mesh.Layout.PositionOffset;
+	switch(format.Position)
+	{
+	case PositionFormat::Float3:
+		for(uint32 i = 0; i < mesh.VertexCount; ++i, dst += stride)
+			std::memcpy(dst, &vertices[i].Position, sizeof(XMFLOAT3));
+		break;
+
+	case PositionFormat::Half4:
+	{
+		// Halfs are most precise near zero, so center the box on the origin.
+		XMVECTOR center = 0.5f*(vMin + vMax);
+		XMStoreFloat3(&mesh.Transform.Offset, center);
+
+		for(uint32 i = 0; i < mesh.VertexCount; ++i, dst += stride)
+			XMStoreHalf4(reinterpret_cast<XMHALF4*>(dst), XMLoadFloat3(&vertices[i].Position) - center);
+		break;
+	}
+
+	case PositionFormat::UNorm16:
+	{
+		// Flat boxes (e.g. a grid's height) keep a unit scale to avoid a
+		// division by zero; every value there encodes to 0 anyway.
+		XMVECTOR extent = vMax - vMin;
+		XMVECTOR scale = XMVectorSelect(extent, XMVectorSplatOne(), XMVectorLessOrEqual(extent, XMVectorZero()));
+		XMVECTOR invScale = XMVectorReciprocal(scale);
+
+		XMStoreFloat3(&mesh.Transform.Scale, scale);
+		XMStoreFloat3(&mesh.Transform.Offset, vMin);
+
+		for(uint32 i = 0; i < mesh.VertexCount; ++i, dst += stride)
+		{
+			XMVECTOR p = (XMLoadFloat3(&vertices[i].Position) - vMin) * invScale;
+			XMStoreUShortN4(reinterpret_cast<XMUSHORTN4*>(dst), p);
+		}
+		break;
+	}
+	}
+
+	//
+	// Normal and tangent.
+	//
+
+	dst = mesh.Data.data() + mesh.Layout.FrameOffset;
+	switch(format.Frame)
+	{
+	case FrameFormat::Float3:
+		for(uint32 i = 0; i < mesh.VertexCount; ++i, dst += stride)
+		{
+			std::memcpy(dst, &vertices[i].Normal, sizeof(XMFLOAT3));
+			std::memcpy(dst + sizeof(XMFLOAT3), &vertices[i].TangentU, sizeof(XMFLOAT3));
+		}
+		break;
+
+	case FrameFormat::Oct16:
+		for(uint32 i = 0; i < mesh.VertexCount; ++i, dst += stride)
+		{
+			XMVECTOR n = QuantizeOct(XMLoadFloat3(&vertices[i].Normal), 32767.0f);
+			XMVECTOR t = QuantizeOct(XMLoadFloat3(&vertices[i].TangentU), 32767.0f);
+			XMStoreShortN4(reinterpret_cast<XMSHORTN4*>(dst), XMVectorPermute<0, 1, 4, 5>(n, t));
+		}
+		break;
+
+	case FrameFormat::Oct8:
+		for(uint32 i = 0; i < mesh.VertexCount; ++i, dst += stride)
+		{
+			XMVECTOR n = QuantizeOct(XMLoadFloat3(&vertices[i].Normal), 127.0f);
+			XMVECTOR t = QuantizeOct(XMLoadFloat3(&vertices[i].TangentU), 127.0f);
+			XMStoreByteN4(reinterpret_cast<XMBYTEN4*>(dst), XMVectorPermute<0, 1, 4, 5>(n, t));
+		}
+		break;
+	}
+
+	//
+	// Texture coordinates.
+	//
+
+	dst = mesh.Data.data() + mesh.Layout.TexCOffset;
+	switch(format.TexC)
+	{
+	case TexCFormat::Float2:
+		for(uint32 i = 0; i < mesh.VertexCount; ++i, dst += stride)
+			std::memcpy(dst, &vertices[i].TexC, sizeof(XMFLOAT2));
+		break;
+
+	case TexCFormat::Half2:
+		for(uint32 i = 0; i < mesh.VertexCount; ++i, dst += stride)
+			XMStoreHalf2(reinterpret_cast<XMHALF2*>(dst), XMLoadFloat2(&vertices[i].TexC));
+		break;
+	}
+
+	float diagonal = XMVectorGetX(XMVector3Length(vMax - vMin));
+	mesh.MaxError = MeasureError(meshData, mesh, diagonal);
+
+	return mesh;
+}
+
+void VertexCompression::Decode(const EncodedMesh& mesh, std::vector<GeometryGenerator::Vertex>& vertices)
+{
+	vertices.resize(mesh.VertexCount);
+
+	const uint32 stride = mesh.Layout.Stride;
+	const XMVECTOR scale = XMLoadFloat3(&mesh.Transform.Scale);
+	const XMVECTOR offset = XMLoadFloat3(&mesh.Transform.Offset);
+
+	const std::uint8_t* src = mesh.Data.data() + mesh.Layout.PositionOffset;
+	for(uint32 i = 0; i < mesh.VertexCount; ++i, src += stride)
+	{
+		XMVECTOR p;
+		switch(mesh.Format.Position)
+		{
+		case PositionFormat::Float3:
+			p = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(src));
+			break;
+		case PositionFormat::Half4:
+			p = XMLoadHalf4(reinterpret_cast<const XMHALF4*>(src));
+			break;
+		default:
+			p = XMLoadUShortN4(reinterpret_cast<const XMUSHORTN4*>(src));
+			break;
+		}
+
+		XMStoreFloat3(&vertices[i].Position, XMVectorMultiplyAdd(p, scale, offset));
+	}
+
+	src = mesh.Data.data() + mesh.Layout.FrameOffset;
+	for(uint32 i = 0; i < mesh.VertexCount; ++i, src += stride)
+	{
+		if(mesh.Format.Frame == FrameFormat::Float3)
+		{
+			std::memcpy(&vertices[i].Normal, src, sizeof(XMFLOAT3));
+			std::memcpy(&vertices[i].TangentU, src + sizeof(XMFLOAT3), sizeof(XMFLOAT3));
+			continue;
+		}
+
+		XMVECTOR e = mesh.Format.Frame == FrameFormat::Oct16 ?
+			XMLoadShortN4(reinterpret_cast<const XMSHORTN4*>(src)) :
+			XMLoadByteN4(reinterpret_cast<const XMBYTEN4*>(src));
+
+		XMStoreFloat3(&vertices[i].Normal, OctDecode(e));
+		XMStoreFloat3(&vertices[i].TangentU, OctDecode(XMVectorSwizzle<2, 3, 0, 1>(e)));
+	}
+
+	src = mesh.Data.data() + mesh.Layout.TexCOffset;
+	for(uint32 i = 0; i < mesh.VertexCount; ++i, src += stride)
+	{
+		if(mesh.Format.TexC == TexCFormat::Float2)
+			std::memcpy(&vertices[i].TexC, src, sizeof(XMFLOAT2));
+		else
+			XMStoreFloat2(&vertices[i].TexC, XMLoadHalf2(reinterpret_cast<const XMHALF2*>(src)));
+	}
+}
+
+VertexCompression::VertexFormat VertexCompression::ChooseFormat(const MeshData& meshData, const ErrorBounds& tolerance)
+{
+	// Start with the smallest format of every attribute and widen only the
+	// attributes that miss their tolerance.  Attributes are encoded
+	// independently, so at most three passes are needed.
+	VertexFormat format;
+	format.Position = PositionFormat::UNorm16;
+	format.Frame = FrameFormat::Oct8;
+	format.TexC = TexCFormat::Half2;
+
+	for(;;)
+	{
+		EncodedMesh mesh = Encode(meshData, format);
+		const ErrorBounds& error = mesh.MaxError;
+
+		bool widened = false;
+		if(error.Position > tolerance.Position && format.Position != PositionFormat::Float3)
+		{
+			format.Position = PositionFormat::Float3;
+			widened = true;
+		}
+
+		if((error.Normal > tolerance.Normal || error.Tangent > tolerance.Tangent) && format.Frame != FrameFormat::Float3)
+		{
+			format.Frame = format.Frame == FrameFormat::Oct8 ? FrameFormat::Oct16 : FrameFormat::Float3;
+			widened = true;
+		}
+
+		if(error.TexC > tolerance.TexC && format.TexC != TexCFormat::Float2)
+		{
+			format.TexC = TexCFormat::Float2;
+			widened = true;
+		}
+
+		if(!widened)
+			return format;
+	}
+}
+
+XMVECTOR XM_CALLCONV VertexCompression::OctEncode(FXMVECTOR n)
+{
+	// Project onto the octahedron |x|+|y|+|z| = 1, then fold the lower half
+	// over the diagonals of the upper half.
+	XMVECTOR a = XMVectorAbs(n);
+	XMVECTOR l1 = XMVectorSplatX(a) + XMVectorSplatY(a) + XMVectorSplatZ(a);
+	XMVECTOR p = XMVectorSelect(n / l1, XMVectorZero(), XMVectorLessOrEqual(l1, XMVectorZero()));
+
+	XMVECTOR sign = XMVectorSelect(XMVectorReplicate(-1.0f), XMVectorSplatOne(), XMVectorGreaterOrEqual(p, XMVectorZero()));
+	XMVECTOR folded = (XMVectorSplatOne() - XMVectorAbs(XMVectorSwizzle<1, 0, 2, 3>(p))) * sign;
+
+	XMVECTOR e = XMVectorSelect(p, folded, XMVectorLess(XMVectorSplatZ(p), XMVectorZero()));
+
+	return XMVectorPermute<0, 1, 4, 5>(e, XMVectorZero());
+}
+
+XMVECTOR XM_CALLCONV VertexCompression::OctDecode(FXMVECTOR e)
+{
+	XMVECTOR a = XMVectorAbs(e);
+	XMVECTOR z = XMVectorSplatOne() - XMVectorSplatX(a) - XMVectorSplatY(a);
+
+	// Unfold the lower half: push x and y back toward zero by -z.
+	XMVECTOR t = XMVectorSaturate(-z);
+	XMVECTOR xy = e + XMVectorSelect(t, -t, XMVectorGreaterOrEqual(e, XMVectorZero()));
+
+	return XMVector3Normalize(XMVectorPermute<0, 1, 4, 5>(xy, XMVectorSetW(z, 0.0f)));
+}
+
+VertexCompression::uint32 VertexCompression::PackColor(const XMFLOAT4& color)
+{
+	XMUBYTEN4 packed;
+	XMStoreUByteN4(&packed, XMLoadFloat4(&color));
+
+	return packed.v;
+}
+
+XMFLOAT4 VertexCompression::UnpackColor(uint32 packed)
+{
+	XMUBYTEN4 color;
+	color.v = packed;
+
+	XMFLOAT4 result;
+	XMStoreFloat4(&result, XMLoadUByteN4(&color));
+
+	return result;
+}
+
+void VertexCompression::PackColors(const XMFLOAT4* colors, uint32* packed, size_t count)
+{
+	for(size_t i = 0; i < count; ++i)
+		XMStoreUByteN4(reinterpret_cast<XMUBYTEN4*>(&packed[i]), XMLoadFloat4(&colors[i]));
+}
+
+std::string VertexCompression::ToString(const EncodedMesh& mesh)
+{
+	char buffer[192];
+	snprintf(buffer, sizeof(buffer),
+		"%u -> %u bytes/vertex (%s/%s/%s), max error: position %.6f, normal %.3f deg, tangent %.3f deg, texc %.5f",
+		(uint32)sizeof(GeometryGenerator::Vertex), mesh.Layout.Stride,
+		FormatName(mesh.Format.Position), FormatName(mesh.Format.Frame), FormatName(mesh.Format.TexC),
+		mesh.MaxError.Position, XMConvertToDegrees(mesh.MaxError.Normal),
+		XMConvertToDegrees(mesh.MaxError.Tangent), mesh.MaxError.TexC);
+
+	return buffer;
+}
@@ -0,0 +1,134 @@
+//***************************************************************************************
+// VertexCompression.h
+//
+// Packs GeometryGenerator::Vertex (44 bytes of floats) into compact interleaved
+// vertex buffers and unpacks them again.
+//
+//   Position      Float3   12 bytes  R32G32B32_FLOAT
+//                 Half4     8 bytes  R16G16B16A16_FLOAT  relative to the box center
+//                 UNorm16   8 bytes  R16G16B16A16_UNORM  relative to the box corner
+//   Normal+Tangent Float3  24 bytes  2 x R32G32B32_FLOAT
+//                 Oct16     8 bytes  R16G16B16A16_SNORM  octahedral (n.xy, t.xy)
+//                 Oct8      4 bytes  R8G8B8A8_SNORM      octahedral (n.xy, t.xy)
+//   TexC          Float2    8 bytes  R32G32_FLOAT
+//                 Half2     4 bytes  R16G16_FLOAT
+//
+// The smallest format is 16 bytes per vertex.  A vertex shader rebuilds the
+// position as pos.xyz*Scale + Offset (see PositionTransform) and the unit
+// vectors with the octahedral decode in OctDecode.  App colors (float4) pack
+// to R8G8B8A8_UNORM with PackColor, which input layouts read back as float4.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <string>
+
+class VertexCompression
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+	using MeshData = GeometryGenerator::MeshData;
+
+	enum class PositionFormat { Float3, Half4, UNorm16 };
+	enum class FrameFormat { Float3, Oct16, Oct8 };
+	enum class TexCFormat { Float2, Half2 };
+
+	struct VertexFormat
+	{
+		PositionFormat Position = PositionFormat::UNorm16;
+		FrameFormat Frame = FrameFormat::Oct16;
+		TexCFormat TexC = TexCFormat::Half2;
+	};
+
+	// Byte offsets of each attribute inside one packed vertex.  With a Float3
+	// frame the tangent follows the normal at FrameOffset + 12.
+	struct VertexLayout
+	{
+		uint32 PositionOffset = 0;
+		uint32 FrameOffset = 0;
+		uint32 TexCOffset = 0;
+		uint32 Stride = 0;
+	};
+
+	// Decoded position = stored position * Scale + Offset.
+	struct PositionTransform
+	{
+		DirectX::XMFLOAT3 Scale = { 1.0f, 1.0f, 1.0f };
+		DirectX::XMFLOAT3 Offset = { 0.0f, 0.0f, 0.0f };
+	};
+
+	// Largest round trip error per attribute.  Position is relative to the
+	// diagonal of the mesh bounding box, like MeshSimplifier's maxError, the
+	// normal and tangent errors are angles in radians and TexC is absolute.
+	struct ErrorBounds
+	{
+		float Position = 0.0f;
+		float Normal = 0.0f;
+		float Tangent = 0.0f;
+		float TexC = 0.0f;
+	};
+
+	struct EncodedMesh
+	{
+		VertexFormat Format;
+		VertexLayout Layout;
+		PositionTransform Transform;
+		uint32 VertexCount = 0;
+		std::vector<std::uint8_t> Data;
+
+		// Measured over every vertex while encoding.
+		ErrorBounds MaxError;
+	};
+
+	// 0.01% of the mesh size, 0.5 and 1 degree for the frame and a
+	// quarter texel of a 2048 texture.
+	static const ErrorBounds DefaultTolerance;
+
+	///<summary>
+	/// Returns the attribute offsets and stride of a packed vertex.  Every
+	/// attribute starts on a 4 byte boundary as input layouts require.
+	///</summary>
+	static VertexLayout GetLayout(const VertexFormat& format);
+
+	///<summary>
+	/// Packs the vertices of meshData into format.  The indices are not
+	/// touched and stay valid for the packed buffer.
+	///</summary>
+	static EncodedMesh Encode(const MeshData& meshData, const VertexFormat& format);
+
+	///<summary>
+	/// Unpacks an encoded mesh back to full precision vertices.
+	///</summary>
+	static void Decode(const EncodedMesh& mesh, std::vector<GeometryGenerator::Vertex>& vertices);
+
+	///<summary>
+	/// Picks, per attribute, the smallest format whose round trip error on
+	/// this mesh stays within tolerance.  Attributes that fail every packed
+	/// format fall back to floats.  Positions go from UNorm16 straight to
+	/// Float3: Half4 spends its precision near the center and is coarser than
+	/// UNorm16 toward the edges of the box, so it is only used when asked for.
+	///</summary>
+	static VertexFormat ChooseFormat(const MeshData& meshData, const ErrorBounds& tolerance = DefaultTolerance);
+
+	///<summary>
+	/// Maps a unit vector to the octahedron unfolded onto [-1,1]^2; the result
+	/// is in x and y.  Zero vectors encode to (0,0).
+	///</summary>
+	static DirectX::XMVECTOR XM_CALLCONV OctEncode(DirectX::FXMVECTOR n);
+
+	///<summary>
+	/// Inverse of OctEncode; returns a unit vector in x, y and z.
+	///</summary>
+	static DirectX::XMVECTOR XM_CALLCONV OctDecode(DirectX::FXMVECTOR e);
+
+	///<summary>
+	/// Converts a float4 color to R8G8B8A8_UNORM (red in the low byte).
+	///</summary>
+	static uint32 PackColor(const DirectX::XMFLOAT4& color);
+	static DirectX::XMFLOAT4 UnpackColor(uint32 packed);
+	static void PackColors(const DirectX::XMFLOAT4* colors, uint32* packed, size_t count);
+
+	static std::string ToString(const EncodedMesh& mesh);
+};
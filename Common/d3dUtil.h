@@ -151,6 +151,9 @@ struct SubmeshGeometry
 	// Bounding box of the geometry defined by this submesh. 
 	// This is used in later chapters of the book.
 	DirectX::BoundingBox Bounds;
+
+	// Bounding sphere of the same geometry; see MeshBounds.
+	DirectX::BoundingSphere Sphere;
 };
 
 struct MeshGeometry
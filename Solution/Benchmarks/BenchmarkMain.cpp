@@ -0,0 +1,63 @@
+//***************************************************************************************
+// BenchmarkMain.cpp
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	struct BenchmarkCase
+	{
+		const char* Name;
+		Benchmark::BenchmarkFn Fn;
+	};
+
+	std::vector<BenchmarkCase>& GetBenchmarks()
+	{
+		static std::vector<BenchmarkCase> benchmarks;
+		return benchmarks;
+	}
+
+	volatile const void* gSink;
+}
+
+Benchmark::Registration::Registration(const char* name, BenchmarkFn fn)
+{
+	GetBenchmarks().push_back({ name, fn });
+}
+
+void Benchmark::Report(const char* label, double seconds, double items, const char* unit)
+{
+	if(items > 0.0)
+		printf("  %-44s %10.3f ms %10.1f M %s/s\n", label, 1000.0*seconds, items / seconds / 1e6, unit);
+	else
+		printf("  %-44s %10.3f ms\n", label, 1000.0*seconds);
+}
+
+void Benchmark::DoNotOptimize(const void* p)
+{
+	gSink = p;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* filter = argc > 1 ? argv[1] : "";
+
+#ifdef _DEBUG
+	printf("Debug build: timings are not representative.\n");
+#endif
+
+	for(const BenchmarkCase& benchmark : GetBenchmarks())
+	{
+		if(strstr(benchmark.Name, filter) == nullptr)
+			continue;
+
+		printf("%s\n", benchmark.Name);
+		benchmark.Fn();
+	}
+
+	return 0;
+}
@@ -0,0 +1,132 @@
+//***************************************************************************************
+// GeometryGeneratorBenchmarks.cpp
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../../Common/GeometryGenerator.h"
+#include <cmath>
+
+using namespace DirectX;
+using uint32 = GeometryGenerator::uint32;
+using Vertex = GeometryGenerator::Vertex;
+using MeshData = GeometryGenerator::MeshData;
+
+namespace
+{
+	// CreateSphere before the shared sin/cos ring table: sinf and cosf of phi
+	// and theta for every vertex, and push_back into the MeshData.
+	MeshData CreateSpherePerVertex(float radius, uint32 sliceCount, uint32 stackCount)
+	{
+		MeshData meshData;
+
+		Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+		Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+
+		meshData.Vertices.push_back(topVertex);
+
+		float phiStep = XM_PI/stackCount;
+		float thetaStep = 2.0f*XM_PI/sliceCount;
+
+		for(uint32 i = 1; i <= stackCount-1; ++i)
+		{
+			float phi = i*phiStep;
+
+			for(uint32 j = 0; j <= sliceCount; ++j)
+			{
+				float theta = j*thetaStep;
+
+				Vertex v;
+
+				v.Position.x = radius*sinf(phi)*cosf(theta);
+				v.Position.y = radius*cosf(phi);
+				v.Position.z = radius*sinf(phi)*sinf(theta);
+
+				v.TangentU.x = -radius*sinf(phi)*sinf(theta);
+				v.TangentU.y = 0.0f;
+				v.TangentU.z = +radius*sinf(phi)*cosf(theta);
+
+				XMVECTOR T = XMLoadFloat3(&v.TangentU);
+				XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
+
+				XMVECTOR p = XMLoadFloat3(&v.Position);
+				XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
+
+				v.TexC.x = theta / XM_2PI;
+				v.TexC.y = phi / XM_PI;
+
+				meshData.Vertices.push_back(v);
+			}
+		}
+
+		meshData.Vertices.push_back(bottomVertex);
+
+		for(uint32 i = 1; i <= sliceCount; ++i)
+		{
+			meshData.Indices32.push_back(0);
+			meshData.Indices32.push_back(i+1);
+			meshData.Indices32.push_back(i);
+		}
+
+		uint32 baseIndex = 1;
+		uint32 ringVertexCount = sliceCount + 1;
+		for(uint32 i = 0; i < stackCount-2; ++i)
+		{
+			for(uint32 j = 0; j < sliceCount; ++j)
+			{
+				meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j);
+				meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
+				meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
+
+				meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
+				meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
+				meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j+1);
+			}
+		}
+
+		uint32 southPoleIndex = (uint32)meshData.Vertices.size()-1;
+		baseIndex = southPoleIndex - ringVertexCount;
+
+		for(uint32 i = 0; i < sliceCount; ++i)
+		{
+			meshData.Indices32.push_back(southPoleIndex);
+			meshData.Indices32.push_back(baseIndex+i);
+			meshData.Indices32.push_back(baseIndex+i+1);
+		}
+
+		return meshData;
+	}
+}
+
+BENCHMARK(GeometryGenerator_Sphere512)
+{
+	const uint32 slices = 512;
+	const uint32 stacks = 512;
+
+	GeometryGenerator geoGen;
+	GeometryGenerator::ShapeParams params = GeometryGenerator::ShapeParams::Sphere(1.0f, slices, stacks);
+	GeometryGenerator::MeshCounts counts = geoGen.QueryCounts(GeometryGenerator::ShapeType::Sphere, params);
+
+	std::vector<Vertex> vertices(counts.VertexCount);
+	std::vector<uint32> indices(counts.IndexCount);
+
+	double seconds = Benchmark::Measure([&]()
+	{
+		geoGen.Generate(GeometryGenerator::ShapeType::Sphere, params, vertices.data(), indices.data());
+		Benchmark::DoNotOptimize(vertices.data());
+	});
+	Benchmark::Report("Generate into caller buffers", seconds, counts.VertexCount, "vertices");
+
+	seconds = Benchmark::Measure([&]()
+	{
+		MeshData sphere = geoGen.CreateSphere(1.0f, slices, stacks);
+		Benchmark::DoNotOptimize(sphere.Vertices.data());
+	});
+	Benchmark::Report("CreateSphere, ring table", seconds, counts.VertexCount, "vertices");
+
+	seconds = Benchmark::Measure([&]()
+	{
+		MeshData sphere = CreateSpherePerVertex(1.0f, slices, stacks);
+		Benchmark::DoNotOptimize(sphere.Vertices.data());
+	});
+	Benchmark::Report("CreateSphere, sinf/cosf per vertex", seconds, counts.VertexCount, "vertices");
+}
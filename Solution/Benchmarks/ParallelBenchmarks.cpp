@@ -0,0 +1,63 @@
+//***************************************************************************************
+// ParallelBenchmarks.cpp
+//
+// What it costs to get work onto other threads: waking the pool's workers for
+// a Parallel::For against creating and joining as many std::threads, the way
+// the modules' own ParallelFor loops did.  Each chunk waits until every chunk
+// has started, so the time is the hand-off alone.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../../Common/Parallel.h"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+	const int LoopCount = 100;
+
+	void WaitForAll(std::atomic<size_t>& started, size_t threadCount)
+	{
+		started++;
+		while(started < threadCount)
+			std::this_thread::yield();
+	}
+}
+
+BENCHMARK(Parallel_WakeVsSpawn)
+{
+	size_t threadCount = Parallel::GetThreadCount();
+	printf("  %zu threads\n", threadCount);
+
+	double seconds = Benchmark::Measure([&]()
+	{
+		for(int i = 0; i < LoopCount; ++i)
+		{
+			std::atomic<size_t> started{ 0 };
+			Parallel::For(threadCount, 1, [&](size_t, size_t)
+			{
+				WaitForAll(started, threadCount);
+			});
+		}
+	});
+	Benchmark::Report("Parallel::For, pool workers, 100 loops", seconds);
+
+	seconds = Benchmark::Measure([&]()
+	{
+		for(int i = 0; i < LoopCount; ++i)
+		{
+			std::atomic<size_t> started{ 0 };
+
+			std::vector<std::thread> threads;
+			for(size_t t = 1; t < threadCount; ++t)
+				threads.emplace_back(WaitForAll, std::ref(started), threadCount);
+
+			WaitForAll(started, threadCount);
+
+			for(std::thread& thread : threads)
+				thread.join();
+		}
+	});
+	Benchmark::Report("std::thread create and join, 100 loops", seconds);
+}
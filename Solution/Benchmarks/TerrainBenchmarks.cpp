@@ -0,0 +1,110 @@
+//***************************************************************************************
+// TerrainBenchmarks.cpp
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../../Common/Terrain.h"
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+BENCHMARK(Terrain_Heights)
+{
+	const size_t count = 1 << 22;
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> coordinate(-80.0f, 80.0f);
+
+	std::vector<float> x(count), z(count), heights(count);
+	for(size_t i = 0; i < count; ++i)
+	{
+		x[i] = coordinate(random);
+		z[i] = coordinate(random);
+	}
+
+	Terrain terrain;
+
+	double seconds = Benchmark::Measure([&]()
+	{
+		terrain.GetHeights(x.data(), z.data(), heights.data(), count);
+	});
+	Benchmark::Report("GetHeights, 4M samples", seconds, (double)count, "samples");
+
+	// LandApp's GetHillsHeight, one sinf and cosf per sample.
+	seconds = Benchmark::Measure([&]()
+	{
+		for(size_t i = 0; i < count; ++i)
+			heights[i] = 0.3f*(z[i]*sinf(0.1f*x[i]) + x[i]*cosf(0.1f*z[i]));
+		Benchmark::DoNotOptimize(heights.data());
+	});
+	Benchmark::Report("Scalar sinf/cosf, 4M samples", seconds, (double)count, "samples");
+}
+
+BENCHMARK(Terrain_Displace)
+{
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData grid = geoGen.CreateGrid(160.0f, 160.0f, 1024, 1024);
+	size_t count = grid.Vertices.size();
+
+	Terrain terrain;
+
+	double seconds = Benchmark::Measure([&]()
+	{
+		terrain.Displace(grid);
+	});
+	Benchmark::Report("Displace, 1024x1024 grid", seconds, (double)count, "vertices");
+
+	// Heights only, as LandApp set them before normals were computed.
+	seconds = Benchmark::Measure([&]()
+	{
+		for(GeometryGenerator::Vertex& v : grid.Vertices)
+			v.Position.y = 0.3f*(v.Position.z*sinf(0.1f*v.Position.x) + v.Position.x*cosf(0.1f*v.Position.z));
+		Benchmark::DoNotOptimize(grid.Vertices.data());
+	});
+	Benchmark::Report("Scalar heights only, 1024x1024 grid", seconds, (double)count, "vertices");
+}
+
+BENCHMARK(Terrain_Colors)
+{
+	const size_t count = 1 << 22;
+
+	std::mt19937 random(2);
+	std::uniform_real_distribution<float> height(-30.0f, 30.0f);
+
+	std::vector<float> heights(count);
+	for(float& h : heights)
+		h = height(random);
+
+	std::vector<XMFLOAT4> colors(count);
+	Terrain terrain;
+
+	double seconds = Benchmark::Measure([&]()
+	{
+		for(size_t i = 0; i < count; ++i)
+			colors[i] = terrain.GetColor(heights[i]);
+		Benchmark::DoNotOptimize(colors.data());
+	});
+	Benchmark::Report("GetColor table, 4M heights", seconds, (double)count, "heights");
+
+	// LandApp's if-chain.
+	seconds = Benchmark::Measure([&]()
+	{
+		for(size_t i = 0; i < count; ++i)
+		{
+			float y = heights[i];
+			if(y < -10.0f)
+				colors[i] = XMFLOAT4(1.0f, 0.96f, 0.62f, 1.0f);
+			else if(y < 5.0f)
+				colors[i] = XMFLOAT4(0.48f, 0.77f, 0.46f, 1.0f);
+			else if(y < 12.0f)
+				colors[i] = XMFLOAT4(0.1f, 0.48f, 0.19f, 1.0f);
+			else if(y < 20.0f)
+				colors[i] = XMFLOAT4(0.45f, 0.39f, 0.34f, 1.0f);
+			else
+				colors[i] = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+		}
+		Benchmark::DoNotOptimize(colors.data());
+	});
+	Benchmark::Report("If-chain, 4M heights", seconds, (double)count, "heights");
+}
@@ -0,0 +1,45 @@
+//***************************************************************************************
+// TransformHierarchyBenchmarks.cpp
+//
+// Update of one dirty level of n nodes, for the per-node cost that sets
+// MinNodesPerChunk against the pool's wake-up cost (Parallel_WakeVsSpawn).
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../../Common/TransformHierarchy.h"
+#include <cstdio>
+
+using namespace DirectX;
+using uint32 = TransformHierarchy::uint32;
+
+BENCHMARK(TransformHierarchy_Update)
+{
+	const uint32 levelSizes[] = { 1024, 4096, 16384, 131072 };
+
+	TransformHierarchy::Transform local;
+	local.Rotation = XMFLOAT4(0.0f, 0.38268343f, 0.0f, 0.92387953f);
+	local.Translation = XMFLOAT3(1.0f, 2.0f, 3.0f);
+
+	for(uint32 n : levelSizes)
+	{
+		TransformHierarchy hierarchy;
+		hierarchy.Reserve(n + 1);
+
+		uint32 root = hierarchy.AddNode(TransformHierarchy::NoParent, local);
+		for(uint32 i = 0; i < n; ++i)
+			hierarchy.AddNode(root, local);
+		hierarchy.Update();
+
+		double seconds = Benchmark::Measure([&]()
+		{
+			for(uint32 i = 1; i <= n; ++i)
+				hierarchy.SetLocal(i, local);
+			hierarchy.Update();
+			Benchmark::DoNotOptimize(&hierarchy.GetWorld(n));
+		});
+
+		char label[64];
+		snprintf(label, sizeof(label), "SetLocal and Update, %u nodes", n);
+		Benchmark::Report(label, seconds, n, "nodes");
+	}
+}
@@ -13,6 +13,8 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/IndexPacking.h"
+#include "../../Common/Stripifier.h"
 #include "FrameResource.h"
 
 #include <iostream>
@@ -589,7 +591,12 @@ void ShapesApp::BuildShapeGeometry()
 	//The MeshData structure is a simple structure nested inside GeometryGenerator that stores a vertexand index list
 
 	//GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n)
-	GeometryGenerator::MeshData grid = geoGen.CreateGrid(20.0f, 30.0f, 60, 40);
+	// The strip form takes about a third of the list's indices; one strip per
+	// row, separated by the strip cut value set in BuildPSOs.
+	GeometryGenerator::MeshData grid = geoGen.CreateGridStrip(20.0f, 30.0f, 60, 40);
+
+	std::string stripReport = "grid: " + Stripifier::ToString(Stripifier::Analyze(grid.Indices32)) + "\n";
+	::OutputDebugStringA(stripReport.c_str());
 	// We are concatenating all the geometry into one big vertex/index buffer.  So
 	// define the regions in the buffer each submesh covers.
 
@@ -623,12 +630,12 @@ void ShapesApp::BuildShapeGeometry()
 	}
 
 
-	std::vector<std::uint16_t> indices;
-	indices.insert(indices.end(), std::begin(grid.GetIndices16()), std::end(grid.GetIndices16()));
+	// 16-bit indices when the mesh fits in them, 32-bit otherwise.
+	IndexPacking::PackedIndices indices = IndexPacking::Pack(grid.Indices32);
 
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	const UINT ibByteSize = indices.GetByteSize();
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "shapeGeo";
@@ -637,17 +644,17 @@ void ShapesApp::BuildShapeGeometry()
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.GetData(), ibByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
 		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
 
 	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+		mCommandList.Get(), indices.GetData(), ibByteSize, geo->IndexBufferUploader);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexFormat = indices.Format;
 	geo->IndexBufferByteSize = ibByteSize;
 
 	geo->DrawArgs["grid"] = gridSubmesh;
@@ -682,6 +689,8 @@ void ShapesApp::BuildPSOs()
 	opaquePsoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
 	opaquePsoDesc.SampleMask = UINT_MAX;
 	opaquePsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	opaquePsoDesc.IBStripCutValue = mGeometries["shapeGeo"]->IndexFormat == DXGI_FORMAT_R16_UINT ?
+		D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFF : D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFFFFFF;
 	opaquePsoDesc.NumRenderTargets = 1;
 	opaquePsoDesc.RTVFormats[0] = mBackBufferFormat;
 	opaquePsoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
@@ -714,8 +723,8 @@ void ShapesApp::BuildRenderItems()
 	XMStoreFloat4x4(&gridRitem->World, XMMatrixScaling(2.0f, 2.0f, 2.0f) * XMMatrixTranslation(0.0f, 0.5f, 0.0f));
 	gridRitem->ObjCBIndex = 0;
 	gridRitem->Geo = mGeometries["shapeGeo"].get();
-	gridRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;  //13806
+	gridRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+	gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;  //4778
 	gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation; //0
 	gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation; //0
 	mAllRitems.push_back(std::move(gridRitem));
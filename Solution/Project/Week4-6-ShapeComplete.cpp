@@ -18,6 +18,8 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/IndexPacking.h"
+#include "../../Common/MeshBounds.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -538,96 +540,55 @@ void ShapesApp::BuildShadersAndInputLayout()
 void ShapesApp::BuildShapeGeometry()
 {
 	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData box = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0);
-	GeometryGenerator::MeshData grid = geoGen.CreateGrid(20.0f, 30.0f, 60, 40);
-	GeometryGenerator::MeshData sphere = geoGen.CreateSphere(0.5f, 20, 20);
-	GeometryGenerator::MeshData cylinder = geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
 
-	// We are concatenating all the geometry into one big vertex/index buffer.  So
-	// define the regions in the buffer each submesh covers.
-
-	// Cache the vertex offsets to each object in the concatenated vertex buffer.
-	UINT boxVertexOffset = 0;
-	UINT gridVertexOffset = (UINT)box.Vertices.size();
-	UINT sphereVertexOffset = gridVertexOffset + (UINT)grid.Vertices.size();
-	UINT cylinderVertexOffset = sphereVertexOffset + (UINT)sphere.Vertices.size();
-
-	// Cache the starting index for each object in the concatenated index buffer.
-	UINT boxIndexOffset = 0;
-	UINT gridIndexOffset = (UINT)box.Indices32.size();
-	UINT sphereIndexOffset = gridIndexOffset + (UINT)grid.Indices32.size();
-	UINT cylinderIndexOffset = sphereIndexOffset + (UINT)sphere.Indices32.size();
-
-	// Define the SubmeshGeometry that cover different
-	// regions of the vertex/index buffers.
-
-	SubmeshGeometry boxSubmesh;
-	boxSubmesh.IndexCount = (UINT)box.Indices32.size();
-	boxSubmesh.StartIndexLocation = boxIndexOffset;
-	boxSubmesh.BaseVertexLocation = boxVertexOffset;
-
-	SubmeshGeometry gridSubmesh;
-	gridSubmesh.IndexCount = (UINT)grid.Indices32.size();
-	gridSubmesh.StartIndexLocation = gridIndexOffset;
-	gridSubmesh.BaseVertexLocation = gridVertexOffset;
-
-	SubmeshGeometry sphereSubmesh;
-	sphereSubmesh.IndexCount = (UINT)sphere.Indices32.size();
-	sphereSubmesh.StartIndexLocation = sphereIndexOffset;
-	sphereSubmesh.BaseVertexLocation = sphereVertexOffset;
-
-	SubmeshGeometry cylinderSubmesh;
-	cylinderSubmesh.IndexCount = (UINT)cylinder.Indices32.size();
-	cylinderSubmesh.StartIndexLocation = cylinderIndexOffset;
-	cylinderSubmesh.BaseVertexLocation = cylinderVertexOffset;
-
-	// Extract the vertex elements we are interested in and pack the
-	// vertices of all the meshes into one vertex buffer.
-
-	auto totalVertexCount =
-		box.Vertices.size() +
-		grid.Vertices.size() +
-		sphere.Vertices.size() +
-		cylinder.Vertices.size();
-
-
-	std::vector<Vertex> vertices(totalVertexCount);
-
-	UINT k = 0;
-
-	for (size_t i = 0; i < box.Vertices.size(); ++i, ++k)
+	// We are concatenating all the geometry into one big vertex/index buffer.
+	// GenerateBatch defines the region of the buffer each submesh covers and
+	// builds the shapes in parallel.
+	GeometryGenerator::ShapeRequest shapes[4];
+	shapes[0].Shape = GeometryGenerator::ShapeType::Box;
+	shapes[0].Params = GeometryGenerator::ShapeParams::Box(1.0f, 1.0f, 1.0f, 0);
+	shapes[1].Shape = GeometryGenerator::ShapeType::Grid;
+	shapes[1].Params = GeometryGenerator::ShapeParams::Grid(20.0f, 30.0f, 60, 40);
+	shapes[2].Shape = GeometryGenerator::ShapeType::Sphere;
+	shapes[2].Params = GeometryGenerator::ShapeParams::Sphere(0.5f, 20, 20);
+	shapes[3].Shape = GeometryGenerator::ShapeType::Cylinder;
+	shapes[3].Params = GeometryGenerator::ShapeParams::Cylinder(0.5f, 0.3f, 3.0f, 20, 20);
+
+	GeometryGenerator::MeshData shapeMesh = geoGen.GenerateBatch(shapes, _countof(shapes));
+
+	const char* names[] = { "box", "grid", "sphere", "cylinder" };
+	const XMVECTORF32 colors[] = { DirectX::Colors::Gold, DirectX::Colors::ForestGreen,
+		DirectX::Colors::Crimson, DirectX::Colors::SteelBlue };
+
+	// Extract the vertex elements we are interested in, coloring each shape.
+	std::vector<Vertex> vertices(shapeMesh.Vertices.size());
+
+	SubmeshGeometry submeshes[_countof(shapes)];
+	for (size_t s = 0; s < _countof(shapes); ++s)
 	{
-		vertices[k].Pos = box.Vertices[i].Position;
-		vertices[k].Color = XMFLOAT4(DirectX::Colors::Gold);
-	}
+		submeshes[s].IndexCount = shapes[s].IndexCount;
+		submeshes[s].StartIndexLocation = shapes[s].StartIndexLocation;
+		submeshes[s].BaseVertexLocation = shapes[s].BaseVertexLocation;
 
-	for (size_t i = 0; i < grid.Vertices.size(); ++i, ++k)
-	{
-		vertices[k].Pos = grid.Vertices[i].Position;
-		vertices[k].Color = XMFLOAT4(DirectX::Colors::ForestGreen);
-	}
+		MeshBounds::Result bounds = MeshBounds::Compute(shapeMesh, shapes[s].IndexCount,
+			shapes[s].StartIndexLocation, shapes[s].BaseVertexLocation);
+		submeshes[s].Bounds = bounds.Box;
+		submeshes[s].Sphere = bounds.Sphere;
 
-	for (size_t i = 0; i < sphere.Vertices.size(); ++i, ++k)
-	{
-		vertices[k].Pos = sphere.Vertices[i].Position;
-		vertices[k].Color = XMFLOAT4(DirectX::Colors::Crimson);
-	}
-
-	for (size_t i = 0; i < cylinder.Vertices.size(); ++i, ++k)
-	{
-		vertices[k].Pos = cylinder.Vertices[i].Position;
-		vertices[k].Color = XMFLOAT4(DirectX::Colors::SteelBlue);
+		UINT end = shapes[s].BaseVertexLocation + shapes[s].VertexCount;
+		for (UINT k = shapes[s].BaseVertexLocation; k < end; ++k)
+		{
+			vertices[k].Pos = shapeMesh.Vertices[k].Position;
+			vertices[k].Color = XMFLOAT4(colors[s]);
+		}
 	}
 
-
-	std::vector<std::uint16_t> indices;
-	indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
-	indices.insert(indices.end(), std::begin(grid.GetIndices16()), std::end(grid.GetIndices16()));
-	indices.insert(indices.end(), std::begin(sphere.GetIndices16()), std::end(sphere.GetIndices16()));
-	indices.insert(indices.end(), std::begin(cylinder.GetIndices16()), std::end(cylinder.GetIndices16()));
+	// Indices are relative to each shape's base vertex, so they are 16-bit
+	// unless one shape has more vertices than that addresses.
+	IndexPacking::PackedIndices indices = IndexPacking::Pack(shapeMesh.Indices32);
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	const UINT ibByteSize = indices.GetByteSize();
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "shapeGeo";
@@ -637,23 +598,21 @@ void ShapesApp::BuildShapeGeometry()
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.GetData(), ibByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
 		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
 
 	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+		mCommandList.Get(), indices.GetData(), ibByteSize, geo->IndexBufferUploader);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexFormat = indices.Format;
 	geo->IndexBufferByteSize = ibByteSize;
 
-	geo->DrawArgs["box"] = boxSubmesh;
-	geo->DrawArgs["grid"] = gridSubmesh;
-	geo->DrawArgs["sphere"] = sphereSubmesh;
-	geo->DrawArgs["cylinder"] = cylinderSubmesh;
+	for (size_t s = 0; s < _countof(shapes); ++s)
+		geo->DrawArgs[names[s]] = submeshes[s];
 
 	mGeometries[geo->Name] = std::move(geo);
 }
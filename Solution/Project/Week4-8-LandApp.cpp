@@ -17,6 +17,9 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/IndexPacking.h"
+#include "../../Common/FrustumCuller.h"
+#include "../../Common/TerrainStreamer.h"
 #include "FrameResource.h"
 
 #include <iostream>
@@ -29,6 +32,9 @@ using namespace DirectX::PackedVector;
 //step3: Our application class will then instantiate a vector of three frame resources, 
 const int gNumFrameResources = 3;
 
+// Most land triangles drawn per frame.
+const UINT gLandTriangleBudget = 200000;
+
 // Step10: Lightweight structure stores parameters to draw a shape.  This will vary from app-to-app.
 struct RenderItem
 {
@@ -59,6 +65,12 @@ struct RenderItem
 	UINT IndexCount = 0; //Number of indices read from the index buffer for each instance.
 	UINT StartIndexLocation = 0; //The location of the first index read by the GPU from the index buffer.
 	int BaseVertexLocation = 0; //A value added to each index before reading a vertex from the vertex buffer.
+
+	// Optional terrain chunks.  When set, the submesh is drawn once for every
+	// vertex slot listed, with the base vertex moved to that slot's chunk:
+	// slot * ChunkVertexCount.
+	const std::vector<UINT>* ChunkSlots = nullptr;
+	UINT ChunkVertexCount = 0;
 };
 
 class LandApp : public D3DApp
@@ -82,6 +94,8 @@ private:
 
 	void OnKeyboardInput(const GameTimer& gt);
 	void UpdateCamera(const GameTimer& gt);
+	void UpdateLandChunks(const GameTimer& gt);
+	bool AcquireLandSlot(UINT node, UINT64 frameFence, UINT64 completedFence);
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 
@@ -97,8 +111,6 @@ private:
 
 	void BuildRenderItems();
 	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
-	//step2
-	float GetHillsHeight(float x, float z)const;
 
 private:
 
@@ -127,6 +139,31 @@ private:
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mOpaqueRitems;
 
+	// Height function and height colors of the land.
+	Terrain mTerrain;
+
+	// Chunked levels of detail of the land.  Chunks are built in the
+	// background by mLandStreamer and copied into a slot of mLandVertices, a
+	// dynamic vertex buffer, the first time they are drawn.
+	std::unique_ptr<TerrainQuadtree> mLand;
+	std::unique_ptr<TerrainStreamer> mLandStreamer;
+	std::unique_ptr<UploadBuffer<Vertex>> mLandVertices;
+	TerrainQuadtree::Selection mLandSelection;
+
+	// Node each vertex slot holds and the fence of the last frame that drew
+	// it; a slot is refilled only once that frame has completed.
+	struct LandSlot
+	{
+		UINT Node = UINT_MAX;
+		UINT64 Fence = 0;
+	};
+	std::vector<LandSlot> mLandSlots;
+	std::unordered_map<UINT, UINT> mLandNodeSlots;
+	std::vector<UINT> mLandDrawSlots;
+#if defined(DEBUG) | defined(_DEBUG)
+	float mLandStatsTime = 0.0f;
+#endif
+
 	//std::vector<RenderItem*> mTransparentRitems;  //we could have render items for transparant items
 
 
@@ -238,6 +275,7 @@ void LandApp::Update(const GameTimer& gt)
 {
 	OnKeyboardInput(gt);
 	UpdateCamera(gt);
+	UpdateLandChunks(gt);
 
 	// Cycle through the circular frame resource array.
 	mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
@@ -377,7 +415,7 @@ void LandApp::OnMouseMove(WPARAM btnState, int x, int y)
 		mRadius += dx - dy;
 
 		// Restrict the radius.
-		mRadius = MathHelper::Clamp(mRadius, 5.0f, 150.0f);
+		mRadius = MathHelper::Clamp(mRadius, 5.0f, 300.0f);
 	}
 
 	mLastMousePos.x = x;
@@ -414,6 +452,86 @@ void LandApp::UpdateCamera(const GameTimer& gt)
 	XMStoreFloat4x4(&mView, view);
 }
 
+// Picks the land chunks to draw from this frame's camera.  The land's world
+// matrix is the identity, so the frustum planes of viewProj are in its space.
+void LandApp::UpdateLandChunks(const GameTimer& gt)
+{
+	XMFLOAT4 planes[6];
+	FrustumCuller::ExtractFrustumPlanes(XMMatrixMultiply(XMLoadFloat4x4(&mView), XMLoadFloat4x4(&mProj)), planes);
+
+	TerrainQuadtree::LodSettings lod;
+	lod.ScreenScale = 0.5f * mClientHeight * mProj(1, 1);
+	lod.MaxPixelError = 2.0f;
+	lod.TriangleBudget = gLandTriangleBudget;
+
+	// This frame's commands complete at the next fence value, so the slots it
+	// draws are held until then.  Chunks not built yet are requested, and
+	// their parents drawn meanwhile.
+	UINT64 frameFence = mCurrentFence + 1;
+	UINT64 completedFence = mFence->GetCompletedValue();
+
+	mLandStreamer->BeginFrame();
+	mLand->Select(mEyePos, planes, lod, mLandSelection, [&](UINT node)
+	{
+		return AcquireLandSlot(node, frameFence, completedFence);
+	});
+
+	mLandDrawSlots.clear();
+	for (UINT node : mLandSelection.Chunks)
+		mLandDrawSlots.push_back(mLandNodeSlots[node]);
+
+	// Debug builds report the cache now and then so its budget can be sized.
+#if defined(DEBUG) | defined(_DEBUG)
+	if (gt.TotalTime() - mLandStatsTime >= 5.0f)
+	{
+		mLandStatsTime = gt.TotalTime();
+		std::string report = "land: " + TerrainStreamer::ToString(mLandStreamer->GetStats()) + "\n";
+		::OutputDebugStringA(report.c_str());
+	}
+#endif
+}
+
+// Makes node drawable this frame: finds the vertex slot holding it, or, once
+// the streamer has built it, copies it into the least recently drawn slot no
+// frame in flight still uses.  Slots act as a cache in front of the streamer's,
+// so only chunks missing from them count as streamer hits or misses.
+bool LandApp::AcquireLandSlot(UINT node, UINT64 frameFence, UINT64 completedFence)
+{
+	auto it = mLandNodeSlots.find(node);
+	if (it != mLandNodeSlots.end())
+	{
+		mLandSlots[it->second].Fence = frameFence;
+		return true;
+	}
+
+	TerrainStreamer::ChunkPtr chunk = mLandStreamer->Acquire(node);
+	if (chunk == nullptr)
+		return false;
+
+	UINT best = UINT_MAX;
+	for (UINT s = 0; s < (UINT)mLandSlots.size(); ++s)
+	{
+		if (mLandSlots[s].Fence <= completedFence &&
+			(best == UINT_MAX || mLandSlots[s].Fence < mLandSlots[best].Fence))
+			best = s;
+	}
+
+	if (best == UINT_MAX)
+		return false;
+
+	LandSlot& slot = mLandSlots[best];
+	if (slot.Node != UINT_MAX)
+		mLandNodeSlots.erase(slot.Node);
+
+	slot.Node = node;
+	slot.Fence = frameFence;
+	mLandNodeSlots[node] = best;
+
+	UINT chunkVertexCount = mLand->GetChunkVertexCount();
+	mLandVertices->CopyData(best * chunkVertexCount, reinterpret_cast<const Vertex*>(chunk->Bytes.data()), chunkVertexCount);
+	return true;
+}
+
 //step8: Update resources (cbuffers) in mCurrFrameResource
 void LandApp::UpdateObjectCBs(const GameTimer& gt)
 {
@@ -596,124 +714,74 @@ void LandApp::BuildShadersAndInputLayout()
 //step1
 void LandApp::BuildLandGeometry()
 {
-	//GeometryGenerator is a utility class for generating simple geometric shapes like grids, grid, grids, and boxes
-	GeometryGenerator geoGen;
-	//The MeshData structure is a simple structure nested inside GeometryGenerator that stores a vertexand index list
-
-	//GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n)
-	GeometryGenerator::MeshData grid = geoGen.CreateGrid(160.0f, 160.0f, 50, 50);
-
-	//number of cells 2x(m-1)(n-1)
-	//Vij = [-0.5w+jdx, 0, 0.5=i-dz]
+	// A 1280x1280 square in seven levels of 32x32 quad chunks.  The finest
+	// level alone is a 2048x2048 quad grid, far more than should be resident,
+	// so chunks are built on demand around the camera.
+	mLand = std::make_unique<TerrainQuadtree>(mTerrain, 1280.0f, 7);
+	UINT chunkVertexCount = mLand->GetChunkVertexCount();
 
 	//
-	// Extract the vertex elements we are interested and apply the height function to
-	// each vertex.  In addition, color the vertices based on their height so we have
-	// sandy looking beaches, grassy low hills, and snow mountain peaks.
+	// Workers convert each chunk to our vertex format and color the vertices
+	// based on their height so we have sandy looking beaches, grassy low hills,
+	// and snow mountain peaks.  Skirt vertices take the color of the edge
+	// they hang from.
 	//
 
-	std::vector<Vertex> vertices(grid.Vertices.size());
-	for (size_t i = 0; i < grid.Vertices.size(); ++i)
+	auto encode = [this](UINT node, const std::vector<GeometryGenerator::Vertex>& chunk, std::vector<std::uint8_t>& bytes)
 	{
-		auto& p = grid.Vertices[i].Position;
-		vertices[i].Pos = p;
-		vertices[i].Pos.y = GetHillsHeight(p.x, p.z);
+		bytes.resize(chunk.size() * sizeof(Vertex));
+		Vertex* dest = reinterpret_cast<Vertex*>(bytes.data());
 
-		// Color the vertex based on its height.
-		if (vertices[i].Pos.y < -10.0f)
+		for (UINT i = 0; i < (UINT)chunk.size(); ++i)
 		{
-			// Sandy beach color.
-			vertices[i].Color = XMFLOAT4(1.0f, 0.96f, 0.62f, 1.0f);
+			dest[i].Pos = chunk[i].Position;
+			float height = mLand->IsSkirtVertex(i) ? chunk[i].Position.y + mLand->GetSkirtDepth() : chunk[i].Position.y;
+			dest[i].Color = mTerrain.GetColor(height);
 		}
-		else if (vertices[i].Pos.y < 5.0f)
-		{
-			// Light yellow-green.
-			vertices[i].Color = XMFLOAT4(0.48f, 0.77f, 0.46f, 1.0f);
-		}
-		else if (vertices[i].Pos.y < 12.0f)
-		{
-			// Dark yellow-green.
-			vertices[i].Color = XMFLOAT4(0.1f, 0.48f, 0.19f, 1.0f);
-		}
-		else if (vertices[i].Pos.y < 20.0f)
-		{
-			// Dark brown.
-			vertices[i].Color = XMFLOAT4(0.45f, 0.39f, 0.34f, 1.0f);
-		}
-		else
-		{
-			// White snow.
-			vertices[i].Color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-		}
-	}
-
-
-
-	//
-	// We are concatenating all the geometry into one big vertex/index buffer.  So
-	// define the regions in the buffer each submesh covers.
-	//
-
-	// Cache the vertex offsets to each object in the concatenated vertex buffer.
-	UINT gridVertexOffset = 0;
-
-
-	// Cache the starting index for each object in the concatenated index buffer.
-	UINT gridIndexOffset = 0;
-
+	};
+	mLandStreamer = std::make_unique<TerrainStreamer>(*mLand, encode, 32ull << 20);
 
-	// Define the SubmeshGeometry that cover different 
-	// regions of the vertex/index buffers.
+	// Enough vertex slots for every frame in flight to draw a full budget of
+	// chunks, and as many again to keep recently drawn chunks on the GPU.
+	UINT maxChunks = gLandTriangleBudget / mLand->GetChunkTriangleCount() + 1;
+	mLandSlots.resize(2 * (gNumFrameResources + 1) * maxChunks);
+	mLandVertices = std::make_unique<UploadBuffer<Vertex>>(md3dDevice.Get(), (UINT)mLandSlots.size() * chunkVertexCount, false);
 
+	// Every chunk is drawn with the same indices and its own base vertex.
 	SubmeshGeometry gridSubmesh;
-	gridSubmesh.IndexCount = (UINT)grid.Indices32.size();
-	gridSubmesh.StartIndexLocation = gridIndexOffset;
-	gridSubmesh.BaseVertexLocation = gridVertexOffset;
-
-
-	//
-	// Extract the vertex elements we are interested in and pack the
-	// vertices of all the meshes into one vertex buffer.
-	//
-
-	//auto totalVertexCount = grid.Vertices.size();
-
-
-	//std::vector<Vertex> vertices(totalVertexCount);
-
-	//UINT k = 0;
-	//for (size_t i = 0; i < grid.Vertices.size(); ++i, ++k)
-	//{
-	//	vertices[k].Pos = grid.Vertices[i].Position;
-	//	vertices[k].Color = XMFLOAT4(DirectX::Colors::DarkOrange);
-	//}
+	gridSubmesh.IndexCount = (UINT)mLand->GetChunkIndices().size();
+	gridSubmesh.StartIndexLocation = 0;
+	gridSubmesh.BaseVertexLocation = 0;
+	gridSubmesh.Bounds = mLand->GetNode(0).Bounds;
+	BoundingSphere::CreateFromBoundingBox(gridSubmesh.Sphere, gridSubmesh.Bounds);
 
+	IndexPacking::PackedIndices indices = IndexPacking::Pack(mLand->GetChunkIndices());
 
-	std::vector<std::uint16_t> indices;
-	indices.insert(indices.end(), std::begin(grid.GetIndices16()), std::end(grid.GetIndices16()));
+	std::string landReport = "land: " + std::to_string(mLand->GetNodeCount()) + " chunks of " +
+		std::to_string(chunkVertexCount) + " vertices and " + std::to_string(mLand->GetChunkTriangleCount()) +
+		" triangles, skirts " + std::to_string(mLand->GetSkirtDepth()) + " deep, " +
+		std::to_string(mLandSlots.size()) + " vertex slots\n";
+	::OutputDebugStringA(landReport.c_str());
 
 
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	const UINT vbByteSize = (UINT)mLandSlots.size() * chunkVertexCount * sizeof(Vertex);
+	const UINT ibByteSize = indices.GetByteSize();
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "landGeo";
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.GetData(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	// The vertices live in the dynamic slots, filled as chunks arrive.
+	geo->VertexBufferGPU = mLandVertices->Resource();
 
 	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+		mCommandList.Get(), indices.GetData(), ibByteSize, geo->IndexBufferUploader);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexFormat = indices.Format;
 	geo->IndexBufferByteSize = ibByteSize;
 
 	geo->DrawArgs["grid"] = gridSubmesh;
@@ -789,6 +857,8 @@ void LandApp::BuildRenderItems()
 	gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
 	gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
 	gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
+	gridRitem->ChunkSlots = &mLandDrawSlots;
+	gridRitem->ChunkVertexCount = mLand->GetChunkVertexCount();
 	mAllRitems.push_back(std::move(gridRitem));
 
 
@@ -821,15 +891,18 @@ void LandApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vec
 
 		cmdList->SetGraphicsRootDescriptorTable(0, cbvHandle);
 
-		cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
-	}
-}
+		if (ri->ChunkSlots == nullptr)
+		{
+			cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+			continue;
+		}
 
-float LandApp::GetHillsHeight(float x, float z)const
-{
-	//https://www.geogebra.org/3d?lang=en
-	//f(x,z)=0.3 (z sin(0.1 x)+x cos(0.1 z))
-	return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
+		for (UINT slot : *ri->ChunkSlots)
+		{
+			cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation,
+				ri->BaseVertexLocation + (int)(slot * ri->ChunkVertexCount), 0);
+		}
+	}
 }
 
 
@@ -17,6 +17,13 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/GeometryCache.h"
+#include "../../Common/IndexPacking.h"
+#include "../../Common/MeshBounds.h"
+#include "../../Common/RenderItemStore.h"
+#include "../../Common/TransformHierarchy.h"
+#include "../../Common/FrustumCuller.h"
+#include "../../Common/DynamicBvh.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -25,36 +32,9 @@ using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
-// Lightweight structure stores parameters to draw a shape.  This will
-// vary from app-to-app.
-struct RenderItem
-{
-	RenderItem() = default;
-
-	// World matrix of the shape that describes the object's local space
-	// relative to the world space, which defines the position, orientation,
-	// and scale of the object in the world.
-	XMFLOAT4X4 World = MathHelper::Identity4x4();
-
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
-
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
-	UINT ObjCBIndex = -1;
-
-	MeshGeometry* Geo = nullptr;
-
-	// Primitive topology.
-	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-
-	// DrawIndexedInstanced parameters.
-	UINT IndexCount = 0;
-	UINT StartIndexLocation = 0;
-	int BaseVertexLocation = 0;
-};
+// Scenes with at least this many render items are culled through the BVH,
+// which skips whole groups of items; smaller ones are cheaper to scan.
+const UINT gBvhCullItemCount = 4096;
 
 class ShapesApp : public D3DApp
 {
@@ -77,6 +57,8 @@ private:
 
 	void OnKeyboardInput(const GameTimer& gt);
 	void UpdateCamera(const GameTimer& gt);
+	void UpdateTransforms();
+	void UpdateVisibleRitems();
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 
@@ -88,7 +70,10 @@ private:
 	void BuildPSOs();
 	void BuildFrameResources();
 	void BuildRenderItems();
-	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	UINT AddTransform(UINT parent, const XMFLOAT3& scale, const XMFLOAT3& translation);
+	RenderItemStore::Handle AddRenderItem(UINT node, MeshGeometry* geo, const std::string& submesh);
+	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const RenderItemStore& ritems,
+		const std::vector<UINT>& indices);
 
 private:
 
@@ -107,11 +92,37 @@ private:
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
-	// List of all the render items.
-	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
+	// All the render items; they are all opaque.  An item's index in the
+	// store is also its object constant buffer index.
+	RenderItemStore mAllRitems{ gNumFrameResources };
+
+	// Geometries the render items draw, indexed by DrawArgs::Geometry.
+	std::vector<MeshGeometry*> mRitemGeometries;
 
-	// Render items divided by PSO.
-	std::vector<RenderItem*> mOpaqueRitems;
+	// Indices of the render items inside the view frustum this frame.
+	std::vector<UINT> mVisibleRitems;
+
+	// The render items' world boxes, for culling and other scene queries
+	// that would otherwise scan every item.  Leaves hold item indices, which
+	// stay put because items are never removed; mRitemProxies is the leaf of
+	// each item.
+	DynamicBvh mRitemBvh;
+	std::vector<UINT> mRitemProxies;
+
+	// When the object constant upload counters were last reported.
+#if defined(DEBUG) | defined(_DEBUG)
+	float mRitemStatsTime = 0.0f;
+#endif
+
+	// Where the render items are: the temple node, a group node per row of
+	// columns under it, and a node per item.  Moving the temple or a row is
+	// one SetLocal on its node.
+	TransformHierarchy mTransforms;
+	UINT mTempleNode = 0;
+	std::vector<UINT> mColumnRowNodes;
+
+	// The render item each transform node places, if any.
+	std::vector<RenderItemStore::Handle> mNodeRitems;
 
 	PassConstants mMainPassCB;
 
@@ -220,6 +231,8 @@ void ShapesApp::Update(const GameTimer& gt)
 		CloseHandle(eventHandle);
 	}
 
+	UpdateTransforms();
+	UpdateVisibleRitems();
 	UpdateObjectCBs(gt);
 	UpdateMainPassCB(gt);
 }
@@ -267,7 +280,7 @@ void ShapesApp::Draw(const GameTimer& gt)
 	passCbvHandle.Offset(passCbvIndex, mCbvSrvUavDescriptorSize);
 	mCommandList->SetGraphicsRootDescriptorTable(1, passCbvHandle);
 
-	DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
+	DrawRenderItems(mCommandList.Get(), mAllRitems, mVisibleRitems);
 
 	// Indicate a state transition on the resource usage.
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
@@ -362,26 +375,69 @@ void ShapesApp::UpdateCamera(const GameTimer& gt)
 	XMStoreFloat4x4(&mView, view);
 }
 
+void ShapesApp::UpdateTransforms()
+{
+	// Only the subtrees of nodes moved since the last update are recomputed,
+	// and only their render items are marked dirty.
+	mTransforms.Update();
+
+	for (UINT node : mTransforms.GetUpdatedNodes())
+	{
+		RenderItemStore::Handle item = mNodeRitems[node];
+		if (mAllRitems.IsValid(item))
+		{
+			mAllRitems.SetWorld(item, mTransforms.GetWorld(node));
+			mRitemBvh.SetBounds(mRitemProxies[mAllRitems.GetIndex(item)], mAllRitems.GetWorldBounds(item));
+		}
+	}
+}
+
+void ShapesApp::UpdateVisibleRitems()
+{
+	XMFLOAT4 planes[6];
+	FrustumCuller::ExtractFrustumPlanes(XMLoadFloat4x4(&mView) * XMLoadFloat4x4(&mProj), planes);
+
+	if (mAllRitems.GetCount() >= gBvhCullItemCount)
+	{
+		// Sorted so items sharing geometry are still drawn together.
+		mVisibleRitems.clear();
+		mRitemBvh.QueryFrustum(planes, mVisibleRitems);
+		std::sort(mVisibleRitems.begin(), mVisibleRitems.end());
+	}
+	else
+	{
+		// The store keeps the items' world boxes packed for the culler, so
+		// this is one pass over six float arrays, four items at a time.
+		FrustumCuller::Cull(planes, mAllRitems.GetWorldBounds(), mVisibleRitems);
+	}
+}
+
 void ShapesApp::UpdateObjectCBs(const GameTimer& gt)
 {
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
-	for (auto& e : mAllRitems)
+
+	// Only the items changed since this frame resource was last current are
+	// visited; the store tracks them per frame resource.
+	mAllRitems.UpdateDirty(mCurrFrameResourceIndex, [&](UINT index, const XMFLOAT4X4& worldF)
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if (e->NumFramesDirty > 0)
-		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
+		XMMATRIX world = XMLoadFloat4x4(&worldF);
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
+		ObjectConstants objConstants;
+		XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+		currObjectCB->CopyData(index, objConstants);
+	});
 
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
-		}
+	// Debug builds report the upload counters now and then.
+#if defined(DEBUG) | defined(_DEBUG)
+	if (gt.TotalTime() - mRitemStatsTime >= 5.0f)
+	{
+		mRitemStatsTime = gt.TotalTime();
+		std::string report = "object constants: " + RenderItemStore::ToString(mAllRitems.GetUpdateStats()) +
+			"; " + std::to_string(mVisibleRitems.size()) + " of " + std::to_string(mAllRitems.GetCount()) + " items visible\n";
+		::OutputDebugStringA(report.c_str());
 	}
+#endif
 }
 
 void ShapesApp::UpdateMainPassCB(const GameTimer& gt)
@@ -414,7 +470,7 @@ void ShapesApp::UpdateMainPassCB(const GameTimer& gt)
 
 void ShapesApp::BuildDescriptorHeaps()
 {
-	UINT objCount = (UINT)mOpaqueRitems.size();
+	UINT objCount = mAllRitems.GetCount();
 
 	// Need a CBV descriptor for each object for each frame resource,
 	// +1 for the perPass CBV for each frame resource.
@@ -436,7 +492,7 @@ void ShapesApp::BuildConstantBufferViews()
 {
 	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
 
-	UINT objCount = (UINT)mOpaqueRitems.size();
+	UINT objCount = mAllRitems.GetCount();
 
 	// Need a CBV descriptor for each object for each frame resource.
 	for (int frameIndex = 0; frameIndex < gNumFrameResources; ++frameIndex)
@@ -535,13 +591,32 @@ void ShapesApp::BuildShadersAndInputLayout()
 
 void ShapesApp::BuildShapeGeometry()
 {
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData box = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3);
+	//
+	// Vertex only holds a position and a color, so vertices that differ only
+	// in normal or texture coordinates are welded.  The meshes are then
+	// reordered for the post-transform vertex cache and renumbered so the
+	// vertex buffer is read in order.  The cylinder is drawn 8x17 times, so
+	// its savings are multiplied by 136.  box and box2 are the same cached
+	// mesh, and later launches read all three from disk.
+	//
+
+	GeometryCache geoCache(L"GeometryCache");
+	const UINT optimize = GeometryCache::WeldPositions |
+		GeometryCache::OptimizeVertexCache | GeometryCache::OptimizeVertexFetch;
 
-	GeometryGenerator::MeshData box2 = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3);
+	auto boxMesh = geoCache.Get(GeometryGenerator::ShapeType::Box,
+		GeometryGenerator::ShapeParams::Box(1.0f, 1.0f, 1.0f, 3), optimize);
+	auto box2Mesh = geoCache.Get(GeometryGenerator::ShapeType::Box,
+		GeometryGenerator::ShapeParams::Box(1.0f, 1.0f, 1.0f, 3), optimize);
+	auto cylinderMesh = geoCache.Get(GeometryGenerator::ShapeType::Cylinder,
+		GeometryGenerator::ShapeParams::Cylinder(0.5f, 0.5f, 3.0f, 20, 20), optimize);
 
-	GeometryGenerator::MeshData cylinder = geoGen.CreateCylinder(0.5f, 0.5f, 3.0, 20, 20);
+	const GeometryGenerator::MeshData& box = *boxMesh;
+	const GeometryGenerator::MeshData& box2 = *box2Mesh;
+	const GeometryGenerator::MeshData& cylinder = *cylinderMesh;
 
+	std::string cacheReport = GeometryCache::ToString(geoCache.GetStats()) + "\n";
+	::OutputDebugStringA(cacheReport.c_str());
 
 	/*
 	Step1
@@ -596,6 +671,19 @@ void ShapesApp::BuildShapeGeometry()
 	cylinderSubmesh.StartIndexLocation = CylinderIndexOffset;
 	cylinderSubmesh.BaseVertexLocation = cylinderVertexOffset;
 
+	// Bounds in mesh space, before any world matrix is applied.
+	MeshBounds::Result boxBounds = MeshBounds::Compute(box);
+	boxSubmesh.Bounds = boxBounds.Box;
+	boxSubmesh.Sphere = boxBounds.Sphere;
+
+	MeshBounds::Result box2Bounds = MeshBounds::Compute(box2);
+	box2Submesh.Bounds = box2Bounds.Box;
+	box2Submesh.Sphere = box2Bounds.Sphere;
+
+	MeshBounds::Result cylinderBounds = MeshBounds::Compute(cylinder);
+	cylinderSubmesh.Bounds = cylinderBounds.Box;
+	cylinderSubmesh.Sphere = cylinderBounds.Sphere;
+
 
 
 	//step4
@@ -670,10 +758,13 @@ void ShapesApp::BuildShapeGeometry()
 	//	vertices[k].Color = XMFLOAT4(DirectX::Colors::SteelBlue);
 	//}
 
-	std::vector<std::uint16_t> indices;
-	indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
-	indices.insert(indices.end(), std::begin(box2.GetIndices16()), std::end(box2.GetIndices16()));
-	indices.insert(indices.end(), std::begin(cylinder.GetIndices16()), std::end(cylinder.GetIndices16()));
+	std::vector<GeometryGenerator::uint32> indices32;
+	indices32.insert(indices32.end(), std::begin(box.Indices32), std::end(box.Indices32));
+	indices32.insert(indices32.end(), std::begin(box2.Indices32), std::end(box2.Indices32));
+	indices32.insert(indices32.end(), std::begin(cylinder.Indices32), std::end(cylinder.Indices32));
+
+	// 16-bit indices when every mesh fits in them, 32-bit otherwise.
+	IndexPacking::PackedIndices indices = IndexPacking::Pack(indices32);
 
 
 	//step7
@@ -682,7 +773,7 @@ void ShapesApp::BuildShapeGeometry()
 	//indices.insert(indices.end(), std::begin(cylinder.GetIndices16()), std::end(cylinder.GetIndices16()));
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	const UINT ibByteSize = indices.GetByteSize();
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "shapeGeo";
@@ -691,17 +782,17 @@ void ShapesApp::BuildShapeGeometry()
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.GetData(), ibByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
 		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
 
 	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+		mCommandList.Get(), indices.GetData(), ibByteSize, geo->IndexBufferUploader);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexFormat = indices.Format;
 	geo->IndexBufferByteSize = ibByteSize;
 
 	geo->DrawArgs["box"] = boxSubmesh;
@@ -765,42 +856,58 @@ void ShapesApp::BuildFrameResources()
 	for (int i = 0; i < gNumFrameResources; ++i)
 	{
 		mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-			1, (UINT)mAllRitems.size()));
+			1, mAllRitems.GetCount()));
 	}
 }
 
+UINT ShapesApp::AddTransform(UINT parent, const XMFLOAT3& scale, const XMFLOAT3& translation)
+{
+	TransformHierarchy::Transform local;
+	local.Scale = scale;
+	local.Translation = translation;
+
+	UINT node = mTransforms.AddNode(parent, local);
+	mNodeRitems.resize(mTransforms.GetNodeCount());
+	return node;
+}
+
+// Adds an item drawn where node is.  Its world matrix is filled in by the
+// next UpdateTransforms.
+RenderItemStore::Handle ShapesApp::AddRenderItem(UINT node, MeshGeometry* geo, const std::string& submesh)
+{
+	// Geometries get their table index the first time an item draws them.
+	auto geoIt = std::find(mRitemGeometries.begin(), mRitemGeometries.end(), geo);
+	if (geoIt == mRitemGeometries.end())
+		geoIt = mRitemGeometries.insert(mRitemGeometries.end(), geo);
+
+	const SubmeshGeometry& sub = geo->DrawArgs[submesh];
+
+	RenderItemStore::DrawArgs drawArgs;
+	drawArgs.Geometry = (UINT)(geoIt - mRitemGeometries.begin());
+	drawArgs.PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	drawArgs.IndexCount = sub.IndexCount;
+	drawArgs.StartIndexLocation = sub.StartIndexLocation;
+	drawArgs.BaseVertexLocation = sub.BaseVertexLocation;
+
+	RenderItemStore::Handle item = mAllRitems.Add(MathHelper::Identity4x4(), drawArgs, sub.Bounds);
+	mNodeRitems[node] = item;
+	mRitemProxies.push_back(mRitemBvh.Insert(mAllRitems.GetWorldBounds(item), mAllRitems.GetIndex(item)));
+	return item;
+}
+
 void ShapesApp::BuildRenderItems()
 {
-	auto boxRitem = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem->World, XMMatrixScaling(10.0f, 3.0f, 20.0f) * XMMatrixTranslation(0.0f, 0.5f, 5.0f));
-	boxRitem->ObjCBIndex = 0;
-	boxRitem->Geo = mGeometries["shapeGeo"].get();
-	boxRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem->IndexCount = boxRitem->Geo->DrawArgs["box"].IndexCount;
-	boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["box"].StartIndexLocation;
-	boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(boxRitem));
-
-
-	auto boxRitem2 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem2->World, XMMatrixScaling(9.0f, 1.5f, 18.0f) * XMMatrixTranslation(0.0f, 2.0f, 5.0f));
-	boxRitem2->ObjCBIndex = 1;
-	boxRitem2->Geo = mGeometries["shapeGeo"].get();
-	boxRitem2->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem2->IndexCount = boxRitem2->Geo->DrawArgs["box2"].IndexCount;
-	boxRitem2->StartIndexLocation = boxRitem2->Geo->DrawArgs["box2"].StartIndexLocation;
-	boxRitem2->BaseVertexLocation = boxRitem2->Geo->DrawArgs["box2"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(boxRitem2));
-
-	auto boxRitem3 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem3->World, XMMatrixScaling(8.0f, 1.0f, 16.0f) * XMMatrixTranslation(0.0f, 2.5f, 5.0f));
-	boxRitem3->ObjCBIndex = 2;
-	boxRitem3->Geo = mGeometries["shapeGeo"].get();
-	boxRitem3->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem3->IndexCount = boxRitem3->Geo->DrawArgs["box"].IndexCount;
-	boxRitem3->StartIndexLocation = boxRitem3->Geo->DrawArgs["box"].StartIndexLocation;
-	boxRitem3->BaseVertexLocation = boxRitem3->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(boxRitem3));
+	MeshGeometry* shapeGeo = mGeometries["shapeGeo"].get();
+
+	mAllRitems.Reserve(3 + 8 * 17 + 1);
+	mTransforms.Reserve(1 + 3 + 8 + 8 * 17 + 1);
+
+	const XMFLOAT3 unitScale(1.0f, 1.0f, 1.0f);
+	mTempleNode = AddTransform(TransformHierarchy::NoParent, unitScale, XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+	AddRenderItem(AddTransform(mTempleNode, XMFLOAT3(10.0f, 3.0f, 20.0f), XMFLOAT3(0.0f, 0.5f, 5.0f)), shapeGeo, "box");
+	AddRenderItem(AddTransform(mTempleNode, XMFLOAT3(9.0f, 1.5f, 18.0f), XMFLOAT3(0.0f, 2.0f, 5.0f)), shapeGeo, "box2");
+	AddRenderItem(AddTransform(mTempleNode, XMFLOAT3(8.0f, 1.0f, 16.0f), XMFLOAT3(0.0f, 2.5f, 5.0f)), shapeGeo, "box");
 
 
 	//auto cylinderRitem = std::make_unique<RenderItem>();
@@ -825,35 +932,25 @@ void ShapesApp::BuildRenderItems()
 	//cylinderRitem2->BaseVertexLocation = cylinderRitem2->Geo->DrawArgs["cylinder"].BaseVertexLocation;
 	//mAllRitems.push_back(std::move(cylinderRitem2));
 
-	std::unique_ptr<RenderItem> rItem[8][17];
-	UINT objCBIndex = 3;
-
+	// Each row of columns hangs off its own group node, which carries the
+	// row's x and the columns' common height.
 	for (int i = 0; i < 8; i++)
 	{
+		UINT rowNode = AddTransform(mTempleNode, unitScale, XMFLOAT3(-3.5f + i, 4.5f, 0.0f));
+		mColumnRowNodes.push_back(rowNode);
+
 		for (int j = 0; j < 17; j++)
 		{
-			rItem[i][j] = std::make_unique<RenderItem>();
-			XMStoreFloat4x4(&rItem[i][j]->World, XMMatrixScaling(0.5f, 1.0, 0.5f) * XMMatrixTranslation(-3.5 + i, 4.5f, -3.0f + j));
-			rItem[i][j]->ObjCBIndex = objCBIndex++;
-			rItem[i][j]->Geo = mGeometries["shapeGeo"].get();
-			rItem[i][j]->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-			rItem[i][j]->IndexCount = rItem[i][j]->Geo->DrawArgs["cylinder"].IndexCount;
-			rItem[i][j]->StartIndexLocation = rItem[i][j]->Geo->DrawArgs["cylinder"].StartIndexLocation;
-			rItem[i][j]->BaseVertexLocation = rItem[i][j]->Geo->DrawArgs["cylinder"].BaseVertexLocation;
-			mAllRitems.push_back(std::move(rItem[i][j]));
+			AddRenderItem(AddTransform(rowNode, XMFLOAT3(0.5f, 1.0f, 0.5f), XMFLOAT3(0.0f, 0.0f, -3.0f + j)), shapeGeo, "cylinder");
 		}
 	}
 
+	AddRenderItem(AddTransform(mTempleNode, XMFLOAT3(8.0f, 1.0f, 16.0f), XMFLOAT3(0.0f, 6.5f, 5.0f)), shapeGeo, "box");
 
-	auto boxRitem4 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem4->World, XMMatrixScaling(8.0f, 1.0f, 16.0f) * XMMatrixTranslation(0.0f, 6.5f, 5.0f));
-	boxRitem4->ObjCBIndex = 8*17 + 3;
-	boxRitem4->Geo = mGeometries["shapeGeo"].get();
-	boxRitem4->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem4->IndexCount = boxRitem4->Geo->DrawArgs["box"].IndexCount;
-	boxRitem4->StartIndexLocation = boxRitem4->Geo->DrawArgs["box"].StartIndexLocation;
-	boxRitem4->BaseVertexLocation = boxRitem4->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(boxRitem4));
+	// Every item just moved from the origin to its place; rebuild the BVH
+	// over where they are rather than keep the tree refitting made.
+	UpdateTransforms();
+	mRitemBvh.Rebuild();
 
 
 	/*
@@ -919,35 +1016,49 @@ void ShapesApp::BuildRenderItems()
 		mAllRitems.push_back(std::move(leftSphereRitem));
 		mAllRitems.push_back(std::move(rightSphereRitem));
 	}*/
-
-	// All the render items are opaque.
-	for (auto& e : mAllRitems)
-		mOpaqueRitems.push_back(e.get());
 }
 
-void ShapesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+// Draws the items of ritems at indices, which should be increasing so items
+// sharing geometry stay together.
+void ShapesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const RenderItemStore& ritems,
+	const std::vector<UINT>& indices)
 {
-	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+	const RenderItemStore::DrawArgs* drawArgs = ritems.GetDrawArgs();
 
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
+	// Buffers and topology are only rebound when they change between items.
+	UINT boundGeometry = UINT_MAX;
+	UINT boundPrimitiveType = UINT_MAX;
 
-	// For each render item...
-	for (size_t i = 0; i < ritems.size(); ++i)
+	// This frame resource's object CBVs.
+	UINT frameCbvIndex = mCurrFrameResourceIndex * ritems.GetCount();
+
+	// For each visible render item...
+	for (UINT i : indices)
 	{
-		auto ri = ritems[i];
+		const RenderItemStore::DrawArgs& args = drawArgs[i];
+
+		if (args.Geometry != boundGeometry)
+		{
+			MeshGeometry* geo = mRitemGeometries[args.Geometry];
+			cmdList->IASetVertexBuffers(0, 1, &geo->VertexBufferView());
+			cmdList->IASetIndexBuffer(&geo->IndexBufferView());
+			boundGeometry = args.Geometry;
+		}
 
-		cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+		if (args.PrimitiveType != boundPrimitiveType)
+		{
+			cmdList->IASetPrimitiveTopology((D3D12_PRIMITIVE_TOPOLOGY)args.PrimitiveType);
+			boundPrimitiveType = args.PrimitiveType;
+		}
 
-		// Offset to the CBV in the descriptor heap for this object and for this frame resource.
-		UINT cbvIndex = mCurrFrameResourceIndex * (UINT)mOpaqueRitems.size() + ri->ObjCBIndex;
+		// Offset to the CBV in the descriptor heap for this object and for this
+		// frame resource; an item's index is its constant buffer index.
 		auto cbvHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(mCbvHeap->GetGPUDescriptorHandleForHeapStart());
-		cbvHandle.Offset(cbvIndex, mCbvSrvUavDescriptorSize);
+		cbvHandle.Offset(frameCbvIndex + i, mCbvSrvUavDescriptorSize);
 
 		cmdList->SetGraphicsRootDescriptorTable(0, cbvHandle);
 
-		cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+		cmdList->DrawIndexedInstanced(args.IndexCount, 1, args.StartIndexLocation, args.BaseVertexLocation, 0);
 	}
 }
 
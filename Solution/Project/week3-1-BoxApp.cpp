@@ -14,6 +14,7 @@
 #include "../../Common/UploadBuffer.h"
 
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/IndexPacking.h"
 #include "FrameResource.h"
 
 #include <iostream>
@@ -824,22 +825,25 @@ void ShapesApp::BuildShapeGeometry()
 		vertices[k].Color = XMFLOAT4(DirectX::Colors::Yellow); // diamond color
 	}
 	// Combine all indices into one buffer
-	std::vector<std::uint16_t> indices;
-	indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
-	indices.insert(indices.end(), std::begin(cylinder.GetIndices16()), std::end(cylinder.GetIndices16()));
-	indices.insert(indices.end(), std::begin(grid.GetIndices16()), std::end(grid.GetIndices16()));
-	indices.insert(indices.end(), std::begin(rooftop.GetIndices16()), std::end(rooftop.GetIndices16()));
-	indices.insert(indices.end(), std::begin(door.GetIndices16()), std::end(door.GetIndices16()));
-	indices.insert(indices.end(), std::begin(cone.GetIndices16()), std::end(cone.GetIndices16()));
-	indices.insert(indices.end(), std::begin(wedge.GetIndices16()), std::end(wedge.GetIndices16()));
-	indices.insert(indices.end(), std::begin(torus.GetIndices16()), std::end(torus.GetIndices16()));
-	indices.insert(indices.end(), std::begin(pyramid.GetIndices16()), std::end(pyramid.GetIndices16()));
-	indices.insert(indices.end(), std::begin(diamond.GetIndices16()), std::end(diamond.GetIndices16()));
-	indices.insert(indices.end(), std::begin(diamond1.GetIndices16()), std::end(diamond1.GetIndices16()));
+	std::vector<GeometryGenerator::uint32> indices32;
+	indices32.insert(indices32.end(), std::begin(box.Indices32), std::end(box.Indices32));
+	indices32.insert(indices32.end(), std::begin(cylinder.Indices32), std::end(cylinder.Indices32));
+	indices32.insert(indices32.end(), std::begin(grid.Indices32), std::end(grid.Indices32));
+	indices32.insert(indices32.end(), std::begin(rooftop.Indices32), std::end(rooftop.Indices32));
+	indices32.insert(indices32.end(), std::begin(door.Indices32), std::end(door.Indices32));
+	indices32.insert(indices32.end(), std::begin(cone.Indices32), std::end(cone.Indices32));
+	indices32.insert(indices32.end(), std::begin(wedge.Indices32), std::end(wedge.Indices32));
+	indices32.insert(indices32.end(), std::begin(torus.Indices32), std::end(torus.Indices32));
+	indices32.insert(indices32.end(), std::begin(pyramid.Indices32), std::end(pyramid.Indices32));
+	indices32.insert(indices32.end(), std::begin(diamond.Indices32), std::end(diamond.Indices32));
+	indices32.insert(indices32.end(), std::begin(diamond1.Indices32), std::end(diamond1.Indices32));
+
+	// 16-bit indices when every mesh fits in them, 32-bit otherwise.
+	IndexPacking::PackedIndices indices = IndexPacking::Pack(indices32);
 
 	// Upload combined geometry to GPU
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	const UINT ibByteSize = indices.GetByteSize();
 
 
 	// Create a new mesh geometry
@@ -850,20 +854,20 @@ void ShapesApp::BuildShapeGeometry()
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.GetData(), ibByteSize);
 
 	// Create GPU buffers
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
 		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
 	// Create GPU buffers
 	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+		mCommandList.Get(), indices.GetData(), ibByteSize, geo->IndexBufferUploader);
 
 
 	// Set buffer 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexFormat = indices.Format;
 	geo->IndexBufferByteSize = ibByteSize;
 
 	// Assign submesh geometries to the mesh geometry game object
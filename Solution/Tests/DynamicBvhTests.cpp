@@ -0,0 +1,337 @@
+//***************************************************************************************
+// DynamicBvhTests.cpp
+//
+// DynamicBvh queries against a scan of every box, after random sequences of
+// Insert, Remove, SetBounds and Rebuild, so the rotations and refits that keep
+// the tree balanced are checked through what the queries return.  Boxes sit
+// on integer coordinates so rays along the axes graze their faces exactly.
+//***************************************************************************************
+
+#include "Test.h"
+#include "../../Common/DynamicBvh.h"
+#include "../../Common/FrustumCuller.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <random>
+
+using namespace DirectX;
+using uint32 = DynamicBvh::uint32;
+
+namespace
+{
+	struct Item
+	{
+		uint32 Proxy;
+		BoundingBox Box;
+	};
+
+	typedef std::map<uint32, Item> Items;
+
+	void MinMax(const BoundingBox& box, XMFLOAT3& min, XMFLOAT3& max)
+	{
+		XMStoreFloat3(&min, XMLoadFloat3(&box.Center) - XMLoadFloat3(&box.Extents));
+		XMStoreFloat3(&max, XMLoadFloat3(&box.Center) + XMLoadFloat3(&box.Extents));
+	}
+
+	// A box with integer corners in [-32, 32]^3, 1 to 8 units on a side.
+	BoundingBox RandomBox(std::mt19937& rng)
+	{
+		std::uniform_int_distribution<int> corner(-32, 28);
+		std::uniform_int_distribution<int> size(1, 8);
+
+		XMFLOAT3 min((float)corner(rng), (float)corner(rng), (float)corner(rng));
+		XMFLOAT3 max(min.x + size(rng), min.y + size(rng), min.z + size(rng));
+
+		BoundingBox box;
+		BoundingBox::CreateFromPoints(box, XMLoadFloat3(&min), XMLoadFloat3(&max));
+		return box;
+	}
+
+	std::vector<uint32> Sorted(std::vector<uint32> items)
+	{
+		std::sort(items.begin(), items.end());
+		return items;
+	}
+
+	std::vector<uint32> ReferenceFrustum(const Items& items, const XMFLOAT4 planes[6])
+	{
+		std::vector<uint32> result;
+		for(const auto& item : items)
+		{
+			XMFLOAT3 min, max;
+			MinMax(item.second.Box, min, max);
+			XMFLOAT3 c(0.5f*(min.x + max.x), 0.5f*(min.y + max.y), 0.5f*(min.z + max.z));
+			XMFLOAT3 e(0.5f*(max.x - min.x), 0.5f*(max.y - min.y), 0.5f*(max.z - min.z));
+
+			bool inside = true;
+			for(int p = 0; p < 6; ++p)
+			{
+				float distance = planes[p].x*c.x + planes[p].y*c.y + planes[p].z*c.z + planes[p].w;
+				float radius = fabsf(planes[p].x)*e.x + fabsf(planes[p].y)*e.y + fabsf(planes[p].z)*e.z;
+				inside = inside && distance + radius >= 0.0f;
+			}
+
+			if(inside)
+				result.push_back(item.first);
+		}
+
+		return result;
+	}
+
+	std::vector<uint32> ReferenceBox(const Items& items, const BoundingBox& query)
+	{
+		XMFLOAT3 qMin, qMax;
+		MinMax(query, qMin, qMax);
+
+		std::vector<uint32> result;
+		for(const auto& item : items)
+		{
+			XMFLOAT3 min, max;
+			MinMax(item.second.Box, min, max);
+			if(min.x <= qMax.x && max.x >= qMin.x && min.y <= qMax.y && max.y >= qMin.y &&
+				min.z <= qMax.z && max.z >= qMin.z)
+				result.push_back(item.first);
+		}
+
+		return result;
+	}
+
+	std::vector<uint32> ReferenceSphere(const Items& items, const BoundingSphere& sphere)
+	{
+		std::vector<uint32> result;
+		for(const auto& item : items)
+		{
+			XMFLOAT3 min, max;
+			MinMax(item.second.Box, min, max);
+
+			const XMFLOAT3& c = sphere.Center;
+			float dx = std::max(std::max(min.x - c.x, c.x - max.x), 0.0f);
+			float dy = std::max(std::max(min.y - c.y, c.y - max.y), 0.0f);
+			float dz = std::max(std::max(min.z - c.z, c.z - max.z), 0.0f);
+			if(dx*dx + dy*dy + dz*dz <= sphere.Radius*sphere.Radius)
+				result.push_back(item.first);
+		}
+
+		return result;
+	}
+
+	// Where the ray enters the box within [0, maxDistance], or FLT_MAX.  Axes
+	// the ray does not move along only test the origin.
+	float ReferenceEnter(const BoundingBox& box, const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance)
+	{
+		XMFLOAT3 min, max;
+		MinMax(box, min, max);
+
+		const float o[] = { origin.x, origin.y, origin.z };
+		const float d[] = { direction.x, direction.y, direction.z };
+		const float lo[] = { min.x, min.y, min.z };
+		const float hi[] = { max.x, max.y, max.z };
+
+		float enter = 0.0f;
+		float exit = maxDistance;
+		for(int a = 0; a < 3; ++a)
+		{
+			if(d[a] == 0.0f)
+			{
+				if(o[a] < lo[a] || o[a] > hi[a])
+					return FLT_MAX;
+				continue;
+			}
+
+			float t1 = (lo[a] - o[a])*(1.0f / d[a]);
+			float t2 = (hi[a] - o[a])*(1.0f / d[a]);
+			enter = std::max(enter, std::min(t1, t2));
+			exit = std::min(exit, std::max(t1, t2));
+		}
+
+		return enter <= exit ? enter : FLT_MAX;
+	}
+
+	// Checks Raycast against the nearest entry over every box.  Ties may pick
+	// either box, so the hit is checked by its distance.
+	void CheckRay(const DynamicBvh& bvh, const Items& items, const XMFLOAT3& origin, const XMFLOAT3& direction,
+		float maxDistance)
+	{
+		float nearest = FLT_MAX;
+		for(const auto& item : items)
+			nearest = std::min(nearest, ReferenceEnter(item.second.Box, origin, direction, maxDistance));
+
+		DynamicBvh::RayHit hit;
+		bool found = bvh.Raycast(origin, direction, maxDistance, hit);
+		CHECK(found == (nearest != FLT_MAX));
+		if(!found || nearest == FLT_MAX)
+			return;
+
+		CHECK(hit.Distance == nearest);
+
+		auto item = items.find(hit.Item);
+		CHECK(item != items.end() && item->second.Proxy == hit.Proxy);
+		if(item != items.end())
+			CHECK(ReferenceEnter(item->second.Box, origin, direction, maxDistance) == nearest);
+	}
+
+	void CheckQueries(const DynamicBvh& bvh, const Items& items, std::mt19937& rng)
+	{
+		CHECK(bvh.GetLeafCount() == items.size());
+		for(const auto& item : items)
+		{
+			XMFLOAT3 min, max, leafMin, leafMax;
+			MinMax(item.second.Box, min, max);
+			MinMax(bvh.GetBounds(item.second.Proxy), leafMin, leafMax);
+
+			CHECK(bvh.GetItem(item.second.Proxy) == item.first);
+			CHECK(std::memcmp(&min, &leafMin, sizeof(min)) == 0 && std::memcmp(&max, &leafMax, sizeof(max)) == 0);
+		}
+
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_int_distribution<int> coordinate(-36, 36);
+		std::vector<uint32> found;
+
+		for(int q = 0; q < 4; ++q)
+		{
+			XMVECTOR eye = XMVectorSet(40.0f*unit(rng), 40.0f*unit(rng), 40.0f*unit(rng), 1.0f);
+			XMVECTOR target = XMVectorSet(8.0f*unit(rng), 8.0f*unit(rng), 8.0f*unit(rng), 1.0f);
+			XMMATRIX view = XMMatrixLookAtLH(eye, target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			XMMATRIX proj = XMMatrixPerspectiveFovLH(0.6f + 0.5f*unit(rng), 1.5f, 1.0f, 60.0f);
+
+			XMFLOAT4 planes[6];
+			FrustumCuller::ExtractFrustumPlanes(view*proj, planes);
+
+			found.clear();
+			bvh.QueryFrustum(planes, found);
+			CHECK(Sorted(found) == ReferenceFrustum(items, planes));
+
+			BoundingBox box = RandomBox(rng);
+			found.clear();
+			bvh.QueryBox(box, found);
+			CHECK(Sorted(found) == ReferenceBox(items, box));
+
+			BoundingSphere sphere(XMFLOAT3(30.0f*unit(rng), 30.0f*unit(rng), 30.0f*unit(rng)), 2.0f + 10.0f*fabsf(unit(rng)));
+			found.clear();
+			bvh.QuerySphere(sphere, found);
+			CHECK(Sorted(found) == ReferenceSphere(items, sphere));
+		}
+
+		for(int r = 0; r < 32; ++r)
+		{
+			XMFLOAT3 origin((float)coordinate(rng), (float)coordinate(rng), (float)coordinate(rng));
+
+			// Half the rays run along an axis from an integer origin, so they
+			// often start on, or slide along, a box's face.
+			XMFLOAT3 direction(unit(rng), unit(rng), unit(rng));
+			if(r % 2 == 0)
+			{
+				float sign = unit(rng) < 0.0f ? -1.0f : 1.0f;
+				int axis = r / 2 % 3;
+				direction = XMFLOAT3(axis == 0 ? sign : 0.0f, axis == 1 ? sign : 0.0f, axis == 2 ? sign : 0.0f);
+			}
+
+			CheckRay(bvh, items, origin, direction, r % 4 == 1 ? 10.0f : 1000.0f);
+		}
+	}
+}
+
+TEST(DynamicBvh_AxisRayOnFace)
+{
+	// A ray along x whose origin lies in the box's bottom and side planes:
+	// (min.y - origin.y)*inf would be 0*inf = NaN.
+	DynamicBvh bvh;
+	BoundingBox box(XMFLOAT3(5.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	uint32 proxy = bvh.Insert(box, 7);
+
+	DynamicBvh::RayHit hit;
+	CHECK(bvh.Raycast(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), 100.0f, hit));
+	CHECK(hit.Proxy == proxy && hit.Item == 7 && hit.Distance == 4.0f);
+
+	CHECK(bvh.Raycast(XMFLOAT3(10.0f, 2.0f, 2.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), 100.0f, hit));
+	CHECK(hit.Distance == 4.0f);
+
+	// Parallel and just outside the slab misses; starting inside hits at 0.
+	CHECK(!bvh.Raycast(XMFLOAT3(0.0f, -0.001f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), 100.0f, hit));
+	CHECK(bvh.Raycast(XMFLOAT3(5.0f, 1.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), 100.0f, hit));
+	CHECK(hit.Distance == 0.0f);
+
+	// Out of range.
+	CHECK(!bvh.Raycast(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), 3.5f, hit));
+}
+
+TEST(DynamicBvh_MatchesBruteForce)
+{
+	std::mt19937 rng(12345);
+	std::uniform_int_distribution<int> operation(0, 99);
+
+	DynamicBvh bvh;
+	Items items;
+	uint32 nextItem = 0;
+
+	// Start from a SAH build, then edit it.
+	{
+		std::vector<BoundingBox> boxes;
+		std::vector<uint32> ids;
+		for(int i = 0; i < 200; ++i)
+		{
+			boxes.push_back(RandomBox(rng));
+			ids.push_back(nextItem++);
+		}
+
+		std::vector<uint32> proxies;
+		bvh.Build(boxes.data(), ids.data(), (uint32)boxes.size(), proxies);
+		for(size_t i = 0; i < boxes.size(); ++i)
+			items[ids[i]] = Item{ proxies[i], boxes[i] };
+	}
+	CheckQueries(bvh, items, rng);
+
+	for(int step = 0; step < 4000; ++step)
+	{
+		int op = operation(rng);
+		if(op < 40 || items.empty())
+		{
+			BoundingBox box = RandomBox(rng);
+			uint32 id = nextItem++;
+			items[id] = Item{ bvh.Insert(box, id), box };
+		}
+		else
+		{
+			// A random live item.
+			auto it = items.lower_bound(std::uniform_int_distribution<uint32>(0, nextItem - 1)(rng));
+			if(it == items.end())
+				it = items.begin();
+
+			if(op < 70)
+			{
+				bvh.Remove(it->second.Proxy);
+				items.erase(it);
+			}
+			else if(op < 99)
+			{
+				it->second.Box = RandomBox(rng);
+				bvh.SetBounds(it->second.Proxy, it->second.Box);
+			}
+			else
+			{
+				bvh.Rebuild();
+			}
+		}
+
+		if(step % 200 == 0)
+			CheckQueries(bvh, items, rng);
+	}
+
+	CheckQueries(bvh, items, rng);
+
+	// Balancing keeps the height logarithmic despite the random order.
+	CHECK(bvh.GetHeight() <= 4*(uint32)std::ceil(std::log2((float)items.size() + 1.0f)));
+
+	// Removing everything leaves an empty tree.
+	for(const auto& item : items)
+		bvh.Remove(item.second.Proxy);
+	items.clear();
+	CHECK(bvh.GetLeafCount() == 0 && bvh.GetHeight() == 0);
+
+	std::vector<uint32> found;
+	bvh.QueryBox(RandomBox(rng), found);
+	CHECK(found.empty());
+}
@@ -0,0 +1,197 @@
+//***************************************************************************************
+// FrustumCullerTests.cpp
+//
+// FrustumCuller::Cull against a box-at-a-time reference.
+//***************************************************************************************
+
+#include "Test.h"
+#include "../../Common/FrustumCuller.h"
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+using uint32 = FrustumCuller::uint32;
+
+namespace
+{
+	std::vector<uint32> ReferenceCull(const XMFLOAT4 planes[6], const std::vector<BoundingBox>& boxes)
+	{
+		std::vector<uint32> visible;
+		for(uint32 i = 0; i < (uint32)boxes.size(); ++i)
+		{
+			const BoundingBox& box = boxes[i];
+
+			bool inside = true;
+			for(int p = 0; p < 6; ++p)
+			{
+				const XMFLOAT4& plane = planes[p];
+				float distance = plane.x*box.Center.x + plane.y*box.Center.y + plane.z*box.Center.z + plane.w;
+				float radius = fabsf(plane.x)*box.Extents.x + fabsf(plane.y)*box.Extents.y + fabsf(plane.z)*box.Extents.z;
+				if(distance + radius < 0.0f)
+					inside = false;
+			}
+
+			if(inside)
+				visible.push_back(i);
+		}
+
+		return visible;
+	}
+
+	// Six random unit planes.  With originInside every w is positive, so the
+	// empty boxes at the origin that pad the last group of four are inside.
+	void RandomPlanes(std::mt19937& random, bool originInside, XMFLOAT4 planes[6])
+	{
+		std::uniform_real_distribution<float> component(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> offset(originInside ? 10.0f : -50.0f, 50.0f);
+
+		for(int p = 0; p < 6; ++p)
+		{
+			XMVECTOR n = XMVector3Normalize(XMVectorSet(component(random), component(random), component(random), 0.0f));
+			XMStoreFloat4(&planes[p], XMVectorSetW(n, offset(random)));
+		}
+	}
+
+	std::vector<BoundingBox> RandomBoxes(std::mt19937& random, uint32 count)
+	{
+		std::uniform_real_distribution<float> center(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> extent(0.0f, 5.0f);
+
+		std::vector<BoundingBox> boxes(count);
+		for(BoundingBox& box : boxes)
+		{
+			box.Center = XMFLOAT3(center(random), center(random), center(random));
+			box.Extents = XMFLOAT3(extent(random), extent(random), extent(random));
+		}
+
+		return boxes;
+	}
+
+	void Fill(FrustumCuller::Boxes& boxes, const std::vector<BoundingBox>& source)
+	{
+		boxes.Clear();
+		for(const BoundingBox& box : source)
+			boxes.PushBack(box);
+	}
+
+	bool CullMatches(const XMFLOAT4 planes[6], const FrustumCuller::Boxes& boxes, const std::vector<BoundingBox>& source)
+	{
+		std::vector<uint32> visible;
+		uint32 count = FrustumCuller::Cull(planes, boxes, visible);
+		return count == visible.size() && visible == ReferenceCull(planes, source);
+	}
+}
+
+TEST(FrustumCuller_SmallCounts)
+{
+	std::mt19937 random(1);
+
+	for(int trial = 0; trial < 100; ++trial)
+	{
+		XMFLOAT4 planes[6];
+		RandomPlanes(random, trial % 2 == 0, planes);
+
+		for(uint32 count = 0; count <= 8; ++count)
+		{
+			std::vector<BoundingBox> source = RandomBoxes(random, count);
+			FrustumCuller::Boxes boxes;
+			Fill(boxes, source);
+
+			CHECK(boxes.GetCount() == count);
+			CHECK(CullMatches(planes, boxes, source));
+		}
+	}
+}
+
+TEST(FrustumCuller_PaddingNeverVisible)
+{
+	std::mt19937 random(2);
+
+	// The origin is inside and every box is behind the first plane, so only
+	// the padding lanes would pass.
+	XMFLOAT4 planes[6];
+	RandomPlanes(random, true, planes);
+
+	float behind = planes[0].w + 1000.0f;
+	BoundingBox outside(XMFLOAT3(-planes[0].x*behind, -planes[0].y*behind, -planes[0].z*behind),
+		XMFLOAT3(1.0f, 1.0f, 1.0f));
+
+	for(uint32 count = 1; count <= 7; ++count)
+	{
+		std::vector<BoundingBox> source(count, outside);
+		FrustumCuller::Boxes boxes;
+		Fill(boxes, source);
+
+		std::vector<uint32> visible;
+		CHECK(FrustumCuller::Cull(planes, boxes, visible) == 0);
+		CHECK(visible.empty());
+
+		// The padding lanes of the last group are empty boxes at the origin.
+		uint32 padded = (count + 3) & ~3u;
+		for(uint32 i = count; i < padded; ++i)
+		{
+			CHECK(boxes.GetCenterX()[i] == 0.0f && boxes.GetExtentX()[i] == 0.0f);
+			CHECK(boxes.GetCenterY()[i] == 0.0f && boxes.GetExtentY()[i] == 0.0f);
+			CHECK(boxes.GetCenterZ()[i] == 0.0f && boxes.GetExtentZ()[i] == 0.0f);
+		}
+	}
+}
+
+TEST(FrustumCuller_Shrink)
+{
+	std::mt19937 random(3);
+
+	XMFLOAT4 planes[6];
+	RandomPlanes(random, false, planes);
+
+	// Boxes around the origin so most are visible before shrinking.
+	std::vector<BoundingBox> source = RandomBoxes(random, 37);
+	for(BoundingBox& box : source)
+		box.Extents = XMFLOAT3(1000.0f, 1000.0f, 1000.0f);
+
+	FrustumCuller::Boxes boxes;
+	Fill(boxes, source);
+	CHECK(CullMatches(planes, boxes, source));
+
+	// Boxes dropped from a group stay out of the visible list.
+	while(!source.empty())
+	{
+		boxes.PopBack();
+		source.pop_back();
+		CHECK(boxes.GetCount() == source.size());
+		CHECK(CullMatches(planes, boxes, source));
+	}
+
+	// Shrinking by several groups at once, then growing back.
+	source = RandomBoxes(random, 29);
+	for(BoundingBox& box : source)
+		box.Extents = XMFLOAT3(1000.0f, 1000.0f, 1000.0f);
+	Fill(boxes, source);
+
+	boxes.Resize(6);
+	source.resize(6);
+	CHECK(CullMatches(planes, boxes, source));
+
+	boxes.Resize(10);
+	source.resize(10, BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f)));
+	for(uint32 i = 6; i < 10; ++i)
+		CHECK(boxes.Get(i).Extents.x == 0.0f && boxes.Get(i).Center.x == 0.0f);
+	CHECK(CullMatches(planes, boxes, source));
+}
+
+TEST(FrustumCuller_MillionRandomBoxes)
+{
+	std::mt19937 random(4);
+
+	std::vector<BoundingBox> source = RandomBoxes(random, 1000000);
+	FrustumCuller::Boxes boxes;
+	boxes.Reserve((uint32)source.size());
+	Fill(boxes, source);
+
+	for(int trial = 0; trial < 4; ++trial)
+	{
+		XMFLOAT4 planes[6];
+		RandomPlanes(random, trial % 2 == 0, planes);
+		CHECK(CullMatches(planes, boxes, source));
+	}
+}
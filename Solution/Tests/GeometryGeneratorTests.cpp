@@ -0,0 +1,260 @@
+//***************************************************************************************
+// GeometryGeneratorTests.cpp
+//
+// GeometryGenerator::Subdivide.  The generators build subdivided shapes with
+// GenerateSubdivided, so these tests are what exercises the MeshData path.
+// GenerateBatch gives every shape exactly what Create would, and Generate
+// allocates nothing, including for the shapes whose tangent frames it derives.
+//***************************************************************************************
+
+#include "Test.h"
+#include "../../Common/GeometryGenerator.h"
+#include "../../Common/TangentSpace.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <tuple>
+
+using namespace DirectX;
+using uint32 = GeometryGenerator::uint32;
+using MeshData = GeometryGenerator::MeshData;
+
+namespace
+{
+	// Heap allocations by any thread since the test binary started.
+	std::atomic<size_t> gAllocations{ 0 };
+}
+
+void* operator new(size_t size)
+{
+	gAllocations++;
+	if(void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace
+{
+	// True when, after merging vertices at the same position, every edge of
+	// every triangle is matched by exactly one edge running the other way:
+	// the surface is closed and consistently wound.
+	bool IsWatertight(const MeshData& mesh)
+	{
+		std::map<std::tuple<float, float, float>, uint32> positions;
+		std::vector<uint32> welded(mesh.Vertices.size());
+		for(size_t i = 0; i < mesh.Vertices.size(); ++i)
+		{
+			const XMFLOAT3& p = mesh.Vertices[i].Position;
+			welded[i] = positions.emplace(std::make_tuple(p.x, p.y, p.z), (uint32)positions.size()).first->second;
+		}
+
+		std::map<std::pair<uint32, uint32>, int> edges;
+		for(size_t i = 0; i < mesh.Indices32.size(); i += 3)
+		{
+			for(int k = 0; k < 3; ++k)
+			{
+				uint32 a = welded[mesh.Indices32[i + k]];
+				uint32 b = welded[mesh.Indices32[i + (k + 1) % 3]];
+				if(a == b)
+					return false;
+
+				edges[std::make_pair(a, b)]++;
+			}
+		}
+
+		for(const auto& edge : edges)
+		{
+			auto twin = edges.find(std::make_pair(edge.first.second, edge.first.first));
+			if(edge.second != 1 || twin == edges.end() || twin->second != 1)
+				return false;
+		}
+
+		return true;
+	}
+
+	bool IndicesInRange(const MeshData& mesh)
+	{
+		for(uint32 i : mesh.Indices32)
+		{
+			if(i >= mesh.Vertices.size())
+				return false;
+		}
+
+		return true;
+	}
+}
+
+TEST(Subdivide_SharedIcosahedron)
+{
+	GeometryGenerator geoGen;
+
+	// The unsubdivided geosphere is the icosahedron: 12 vertices, 30 edges,
+	// 20 faces.  Each level adds a vertex per edge and splits each face in
+	// four, so V = 10*4^n + 2.
+	MeshData mesh = geoGen.CreateGeosphere(1.0f, 0);
+	CHECK(mesh.Vertices.size() == 12);
+	CHECK(mesh.Indices32.size() == 60);
+	CHECK(IsWatertight(mesh));
+
+	size_t vertexCount = 12;
+	for(uint32 n = 1; n <= 6; ++n)
+	{
+		geoGen.Subdivide(mesh, GeometryGenerator::SubdivideMode::Shared);
+
+		size_t faces = (size_t)20 << (2*n);
+		CHECK(mesh.Vertices.size() == 10*((size_t)1 << (2*n)) + 2);
+		CHECK(mesh.Indices32.size() == 3*faces);
+		CHECK(IndicesInRange(mesh));
+
+		// About 4x per level, against 6x for Split.
+		CHECK(mesh.Vertices.size() < 4*vertexCount);
+		vertexCount = mesh.Vertices.size();
+
+		if(n <= 4)
+			CHECK(IsWatertight(mesh));
+	}
+}
+
+TEST(Subdivide_SharedBox)
+{
+	GeometryGenerator geoGen;
+
+	// Each face of the box has its own four vertices, so faces subdivide
+	// separately: a face at level n is a (2^n + 1)^2 grid of vertices.
+	MeshData mesh = geoGen.CreateBox(1.0f, 2.0f, 3.0f, 0);
+	CHECK(mesh.Vertices.size() == 24);
+	CHECK(mesh.Indices32.size() == 36);
+	CHECK(IsWatertight(mesh));
+
+	for(uint32 n = 1; n <= 6; ++n)
+	{
+		geoGen.Subdivide(mesh, GeometryGenerator::SubdivideMode::Shared);
+
+		size_t side = ((size_t)1 << n) + 1;
+		CHECK(mesh.Vertices.size() == 6*side*side);
+		CHECK(mesh.Indices32.size() == 36*((size_t)1 << (2*n)));
+		CHECK(IndicesInRange(mesh));
+
+		// Neighbouring faces' midpoints land on the same positions, so the
+		// welded box stays closed.
+		if(n <= 4)
+			CHECK(IsWatertight(mesh));
+	}
+}
+
+TEST(Subdivide_SharedKeepsInputVertices)
+{
+	GeometryGenerator geoGen;
+
+	MeshData base = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0);
+	MeshData mesh = base;
+	geoGen.Subdivide(mesh, GeometryGenerator::SubdivideMode::Shared);
+
+	for(size_t i = 0; i < base.Vertices.size(); ++i)
+	{
+		CHECK(mesh.Vertices[i].Position.x == base.Vertices[i].Position.x);
+		CHECK(mesh.Vertices[i].Position.y == base.Vertices[i].Position.y);
+		CHECK(mesh.Vertices[i].Position.z == base.Vertices[i].Position.z);
+	}
+}
+
+TEST(Subdivide_Split)
+{
+	GeometryGenerator geoGen;
+
+	// Split mode emits six vertices per input triangle.
+	MeshData mesh = geoGen.CreateGeosphere(1.0f, 0);
+	geoGen.Subdivide(mesh, GeometryGenerator::SubdivideMode::Split);
+	CHECK(mesh.Vertices.size() == 6*20);
+	CHECK(mesh.Indices32.size() == 3*80);
+	CHECK(IndicesInRange(mesh));
+	CHECK(IsWatertight(mesh));
+}
+
+TEST(GenerateBatch_MatchesCreate)
+{
+	typedef GeometryGenerator::ShapeType ShapeType;
+	typedef GeometryGenerator::ShapeParams ShapeParams;
+
+	// Shapes of very different cost, so the pool's threads finish out of order.
+	GeometryGenerator::ShapeRequest requests[8];
+	requests[0].Shape = ShapeType::Sphere;    requests[0].Params = ShapeParams::Sphere(1.0f, 256, 256);
+	requests[1].Shape = ShapeType::Box;       requests[1].Params = ShapeParams::Box(1.0f, 2.0f, 3.0f, 1);
+	requests[2].Shape = ShapeType::Cone;      requests[2].Params = ShapeParams::Cone(1.0f, 2.0f, 24);
+	requests[3].Shape = ShapeType::Grid;      requests[3].Params = ShapeParams::Grid(10.0f, 10.0f, 200, 200);
+	requests[4].Shape = ShapeType::Pyramid;   requests[4].Params = ShapeParams::Pyramid(1.0f, 1.0f, 2);
+	requests[5].Shape = ShapeType::Geosphere; requests[5].Params = ShapeParams::Geosphere(1.0f, 4);
+	requests[6].Shape = ShapeType::Wedge;     requests[6].Params = ShapeParams::Wedge(1.0f, 1.0f, 1.0f, 0);
+	requests[7].Shape = ShapeType::Cylinder;  requests[7].Params = ShapeParams::Cylinder(1.0f, 0.5f, 3.0f, 32, 8);
+
+	GeometryGenerator geoGen;
+	MeshData batch = geoGen.GenerateBatch(requests, _countof(requests));
+
+	for(const GeometryGenerator::ShapeRequest& request : requests)
+	{
+		MeshData shape = geoGen.Create(request.Shape, request.Params);
+		CHECK(shape.Vertices.size() == request.VertexCount);
+		CHECK(shape.Indices32.size() == request.IndexCount);
+		CHECK(std::memcmp(shape.Vertices.data(), &batch.Vertices[request.BaseVertexLocation],
+			shape.Vertices.size()*sizeof(GeometryGenerator::Vertex)) == 0);
+		CHECK(std::memcmp(shape.Indices32.data(), &batch.Indices32[request.StartIndexLocation],
+			shape.Indices32.size()*sizeof(uint32)) == 0);
+	}
+}
+
+TEST(Generate_DoesNotAllocate)
+{
+	typedef GeometryGenerator::ShapeType ShapeType;
+	typedef GeometryGenerator::ShapeParams ShapeParams;
+
+	const struct { ShapeType Shape; ShapeParams Params; } shapes[] =
+	{
+		{ ShapeType::Box, ShapeParams::Box(1.0f, 2.0f, 3.0f, 3) },
+		{ ShapeType::Sphere, ShapeParams::Sphere(1.0f, 64, 32) },
+		{ ShapeType::Geosphere, ShapeParams::Geosphere(1.0f, 3) },
+		{ ShapeType::Cylinder, ShapeParams::Cylinder(1.0f, 0.5f, 3.0f, 32, 8) },
+		{ ShapeType::Grid, ShapeParams::Grid(10.0f, 10.0f, 20, 30) },
+		{ ShapeType::Cone, ShapeParams::Cone(1.0f, 2.0f, 24) },
+		{ ShapeType::Wedge, ShapeParams::Wedge(1.0f, 2.0f, 3.0f, 0) },
+		{ ShapeType::Torus, ShapeParams::Torus(1.0f, 0.25f, 32, 16) },
+		{ ShapeType::Pyramid, ShapeParams::Pyramid(1.0f, 1.0f, 6) },
+		{ ShapeType::Diamond, ShapeParams::Pyramid(1.0f, 2.0f, 3) },
+		{ ShapeType::Diamond1, ShapeParams::Pyramid(1.0f, 2.0f, 2) },
+	};
+
+	GeometryGenerator geoGen;
+	for(const auto& shape : shapes)
+	{
+		GeometryGenerator::MeshCounts counts = geoGen.QueryCounts(shape.Shape, shape.Params);
+		std::vector<GeometryGenerator::Vertex> vertices(counts.VertexCount);
+		std::vector<uint32> indices(counts.IndexCount);
+
+		size_t before = gAllocations;
+		geoGen.Generate(shape.Shape, shape.Params, vertices.data(), indices.data());
+		CHECK(gAllocations == before);
+
+		// The shapes with derived tangent frames get exactly those TangentSpace
+		// computes through its adjacency.
+		if(shape.Shape != ShapeType::Cone && shape.Shape != ShapeType::Wedge && shape.Shape != ShapeType::Pyramid &&
+			shape.Shape != ShapeType::Diamond && shape.Shape != ShapeType::Diamond1)
+			continue;
+
+		MeshData mesh;
+		mesh.Vertices = vertices;
+		mesh.Indices32 = indices;
+		TangentSpace::ComputeTangentFrames(mesh);
+		CHECK(std::memcmp(mesh.Vertices.data(), vertices.data(), vertices.size()*sizeof(GeometryGenerator::Vertex)) == 0);
+	}
+}
@@ -0,0 +1,318 @@
+//***************************************************************************************
+// IndexPackingTests.cpp
+//
+// IndexPacking::Pack on ranges just below, at and above MaxIndex16, rebased
+// ranges, and the MeshData regroup path.  Every packed result is unpacked
+// through its chunks' base vertices and must give back the source
+// triangles, with 0xffff never written as an index.
+//***************************************************************************************
+
+#include "Test.h"
+#include "../../Common/IndexPacking.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <random>
+
+using uint32 = IndexPacking::uint32;
+using IndexRange = IndexPacking::IndexRange;
+using Layout = IndexPacking::Layout;
+using Vertex = GeometryGenerator::Vertex;
+using MeshData = GeometryGenerator::MeshData;
+
+namespace
+{
+	// A list whose triangle t uses vertices first + t, first + t + 1 and
+	// first + t + 2, so any run of triangles spans its length plus two.
+	std::vector<uint32> Ribbon(uint32 vertexCount, uint32 first = 0)
+	{
+		std::vector<uint32> indices;
+		for(uint32 t = 0; t + 2 < vertexCount; ++t)
+		{
+			indices.push_back(first + t);
+			indices.push_back(first + t + 1);
+			indices.push_back(first + t + 2);
+		}
+
+		return indices;
+	}
+
+	// The vertex that index i of range r draws, after packing.
+	uint32 Unpacked(const IndexPacking::PackedIndices& packed, uint32 r, uint32 i)
+	{
+		for(uint32 c = packed.FirstChunk[r]; c < packed.FirstChunk[r + 1]; ++c)
+		{
+			const IndexRange& chunk = packed.Chunks[c];
+			if(i >= chunk.StartIndexLocation && i < chunk.StartIndexLocation + chunk.IndexCount)
+			{
+				uint32 index = packed.Format == DXGI_FORMAT_R16_UINT ? packed.Indices16[i] : packed.Indices32[i];
+				return index + (uint32)chunk.BaseVertexLocation;
+			}
+		}
+
+		return 0xffffffff;
+	}
+
+	// Checks that the chunks of every range cover it in order with whole
+	// triangles, and draw the same vertices as the source.
+	bool Unpacks(const IndexPacking::PackedIndices& packed, const std::vector<uint32>& indices,
+		const std::vector<IndexRange>& ranges)
+	{
+		if(packed.FirstChunk.size() != ranges.size() + 1 || packed.FirstChunk.back() != packed.Chunks.size())
+			return false;
+
+		size_t count = packed.Format == DXGI_FORMAT_R16_UINT ? packed.Indices16.size() : packed.Indices32.size();
+		if(count != indices.size())
+			return false;
+
+		for(uint16_t index : packed.Indices16)
+		{
+			if(index == 0xffff)
+				return false;
+		}
+
+		for(uint32 r = 0; r < (uint32)ranges.size(); ++r)
+		{
+			uint32 next = ranges[r].StartIndexLocation;
+			for(uint32 c = packed.FirstChunk[r]; c < packed.FirstChunk[r + 1]; ++c)
+			{
+				if(packed.Chunks[c].StartIndexLocation != next || packed.Chunks[c].IndexCount % 3 != 0)
+					return false;
+				next += packed.Chunks[c].IndexCount;
+			}
+
+			if(next != ranges[r].StartIndexLocation + ranges[r].IndexCount)
+				return false;
+
+			for(uint32 i = ranges[r].StartIndexLocation; i < next; ++i)
+			{
+				if(Unpacked(packed, r, i) != indices[i] + (uint32)ranges[r].BaseVertexLocation)
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	IndexRange Range(uint32 indexCount, uint32 startIndex = 0, std::int32_t baseVertex = 0)
+	{
+		IndexRange range;
+		range.IndexCount = indexCount;
+		range.StartIndexLocation = startIndex;
+		range.BaseVertexLocation = baseVertex;
+		return range;
+	}
+
+	// Vertices with distinct positions, so a copy is recognisable.
+	MeshData Numbered(uint32 vertexCount)
+	{
+		MeshData mesh;
+		mesh.Vertices.resize(vertexCount);
+		for(uint32 v = 0; v < vertexCount; ++v)
+			mesh.Vertices[v] = Vertex((float)v, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+
+		return mesh;
+	}
+}
+
+TEST(IndexPacking_SplitAtMaxIndex16)
+{
+	const uint32 limit = IndexPacking::MaxIndex16;
+
+	// Indices 0 to MaxIndex16 fit in one 16-bit draw.
+	std::vector<uint32> below = Ribbon(limit + 1);
+	std::vector<IndexRange> ranges = { Range((uint32)below.size()) };
+	IndexPacking::PackedIndices packed = IndexPacking::Pack(below, ranges);
+	CHECK(packed.Result == Layout::Index16);
+	CHECK(packed.Chunks.size() == 1 && packed.Chunks[0].BaseVertexLocation == 0);
+	CHECK(Unpacks(packed, below, ranges));
+
+	// One more vertex and index 0xffff would be written, so the range splits
+	// and the second chunk starts on a triangle boundary.
+	std::vector<uint32> at = Ribbon(limit + 2);
+	ranges = { Range((uint32)at.size()) };
+	packed = IndexPacking::Pack(at, ranges);
+	CHECK(packed.Result == Layout::Split16);
+	CHECK(packed.Chunks.size() == 2);
+	CHECK(Unpacks(packed, at, ranges));
+
+	// Every chunk spans at most MaxIndex16, and is as long as that allows.
+	std::vector<uint32> above = Ribbon(3*limit);
+	ranges = { Range((uint32)above.size()) };
+	packed = IndexPacking::Pack(above, ranges);
+	CHECK(packed.Result == Layout::Split16);
+	CHECK(packed.Chunks.size() == 4);
+	CHECK(Unpacks(packed, above, ranges));
+	for(size_t c = 0; c + 1 < packed.Chunks.size(); ++c)
+		CHECK(packed.Chunks[c].IndexCount == 3*(limit - 1));
+
+	// Too many chunks, or a single triangle spanning more than MaxIndex16,
+	// leave the ranges as they are in 32 bits.
+	packed = IndexPacking::Pack(above, ranges, 3);
+	CHECK(packed.Result == Layout::Index32 && packed.Format == DXGI_FORMAT_R32_UINT);
+	CHECK(packed.Indices32 == above && packed.Chunks.size() == 1);
+	CHECK(Unpacks(packed, above, ranges));
+
+	std::vector<uint32> wide = { 0, limit + 1, 1,   1, 2, 3 };
+	ranges = { Range(6) };
+	packed = IndexPacking::Pack(wide, ranges);
+	CHECK(packed.Result == Layout::Index32);
+	CHECK(Unpacks(packed, wide, ranges));
+
+	std::vector<uint32> widest = { 0, limit, 1 };
+	ranges = { Range(3) };
+	packed = IndexPacking::Pack(widest, ranges);
+	CHECK(packed.Result == Layout::Index16);
+	CHECK(Unpacks(packed, widest, ranges));
+}
+
+TEST(IndexPacking_Rebase)
+{
+	// Ranges far above 16 bits, with their own base vertices and a gap of
+	// indices between them that belongs to no range.
+	std::vector<uint32> indices = Ribbon(1000, 200000);
+	uint32 firstCount = (uint32)indices.size();
+
+	std::vector<uint32> gap = { 7, 8, 9 };
+	indices.insert(indices.end(), gap.begin(), gap.end());
+
+	std::vector<uint32> second = Ribbon(IndexPacking::MaxIndex16 + 500, 70000);
+	uint32 secondStart = (uint32)indices.size();
+	indices.insert(indices.end(), second.begin(), second.end());
+
+	std::vector<IndexRange> ranges =
+	{
+		Range(firstCount, 0, 12),
+		Range((uint32)second.size(), secondStart, 5000)
+	};
+
+	IndexPacking::PackedIndices packed = IndexPacking::Pack(indices, ranges);
+	CHECK(packed.Result == Layout::Split16);
+	CHECK(packed.FirstChunk == std::vector<uint32>({ 0, 1, 3 }));
+	CHECK(packed.Chunks.size() == 3 && packed.Chunks[0].BaseVertexLocation == 200012);
+	CHECK(packed.Chunks.size() == 3 && packed.Chunks[1].BaseVertexLocation == 75000);
+	CHECK(Unpacks(packed, indices, ranges));
+
+	// Indices outside the ranges are copied, not rebased.
+	CHECK(packed.Indices16.size() == indices.size());
+	for(uint32 i = 0; i < 3 && packed.Indices16.size() == indices.size(); ++i)
+		CHECK(packed.Indices16[firstCount + i] == gap[i]);
+
+	// A gap index that does not fit in 16 bits forces 32 bits.
+	indices[firstCount] = 0x10000;
+	packed = IndexPacking::Pack(indices, ranges);
+	CHECK(packed.Result == Layout::Index32);
+	CHECK(Unpacks(packed, indices, ranges));
+
+	// The whole-buffer overload neither rebases nor splits, and keeps strip
+	// cuts as 0xffff.
+	std::vector<uint32> strip = { 0, 1, 2, GeometryGenerator::StripRestart, 3, IndexPacking::MaxIndex16 };
+	packed = IndexPacking::Pack(strip);
+	CHECK(packed.Result == Layout::Index16 && packed.Indices16.size() == strip.size());
+	CHECK(packed.Indices16.size() == strip.size() && packed.Indices16[3] == 0xffff &&
+		packed.Indices16[5] == IndexPacking::MaxIndex16);
+
+	strip.back() = IndexPacking::MaxIndex16 + 1;
+	packed = IndexPacking::Pack(strip);
+	CHECK(packed.Result == Layout::Index32 && packed.Indices32 == strip);
+}
+
+TEST(IndexPacking_MeshRegroup)
+{
+	std::mt19937 rng(7);
+
+	// Disjoint triangles over shuffled vertices: every triangle spans most of
+	// the mesh, so only regrouping the vertices can reach 16 bits.  A chunk
+	// holds MaxIndex16 + 1 vertices, i.e. 21845 of these triangles.
+	const uint32 trianglesPerChunk = (IndexPacking::MaxIndex16 + 1) / 3;
+
+	for(uint32 triangleCount : { trianglesPerChunk, trianglesPerChunk + 1, 2*trianglesPerChunk + 7 })
+	{
+		uint32 vertexCount = 3*triangleCount;
+		MeshData mesh = Numbered(vertexCount);
+		mesh.Indices32.resize(vertexCount);
+		std::iota(mesh.Indices32.begin(), mesh.Indices32.end(), 0u);
+		std::shuffle(mesh.Indices32.begin(), mesh.Indices32.end(), rng);
+
+		// The first triangle uses the first and last vertex.
+		std::swap(mesh.Indices32[0], *std::find(mesh.Indices32.begin(), mesh.Indices32.end(), 0u));
+		std::swap(mesh.Indices32[1], *std::find(mesh.Indices32.begin(), mesh.Indices32.end(), vertexCount - 1));
+
+		const MeshData source = mesh;
+		IndexPacking::PackedIndices packed = IndexPacking::Pack(mesh);
+
+		// Up to MaxIndex16 + 1 vertices the indices fit as they are.
+		uint32 chunkCount = (triangleCount + trianglesPerChunk - 1) / trianglesPerChunk;
+		CHECK(packed.Result == (chunkCount == 1 ? Layout::Index16 : Layout::Split16));
+		CHECK(packed.Chunks.size() == chunkCount);
+		CHECK(packed.Indices16.size() == source.Indices32.size());
+		CHECK(mesh.Indices32.size() == source.Indices32.size());
+
+		std::vector<IndexRange> ranges = { Range((uint32)mesh.Indices32.size()) };
+		CHECK(Unpacks(packed, mesh.Indices32, ranges));
+
+		// Every triangle draws the same vertices, bit for bit, as before.
+		bool same = true;
+		for(size_t i = 0; i < source.Indices32.size() && i < mesh.Indices32.size(); ++i)
+		{
+			uint32 v = mesh.Indices32[i];
+			same = same && v < mesh.Vertices.size() &&
+				std::memcmp(&mesh.Vertices[v], &source.Vertices[source.Indices32[i]], sizeof(Vertex)) == 0;
+		}
+		CHECK(same);
+
+		// Full chunks use every 16-bit index up to MaxIndex16.
+		for(size_t c = 0; c < packed.Chunks.size() && packed.Indices16.size() == mesh.Indices32.size(); ++c)
+		{
+			const IndexRange& chunk = packed.Chunks[c];
+			uint32 hi = 0;
+			for(uint32 i = chunk.StartIndexLocation; i < chunk.StartIndexLocation + chunk.IndexCount; ++i)
+				hi = std::max<uint32>(hi, packed.Indices16[i]);
+
+			if(c + 1 < packed.Chunks.size())
+				CHECK(hi == IndexPacking::MaxIndex16);
+		}
+	}
+
+	// A ribbon over shuffled vertices adds one vertex per triangle, so the
+	// first chunk fills to exactly MaxIndex16 + 1 vertices.
+	{
+		uint32 vertexCount = IndexPacking::MaxIndex16 + 1000;
+		std::vector<uint32> order(vertexCount);
+		std::iota(order.begin(), order.end(), 0u);
+		std::shuffle(order.begin(), order.end(), rng);
+
+		MeshData mesh = Numbered(vertexCount);
+		for(uint32 index : Ribbon(vertexCount))
+			mesh.Indices32.push_back(order[index]);
+
+		const MeshData source = mesh;
+		IndexPacking::PackedIndices packed = IndexPacking::Pack(mesh);
+		CHECK(packed.Result == Layout::Split16);
+		CHECK(packed.Chunks.size() == 2);
+		CHECK(packed.Chunks.size() == 2 && packed.Chunks[1].BaseVertexLocation == (std::int32_t)IndexPacking::MaxIndex16 + 1);
+
+		std::vector<IndexRange> ranges = { Range((uint32)mesh.Indices32.size()) };
+		CHECK(Unpacks(packed, mesh.Indices32, ranges));
+
+		bool same = mesh.Indices32.size() == source.Indices32.size();
+		for(size_t i = 0; same && i < source.Indices32.size(); ++i)
+		{
+			uint32 v = mesh.Indices32[i];
+			same = v < mesh.Vertices.size() &&
+				std::memcmp(&mesh.Vertices[v], &source.Vertices[source.Indices32[i]], sizeof(Vertex)) == 0;
+		}
+		CHECK(same);
+	}
+
+	// Past maxChunks the mesh is left alone in 32 bits.
+	MeshData mesh = Numbered(3*(2*trianglesPerChunk + 7));
+	mesh.Indices32.resize(mesh.Vertices.size());
+	std::iota(mesh.Indices32.begin(), mesh.Indices32.end(), 0u);
+	std::swap(mesh.Indices32[1], mesh.Indices32.back());
+
+	const MeshData source = mesh;
+	IndexPacking::PackedIndices packed = IndexPacking::Pack(mesh, 2);
+	CHECK(packed.Result == Layout::Index32);
+	CHECK(mesh.Indices32 == source.Indices32 && mesh.Vertices.size() == source.Vertices.size());
+}
@@ -0,0 +1,281 @@
+//***************************************************************************************
+// MeshFileTests.cpp
+//
+// MeshFile::Write followed by MeshFile::Open gives back the same vertices,
+// indices, submeshes, LODs and bounds, and Open rejects files that are
+// truncated, whose sections or records point outside the file, or whose
+// names are not NUL terminated.
+//***************************************************************************************
+
+#include "Test.h"
+#include "../../Common/MeshFile.h"
+#include "../../Common/GeometryGenerator.h"
+#include <cfloat>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace DirectX;
+using uint32 = MeshFile::uint32;
+using uint64 = MeshFile::uint64;
+using Vertex = GeometryGenerator::Vertex;
+using MeshData = GeometryGenerator::MeshData;
+
+namespace
+{
+	const char* FileName = "MeshFileTests.mesh";
+	const wchar_t* WideFileName = L"MeshFileTests.mesh";
+
+	// A box and a sphere in one buffer; the sphere has one coarser LOD.
+	struct TestMesh
+	{
+		MeshData Mesh;
+		std::vector<std::uint16_t> Indices16;
+		GeometryGenerator::ShapeRequest Requests[2];
+		MeshFile::MeshDesc Desc;
+	};
+
+	void BuildTestMesh(TestMesh& t, uint32 indexSize)
+	{
+		GeometryGenerator geoGen;
+		t.Requests[0].Shape = GeometryGenerator::ShapeType::Box;
+		t.Requests[0].Params = GeometryGenerator::ShapeParams::Box(2.0f, 1.0f, 1.0f, 2);
+		t.Requests[1].Shape = GeometryGenerator::ShapeType::Sphere;
+		t.Requests[1].Params = GeometryGenerator::ShapeParams::Sphere(3.0f, 20, 20);
+		t.Mesh = geoGen.GenerateBatch(t.Requests, 2);
+		t.Indices16 = t.Mesh.GetIndices16();
+
+		MeshFile::MeshDesc& d = t.Desc;
+		d.Vertices = t.Mesh.Vertices.data();
+		d.VertexCount = (uint32)t.Mesh.Vertices.size();
+		d.VertexStride = sizeof(Vertex);
+		d.IndexSize = indexSize;
+		d.IndexCount = (uint32)t.Mesh.Indices32.size();
+		d.Indices = indexSize == 2 ? (const void*)t.Indices16.data() : (const void*)t.Mesh.Indices32.data();
+
+		const char* names[] = { "box", "sphere" };
+		for(int i = 0; i < 2; ++i)
+		{
+			MeshFile::SubmeshDesc s;
+			s.Name = names[i];
+			s.IndexCount = t.Requests[i].IndexCount;
+			s.StartIndexLocation = t.Requests[i].StartIndexLocation;
+			s.BaseVertexLocation = t.Requests[i].BaseVertexLocation;
+			d.Submeshes.push_back(s);
+		}
+
+		MeshFile::LodRecord lod;
+		lod.IndexCount = t.Requests[1].IndexCount / 2 / 3 * 3;
+		lod.StartIndexLocation = t.Requests[1].StartIndexLocation;
+		lod.BaseVertexLocation = t.Requests[1].BaseVertexLocation;
+		lod.Error = 0.25f;
+		d.Submeshes[1].Lods.push_back(lod);
+	}
+
+	std::vector<char> ReadBytes()
+	{
+		std::ifstream fin(FileName, std::ios::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	}
+
+	void WriteBytes(const std::vector<char>& bytes)
+	{
+		std::ofstream fout(FileName, std::ios::binary | std::ios::trunc);
+		fout.write(bytes.data(), (std::streamsize)bytes.size());
+	}
+
+	MeshFile::FileHeader& Header(std::vector<char>& bytes)
+	{
+		return *reinterpret_cast<MeshFile::FileHeader*>(bytes.data());
+	}
+
+	MeshFile::SubmeshRecord& Submesh(std::vector<char>& bytes, uint32 i)
+	{
+		return reinterpret_cast<MeshFile::SubmeshRecord*>(bytes.data() + Header(bytes).SubmeshOffset)[i];
+	}
+
+	// True if Open accepts the file after corrupt has edited its bytes.
+	template<typename Fn>
+	bool OpensAfter(const std::vector<char>& valid, Fn&& corrupt)
+	{
+		std::vector<char> bytes = valid;
+		corrupt(bytes);
+		WriteBytes(bytes);
+
+		MeshFile file;
+		bool opened = file.Open(WideFileName);
+		CHECK(opened == file.IsOpen());
+		return opened;
+	}
+
+	BoundingBox Bounds(const Vertex* vertices, uint32 count)
+	{
+		XMVECTOR vMin = XMVectorReplicate(+FLT_MAX);
+		XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+		for(uint32 i = 0; i < count; ++i)
+		{
+			vMin = XMVectorMin(vMin, XMLoadFloat3(&vertices[i].Position));
+			vMax = XMVectorMax(vMax, XMLoadFloat3(&vertices[i].Position));
+		}
+
+		BoundingBox bounds;
+		BoundingBox::CreateFromPoints(bounds, vMin, vMax);
+		return bounds;
+	}
+
+	bool SameBox(const DirectX::BoundingBox& a, const DirectX::BoundingBox& b)
+	{
+		return std::memcmp(&a.Center, &b.Center, sizeof(a.Center)) == 0 &&
+			std::memcmp(&a.Extents, &b.Extents, sizeof(a.Extents)) == 0;
+	}
+}
+
+TEST(MeshFile_RoundTrip)
+{
+	for(uint32 indexSize : { 2u, 4u })
+	{
+		TestMesh t;
+		BuildTestMesh(t, indexSize);
+		CHECK(MeshFile::Write(WideFileName, t.Desc));
+
+		MeshFile file;
+		CHECK(file.Open(WideFileName));
+		if(!file.IsOpen())
+			continue;
+
+		CHECK(file.GetFileSize() == ReadBytes().size());
+
+		CHECK(file.GetVertexCount() == t.Mesh.Vertices.size());
+		CHECK(file.GetVertexStride() == sizeof(Vertex));
+		CHECK(file.GetVertices<Vertex>() != nullptr);
+		CHECK(std::memcmp(file.GetVertexData(), t.Mesh.Vertices.data(), t.Mesh.Vertices.size()*sizeof(Vertex)) == 0);
+		CHECK(reinterpret_cast<std::uintptr_t>(file.GetVertexData()) % MeshFile::SectionAlignment == 0);
+
+		CHECK(file.GetIndexCount() == t.Mesh.Indices32.size());
+		CHECK(file.GetIndexSize() == indexSize);
+		CHECK((file.GetIndices16() != nullptr) == (indexSize == 2));
+		CHECK((file.GetIndices32() != nullptr) == (indexSize == 4));
+		CHECK(std::memcmp(file.GetIndexData(), t.Desc.Indices, (size_t)t.Desc.IndexCount*indexSize) == 0);
+
+		CHECK(SameBox(file.GetBounds(), Bounds(t.Mesh.Vertices.data(), (uint32)t.Mesh.Vertices.size())));
+
+		CHECK(file.GetSubmeshCount() == 2);
+		for(uint32 i = 0; i < 2 && i < file.GetSubmeshCount(); ++i)
+		{
+			const MeshFile::SubmeshDesc& src = t.Desc.Submeshes[i];
+			const MeshFile::SubmeshRecord& submesh = file.GetSubmeshes()[i];
+
+			CHECK(file.FindSubmesh(src.Name) == &submesh);
+			CHECK(std::strcmp(file.GetSubmeshName(submesh), src.Name.c_str()) == 0);
+			CHECK(submesh.NameLength == src.Name.size());
+			CHECK(submesh.IndexCount == src.IndexCount);
+			CHECK(submesh.StartIndexLocation == src.StartIndexLocation);
+			CHECK(submesh.BaseVertexLocation == src.BaseVertexLocation);
+			CHECK(submesh.LodCount == src.Lods.size());
+
+			// Submesh bounds cover the vertices the submesh draws.
+			const GeometryGenerator::ShapeRequest& r = t.Requests[i];
+			CHECK(SameBox(submesh.Bounds, Bounds(&t.Mesh.Vertices[r.BaseVertexLocation], r.VertexCount)));
+
+			const MeshFile::LodRecord* lods = file.GetLods(submesh);
+			for(uint32 l = 0; l < submesh.LodCount && l < src.Lods.size(); ++l)
+			{
+				CHECK(lods[l].IndexCount == src.Lods[l].IndexCount);
+				CHECK(lods[l].StartIndexLocation == src.Lods[l].StartIndexLocation);
+				CHECK(lods[l].BaseVertexLocation == src.Lods[l].BaseVertexLocation);
+				CHECK(lods[l].Error == src.Lods[l].Error);
+			}
+		}
+
+		CHECK(file.FindSubmesh("sphe") == nullptr);
+		CHECK(file.FindSubmesh("spheres") == nullptr);
+	}
+
+	std::remove(FileName);
+}
+
+TEST(MeshFile_WriteRejectsBadDesc)
+{
+	TestMesh t;
+	BuildTestMesh(t, 2);
+
+	MeshFile::MeshDesc desc = t.Desc;
+	desc.Submeshes[0].IndexCount = desc.IndexCount + 3;
+	CHECK(!MeshFile::Write(WideFileName, desc));
+
+	desc = t.Desc;
+	desc.Submeshes[1].Lods[0].BaseVertexLocation = (std::int32_t)desc.VertexCount;
+	CHECK(!MeshFile::Write(WideFileName, desc));
+
+	desc = t.Desc;
+	desc.IndexSize = 3;
+	CHECK(!MeshFile::Write(WideFileName, desc));
+
+	CHECK(!MeshFile::Write(L"MeshFileTests.missing/MeshFileTests.mesh", t.Desc));
+
+	std::remove(FileName);
+}
+
+TEST(MeshFile_OpenRejectsCorruptFiles)
+{
+	TestMesh t;
+	BuildTestMesh(t, 2);
+	CHECK(MeshFile::Write(WideFileName, t.Desc));
+
+	const std::vector<char> valid = ReadBytes();
+	CHECK(valid.size() > sizeof(MeshFile::FileHeader));
+	if(valid.size() <= sizeof(MeshFile::FileHeader))
+		return;
+
+	CHECK(OpensAfter(valid, [](std::vector<char>&) {}));
+
+	{
+		MeshFile file;
+		CHECK(!file.Open(L"MeshFileTests.missing.mesh"));
+	}
+
+	// Header fields.
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Header(b).Magic++; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Header(b).Version++; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Header(b).HeaderSize--; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Header(b).VertexStride = 0; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Header(b).IndexSize = 3; }));
+
+	// Truncated anywhere, from inside the header to the last name byte.
+	const MeshFile::FileHeader& header = *reinterpret_cast<const MeshFile::FileHeader*>(valid.data());
+	const uint64 lengths[] = { 0, sizeof(MeshFile::FileHeader) - 1, sizeof(MeshFile::FileHeader),
+		header.IndexOffset, valid.size() - 1 };
+	for(uint64 length : lengths)
+		CHECK(!OpensAfter(valid, [&](std::vector<char>& b) { b.resize((size_t)length); }));
+
+	// Sections that start or end past the end of the file, or off alignment.
+	const uint64 size = valid.size();
+	CHECK(!OpensAfter(valid, [&](std::vector<char>& b) { Header(b).VertexOffset = size + MeshFile::SectionAlignment; }));
+	CHECK(!OpensAfter(valid, [&](std::vector<char>& b) { Header(b).IndexOffset = ~uint64(MeshFile::SectionAlignment - 1); }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Header(b).NameOffset += 1; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Header(b).VertexCount = 0xffffffffu; }));
+	CHECK(!OpensAfter(valid, [&](std::vector<char>& b) { Header(b).IndexCount = (uint32)size; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Header(b).SubmeshCount = 0x10000000u; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Header(b).LodCount = 0x10000000u; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Header(b).NameBytes += 1; }));
+
+	// Records that point outside their sections.
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Submesh(b, 0).StartIndexLocation = Header(b).IndexCount; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Submesh(b, 1).FirstLod = Header(b).LodCount; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Submesh(b, 1).LodCount++; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Submesh(b, 1).NameOffset = Header(b).NameBytes; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b)
+	{
+		MeshFile::LodRecord* lods = reinterpret_cast<MeshFile::LodRecord*>(b.data() + Header(b).LodOffset);
+		lods[0].StartIndexLocation = Header(b).IndexCount - 1;
+	}));
+
+	// Names without their NUL terminator.
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { b[Header(b).NameOffset + Header(b).NameBytes - 1] = 'x'; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Submesh(b, 0).NameLength++; }));
+	CHECK(!OpensAfter(valid, [](std::vector<char>& b) { Submesh(b, 0).NameLength--; }));
+
+	std::remove(FileName);
+}
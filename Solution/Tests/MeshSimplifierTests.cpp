@@ -0,0 +1,318 @@
+//***************************************************************************************
+// MeshSimplifierTests.cpp
+//
+// MeshSimplifier::Simplify on meshes with UV seams (sphere, box) and open
+// borders (grids): seam vertices survive unchanged, the border outline keeps
+// its shape, no triangle turns over, and the result stops at the triangle
+// target or the error limit.
+//***************************************************************************************
+
+#include "Test.h"
+#include "../../Common/MeshSimplifier.h"
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <set>
+#include <tuple>
+
+using namespace DirectX;
+using uint32 = MeshSimplifier::uint32;
+using Vertex = GeometryGenerator::Vertex;
+using MeshData = GeometryGenerator::MeshData;
+
+namespace
+{
+	typedef std::tuple<float, float, float> PositionKey;
+
+	PositionKey Key(const XMFLOAT3& p)
+	{
+		return std::make_tuple(p.x, p.y, p.z);
+	}
+
+	bool SameVertex(const Vertex& a, const Vertex& b)
+	{
+		return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+	}
+
+	// Vertices that share their position with another vertex: the copies
+	// along UV seams and hard edges.
+	std::vector<uint32> SeamVertices(const MeshData& mesh)
+	{
+		std::map<PositionKey, int> counts;
+		for(const Vertex& v : mesh.Vertices)
+			counts[Key(v.Position)]++;
+
+		std::vector<uint32> seams;
+		for(uint32 i = 0; i < (uint32)mesh.Vertices.size(); ++i)
+		{
+			if(counts[Key(mesh.Vertices[i].Position)] > 1)
+				seams.push_back(i);
+		}
+
+		return seams;
+	}
+
+	bool Contains(const MeshData& mesh, const Vertex& v)
+	{
+		for(const Vertex& w : mesh.Vertices)
+		{
+			if(SameVertex(v, w))
+				return true;
+		}
+
+		return false;
+	}
+
+	// Every vertex of simplified is, bit for bit, a vertex of source.
+	bool NoVertexMoved(const MeshData& source, const MeshData& simplified)
+	{
+		for(const Vertex& v : simplified.Vertices)
+		{
+			if(!Contains(source, v))
+				return false;
+		}
+
+		return true;
+	}
+
+	bool IndicesInRange(const MeshData& mesh)
+	{
+		for(uint32 i : mesh.Indices32)
+		{
+			if(i >= mesh.Vertices.size())
+				return false;
+		}
+
+		return mesh.Indices32.size() % 3 == 0;
+	}
+
+	XMVECTOR TriangleNormal(const MeshData& mesh, size_t i)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&mesh.Vertices[mesh.Indices32[i + 0]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&mesh.Vertices[mesh.Indices32[i + 1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&mesh.Vertices[mesh.Indices32[i + 2]].Position);
+
+		return XMVector3Cross(p1 - p0, p2 - p0);
+	}
+
+	// Number of triangles whose winding disagrees with the shading normals of
+	// their corners, i.e. that face away from the surface they approximate.
+	// In the generators' meshes cross(p1 - p0, p2 - p0) of every triangle
+	// points along its vertex normals.
+	int CountFlipped(const MeshData& mesh)
+	{
+		int flipped = 0;
+		for(size_t i = 0; i < mesh.Indices32.size(); i += 3)
+		{
+			XMVECTOR normals = XMVectorZero();
+			for(int c = 0; c < 3; ++c)
+				normals += XMLoadFloat3(&mesh.Vertices[mesh.Indices32[i + c]].Normal);
+
+			if(XMVectorGetX(XMVector3Dot(TriangleNormal(mesh, i), normals)) <= 0.0f)
+				flipped++;
+		}
+
+		return flipped;
+	}
+
+	float SurfaceArea(const MeshData& mesh)
+	{
+		float area = 0.0f;
+		for(size_t i = 0; i < mesh.Indices32.size(); i += 3)
+			area += 0.5f*XMVectorGetX(XMVector3Length(TriangleNormal(mesh, i)));
+
+		return area;
+	}
+
+	// A grid bent into a paraboloid, so its border curves at every vertex.
+	MeshData Bowl()
+	{
+		GeometryGenerator geoGen;
+		MeshData grid = geoGen.CreateGrid(160.0f, 160.0f, 41, 41);
+		for(Vertex& v : grid.Vertices)
+			v.Position.y = (v.Position.x*v.Position.x + v.Position.z*v.Position.z) / 320.0f;
+
+		return grid;
+	}
+
+	// Signed area of the triangles projected onto the xz plane, and whether
+	// any of them is turned over.
+	float ProjectedArea(const MeshData& mesh, bool& reversed)
+	{
+		reversed = false;
+
+		float area = 0.0f;
+		for(size_t i = 0; i < mesh.Indices32.size(); i += 3)
+		{
+			float cross = XMVectorGetY(TriangleNormal(mesh, i));
+			reversed = reversed || cross < 0.0f;
+			area += 0.5f*cross;
+		}
+
+		return area;
+	}
+
+	// Vertices on the outline of a grid of the given size centered on the origin.
+	bool OnGridBorder(const XMFLOAT3& p, float width, float depth)
+	{
+		return fabsf(p.x) == 0.5f*width || fabsf(p.z) == 0.5f*depth;
+	}
+}
+
+TEST(MeshSimplifier_SphereSeams)
+{
+	GeometryGenerator geoGen;
+	MeshData sphere = geoGen.CreateSphere(1.0f, 40, 40);
+	uint32 sourceTriangles = (uint32)sphere.Indices32.size() / 3;
+
+	std::vector<uint32> seams = SeamVertices(sphere);
+	CHECK(!seams.empty());
+	CHECK(CountFlipped(sphere) == 0);
+
+	for(uint32 target : { sourceTriangles / 2, sourceTriangles / 8, 100u })
+	{
+		float error = -1.0f;
+		MeshData simplified = MeshSimplifier::Simplify(sphere, target, 1.0f, &error);
+
+		CHECK(IndicesInRange(simplified));
+		CHECK(simplified.Indices32.size() / 3 <= target);
+		CHECK(error >= 0.0f && error <= 1.0f);
+
+		CHECK(NoVertexMoved(sphere, simplified));
+		for(uint32 s : seams)
+			CHECK(Contains(simplified, sphere.Vertices[s]));
+
+		CHECK(CountFlipped(simplified) == 0);
+	}
+}
+
+TEST(MeshSimplifier_ErrorLimit)
+{
+	GeometryGenerator geoGen;
+	MeshData sphere = geoGen.CreateSphere(1.0f, 40, 40);
+
+	// A tight limit stops well short of an unreachable target.
+	for(float maxError : { 0.005f, 0.02f })
+	{
+		float error = -1.0f;
+		MeshData simplified = MeshSimplifier::Simplify(sphere, 10, maxError, &error);
+
+		CHECK(simplified.Indices32.size() / 3 > 10);
+		CHECK(simplified.Indices32.size() < sphere.Indices32.size());
+		CHECK(error > 0.0f && error <= maxError);
+		CHECK(CountFlipped(simplified) == 0);
+	}
+
+	// A target at or above the triangle count returns the mesh unchanged.
+	float error = -1.0f;
+	MeshData same = MeshSimplifier::Simplify(sphere, (uint32)sphere.Indices32.size() / 3, 1.0f, &error);
+	CHECK(same.Indices32 == sphere.Indices32);
+	CHECK(same.Vertices.size() == sphere.Vertices.size());
+	CHECK(error == 0.0f);
+}
+
+TEST(MeshSimplifier_BoxSeams)
+{
+	// Every vertex on a box edge is a seam between two or three faces, so only
+	// the face interiors simplify and the faces stay flat.
+	GeometryGenerator geoGen;
+	MeshData box = geoGen.CreateBox(1.0f, 2.0f, 3.0f, 3);
+	std::vector<uint32> seams = SeamVertices(box);
+
+	float error = -1.0f;
+	MeshData simplified = MeshSimplifier::Simplify(box, 12, 1.0f, &error);
+
+	CHECK(IndicesInRange(simplified));
+	CHECK(simplified.Indices32.size() < box.Indices32.size());
+	CHECK(error == 0.0f);
+
+	CHECK(NoVertexMoved(box, simplified));
+	for(uint32 s : seams)
+		CHECK(Contains(simplified, box.Vertices[s]));
+
+	CHECK(CountFlipped(simplified) == 0);
+	CHECK(fabsf(SurfaceArea(simplified) - 22.0f) <= 1e-3f);
+}
+
+TEST(MeshSimplifier_StraightBorderSlides)
+{
+	// A flat grid simplifies without error; vertices along its straight
+	// borders may slide, but the outline and its corners stay.
+	GeometryGenerator geoGen;
+	MeshData grid = geoGen.CreateGrid(160.0f, 160.0f, 41, 41);
+
+	for(float maxError : { 0.001f, 1.0f })
+	{
+		float error = -1.0f;
+		MeshData simplified = MeshSimplifier::Simplify(grid, 2, maxError, &error);
+
+		CHECK(IndicesInRange(simplified));
+		CHECK(simplified.Indices32.size() / 3 <= 8);
+		CHECK(error == 0.0f);
+		CHECK(NoVertexMoved(grid, simplified));
+
+		bool reversed = true;
+		CHECK(fabsf(ProjectedArea(simplified, reversed) - 160.0f*160.0f) <= 0.01f);
+		CHECK(!reversed);
+
+		std::set<PositionKey> positions;
+		for(const Vertex& v : simplified.Vertices)
+			positions.insert(Key(v.Position));
+
+		for(float x : { -80.0f, 80.0f })
+		{
+			for(float z : { -80.0f, 80.0f })
+				CHECK(positions.count(std::make_tuple(x, 0.0f, z)) == 1);
+		}
+	}
+}
+
+TEST(MeshSimplifier_CurvedBorderLocked)
+{
+	// A bowl's border turns at every vertex, so none of it may move:
+	// every border vertex survives and the projected outline is unchanged.
+	MeshData bowl = Bowl();
+
+	for(float maxError : { 0.005f, 0.02f, 1.0f })
+	{
+		float error = -1.0f;
+		MeshData simplified = MeshSimplifier::Simplify(bowl, 200, maxError, &error);
+
+		CHECK(IndicesInRange(simplified));
+		CHECK(simplified.Indices32.size() < bowl.Indices32.size());
+		CHECK(error <= maxError);
+		CHECK(NoVertexMoved(bowl, simplified));
+
+		for(const Vertex& v : bowl.Vertices)
+		{
+			if(OnGridBorder(v.Position, 160.0f, 160.0f))
+				CHECK(Contains(simplified, v));
+		}
+
+		bool reversed = true;
+		CHECK(fabsf(ProjectedArea(simplified, reversed) - 160.0f*160.0f) <= 0.01f);
+		CHECK(!reversed);
+	}
+}
+
+TEST(MeshSimplifier_LodChain)
+{
+	GeometryGenerator geoGen;
+	MeshData sphere = geoGen.CreateSphere(1.0f, 40, 40);
+	size_t sourceTriangles = sphere.Indices32.size() / 3;
+
+	const std::vector<float> ratios = { 1.0f, 0.5f, 0.25f, 0.1f };
+	std::vector<MeshData> lods = MeshSimplifier::BuildLodChain(sphere, ratios, 1.0f);
+	CHECK(lods.size() == ratios.size());
+
+	for(size_t i = 0; i < lods.size() && i < ratios.size(); ++i)
+	{
+		CHECK(IndicesInRange(lods[i]));
+		CHECK(lods[i].Indices32.size() / 3 <= (size_t)(ratios[i]*sourceTriangles));
+		CHECK(NoVertexMoved(sphere, lods[i]));
+		CHECK(CountFlipped(lods[i]) == 0);
+
+		if(i > 0)
+			CHECK(lods[i].Indices32.size() <= lods[i - 1].Indices32.size());
+	}
+}
@@ -0,0 +1,180 @@
+//***************************************************************************************
+// ParallelTests.cpp
+//
+// Parallel::For and Parallel::Reduce cover every index exactly once, whatever
+// the count, minimum chunk and thread count, and loops may nest.
+//***************************************************************************************
+
+#include "Test.h"
+#include "../../Common/Parallel.h"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace
+{
+	const size_t Counts[] = { 0, 1, 2, 3, 7, 100, 1000, 4095, 4096, 4097, 100000 };
+	const size_t MinChunks[] = { 0, 1, 16, 1024, 65536 };
+
+	// True if fn(begin, end) called through For visits each of [0, count) once.
+	bool CoversOnce(size_t count, size_t minChunk)
+	{
+		std::vector<std::atomic<int>> visits(count);
+		for(std::atomic<int>& v : visits)
+			v = 0;
+
+		std::atomic<bool> badRange{ false };
+		Parallel::For(count, minChunk, [&](size_t begin, size_t end)
+		{
+			if(begin >= end || end > count)
+				badRange = true;
+
+			for(size_t i = begin; i < end && i < count; ++i)
+				visits[i]++;
+		});
+
+		if(badRange)
+			return false;
+
+		for(std::atomic<int>& v : visits)
+		{
+			if(v != 1)
+				return false;
+		}
+
+		return true;
+	}
+}
+
+TEST(Parallel_ForCoversEachIndexOnce)
+{
+	for(size_t count : Counts)
+	{
+		for(size_t minChunk : MinChunks)
+			CHECK(CoversOnce(count, minChunk));
+	}
+}
+
+TEST(Parallel_ForRepeated)
+{
+	// Back-to-back loops reuse the same workers.
+	for(int i = 0; i < 1000; ++i)
+		CHECK(CoversOnce(10000, 16));
+}
+
+TEST(Parallel_ReduceSum)
+{
+	for(size_t count : Counts)
+	{
+		for(size_t minChunk : MinChunks)
+		{
+			std::uint64_t sum = Parallel::Reduce<std::uint64_t>(count, minChunk,
+				[](size_t begin, size_t end)
+				{
+					std::uint64_t s = 0;
+					for(size_t i = begin; i < end; ++i)
+						s += i;
+					return s;
+				},
+				[](std::uint64_t a, std::uint64_t b) { return a + b; });
+
+			CHECK(sum == (std::uint64_t)count*(count > 0 ? count - 1 : 0) / 2);
+		}
+	}
+}
+
+TEST(Parallel_ReduceCombinesInChunkOrder)
+{
+	// Concatenating chunk ranges only gives [0, count) if chunks are folded
+	// in order.
+	struct Range
+	{
+		size_t Begin = 0;
+		size_t End = 0;
+		bool Contiguous = true;
+	};
+
+	Range range = Parallel::Reduce<Range>(100000, 16,
+		[](size_t begin, size_t end)
+		{
+			Range r;
+			r.Begin = begin;
+			r.End = end;
+			return r;
+		},
+		[](const Range& a, const Range& b)
+		{
+			Range r;
+			r.Begin = a.Begin;
+			r.End = b.End;
+			r.Contiguous = a.Contiguous && b.Contiguous && a.End == b.Begin;
+			return r;
+		});
+
+	CHECK(range.Begin == 0);
+	CHECK(range.End == 100000);
+	CHECK(range.Contiguous);
+}
+
+TEST(Parallel_Nested)
+{
+	std::atomic<size_t> total{ 0 };
+	Parallel::For(64, 1, [&](size_t begin, size_t end)
+	{
+		for(size_t i = begin; i < end; ++i)
+		{
+			Parallel::For(1000, 16, [&](size_t b, size_t e)
+			{
+				total += e - b;
+			});
+		}
+	});
+
+	CHECK(total == 64*1000);
+}
+
+TEST(Parallel_ConcurrentCallers)
+{
+	// Loops from several threads at once: one gets the pool, the rest run
+	// inline, and none waits on another.
+	std::atomic<bool> ok{ true };
+
+	std::vector<std::thread> threads;
+	for(int t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([&]
+		{
+			for(int i = 0; i < 200; ++i)
+			{
+				if(!CoversOnce(5000, 16))
+					ok = false;
+			}
+		});
+	}
+
+	for(std::thread& thread : threads)
+		thread.join();
+
+	CHECK(ok);
+}
+
+TEST(Parallel_ForEach)
+{
+	for(size_t count : Counts)
+	{
+		std::vector<std::atomic<int>> visits(count);
+		for(std::atomic<int>& v : visits)
+			v = 0;
+
+		Parallel::ForEach(count, [&](size_t i)
+		{
+			if(i < count)
+				visits[i]++;
+		});
+
+		bool once = true;
+		for(std::atomic<int>& v : visits)
+			once = once && v == 1;
+		CHECK(once);
+	}
+}
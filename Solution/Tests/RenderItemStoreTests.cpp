@@ -0,0 +1,247 @@
+//***************************************************************************************
+// RenderItemStoreTests.cpp
+//
+// RenderItemStore handles and dirty tracking across swap-removes: removing
+// from the middle moves the last item and its handle, removing from the end
+// moves nothing, a handle to a removed item stays invalid after its slot is
+// reused, and items dirty in some frame resources are still uploaded to
+// their new index there once a removal moves them.
+//***************************************************************************************
+
+#include "Test.h"
+#include "../../Common/RenderItemStore.h"
+#include <vector>
+
+using namespace DirectX;
+
+using uint32 = RenderItemStore::uint32;
+using Handle = RenderItemStore::Handle;
+
+namespace
+{
+	// Item id's world is a translation by id and its draw arguments draw id
+	// indices, so both identify it wherever it moves.
+	XMFLOAT4X4 World(uint32 id)
+	{
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixTranslation((float)id, 0.0f, 0.0f));
+		return world;
+	}
+
+	BoundingBox LocalBounds(uint32 id)
+	{
+		return BoundingBox(XMFLOAT3(0.0f, (float)id, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
+	}
+
+	Handle AddItem(RenderItemStore& store, uint32 id)
+	{
+		RenderItemStore::DrawArgs drawArgs;
+		drawArgs.IndexCount = id;
+		return store.Add(World(id), drawArgs, LocalBounds(id));
+	}
+
+	// Checks the handle reaches item id through every accessor.
+	bool HoldsItem(const RenderItemStore& store, Handle handle, uint32 id)
+	{
+		if(!store.IsValid(handle))
+			return false;
+
+		uint32 index = store.GetIndex(handle);
+		if(index >= store.GetCount())
+			return false;
+
+		Handle back = store.GetHandle(index);
+
+		BoundingBox expected;
+		LocalBounds(id).Transform(expected, XMMatrixTranslation((float)id, 0.0f, 0.0f));
+		BoundingBox bounds = store.GetWorldBounds(handle);
+
+		return back.Slot == handle.Slot && back.Generation == handle.Generation &&
+			store.GetWorld(handle)._41 == (float)id &&
+			store.GetWorlds()[index]._41 == (float)id &&
+			store.GetDrawArgs(handle).IndexCount == id &&
+			store.GetDrawArgs()[index].IndexCount == id &&
+			bounds.Center.x == expected.Center.x && bounds.Center.y == expected.Center.y &&
+			bounds.Extents.x == expected.Extents.x;
+	}
+
+	struct Upload
+	{
+		uint32 Index;
+		uint32 Id;
+
+		bool operator==(const Upload& other)const { return Index == other.Index && Id == other.Id; }
+	};
+
+	// The (index, item id) writes UpdateDirty makes for frameResource.
+	std::vector<Upload> Update(RenderItemStore& store, uint32 frameResource)
+	{
+		std::vector<Upload> uploads;
+		store.UpdateDirty(frameResource, [&](uint32 index, const XMFLOAT4X4& world)
+		{
+			Upload upload = { index, (uint32)world._41 };
+			uploads.push_back(upload);
+		});
+
+		return uploads;
+	}
+
+	void UpdateAll(RenderItemStore& store)
+	{
+		for(uint32 f = 0; f < store.GetFrameResourceCount(); ++f)
+			Update(store, f);
+	}
+}
+
+TEST(RenderItemStore_RemoveFromMiddle)
+{
+	RenderItemStore store(3);
+
+	std::vector<Handle> handles;
+	for(uint32 id = 0; id < 5; ++id)
+		handles.push_back(AddItem(store, id));
+	UpdateAll(store);
+
+	store.Remove(handles[1]);
+
+	CHECK(store.GetCount() == 4);
+	CHECK(!store.IsValid(handles[1]));
+
+	// The last item fills the hole; the others keep their index.
+	CHECK(HoldsItem(store, handles[4], 4));
+	CHECK(store.GetIndex(handles[4]) == 1);
+	CHECK(store.GetIndex(handles[0]) == 0);
+	CHECK(store.GetIndex(handles[2]) == 2);
+	CHECK(store.GetIndex(handles[3]) == 3);
+	for(uint32 id : { 0u, 2u, 3u })
+		CHECK(HoldsItem(store, handles[id], id));
+	CHECK(store.GetWorldBounds().GetCount() == 4);
+
+	// Only the moved item is written again, at its new index.
+	std::vector<Upload> expected = { { 1, 4 } };
+	for(uint32 f = 0; f < 3; ++f)
+		CHECK(Update(store, f) == expected);
+	for(uint32 f = 0; f < 3; ++f)
+		CHECK(Update(store, f).empty());
+}
+
+TEST(RenderItemStore_RemoveFromEnd)
+{
+	RenderItemStore store(2);
+
+	std::vector<Handle> handles;
+	for(uint32 id = 0; id < 4; ++id)
+		handles.push_back(AddItem(store, id));
+	UpdateAll(store);
+
+	// Nothing moves, so nothing is written.
+	store.Remove(handles[3]);
+	CHECK(store.GetCount() == 3);
+	CHECK(!store.IsValid(handles[3]));
+	for(uint32 id = 0; id < 3; ++id)
+	{
+		CHECK(HoldsItem(store, handles[id], id));
+		CHECK(store.GetIndex(handles[id]) == id);
+	}
+	CHECK(Update(store, 0).empty());
+	CHECK(Update(store, 1).empty());
+
+	// A dirty last item leaves a stale entry behind that must not be written.
+	store.SetWorld(handles[2], World(2));
+	store.Remove(handles[2]);
+	CHECK(store.GetCount() == 2);
+	CHECK(Update(store, 0).empty());
+	CHECK(Update(store, 1).empty());
+
+	// Nor when a new item takes that index clean and is dirtied again: it is
+	// written once.
+	Handle added = AddItem(store, 7);
+	CHECK(store.GetIndex(added) == 2);
+	std::vector<Upload> expected = { { 2, 7 } };
+	CHECK(Update(store, 0) == expected);
+	store.SetWorld(added, World(7));
+	CHECK(Update(store, 0) == expected);
+	CHECK(Update(store, 1) == expected);
+
+	// Down to empty and back.
+	store.Remove(handles[1]);
+	store.Remove(added);
+	store.Remove(handles[0]);
+	CHECK(store.GetCount() == 0);
+	CHECK(Update(store, 0).empty());
+	CHECK(HoldsItem(store, AddItem(store, 9), 9));
+}
+
+TEST(RenderItemStore_StaleHandleAfterReuse)
+{
+	RenderItemStore store(1);
+
+	Handle a = AddItem(store, 0);
+	Handle b = AddItem(store, 1);
+	store.Remove(a);
+
+	// The new item reuses a's slot under a new generation.
+	Handle c = AddItem(store, 2);
+	CHECK(c.Slot == a.Slot);
+	CHECK(c.Generation != a.Generation);
+	CHECK(!store.IsValid(a));
+	CHECK(HoldsItem(store, c, 2));
+	CHECK(HoldsItem(store, b, 1));
+
+	// Reused again, and after Clear.
+	store.Remove(c);
+	Handle d = AddItem(store, 3);
+	CHECK(d.Slot == a.Slot);
+	CHECK(!store.IsValid(a));
+	CHECK(!store.IsValid(c));
+	CHECK(HoldsItem(store, d, 3));
+
+	store.Clear();
+	CHECK(!store.IsValid(b));
+	CHECK(!store.IsValid(d));
+	Handle e = AddItem(store, 4);
+	CHECK(!store.IsValid(b));
+	CHECK(!store.IsValid(d));
+	CHECK(HoldsItem(store, e, 4));
+
+	// A handle that never existed.
+	Handle none;
+	CHECK(!store.IsValid(none));
+}
+
+TEST(RenderItemStore_DirtySurvivesRemove)
+{
+	RenderItemStore store(3);
+
+	std::vector<Handle> handles;
+	for(uint32 id = 0; id < 6; ++id)
+		handles.push_back(AddItem(store, id));
+	UpdateAll(store);
+
+	// Item 5 changes and only frame resource 0 catches up; item 2 changes
+	// and no frame resource does.
+	store.SetWorld(handles[5], World(5));
+	CHECK(Update(store, 0) == std::vector<Upload>({ { 5, 5 } }));
+	store.SetWorld(handles[2], World(2));
+
+	// Removing item 0 moves item 5 to index 0.  Frame resource 0 writes it
+	// there because it moved; 1 and 2 write it there instead of at index 5,
+	// which no longer exists.  Item 2 stays dirty where it was.
+	store.Remove(handles[0]);
+	CHECK(store.GetIndex(handles[5]) == 0);
+	CHECK(HoldsItem(store, handles[5], 5));
+
+	for(uint32 f = 0; f < 3; ++f)
+		CHECK(Update(store, f) == std::vector<Upload>({ { 2, 2 }, { 0, 5 } }));
+
+	// A dirty item that is removed is not written, and the item moved into
+	// its index is written once.
+	store.SetWorld(handles[3], World(3));
+	store.Remove(handles[3]);
+	CHECK(store.GetIndex(handles[4]) == 3);
+	for(uint32 f = 0; f < 3; ++f)
+		CHECK(Update(store, f) == std::vector<Upload>({ { 3, 4 } }));
+
+	for(uint32 id : { 1u, 2u, 4u, 5u })
+		CHECK(HoldsItem(store, handles[id], id));
+}
@@ -0,0 +1,209 @@
+//***************************************************************************************
+// StripifierTests.cpp
+//
+// Stripifier round trips: ToTriangleList(Stripify(x)) must give back the
+// triangles of x with their winding, whatever the strips look like, across
+// restarts, odd/even parity and meshes whose neighbours wind inconsistently.
+// Also the generator's own strips: the same vertices as the list shapes and
+// every triangle facing out.
+//***************************************************************************************
+
+#include "Test.h"
+#include "../../Common/Stripifier.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+using uint32 = Stripifier::uint32;
+using MeshData = GeometryGenerator::MeshData;
+
+namespace
+{
+	const uint32 R = GeometryGenerator::StripRestart;
+
+	// The non-degenerate triangles of a list, each rotated to start at its
+	// smallest index so the winding is kept, in sorted order.
+	std::vector<std::vector<uint32>> Triangles(const std::vector<uint32>& list)
+	{
+		std::vector<std::vector<uint32>> triangles;
+		for(size_t i = 0; i + 2 < list.size(); i += 3)
+		{
+			uint32 a = list[i], b = list[i + 1], c = list[i + 2];
+			if(a == b || b == c || c == a)
+				continue;
+
+			std::vector<uint32> tri = { a, b, c };
+			std::rotate(tri.begin(), std::min_element(tri.begin(), tri.end()), tri.end());
+			triangles.push_back(tri);
+		}
+
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	// Stripifies list and checks the round trip; returns the report.
+	Stripifier::StripReport RoundTrip(const std::vector<uint32>& list, size_t vertexCount)
+	{
+		std::vector<uint32> strip;
+		Stripifier::StripReport report = Stripifier::Stripify(list, vertexCount, strip);
+
+		std::vector<uint32> back;
+		Stripifier::ToTriangleList(strip, back);
+		CHECK(Triangles(back) == Triangles(list));
+		CHECK(report.TriangleCount == (uint32)Triangles(list).size());
+		CHECK(report.StripIndexCount == (uint32)strip.size());
+
+		// Strips never start or end with a restart, nor hold two in a row.
+		CHECK(strip.empty() || (strip.front() != R && strip.back() != R));
+		for(size_t i = 1; i < strip.size(); ++i)
+			CHECK(!(strip[i] == R && strip[i - 1] == R));
+
+		return report;
+	}
+
+	// Checks the strip mesh has list's vertices, as many triangles, and that
+	// each faces the way its vertex normals do.
+	void CheckGeneratorStrip(const MeshData& strip, const MeshData& list)
+	{
+		CHECK(strip.Vertices.size() == list.Vertices.size());
+		CHECK(memcmp(strip.Vertices.data(), list.Vertices.data(),
+			list.Vertices.size()*sizeof(GeometryGenerator::Vertex)) == 0);
+
+		std::vector<uint32> triangles;
+		Stripifier::ToTriangleList(strip.Indices32, triangles);
+		CHECK(triangles.size() == list.Indices32.size());
+
+		for(size_t i = 0; i + 2 < triangles.size(); i += 3)
+		{
+			const GeometryGenerator::Vertex& v0 = strip.Vertices[triangles[i]];
+			const GeometryGenerator::Vertex& v1 = strip.Vertices[triangles[i + 1]];
+			const GeometryGenerator::Vertex& v2 = strip.Vertices[triangles[i + 2]];
+
+			// Clockwise front faces in a left-handed frame: (p1 - p0) x (p2 - p0)
+			// points out of the front.
+			float e1[3] = { v1.Position.x - v0.Position.x, v1.Position.y - v0.Position.y, v1.Position.z - v0.Position.z };
+			float e2[3] = { v2.Position.x - v0.Position.x, v2.Position.y - v0.Position.y, v2.Position.z - v0.Position.z };
+			float face[3] = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+			float normal[3] = {
+				v0.Normal.x + v1.Normal.x + v2.Normal.x,
+				v0.Normal.y + v1.Normal.y + v2.Normal.y,
+				v0.Normal.z + v1.Normal.z + v2.Normal.z };
+
+			CHECK((face[0]*normal[0] + face[1]*normal[1] + face[2]*normal[2]) > 0.0f);
+		}
+	}
+}
+
+TEST(Stripifier_ToTriangleList)
+{
+	// Parity restarts after a restart; degenerate triangles are dropped
+	// without shifting the parity of the ones after them.
+	std::vector<uint32> strip = { 0, 1, 2, 3, R, 4, 5, 6, 7, R, 8, 9, 10, 10, 11, 12 };
+	std::vector<uint32> list;
+	Stripifier::ToTriangleList(strip, list);
+
+	std::vector<uint32> expected = { 0, 1, 2, 2, 1, 3, 4, 5, 6, 6, 5, 7, 8, 9, 10, 11, 10, 12 };
+	CHECK(list == expected);
+
+	Stripifier::StripReport report = Stripifier::Analyze(strip);
+	CHECK(report.StripCount == 3);
+	CHECK(report.TriangleCount == 6);
+}
+
+TEST(Stripifier_Parity)
+{
+	// A fan around vertex 0: consecutive triangles share edges in
+	// alternating directions along any strip through them.
+	std::vector<uint32> fan;
+	for(uint32 i = 1; i < 7; ++i)
+	{
+		fan.push_back(0);
+		fan.push_back(i + 1);
+		fan.push_back(i);
+	}
+	RoundTrip(fan, 8);
+
+	// A row of quads split along the diagonals a strip zigzags over, which
+	// the stripifier joins into one strip.
+	std::vector<uint32> row;
+	for(uint32 j = 0; j < 8; ++j)
+	{
+		uint32 q[6] = { 9 + j, j, 10 + j, 10 + j, j, j + 1 };
+		row.insert(row.end(), q, q + 6);
+	}
+	Stripifier::StripReport report = RoundTrip(row, 18);
+	CHECK(report.StripCount == 1);
+	CHECK(report.StripIndexCount == 18);
+
+	// Neighbours that share the directed edge 0->1 wind inconsistently, so no
+	// strip can hold both and each must get its own.
+	std::vector<uint32> flipped = { 0, 1, 2, 0, 1, 3 };
+	report = RoundTrip(flipped, 4);
+	CHECK(report.StripCount == 2);
+}
+
+TEST(Stripifier_Restarts)
+{
+	// Disjoint triangles, one strip each; one is degenerate and vanishes.
+	std::vector<uint32> list = { 0, 1, 2, 3, 4, 5, 6, 6, 7, 8, 9, 10 };
+	std::vector<uint32> strip;
+	Stripifier::StripReport report = Stripifier::Stripify(list, 11, strip);
+
+	std::vector<uint32> expected = { 0, 1, 2, R, 3, 4, 5, R, 8, 9, 10 };
+	CHECK(strip == expected);
+	CHECK(report.StripCount == 3);
+	CHECK(report.TriangleCount == 3);
+
+	RoundTrip(list, 11);
+	RoundTrip(std::vector<uint32>(), 0);
+}
+
+TEST(Stripifier_Shapes)
+{
+	GeometryGenerator geoGen;
+	const MeshData shapes[] =
+	{
+		geoGen.CreateBox(1.0f, 2.0f, 3.0f, 1),
+		geoGen.CreateSphere(1.0f, 13, 7),
+		geoGen.CreateGeosphere(1.0f, 2),
+		geoGen.CreateCylinder(1.0f, 0.5f, 2.0f, 11, 4),
+		geoGen.CreateGrid(4.0f, 3.0f, 9, 6),
+		geoGen.CreateTorus(1.0f, 0.25f, 12, 8),
+	};
+
+	for(const MeshData& shape : shapes)
+	{
+		Stripifier::StripReport report = RoundTrip(shape.Indices32, shape.Vertices.size());
+		CHECK(report.StripIndexCount < report.ListIndexCount);
+	}
+}
+
+TEST(Stripifier_Random)
+{
+	// Dense random triangles over few vertices, with random winding: many
+	// shared and non-manifold edges.
+	std::mt19937 rng(7);
+	for(int round = 0; round < 20; ++round)
+	{
+		uint32 vertexCount = 4 + rng() % 12;
+		std::vector<uint32> list;
+		for(int t = 0; t < 60; ++t)
+		{
+			for(int c = 0; c < 3; ++c)
+				list.push_back(rng() % vertexCount);
+		}
+
+		RoundTrip(list, vertexCount);
+	}
+}
+
+TEST(Stripifier_GeneratorStrips)
+{
+	GeometryGenerator geoGen;
+
+	CheckGeneratorStrip(geoGen.CreateGridStrip(4.0f, 3.0f, 9, 6), geoGen.CreateGrid(4.0f, 3.0f, 9, 6));
+	CheckGeneratorStrip(geoGen.CreateSphereStrip(1.0f, 13, 7), geoGen.CreateSphere(1.0f, 13, 7));
+	CheckGeneratorStrip(geoGen.CreateSphereStrip(1.0f, 5, 2), geoGen.CreateSphere(1.0f, 5, 2));
+	CheckGeneratorStrip(geoGen.CreateCylinderStrip(1.0f, 0.5f, 2.0f, 11, 4),
+		geoGen.CreateCylinder(1.0f, 0.5f, 2.0f, 11, 4));
+}
@@ -0,0 +1,239 @@
+//***************************************************************************************
+// TerrainTests.cpp
+//
+// Terrain's vectorized heights, normals and color table against the scalar
+// code LandApp used before (GetHillsHeight and its if-chain of colors).
+//***************************************************************************************
+
+#include "Test.h"
+#include "../../Common/Terrain.h"
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+using Vertex = GeometryGenerator::Vertex;
+
+namespace
+{
+	float GetHillsHeight(float x, float z)
+	{
+		return 0.3f*(z*sinf(0.1f*x) + x*cosf(0.1f*z));
+	}
+
+	XMFLOAT4 GetHillsColor(float y)
+	{
+		if(y < -10.0f)
+			return XMFLOAT4(1.0f, 0.96f, 0.62f, 1.0f);
+		else if(y < 5.0f)
+			return XMFLOAT4(0.48f, 0.77f, 0.46f, 1.0f);
+		else if(y < 12.0f)
+			return XMFLOAT4(0.1f, 0.48f, 0.19f, 1.0f);
+		else if(y < 20.0f)
+			return XMFLOAT4(0.45f, 0.39f, 0.34f, 1.0f);
+		else
+			return XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+
+	// The vector sine and cosine are polynomial approximations, so heights
+	// agree to a few ulps of the larger term.
+	bool NearHeight(float height, float x, float z)
+	{
+		return fabsf(height - GetHillsHeight(x, z)) <= 1e-5f*(1.0f + fabsf(x) + fabsf(z));
+	}
+
+	bool Near(const XMFLOAT3& a, const XMFLOAT3& b, float tolerance)
+	{
+		return fabsf(a.x - b.x) <= tolerance && fabsf(a.y - b.y) <= tolerance && fabsf(a.z - b.z) <= tolerance;
+	}
+
+	bool SameColor(const XMFLOAT4& a, const XMFLOAT4& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+	}
+
+	// LandApp's 160x160 grid of 50x50 vertices.
+	GeometryGenerator::MeshData LandGrid()
+	{
+		GeometryGenerator geoGen;
+		return geoGen.CreateGrid(160.0f, 160.0f, 50, 50);
+	}
+}
+
+TEST(Terrain_HeightsMatchScalar)
+{
+	Terrain terrain;
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> coordinate(-200.0f, 200.0f);
+
+	// Every tail length past the groups of eight and four.
+	for(size_t count = 0; count <= 20; ++count)
+	{
+		std::vector<float> x(count), z(count), heights(count, FLT_MAX);
+		for(size_t i = 0; i < count; ++i)
+		{
+			x[i] = coordinate(random);
+			z[i] = coordinate(random);
+		}
+
+		terrain.GetHeights(x.data(), z.data(), heights.data(), count);
+		for(size_t i = 0; i < count; ++i)
+		{
+			CHECK(NearHeight(heights[i], x[i], z[i]));
+			CHECK(terrain.GetHeight(x[i], z[i]) == GetHillsHeight(x[i], z[i]));
+		}
+	}
+
+	// Writes stop at count.
+	float x[5] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f };
+	float z[5] = { 5.0f, 4.0f, 3.0f, 2.0f, 1.0f };
+	float heights[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f };
+	terrain.GetHeights(x, z, heights, 5);
+	CHECK(heights[5] == -1.0f);
+
+	size_t count = 1 << 20;
+	std::vector<float> bigX(count), bigZ(count), bigHeights(count);
+	for(size_t i = 0; i < count; ++i)
+	{
+		bigX[i] = coordinate(random);
+		bigZ[i] = coordinate(random);
+	}
+
+	terrain.GetHeights(bigX.data(), bigZ.data(), bigHeights.data(), count);
+	size_t mismatches = 0;
+	for(size_t i = 0; i < count; ++i)
+		mismatches += NearHeight(bigHeights[i], bigX[i], bigZ[i]) ? 0 : 1;
+	CHECK(mismatches == 0);
+}
+
+TEST(Terrain_DisplaceMatchesScalar)
+{
+	Terrain terrain;
+	GeometryGenerator::MeshData grid = LandGrid();
+	terrain.Displace(grid);
+
+	const float step = 1e-2f;
+	for(const Vertex& v : grid.Vertices)
+	{
+		float x = v.Position.x;
+		float z = v.Position.z;
+		CHECK(NearHeight(v.Position.y, x, z));
+
+		// The analytic normal, and central differences of the old heights.
+		CHECK(Near(v.Normal, terrain.GetNormal(x, z), 1e-4f));
+
+		float slopeX = (GetHillsHeight(x + step, z) - GetHillsHeight(x - step, z)) / (2.0f*step);
+		float slopeZ = (GetHillsHeight(x, z + step) - GetHillsHeight(x, z - step)) / (2.0f*step);
+		XMFLOAT3 normal;
+		XMStoreFloat3(&normal, XMVector3Normalize(XMVectorSet(-slopeX, 1.0f, -slopeZ, 0.0f)));
+		CHECK(Near(v.Normal, normal, 2e-3f));
+
+		// Unit tangent along +x, in the surface.
+		XMVECTOR n = XMLoadFloat3(&v.Normal);
+		XMVECTOR t = XMLoadFloat3(&v.TangentU);
+		CHECK(fabsf(XMVectorGetX(XMVector3Length(n)) - 1.0f) < 1e-4f);
+		CHECK(fabsf(XMVectorGetX(XMVector3Length(t)) - 1.0f) < 1e-4f);
+		CHECK(fabsf(XMVectorGetX(XMVector3Dot(n, t))) < 1e-4f);
+		CHECK(v.TangentU.x > 0.0f && v.TangentU.z == 0.0f);
+	}
+
+	// Short runs take the padded last group; the result must not depend on
+	// where a vertex falls in it.
+	GeometryGenerator::MeshData flat = LandGrid();
+	for(size_t count = 1; count <= 9; ++count)
+	{
+		std::vector<Vertex> vertices(flat.Vertices.begin() + 7, flat.Vertices.begin() + 7 + count);
+		terrain.Displace(vertices.data(), count);
+
+		for(size_t i = 0; i < count; ++i)
+		{
+			const Vertex& expected = grid.Vertices[7 + i];
+			CHECK(vertices[i].Position.y == expected.Position.y);
+			CHECK(Near(vertices[i].Normal, expected.Normal, 0.0f));
+			CHECK(Near(vertices[i].TangentU, expected.TangentU, 0.0f));
+		}
+	}
+}
+
+TEST(Terrain_ColorsMatchIfChain)
+{
+	Terrain terrain;
+
+	// At, just below and just above every threshold.
+	const float thresholds[] = { -10.0f, 5.0f, 12.0f, 20.0f };
+	for(float threshold : thresholds)
+	{
+		for(float y : { threshold, std::nextafter(threshold, -FLT_MAX), std::nextafter(threshold, FLT_MAX) })
+			CHECK(SameColor(terrain.GetColor(y), GetHillsColor(y)));
+	}
+
+	// Far outside the table, and a dense sweep through it.
+	for(float y : { -FLT_MAX, -1e6f, -10.5f, 20.5f, 1e6f, FLT_MAX })
+		CHECK(SameColor(terrain.GetColor(y), GetHillsColor(y)));
+
+	size_t mismatches = 0;
+	for(int i = -40000; i <= 40000; ++i)
+	{
+		float y = i*0.001f;
+		mismatches += SameColor(terrain.GetColor(y), GetHillsColor(y)) ? 0 : 1;
+	}
+
+	std::mt19937 random(2);
+	std::uniform_real_distribution<float> height(-60.0f, 60.0f);
+	for(int i = 0; i < 1000000; ++i)
+	{
+		float y = height(random);
+		mismatches += SameColor(terrain.GetColor(y), GetHillsColor(y)) ? 0 : 1;
+	}
+
+	CHECK(mismatches == 0);
+}
+
+TEST(Terrain_ColorsWithCustomBands)
+{
+	// Uneven bands, two sharing a threshold, and one narrower than a cell.
+	const Terrain::ColorBand bands[] =
+	{
+		{ -3.0f, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f) },
+		{ -2.99f, XMFLOAT4(0.1f, 0.0f, 0.0f, 1.0f) },
+		{ 0.0f, XMFLOAT4(0.2f, 0.0f, 0.0f, 1.0f) },
+		{ 0.0f, XMFLOAT4(0.3f, 0.0f, 0.0f, 1.0f) },
+		{ 100.0f, XMFLOAT4(0.4f, 0.0f, 0.0f, 1.0f) },
+		{ FLT_MAX, XMFLOAT4(0.5f, 0.0f, 0.0f, 1.0f) }
+	};
+	const size_t bandCount = _countof(bands);
+
+	Terrain terrain;
+	terrain.SetColorBands(bands, bandCount);
+
+	auto reference = [&](float y)
+	{
+		for(size_t b = 0; b + 1 < bandCount; ++b)
+		{
+			if(y < bands[b].MaxHeight)
+				return bands[b].Color;
+		}
+		return bands[bandCount - 1].Color;
+	};
+
+	size_t mismatches = 0;
+	for(int i = -20000; i <= 120000; ++i)
+	{
+		float y = i*0.001f;
+		mismatches += SameColor(terrain.GetColor(y), reference(y)) ? 0 : 1;
+	}
+
+	for(size_t b = 0; b + 1 < bandCount; ++b)
+	{
+		float threshold = bands[b].MaxHeight;
+		for(float y : { threshold, std::nextafter(threshold, -FLT_MAX), std::nextafter(threshold, FLT_MAX) })
+			mismatches += SameColor(terrain.GetColor(y), reference(y)) ? 0 : 1;
+	}
+
+	CHECK(mismatches == 0);
+
+	// A single band colors everything.
+	terrain.SetColorBands(bands, 1);
+	CHECK(SameColor(terrain.GetColor(-1e9f), bands[0].Color));
+	CHECK(SameColor(terrain.GetColor(1e9f), bands[0].Color));
+}
@@ -0,0 +1,32 @@
+//***************************************************************************************
+// Test.h
+//
+// A small test harness for the Common modules that run without a device.
+// TEST(Name) defines a test and registers it; CHECK(condition) reports a
+// failed condition with its file and line and lets the test carry on, so one
+// run lists every failure.  TestMain.cpp runs the registered tests (those
+// whose name contains the first argument, if one is given) and exits non-zero
+// if any check failed.
+//***************************************************************************************
+
+#pragma once
+
+namespace Test
+{
+	typedef void (*TestFn)();
+
+	struct Registration
+	{
+		Registration(const char* name, TestFn fn);
+	};
+
+	void Fail(const char* file, int line, const char* condition);
+}
+
+#define TEST(name) \
+	static void name(); \
+	static Test::Registration name##Registration(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	((condition) ? (void)0 : Test::Fail(__FILE__, __LINE__, #condition))
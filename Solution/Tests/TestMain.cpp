@@ -0,0 +1,64 @@
+//***************************************************************************************
+// TestMain.cpp
+//***************************************************************************************
+
+#include "Test.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	struct TestCase
+	{
+		const char* Name;
+		Test::TestFn Fn;
+	};
+
+	// Function-local so registrations from other files' static initializers
+	// never see it unconstructed.
+	std::vector<TestCase>& GetTests()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	int gFailures = 0;
+}
+
+Test::Registration::Registration(const char* name, TestFn fn)
+{
+	GetTests().push_back({ name, fn });
+}
+
+void Test::Fail(const char* file, int line, const char* condition)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", file, line, condition);
+	gFailures++;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* filter = argc > 1 ? argv[1] : "";
+
+	int run = 0;
+	int failed = 0;
+	for(const TestCase& test : GetTests())
+	{
+		if(strstr(test.Name, filter) == nullptr)
+			continue;
+
+		int failuresBefore = gFailures;
+		test.Fn();
+		run++;
+
+		bool passed = gFailures == failuresBefore;
+		if(!passed)
+			failed++;
+
+		printf("%s %s\n", passed ? "[  OK  ]" : "[FAILED]", test.Name);
+	}
+
+	printf("%d of %d tests passed\n", run - failed, run);
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+//***************************************************************************************
+// TiledGridTests.cpp
+//
+// TiledGrid's tiles, stitched back together, are CreateGrid's grid: every
+// vertex matches bit for bit, including those of the short tiles on the far
+// edges, and the tiles' triangles are exactly the grid's.
+//***************************************************************************************
+
+#include "Test.h"
+#include "../../Common/TiledGrid.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+using uint32 = TiledGrid::uint32;
+using Vertex = GeometryGenerator::Vertex;
+using MeshData = GeometryGenerator::MeshData;
+
+namespace
+{
+	typedef std::array<uint32, 3> Triangle;
+
+	bool SameVertex(const Vertex& a, const Vertex& b)
+	{
+		return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+	}
+
+	// Center and extents round, so allow a little slack.
+	bool InBounds(const DirectX::BoundingBox& bounds, const DirectX::XMFLOAT3& p)
+	{
+		const float c[] = { bounds.Center.x, bounds.Center.y, bounds.Center.z };
+		const float e[] = { bounds.Extents.x, bounds.Extents.y, bounds.Extents.z };
+		const float q[] = { p.x, p.y, p.z };
+
+		for(int i = 0; i < 3; ++i)
+		{
+			if(fabsf(q[i] - c[i]) > e[i] + 1e-4f*(1.0f + fabsf(c[i]) + e[i]))
+				return false;
+		}
+
+		return true;
+	}
+
+	// Rotated so the smallest index leads, keeping the winding.
+	Triangle Canonical(uint32 a, uint32 b, uint32 c)
+	{
+		if(b < a && b < c)
+			return Triangle{ { b, c, a } };
+		if(c < a && c < b)
+			return Triangle{ { c, a, b } };
+		return Triangle{ { a, b, c } };
+	}
+
+	std::vector<Triangle> SortedTriangles(std::vector<Triangle> triangles)
+	{
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	// Builds every tile of TiledGrid(width, depth, m, n, tileQuads) and checks
+	// it against CreateGrid(width, depth, m, n).
+	void CheckMatchesGrid(float width, float depth, uint32 m, uint32 n, uint32 tileQuads)
+	{
+		GeometryGenerator geoGen;
+		MeshData grid = geoGen.CreateGrid(width, depth, m, n);
+		TiledGrid tiled(width, depth, m, n, tileQuads);
+
+		CHECK(tiled.GetTileCountX() == (n - 1 + tileQuads - 1) / tileQuads);
+		CHECK(tiled.GetTileCountZ() == (m - 1 + tileQuads - 1) / tileQuads);
+
+		std::vector<int> covered(grid.Vertices.size(), 0);
+		std::vector<Triangle> triangles;
+		uint32 tileCount = 0;
+		bool shortTile = false;
+
+		tiled.ForEachTile([&](const TiledGrid::Tile& tile)
+		{
+			tileCount++;
+			CHECK(tile.FirstRow == tile.TileZ*tileQuads);
+			CHECK(tile.FirstColumn == tile.TileX*tileQuads);
+			CHECK(tile.Rows >= 2 && tile.Rows <= tileQuads + 1);
+			CHECK(tile.Columns >= 2 && tile.Columns <= tileQuads + 1);
+			CHECK(tile.FirstRow + tile.Rows <= m && tile.FirstColumn + tile.Columns <= n);
+			CHECK(tile.Mesh.Vertices.size() == tile.Rows*tile.Columns);
+			shortTile = shortTile || tile.Rows < tileQuads + 1 || tile.Columns < tileQuads + 1;
+
+			// Tile (i, j) is grid vertex (FirstRow + i, FirstColumn + j).
+			std::vector<uint32> toGrid(tile.Mesh.Vertices.size());
+			for(uint32 i = 0; i < tile.Rows; ++i)
+			{
+				for(uint32 j = 0; j < tile.Columns; ++j)
+				{
+					uint32 g = (tile.FirstRow + i)*n + tile.FirstColumn + j;
+					const Vertex& v = tile.Mesh.Vertices[i*tile.Columns + j];
+					toGrid[i*tile.Columns + j] = g;
+
+					CHECK(SameVertex(v, grid.Vertices[g]));
+					CHECK(InBounds(tile.Bounds, v.Position));
+					covered[g]++;
+				}
+			}
+
+			const std::vector<uint32>& indices = tile.Mesh.Indices32;
+			CHECK(indices.size() == 6*(tile.Rows - 1)*(tile.Columns - 1));
+			for(size_t k = 0; k + 2 < indices.size(); k += 3)
+			{
+				if(indices[k] < toGrid.size() && indices[k + 1] < toGrid.size() && indices[k + 2] < toGrid.size())
+					triangles.push_back(Canonical(toGrid[indices[k]], toGrid[indices[k + 1]], toGrid[indices[k + 2]]));
+				else
+					CHECK(false);
+			}
+
+			return true;
+		});
+
+		CHECK(tileCount == tiled.GetTileCountX()*tiled.GetTileCountZ());
+		CHECK(shortTile == ((m - 1) % tileQuads != 0 || (n - 1) % tileQuads != 0));
+
+		// Interior vertices belong to one tile, tile edges to two, tile corners
+		// to four; none is missed.
+		for(uint32 row = 0; row < m; ++row)
+		{
+			for(uint32 column = 0; column < n; ++column)
+			{
+				bool rowEdge = row % tileQuads == 0 && row != 0 && row != m - 1;
+				bool columnEdge = column % tileQuads == 0 && column != 0 && column != n - 1;
+				CHECK(covered[row*n + column] == (rowEdge ? 2 : 1)*(columnEdge ? 2 : 1));
+			}
+		}
+
+		std::vector<Triangle> gridTriangles;
+		for(size_t k = 0; k + 2 < grid.Indices32.size(); k += 3)
+			gridTriangles.push_back(Canonical(grid.Indices32[k], grid.Indices32[k + 1], grid.Indices32[k + 2]));
+
+		CHECK(SortedTriangles(triangles) == SortedTriangles(gridTriangles));
+	}
+}
+
+TEST(TiledGrid_MatchesCreateGrid)
+{
+	// Tiles that divide the grid exactly.
+	CheckMatchesGrid(100.0f, 80.0f, 257, 129, 64);
+
+	// Short tiles along the far row, the far column, and both.
+	CheckMatchesGrid(100.0f, 80.0f, 301, 257, 64);
+	CheckMatchesGrid(100.0f, 80.0f, 257, 301, 64);
+	CheckMatchesGrid(37.5f, 91.0f, 101, 67, 16);
+
+	// One tile larger than the grid, one quad per tile, and a tile only one
+	// quad wide or deep on the edges.
+	CheckMatchesGrid(10.0f, 10.0f, 20, 30, 64);
+	CheckMatchesGrid(3.0f, 7.0f, 5, 4, 1);
+	CheckMatchesGrid(50.0f, 50.0f, 66, 66, 64);
+}
+
+TEST(TiledGrid_BuildTileReuse)
+{
+	// A Tile reused across tiles of different sizes ends up as a fresh one.
+	TiledGrid tiled(100.0f, 80.0f, 301, 257, 64);
+
+	TiledGrid::Tile reused;
+	for(uint32 tileZ = tiled.GetTileCountZ(); tileZ-- > 0;)
+	{
+		for(uint32 tileX = tiled.GetTileCountX(); tileX-- > 0;)
+		{
+			TiledGrid::Tile fresh;
+			tiled.BuildTile(tileX, tileZ, fresh);
+			tiled.BuildTile(tileX, tileZ, reused);
+
+			CHECK(reused.Rows == fresh.Rows && reused.Columns == fresh.Columns);
+			CHECK(reused.Mesh.Indices32 == fresh.Mesh.Indices32);
+			CHECK(reused.Mesh.Vertices.size() == fresh.Mesh.Vertices.size());
+			CHECK(std::memcmp(reused.Mesh.Vertices.data(), fresh.Mesh.Vertices.data(),
+				fresh.Mesh.Vertices.size()*sizeof(Vertex)) == 0);
+		}
+	}
+}
+
+TEST(TiledGrid_HeightEdgesMatch)
+{
+	// With a height function, the vertices two tiles share are still equal
+	// bit for bit, normals and tangents included.
+	TiledGrid tiled(100.0f, 100.0f, 300, 300, 64, [](float x, float z)
+	{
+		return 3.0f*sinf(0.1f*x)*cosf(0.13f*z);
+	});
+
+	for(uint32 tileZ = 0; tileZ < tiled.GetTileCountZ(); ++tileZ)
+	{
+		for(uint32 tileX = 0; tileX < tiled.GetTileCountX(); ++tileX)
+		{
+			TiledGrid::Tile tile;
+			tiled.BuildTile(tileX, tileZ, tile);
+
+			if(tileX + 1 < tiled.GetTileCountX())
+			{
+				TiledGrid::Tile right;
+				tiled.BuildTile(tileX + 1, tileZ, right);
+				for(uint32 i = 0; i < tile.Rows; ++i)
+					CHECK(SameVertex(tile.Mesh.Vertices[i*tile.Columns + tile.Columns - 1], right.Mesh.Vertices[i*right.Columns]));
+			}
+
+			if(tileZ + 1 < tiled.GetTileCountZ())
+			{
+				TiledGrid::Tile below;
+				tiled.BuildTile(tileX, tileZ + 1, below);
+				for(uint32 j = 0; j < tile.Columns; ++j)
+					CHECK(SameVertex(tile.Mesh.Vertices[(tile.Rows - 1)*tile.Columns + j], below.Mesh.Vertices[j]));
+			}
+		}
+	}
+}
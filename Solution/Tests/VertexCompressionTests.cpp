@@ -0,0 +1,435 @@
+//***************************************************************************************
+// VertexCompressionTests.cpp
+//
+// Encode/Decode round trips for every format against the precision of that
+// format, ChooseFormat against DefaultTolerance, and the edge cases of the
+// encoders: zero normals, flat and empty boxes, normals on the folded lower
+// half of the octahedron, and color packing.
+//***************************************************************************************
+
+#include "Test.h"
+#include "../../Common/VertexCompression.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+using uint32 = VertexCompression::uint32;
+using Vertex = GeometryGenerator::Vertex;
+using MeshData = GeometryGenerator::MeshData;
+using PositionFormat = VertexCompression::PositionFormat;
+using FrameFormat = VertexCompression::FrameFormat;
+using TexCFormat = VertexCompression::TexCFormat;
+
+namespace
+{
+	const PositionFormat PositionFormats[] = { PositionFormat::Float3, PositionFormat::Half4, PositionFormat::UNorm16 };
+	const FrameFormat FrameFormats[] = { FrameFormat::Float3, FrameFormat::Oct16, FrameFormat::Oct8 };
+	const TexCFormat TexCFormats[] = { TexCFormat::Float2, TexCFormat::Half2 };
+
+	// Worst round trip error each format can have, in the units of
+	// ErrorBounds.  Half4 rounds each coordinate to 11 bits relative to the
+	// half box; UNorm16 to half a step of 1/65535 of the box; texture
+	// coordinates in [0,1] to half a step of 2^-11.
+	float PositionBound(PositionFormat format)
+	{
+		switch(format)
+		{
+		case PositionFormat::Float3: return 0.0f;
+		case PositionFormat::Half4:  return 1.0f / 4096.0f;
+		default:                     return 1.0f / 65535.0f;
+		}
+	}
+
+	float FrameBound(FrameFormat format)
+	{
+		switch(format)
+		{
+		case FrameFormat::Float3: return 0.0f;
+		case FrameFormat::Oct16:  return XMConvertToRadians(0.01f);
+		default:                  return XMConvertToRadians(1.0f);
+		}
+	}
+
+	float TexCBound(TexCFormat format)
+	{
+		return format == TexCFormat::Float2 ? 0.0f : 1.0f / 4096.0f;
+	}
+
+	bool IsFinite(const Vertex& v)
+	{
+		const float values[] =
+		{
+			v.Position.x, v.Position.y, v.Position.z,
+			v.Normal.x, v.Normal.y, v.Normal.z,
+			v.TangentU.x, v.TangentU.y, v.TangentU.z,
+			v.TexC.x, v.TexC.y
+		};
+
+		for(float value : values)
+		{
+			if(!std::isfinite(value))
+				return false;
+		}
+
+		return true;
+	}
+
+	float Angle(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		XMVECTOR va = XMLoadFloat3(&a);
+		XMVECTOR vb = XMLoadFloat3(&b);
+		if(XMVectorGetX(XMVector3LengthSq(va)) <= 0.0f || XMVectorGetX(XMVector3LengthSq(vb)) <= 0.0f)
+			return 0.0f;
+
+		return atan2f(XMVectorGetX(XMVector3Length(XMVector3Cross(va, vb))), XMVectorGetX(XMVector3Dot(va, vb)));
+	}
+
+	// Recomputes the round trip error of mesh from Decode, independently of
+	// the MaxError Encode measured.
+	VertexCompression::ErrorBounds DecodedError(const MeshData& meshData, const VertexCompression::EncodedMesh& mesh)
+	{
+		std::vector<Vertex> decoded;
+		VertexCompression::Decode(mesh, decoded);
+
+		XMVECTOR vMin = XMVectorReplicate(+FLT_MAX);
+		XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+		for(const Vertex& v : meshData.Vertices)
+		{
+			vMin = XMVectorMin(vMin, XMLoadFloat3(&v.Position));
+			vMax = XMVectorMax(vMax, XMLoadFloat3(&v.Position));
+		}
+
+		float diagonal = XMVectorGetX(XMVector3Length(vMax - vMin));
+		float invDiagonal = diagonal > 0.0f ? 1.0f / diagonal : 1.0f;
+
+		VertexCompression::ErrorBounds error;
+		for(size_t i = 0; i < decoded.size(); ++i)
+		{
+			const Vertex& a = meshData.Vertices[i];
+			const Vertex& b = decoded[i];
+
+			XMVECTOR d = XMLoadFloat3(&a.Position) - XMLoadFloat3(&b.Position);
+			error.Position = std::max(error.Position, XMVectorGetX(XMVector3Length(d))*invDiagonal);
+			error.Normal = std::max(error.Normal, Angle(a.Normal, b.Normal));
+			error.Tangent = std::max(error.Tangent, Angle(a.TangentU, b.TangentU));
+			error.TexC = std::max(error.TexC, std::max(fabsf(a.TexC.x - b.TexC.x), fabsf(a.TexC.y - b.TexC.y)));
+		}
+
+		return error;
+	}
+
+	bool Within(const VertexCompression::ErrorBounds& error, const VertexCompression::ErrorBounds& bound)
+	{
+		return error.Position <= bound.Position && error.Normal <= bound.Normal &&
+			error.Tangent <= bound.Tangent && error.TexC <= bound.TexC;
+	}
+
+	// Random unit normals and tangents over the whole sphere, half of them
+	// on the folded z < 0 side, at random positions in a box.
+	MeshData RandomFrames(uint32 count)
+	{
+		std::mt19937 rng(7);
+		std::normal_distribution<float> normal;
+		std::uniform_real_distribution<float> uniform(-3.0f, 5.0f);
+
+		MeshData mesh;
+		for(uint32 i = 0; i < count; ++i)
+		{
+			XMFLOAT3 p(uniform(rng), uniform(rng), uniform(rng));
+
+			XMFLOAT3 n, t;
+			XMStoreFloat3(&n, XMVector3Normalize(XMVectorSet(normal(rng), normal(rng), normal(rng), 0.0f)));
+			XMStoreFloat3(&t, XMVector3Normalize(XMVectorSet(normal(rng), normal(rng), normal(rng), 0.0f)));
+
+			XMFLOAT2 uv((uniform(rng) + 3.0f) / 8.0f, (uniform(rng) + 3.0f) / 8.0f);
+			mesh.Vertices.push_back(Vertex(p, n, t, uv));
+		}
+
+		return mesh;
+	}
+
+	std::vector<MeshData> TestMeshes()
+	{
+		GeometryGenerator geoGen;
+
+		std::vector<MeshData> meshes;
+		meshes.push_back(geoGen.CreateBox(1.0f, 2.0f, 3.0f, 2));
+		meshes.push_back(geoGen.CreateSphere(1.0f, 64, 64));
+		meshes.push_back(geoGen.CreateGeosphere(1.0f, 5));
+		meshes.push_back(geoGen.CreateCylinder(0.5f, 0.5f, 3.0f, 20, 20));
+		meshes.push_back(geoGen.CreateGrid(160.0f, 160.0f, 50, 50));
+		meshes.push_back(RandomFrames(20000));
+		return meshes;
+	}
+}
+
+TEST(VertexCompression_RoundTripEveryFormat)
+{
+	for(const MeshData& mesh : TestMeshes())
+	{
+		for(PositionFormat position : PositionFormats)
+		{
+			for(FrameFormat frame : FrameFormats)
+			{
+				for(TexCFormat texC : TexCFormats)
+				{
+					VertexCompression::VertexFormat format;
+					format.Position = position;
+					format.Frame = frame;
+					format.TexC = texC;
+
+					VertexCompression::EncodedMesh encoded = VertexCompression::Encode(mesh, format);
+					CHECK(encoded.VertexCount == mesh.Vertices.size());
+					CHECK(encoded.Data.size() == (size_t)encoded.VertexCount*encoded.Layout.Stride);
+					CHECK(encoded.Layout.Stride % 4 == 0);
+
+					// MaxError is what Decode actually gives back...
+					VertexCompression::ErrorBounds decoded = DecodedError(mesh, encoded);
+					CHECK(fabsf(decoded.Position - encoded.MaxError.Position) <= 1e-6f);
+					CHECK(fabsf(decoded.Normal - encoded.MaxError.Normal) <= 1e-6f);
+					CHECK(fabsf(decoded.Tangent - encoded.MaxError.Tangent) <= 1e-6f);
+					CHECK(fabsf(decoded.TexC - encoded.MaxError.TexC) <= 1e-6f);
+
+					// ...and within what the format can hold.
+					VertexCompression::ErrorBounds bound;
+					bound.Position = PositionBound(position);
+					bound.Normal = FrameBound(frame);
+					bound.Tangent = FrameBound(frame);
+					bound.TexC = TexCBound(texC);
+					CHECK(Within(encoded.MaxError, bound));
+				}
+			}
+		}
+	}
+}
+
+TEST(VertexCompression_ChooseFormatWithinTolerance)
+{
+	const VertexCompression::ErrorBounds& tolerance = VertexCompression::DefaultTolerance;
+
+	for(const MeshData& mesh : TestMeshes())
+	{
+		VertexCompression::VertexFormat format = VertexCompression::ChooseFormat(mesh);
+		CHECK(Within(VertexCompression::Encode(mesh, format).MaxError, tolerance));
+
+		// No attribute is wider than it needs to be.
+		if(format.Frame == FrameFormat::Oct16)
+		{
+			VertexCompression::VertexFormat narrower = format;
+			narrower.Frame = FrameFormat::Oct8;
+			VertexCompression::ErrorBounds error = VertexCompression::Encode(mesh, narrower).MaxError;
+			CHECK(error.Normal > tolerance.Normal || error.Tangent > tolerance.Tangent);
+		}
+
+		// Half4 is never chosen, only asked for.
+		CHECK(format.Position != PositionFormat::Half4);
+		if(format.Position == PositionFormat::Float3)
+		{
+			VertexCompression::VertexFormat narrower = format;
+			narrower.Position = PositionFormat::UNorm16;
+			CHECK(VertexCompression::Encode(mesh, narrower).MaxError.Position > tolerance.Position);
+		}
+
+		if(format.TexC == TexCFormat::Float2)
+		{
+			VertexCompression::VertexFormat narrower = format;
+			narrower.TexC = TexCFormat::Half2;
+			CHECK(VertexCompression::Encode(mesh, narrower).MaxError.TexC > tolerance.TexC);
+		}
+	}
+
+	// The curved meshes need 16 bit frames; a box's axis-aligned frames fit 8.
+	GeometryGenerator geoGen;
+	CHECK(VertexCompression::ChooseFormat(geoGen.CreateSphere(1.0f, 64, 64)).Frame == FrameFormat::Oct16);
+	CHECK(VertexCompression::ChooseFormat(geoGen.CreateBox(1.0f, 2.0f, 3.0f, 2)).Frame == FrameFormat::Oct8);
+
+	// A grid on whole units round trips exactly through Half4 but not UNorm16;
+	// positions still widen straight to Float3.
+	VertexCompression::ErrorBounds tight = tolerance;
+	tight.Position = 1e-6f;
+	CHECK(VertexCompression::ChooseFormat(geoGen.CreateGrid(1000.0f, 1000.0f, 11, 11), tight).Position == PositionFormat::Float3);
+
+	// Nothing packed meets a zero tolerance.
+	VertexCompression::ErrorBounds exact;
+	VertexCompression::VertexFormat format = VertexCompression::ChooseFormat(RandomFrames(1000), exact);
+	CHECK(format.Position == PositionFormat::Float3);
+	CHECK(format.Frame == FrameFormat::Float3);
+	CHECK(format.TexC == TexCFormat::Float2);
+}
+
+TEST(VertexCompression_ZeroNormals)
+{
+	XMFLOAT4 zero;
+	XMStoreFloat4(&zero, VertexCompression::OctEncode(XMVectorZero()));
+	CHECK(zero.x == 0.0f && zero.y == 0.0f);
+
+	MeshData mesh = RandomFrames(100);
+	for(size_t i = 0; i < mesh.Vertices.size(); i += 2)
+	{
+		mesh.Vertices[i].Normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		mesh.Vertices[i].TangentU = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	}
+
+	for(FrameFormat frame : FrameFormats)
+	{
+		VertexCompression::VertexFormat format;
+		format.Frame = frame;
+
+		VertexCompression::EncodedMesh encoded = VertexCompression::Encode(mesh, format);
+		CHECK(encoded.MaxError.Normal <= FrameBound(frame));
+		CHECK(encoded.MaxError.Tangent <= FrameBound(frame));
+
+		std::vector<Vertex> decoded;
+		VertexCompression::Decode(encoded, decoded);
+		for(const Vertex& v : decoded)
+			CHECK(IsFinite(v));
+	}
+}
+
+TEST(VertexCompression_FlatBoxes)
+{
+	// A grid is flat in y; UNorm16 keeps a unit scale there and every
+	// height decodes exactly.
+	GeometryGenerator geoGen;
+	MeshData grid = geoGen.CreateGrid(10.0f, 20.0f, 11, 21);
+
+	VertexCompression::VertexFormat format;
+	format.Position = PositionFormat::UNorm16;
+
+	VertexCompression::EncodedMesh encoded = VertexCompression::Encode(grid, format);
+	CHECK(encoded.Transform.Scale.y == 1.0f);
+	CHECK(encoded.MaxError.Position <= PositionBound(PositionFormat::UNorm16));
+
+	std::vector<Vertex> decoded;
+	VertexCompression::Decode(encoded, decoded);
+	for(const Vertex& v : decoded)
+	{
+		CHECK(IsFinite(v));
+		CHECK(v.Position.y == 0.0f);
+	}
+
+	// Every vertex at one point: a zero box in all three axes.
+	MeshData point = RandomFrames(10);
+	for(Vertex& v : point.Vertices)
+		v.Position = XMFLOAT3(1.5f, -2.0f, 3.25f);
+
+	for(PositionFormat position : PositionFormats)
+	{
+		format.Position = position;
+		encoded = VertexCompression::Encode(point, format);
+		CHECK(encoded.MaxError.Position == 0.0f);
+
+		VertexCompression::Decode(encoded, decoded);
+		for(const Vertex& v : decoded)
+		{
+			CHECK(IsFinite(v));
+			CHECK(v.Position.x == 1.5f && v.Position.y == -2.0f && v.Position.z == 3.25f);
+		}
+	}
+
+	// No vertices at all.
+	encoded = VertexCompression::Encode(MeshData(), format);
+	CHECK(encoded.VertexCount == 0);
+	CHECK(encoded.Data.empty());
+}
+
+TEST(VertexCompression_OctFold)
+{
+	// The lower half of the octahedron folds over the upper half's diagonals;
+	// check the fold's corners and edges, every sign of x and y, and random
+	// directions below the equator.
+	std::vector<XMVECTOR> directions =
+	{
+		XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f),
+		XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f),
+		XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f),
+		XMVectorSet(-1.0f, 0.0f, 0.0f, 0.0f),
+		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f),
+		XMVectorSet(0.0f, -1.0f, 0.0f, 0.0f),
+		XMVectorSet(1.0f, 0.0f, -1.0f, 0.0f),
+		XMVectorSet(0.0f, -1.0f, -1.0f, 0.0f),
+		XMVectorSet(1e-6f, 0.0f, -1.0f, 0.0f),
+		XMVectorSet(0.0f, 1e-6f, -1.0f, 0.0f),
+	};
+
+	for(float x : { -0.3f, 0.3f })
+	{
+		for(float y : { -0.4f, 0.4f })
+			directions.push_back(XMVectorSet(x, y, -0.8f, 0.0f));
+	}
+
+	std::mt19937 rng(11);
+	std::normal_distribution<float> normal;
+	for(int i = 0; i < 10000; ++i)
+		directions.push_back(XMVectorSet(normal(rng), normal(rng), -fabsf(normal(rng)), 0.0f));
+
+	for(XMVECTOR d : directions)
+	{
+		XMVECTOR n = XMVector3Normalize(d);
+
+		XMFLOAT4 e;
+		XMStoreFloat4(&e, VertexCompression::OctEncode(n));
+		CHECK(fabsf(e.x) <= 1.0f && fabsf(e.y) <= 1.0f);
+		CHECK(e.z == 0.0f && e.w == 0.0f);
+
+		XMFLOAT3 a, b;
+		XMStoreFloat3(&a, n);
+		XMStoreFloat3(&b, VertexCompression::OctDecode(XMLoadFloat4(&e)));
+		CHECK(Angle(a, b) <= 1e-5f);
+		CHECK(fabsf(XMVectorGetX(XMVector3Length(XMLoadFloat3(&b))) - 1.0f) <= 1e-5f);
+	}
+
+	// The same directions quantized: the folded half meets the format bounds.
+	MeshData mesh;
+	for(XMVECTOR d : directions)
+	{
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, XMVector3Normalize(d));
+		mesh.Vertices.push_back(Vertex(XMFLOAT3(0.0f, 0.0f, 0.0f), n, n, XMFLOAT2(0.0f, 0.0f)));
+	}
+
+	for(FrameFormat frame : FrameFormats)
+	{
+		VertexCompression::VertexFormat format;
+		format.Frame = frame;
+		VertexCompression::ErrorBounds error = VertexCompression::Encode(mesh, format).MaxError;
+		CHECK(error.Normal <= FrameBound(frame));
+		CHECK(error.Tangent <= FrameBound(frame));
+	}
+}
+
+TEST(VertexCompression_PackColor)
+{
+	// Red in the low byte, as R8G8B8A8_UNORM reads it.
+	CHECK(VertexCompression::PackColor(XMFLOAT4(1.0f, 0.0f, 0.0f, 0.0f)) == 0x000000ffu);
+	CHECK(VertexCompression::PackColor(XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f)) == 0xff000000u);
+	CHECK(VertexCompression::PackColor(XMFLOAT4(1.0f, 0.5f, 0.0f, 1.0f)) == 0xff0080ffu);
+
+	// Out of range values saturate.
+	CHECK(VertexCompression::PackColor(XMFLOAT4(-1.0f, 2.0f, -0.5f, 1.5f)) == 0xff00ff00u);
+
+	// Every 8 bit value survives the round trip exactly.
+	std::vector<XMFLOAT4> colors;
+	for(uint32 k = 0; k < 256; ++k)
+	{
+		float c = k / 255.0f;
+		XMFLOAT4 color(c, 1.0f - c, c, 1.0f);
+		colors.push_back(color);
+
+		uint32 packed = VertexCompression::PackColor(color);
+		CHECK((packed & 0xff) == k);
+
+		XMFLOAT4 unpacked = VertexCompression::UnpackColor(packed);
+		CHECK(fabsf(unpacked.x - color.x) <= 1e-6f);
+		CHECK(fabsf(unpacked.y - color.y) <= 1e-6f);
+		CHECK(fabsf(unpacked.z - color.z) <= 1e-6f);
+		CHECK(unpacked.w == 1.0f);
+	}
+
+	std::vector<uint32> packed(colors.size());
+	VertexCompression::PackColors(colors.data(), packed.data(), colors.size());
+	for(size_t i = 0; i < colors.size(); ++i)
+		CHECK(packed[i] == VertexCompression::PackColor(colors[i]));
+}